@@ -57,14 +57,31 @@ libsamsung_ipc_local_src_files := \
 	samsung-ipc/call.c \
 	samsung-ipc/gen.c \
 	samsung-ipc/gprs.c \
+	samsung-ipc/gprs_session.c \
 	samsung-ipc/ipc.c \
+	samsung-ipc/ipc_arena.c \
+	samsung-ipc/ipc_capture.c \
+	samsung-ipc/ipc_coalesce.c \
+	samsung-ipc/ipc_counters.c \
+	samsung-ipc/ipc_input.c \
+	samsung-ipc/ipc_loopback.c \
+	samsung-ipc/ipc_netlink.c \
+	samsung-ipc/ipc_output.c \
+	samsung-ipc/ipc_scheduler.c \
+	samsung-ipc/ipc_state.c \
+	samsung-ipc/ipc_stats.c \
 	samsung-ipc/ipc_strings.c \
+	samsung-ipc/ipc_submit.c \
+	samsung-ipc/ipc_uring.c \
 	samsung-ipc/ipc_utils.c \
 	samsung-ipc/misc.c \
 	samsung-ipc/net.c \
 	samsung-ipc/rfs.c \
 	samsung-ipc/sec.c \
+	samsung-ipc/sec_rsim_cache.c \
 	samsung-ipc/sms.c \
+	samsung-ipc/sms_pdu.c \
+	samsung-ipc/sms_pipeline.c \
 	samsung-ipc/svc.c \
 	samsung-ipc/utils.c \
 	samsung-ipc/devices/ipc_devices.c \
@@ -169,7 +186,7 @@ include $(LOCAL_PATH)/android_versions.mk
 LOCAL_MODULE := ipc-modem
 LOCAL_MODULE_TAGS := optional
 
-LOCAL_SRC_FILES := tools/ipc-modem.c
+LOCAL_SRC_FILES := tools/ipc-modem.c tools/common/event_loop.c
 
 LOCAL_C_INCLUDES := $(LOCAL_PATH)/include
 LOCAL_SHARED_LIBRARIES := libsamsung-ipc
@@ -185,13 +202,31 @@ include $(LOCAL_PATH)/android_versions.mk
 LOCAL_MODULE := ipc-imei
 LOCAL_MODULE_TAGS := optional
 
-LOCAL_SRC_FILES := tools/ipc-imei.c tools/common/modem.c
+LOCAL_SRC_FILES := tools/ipc-imei.c tools/common/event_loop.c \
+	tools/common/modem.c
 
 LOCAL_C_INCLUDES := $(LOCAL_PATH)/include $(LOCAL_PATH)/tools/include/glibc
 LOCAL_SHARED_LIBRARIES := libsamsung-ipc
 
 include $(BUILD_EXECUTABLE)
 
+###################
+# ipc-replay tool #
+###################
+include $(CLEAR_VARS)
+include $(LOCAL_PATH)/android_versions.mk
+
+LOCAL_MODULE := ipc-replay
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_SRC_FILES := tools/ipc-replay.c
+
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/include $(LOCAL_PATH)/tools/include/glibc
+
+LOCAL_SHARED_LIBRARIES := libsamsung-ipc
+
+include $(BUILD_EXECUTABLE)
+
 #################
 # ipc-test tool #
 #################
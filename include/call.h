@@ -147,6 +147,10 @@ int ipc_call_outgoing_setup(struct ipc_call_outgoing_data *data,
 unsigned char ipc_call_list_count_extract(const void *data, size_t size);
 struct ipc_call_list_entry *ipc_call_list_entry_extract(
 	const void *data, size_t size, unsigned int index);
+int ipc_call_list_iterator_setup(struct ipc_list_iterator *iterator,
+				 const void *data, size_t size);
+struct ipc_call_list_entry *ipc_call_list_iterator_next(
+	struct ipc_list_iterator *iterator);
 char *ipc_call_list_entry_number_extract(
 	const struct ipc_call_list_entry *entry);
 size_t ipc_call_burst_dtmf_size_setup(
@@ -86,6 +86,14 @@
 #define IPC_GPRS_STATUS_ENABLED				0x01
 #define IPC_GPRS_STATUS_DISABLED				0x03
 
+#define IPC_GPRS_SESSION_STATE_IDLE				0x00
+#define IPC_GPRS_SESSION_STATE_DEFINING			0x01
+#define IPC_GPRS_SESSION_STATE_ACTIVATING			0x02
+#define IPC_GPRS_SESSION_STATE_CONFIGURING			0x03
+#define IPC_GPRS_SESSION_STATE_ACTIVE				0x04
+#define IPC_GPRS_SESSION_STATE_RETRY_WAIT			0x05
+#define IPC_GPRS_SESSION_STATE_FAILED				0x06
+
 /*
  * Structures
  */
@@ -155,6 +163,17 @@ struct ipc_gprs_port_list_data {
 	unsigned char magic[804];
 } __attribute__((__packed__));
 
+struct ipc_gprs_session;
+
+struct ipc_gprs_session_status {
+	unsigned int cid;
+	unsigned char state;		/* IPC_GPRS_SESSION_STATE */
+	unsigned short fail_cause;	/* IPC_GPRS_FAIL_CAUSE */
+	unsigned int attempts;
+	unsigned long latency;		/* ms from activation to ACTIVE */
+	struct ipc_gprs_ip_configuration_data ip_configuration;
+};
+
 /*
  * Helpers
  */
@@ -168,4 +187,26 @@ int ipc_gprs_pdp_context_request_set_setup(
 	const char *password);
 int ipc_gprs_port_list_setup(struct ipc_gprs_port_list_data *data);
 
+struct ipc_gprs_session *ipc_gprs_session_create(
+	struct ipc_client *client, unsigned int retries, unsigned int timeout,
+	unsigned int retry_delay, unsigned char (*seq_get)(void *data),
+	void *seq_data,
+	void (*callback)(void *data,
+			 const struct ipc_gprs_session_status *status),
+	void *callback_data);
+void ipc_gprs_session_destroy(struct ipc_gprs_session *session);
+int ipc_gprs_session_activate(struct ipc_gprs_session *session,
+			      unsigned int cid, const char *apn,
+			      const char *username, const char *password);
+int ipc_gprs_session_deactivate(struct ipc_gprs_session *session,
+				unsigned int cid);
+int ipc_gprs_session_handle(struct ipc_gprs_session *session,
+			    const struct ipc_message *message);
+int ipc_gprs_session_timeouts_check(struct ipc_gprs_session *session);
+int ipc_gprs_session_timeout_get(struct ipc_gprs_session *session,
+				 struct timeval *timeout);
+int ipc_gprs_session_status_get(struct ipc_gprs_session *session,
+				unsigned int cid,
+				struct ipc_gprs_session_status *status);
+
 #endif /* __SAMSUNG_IPC_GPRS_H__ */
@@ -86,7 +86,11 @@ struct ipc_misc_time_info_data {
  */
 
 int ipc_misc_me_version_setup(struct ipc_misc_me_version_request_data *data);
+int ipc_misc_me_imsi_imsi_view(const void *data, size_t size,
+			       struct ipc_data_view *view);
 char *ipc_misc_me_imsi_imsi_extract(const void *data, size_t size);
+int ipc_misc_me_sn_view(const void *data, size_t size,
+			struct ipc_data_view *view);
 char *ipc_misc_me_sn_extract(const struct ipc_misc_me_sn_response_data *data);
 
 #endif /*  __SAMSUNG_IPC_MISC_H__ */
@@ -136,8 +136,17 @@ int ipc_net_plmn_sel_setup(struct ipc_net_plmn_sel_request_data *data,
 			   unsigned char act);
 int ipc_net_regist_setup(struct ipc_net_regist_request_data *data,
 			 unsigned char domain);
+int ipc_net_serving_network_plmn_view(const void *data, size_t size,
+				      struct ipc_data_view *view);
+int ipc_net_plmn_list_entry_plmn_view(
+	const struct ipc_net_plmn_list_entry *entry,
+	struct ipc_data_view *view);
 unsigned char ipc_net_plmn_list_count_extract(const void *data, size_t size);
 struct ipc_net_plmn_list_entry *ipc_net_plmn_list_entry_extract(
 	const void *data, size_t size, unsigned int index);
+int ipc_net_plmn_list_iterator_setup(struct ipc_list_iterator *iterator,
+				     const void *data, size_t size);
+struct ipc_net_plmn_list_entry *ipc_net_plmn_list_iterator_next(
+	struct ipc_list_iterator *iterator);
 
 #endif /* __SAMSUNG_IPC_NET_H__ */
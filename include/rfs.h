@@ -63,10 +63,22 @@ struct ipc_rfs_nv_write_item_response_data {
 	unsigned int length;
 } __attribute__((__packed__));
 
+struct ipc_nv_data_md5_context;
+
 /*
  * Helpers
  */
 
+struct ipc_nv_data_md5_context *ipc_nv_data_md5_context_create(
+	struct ipc_client *client);
+void ipc_nv_data_md5_context_destroy(struct ipc_nv_data_md5_context *context);
+int ipc_nv_data_md5_update(struct ipc_nv_data_md5_context *context,
+			   const void *data, size_t size);
+char *ipc_nv_data_md5_final(struct ipc_nv_data_md5_context *context,
+			    const char *secret);
+char *ipc_nv_data_md5_data_calculate(struct ipc_client *client,
+				     const void *data, size_t size,
+				     const char *secret);
 char *ipc_nv_data_md5_calculate(struct ipc_client *client, const char *path,
 				const char *secret, size_t size,
 				size_t chunk_size);
@@ -89,6 +101,9 @@ size_t ipc_rfs_nv_data_item_size_setup(
 void *ipc_rfs_nv_read_item_setup(
 	struct ipc_rfs_nv_read_item_response_header *header,
 	const void *nv_data, size_t nv_size);
+size_t ipc_rfs_nv_read_item_setup_into(
+	struct ipc_rfs_nv_read_item_response_header *header,
+	const void *nv_data, size_t nv_size, void *buffer, size_t buffer_size);
 size_t ipc_rfs_nv_write_item_size_extract(const void *data, size_t size);
 void *ipc_rfs_nv_write_item_extract(const void *data, size_t size);
 
@@ -25,6 +25,7 @@
 #include <stddef.h>
 #include <unistd.h>
 
+#include <time.h>
 #include <sys/time.h>
 
 /*
@@ -35,6 +36,42 @@
 #define IPC_CLIENT_TYPE_RFS					0x01
 #define IPC_CLIENT_TYPE_DUMMY					0x02
 
+#define IPC_CLIENT_SEND_QUEUED					1
+#define IPC_CLIENT_RECV_TIMEOUT					1
+#define IPC_CLIENT_URING_UNAVAILABLE				1
+
+#define IPC_CLIENT_ARENA_SIZE					0x1000
+#define IPC_CLIENT_ARENA_ALIGN					16
+
+#define IPC_CLIENT_STATE_RSSI					0x00
+#define IPC_CLIENT_STATE_HDR_RSSI				0x01
+#define IPC_CLIENT_STATE_BATTERY				0x02
+#define IPC_CLIENT_STATE_REGIST_GSM				0x03
+#define IPC_CLIENT_STATE_REGIST_GPRS				0x04
+#define IPC_CLIENT_STATE_SERVING_NETWORK			0x05
+#define IPC_CLIENT_STATE_HSDPA_STATUS				0x06
+#define IPC_CLIENT_STATE_COUNT					7
+
+#define IPC_CLIENT_STATE_MASK(field)				(1 << (field))
+#define IPC_CLIENT_STATE_MASK_ALL				0x7F
+
+#define IPC_CLIENT_PRIORITY_CALL				0x00
+#define IPC_CLIENT_PRIORITY_SEC					0x01
+#define IPC_CLIENT_PRIORITY_NET					0x02
+#define IPC_CLIENT_PRIORITY_BULK				0x03
+#define IPC_CLIENT_PRIORITY_COUNT				4
+
+#define IPC_CLIENT_STATS_COMMANDS				64
+#define IPC_CLIENT_STATS_BUCKETS				240
+
+#define IPC_CAPTURE_MAGIC					"SIPC"
+#define IPC_CAPTURE_VERSION					1
+#define IPC_CAPTURE_DIRECTION_SEND				0x00
+#define IPC_CAPTURE_DIRECTION_RECV				0x01
+
+#define IPC_DATA_DUMP_LINE_BYTES				16
+#define IPC_DATA_DUMP_LINE_LENGTH				81
+
 /*
  * Structures
  */
@@ -63,12 +100,163 @@ struct ipc_poll_fds {
 	unsigned int count;
 };
 
+/*
+ * Views point into the message data instead of copying it: they are only
+ * valid as long as the message data is.
+ */
+struct ipc_data_view {
+	const void *data;
+	size_t size;
+};
+
+/*
+ * Iterators over the lists of entries of a message. The whole message is
+ * validated once when the iterator is set up, so walking the entries only
+ * costs a pointer increment per entry.
+ */
+struct ipc_list_iterator {
+	const unsigned char *data;
+	size_t size;
+	size_t offset;
+	unsigned int count;
+	unsigned int index;
+};
+
+struct ipc_client_coalesce_stats {
+	unsigned long received;
+	unsigned long dropped;
+	unsigned int queued;
+};
+
+struct ipc_client_state_regist {
+	unsigned char act;		/* IPC_NET_ACCESS_TECHNOLOGY */
+	unsigned char status;		/* IPC_NET_REGISTRATION_STATUS */
+	unsigned char edge;
+	unsigned short lac;
+	unsigned int cid;
+	unsigned char fail_cause;
+};
+
+/*
+ * The timestamps are in milliseconds of CLOCK_MONOTONIC, and a field is only
+ * meaningful when its IPC_CLIENT_STATE_MASK bit is set in valid.
+ */
+struct ipc_client_state {
+	unsigned int valid;
+	unsigned long long timestamps[IPC_CLIENT_STATE_COUNT];
+
+	unsigned char rssi;
+	unsigned char hdr_rssi;
+	unsigned char battery;
+	struct ipc_client_state_regist regist_gsm;
+	struct ipc_client_state_regist regist_gprs;
+	char plmn[7];
+	unsigned short lac;
+	unsigned char hsdpa_status;	/* IPC_GPRS_HSDPA_STATUS */
+};
+
+/* The delays are in microseconds */
+struct ipc_client_scheduler_stats {
+	unsigned int queued;
+	unsigned int outstanding;
+	unsigned long sent;
+	unsigned long expired;
+	unsigned long long delay_total;
+	unsigned long long delay_max;
+};
+
+/* The enqueue times are in nanoseconds, the delays in microseconds */
+struct ipc_client_submit_stats {
+	unsigned long long depth;
+	unsigned long long depth_max;
+	unsigned long long submitted;
+	unsigned long long sent;
+	unsigned long long done;
+	unsigned long long enqueue_total;
+	unsigned long long enqueue_max;
+	unsigned long long delay_total;
+	unsigned long long delay_max;
+};
+
+/*
+ * The enters are the io_uring_enter calls, that submit the queued writes and
+ * wait for the completions, and the polls are only made when other fds are
+ * polled along. The reads and writes are the completions, and the arms are
+ * the multishot reads that were posted.
+ */
+struct ipc_client_uring_stats {
+	unsigned long long enters;
+	unsigned long long polls;
+	unsigned long long reads;
+	unsigned long long writes;
+	unsigned long long arms;
+};
+
+/* The bytes include the fmt or rfs header of the frames */
+struct ipc_client_counters {
+	unsigned long long frames_in;
+	unsigned long long frames_out;
+	unsigned long long bytes_in;
+	unsigned long long bytes_out;
+	unsigned long long reads;
+	unsigned long long writes;
+	unsigned long long partial_reads;
+	unsigned long long allocations;
+	unsigned long long parse_errors;
+	unsigned long long transport_errors;
+	unsigned long long poll_wakeups;
+};
+
+/* The round trip times are in microseconds */
+struct ipc_client_stats {
+	unsigned short command;
+	unsigned long count;
+	unsigned long unanswered;
+	unsigned long long total;
+	unsigned long long min;
+	unsigned long long max;
+	unsigned long long p50;
+	unsigned long long p90;
+	unsigned long long p99;
+};
+
+struct ipc_capture_header {
+	char magic[4];			/* IPC_CAPTURE_MAGIC */
+	unsigned short version;
+	unsigned short reserved;
+} __attribute__((__packed__));
+
+/* Followed by the raw fmt or rfs header, then by the data */
+struct ipc_capture_record {
+	unsigned long long timestamp;	/* Microseconds since the capture start */
+	unsigned char direction;	/* IPC_CAPTURE_DIRECTION */
+	unsigned char client_type;	/* IPC_CLIENT_TYPE */
+	unsigned short header_size;
+	unsigned int data_size;
+} __attribute__((__packed__));
+
+struct ipc_netlink_link_event {
+	char iface[16];
+	unsigned int index;
+	unsigned int flags;		/* IFF_UP, IFF_RUNNING, ... */
+	int removed;
+};
+
 /*
  * Helpers
  */
 
 int ipc_device_detect(void);
 
+/*
+ * Each client belongs to the thread that drives it: sending, receiving,
+ * polling and the optional features of a client must not be used from
+ * several threads at once, but different clients can be used from different
+ * threads without any locking. The handlers must be registered before the
+ * client is opened, while the log callback can be replaced at any time. The
+ * counters and the state store can be read from any thread, and the messages
+ * can be submitted from any thread once the submission queue is enabled.
+ */
 struct ipc_client *ipc_client_create(int type);
 int ipc_client_destroy(struct ipc_client *client);
 
@@ -83,6 +271,27 @@ int ipc_client_transport_handlers_register(
 	int (*poll)(struct ipc_client *client, void *transport_data,
 		    struct ipc_poll_fds *fds, struct timeval *timeout),
 	void *transport_data);
+/*
+ * The loopback transport connects the client to the returned socket instead
+ * of the modem, which is then used to play the modem side, for instance in
+ * tests. The returned socket belongs to the caller.
+ */
+int ipc_client_loopback_open(struct ipc_client *client);
+/*
+ * The io_uring transport takes over the reads, writes and polls of the
+ * registered transport, on the same fd: a multishot read stays posted into a
+ * ring of provided buffers, so that receiving takes no read call, and each
+ * write is submitted along with the pending requests, and completed in order
+ * before the next one. ipc_client_uring_submit submits the pending requests
+ * without waiting. It must be enabled after the transport handlers are
+ * registered and the transport data is created. IPC_CLIENT_URING_UNAVAILABLE
+ * is returned, and the transport is left as is, when the kernel or the
+ * transport doesn't support it.
+ */
+int ipc_client_uring_enable(struct ipc_client *client);
+int ipc_client_uring_submit(struct ipc_client *client);
+int ipc_client_uring_stats_get(struct ipc_client *client,
+			       struct ipc_client_uring_stats *stats);
 int ipc_client_power_handlers_register(
 	struct ipc_client *client,
 	int (*power_on)(struct ipc_client *client, void *power_data),
@@ -102,16 +311,199 @@ int ipc_client_log_callback_register(
 	void (*log_callback)(void *log_data, const char *message),
 	void *log_data);
 
+/*
+ * Memory returned by ipc_client_arena_alloc is only valid until the next
+ * ipc_client_send or ipc_client_arena_reset call on the same client: the
+ * arena is reset after each message is sent.
+ */
+int ipc_client_arena_create(struct ipc_client *client, size_t size);
+int ipc_client_arena_destroy(struct ipc_client *client);
+void *ipc_client_arena_alloc(struct ipc_client *client, size_t size);
+void ipc_client_arena_reset(struct ipc_client *client);
+
+/*
+ * Network interfaces are managed through a rtnetlink socket that is kept
+ * open for the lifetime of the client, falling back to network_iface_up and
+ * network_iface_down when rtnetlink isn't usable. Between batch begin and
+ * commit, the requests are only queued and then sent at once. When the
+ * security policy denies them, the link changes of the batch are replayed
+ * through ioctl, but the addresses are not and the commit fails.
+ */
+int ipc_client_netlink_open(struct ipc_client *client);
+int ipc_client_netlink_close(struct ipc_client *client);
+int ipc_client_netlink_batch_begin(struct ipc_client *client);
+int ipc_client_netlink_batch_commit(struct ipc_client *client);
+int ipc_client_iface_up(struct ipc_client *client, const char *iface,
+			int domain, int type);
+int ipc_client_iface_down(struct ipc_client *client, const char *iface,
+			  int domain, int type);
+int ipc_client_iface_address_add(struct ipc_client *client, const char *iface,
+				 int family, const void *address,
+				 unsigned char prefix_length);
+int ipc_client_netlink_subscribe(struct ipc_client *client);
+int ipc_client_netlink_event_read(struct ipc_client *client,
+				  struct ipc_netlink_link_event *events,
+				  unsigned int count);
+
+/*
+ * When coalescing is enabled, ipc_client_recv reads all the messages that
+ * are already available and queues them. An IPC_TYPE_NOTI or IPC_TYPE_INDI
+ * message with one of the given commands then replaces the older one that
+ * is still queued, and ipc_client_poll returns right away as long as the
+ * queue isn't empty, with the other fds that are already readable.
+ */
+int ipc_client_coalesce_set(struct ipc_client *client,
+			    const unsigned short *commands,
+			    unsigned int count);
+int ipc_client_coalesce_stats_get(struct ipc_client *client,
+				  struct ipc_client_coalesce_stats *stats);
+int ipc_client_coalesce_dropped_get(struct ipc_client *client,
+				    unsigned short command,
+				    unsigned long *dropped);
+
+/*
+ * When the state store is enabled, ipc_client_recv keeps the last known
+ * values that the modem reported in its notifications and responses, so that
+ * they can be read back without sending a request. Getting the state never
+ * blocks the receive path, and can be done from any thread. The subscribers
+ * are called from ipc_client_recv with the mask of the changed fields, and
+ * can subscribe or unsubscribe from any thread: a callback that is being
+ * called when it is unsubscribed may still be called that one last time.
+ */
+int ipc_client_state_enable(struct ipc_client *client);
+int ipc_client_state_get(struct ipc_client *client,
+			 struct ipc_client_state *state);
+int ipc_client_state_subscribe(
+	struct ipc_client *client, unsigned int mask,
+	void (*callback)(void *data, unsigned int changed,
+			 const struct ipc_client_state *state),
+	void *data);
+int ipc_client_state_unsubscribe(struct ipc_client *client, int id);
+
+/*
+ * With the output queue enabled, the send ops don't wait for the transport to
+ * accept the whole frame: what couldn't be written is queued, and
+ * ipc_client_send returns IPC_CLIENT_SEND_QUEUED. The queue is written by
+ * ipc_client_output_flush, which returns the count of bytes left, and the
+ * poll handlers flush it when the transport becomes writable, and then go on
+ * waiting for input until the timeout expires. The callback is called when
+ * the queued bytes go above the high watermark, and again when they go back
+ * below it.
+ */
+int ipc_client_output_enable(struct ipc_client *client, size_t high_watermark,
+			     void (*callback)(void *data, size_t queued),
+			     void *data);
+int ipc_client_output_flush(struct ipc_client *client);
+size_t ipc_client_output_pending(struct ipc_client *client);
+
+/*
+ * When the scheduler is enabled, ipc_client_queue only queues the message in
+ * the queue of its priority class, and ipc_client_scheduler_drain sends the
+ * queued messages, highest priority first. The limits give the maximum
+ * number of requests of each class that can be waiting for a response, 0
+ * meaning no limit, and the timeout in milliseconds after which a request
+ * that got no response isn't counted anymore. Without the scheduler,
+ * ipc_client_queue sends the message right away.
+ */
+int ipc_client_priority_get(unsigned short command);
+int ipc_client_scheduler_enable(struct ipc_client *client,
+				const unsigned int *limits,
+				unsigned int timeout);
+int ipc_client_queue(struct ipc_client *client, unsigned char mseq,
+		     unsigned short command, unsigned char type,
+		     const void *data, size_t size);
+int ipc_client_scheduler_drain(struct ipc_client *client);
+int ipc_client_scheduler_stats_get(struct ipc_client *client,
+				   unsigned int priority,
+				   struct ipc_client_scheduler_stats *stats);
+
+/*
+ * With the submission queue enabled, several threads can send on the same
+ * client without any lock: ipc_client_submit copies the message into a frame
+ * of the queue and gives its token, and a single writer thread sends the
+ * queued frames in order with ipc_client_submit_drain. The fd becomes
+ * readable when frames are submitted to an empty queue, so that the writer
+ * can poll it along with the transport. A frame that couldn't be sent stays
+ * in the queue for the next drain. A token is done once its frame and all the
+ * frames with lower tokens were sent.
+ */
+int ipc_client_submit_enable(struct ipc_client *client);
+int ipc_client_submit_fd(struct ipc_client *client);
+int ipc_client_submit(struct ipc_client *client, unsigned char mseq,
+		      unsigned short command, unsigned char type,
+		      const void *data, size_t size,
+		      unsigned long long *token);
+int ipc_client_submit_drain(struct ipc_client *client);
+int ipc_client_submit_done(struct ipc_client *client,
+			   unsigned long long token);
+int ipc_client_submit_stats_get(struct ipc_client *client,
+				struct ipc_client_submit_stats *stats);
+
+/*
+ * The counters of each client are always maintained, and can be read and
+ * reset from any thread. The reads and writes are the calls to the transport
+ * handlers, and the partial reads are the receives that only got a part of a
+ * frame. The allocations are the ones made on the send and receive paths,
+ * including the data of the received messages.
+ */
+int ipc_client_counters_get(struct ipc_client *client,
+			    struct ipc_client_counters *counters);
+int ipc_client_counters_reset(struct ipc_client *client);
+
+/*
+ * When the stats are enabled, the time between each request and its response
+ * is recorded in a histogram of its command, for up to
+ * IPC_CLIENT_STATS_COMMANDS commands. ipc_client_stats_get returns the count
+ * of commands with stats, and fills at most count of them. The histograms
+ * have IPC_CLIENT_STATS_BUCKETS buckets, and ipc_client_stats_bucket_value
+ * gives the highest value of a bucket. The requests that got no response
+ * before their sequence was used again are counted as unanswered.
+ */
+int ipc_client_stats_enable(struct ipc_client *client);
+int ipc_client_stats_reset(struct ipc_client *client);
+int ipc_client_stats_get(struct ipc_client *client,
+			 struct ipc_client_stats *stats, unsigned int count);
+int ipc_client_stats_histogram_get(struct ipc_client *client,
+				   unsigned short command,
+				   unsigned int *buckets);
+unsigned long long ipc_client_stats_bucket_value(unsigned int bucket);
+unsigned long ipc_client_stats_dropped_get(struct ipc_client *client);
+
+/*
+ * While a capture is open, the messages that are sent and received by the
+ * client are written to the capture file, with their raw header and the
+ * time at which they went through ipc_client_send or ipc_client_recv. The
+ * ipc-replay tool plays such a capture file back.
+ */
+int ipc_client_capture_open(struct ipc_client *client, const char *path);
+int ipc_client_capture_close(struct ipc_client *client);
+
 int ipc_client_boot(struct ipc_client *client);
 int ipc_client_send(struct ipc_client *client, unsigned char mseq,
 		    unsigned short command, unsigned char type,
 		    const void *data, size_t size);
 int ipc_client_recv(struct ipc_client *client, struct ipc_message *message);
 
+/*
+ * The deadlines are absolute CLOCK_MONOTONIC times, that can be set from a
+ * timeout in milliseconds with ipc_client_deadline_set, or NULL to wait with
+ * no limit. The wait goes on across interrupted system calls, and
+ * ipc_client_recv_deadline returns IPC_CLIENT_RECV_TIMEOUT when the deadline
+ * is reached: the part of the frame that was already received is kept for
+ * the next receive.
+ */
+int ipc_client_deadline_set(struct timespec *deadline, unsigned int timeout);
+int ipc_client_recv_deadline(struct ipc_client *client,
+			     struct ipc_message *message,
+			     const struct timespec *deadline);
+
 int ipc_client_open(struct ipc_client *client);
 int ipc_client_close(struct ipc_client *client);
 int ipc_client_poll(struct ipc_client *client, struct ipc_poll_fds *fds,
 		    struct timeval *timeout);
+int ipc_client_poll_deadline(struct ipc_client *client,
+			     struct ipc_poll_fds *fds,
+			     const struct timespec *deadline);
 int ipc_client_power_on(struct ipc_client *client);
 int ipc_client_power_off(struct ipc_client *client);
 int ipc_client_gprs_activate(struct ipc_client *client, unsigned int cid);
@@ -140,6 +532,8 @@ const char *ipc_command_string(unsigned short command);
 const char *ipc_group_string(unsigned char group);
 const char *ipc_client_type_string(unsigned char client_type);
 
+int ipc_data_dump_line(const void *data, size_t size, size_t offset,
+		       char *line, size_t length);
 int ipc_data_dump(struct ipc_client *client, const void *data, size_t size);
 void ipc_client_log_send(struct ipc_client *client, struct ipc_message *message,
 			 const char *prefix);
@@ -172,8 +566,11 @@ char *sysfs_string_read(const char *path, size_t length);
 int sysfs_string_write(const char *path, const char *buffer, size_t length);
 size_t data2string_length(const void *data, size_t size);
 char *data2string(const void *data, size_t size);
+int data2string_into(const void *data, size_t size, char *string,
+		     size_t length);
 size_t string2data_size(const char *string);
 void *string2data(const char *string);
+int string2data_into(const char *string, void *data, size_t size);
 
 /*
  * Samsung-IPC protocol
@@ -86,6 +86,10 @@
 #define IPC_SEC_SIM_CARD_TYPE_SIM					0x01
 #define IPC_SEC_SIM_CARD_TYPE_USIM					0x02
 
+#define IPC_SEC_RSIM_CACHE_SENT					0x00
+#define IPC_SEC_RSIM_CACHE_HIT						0x01
+#define IPC_SEC_RSIM_CACHE_JOINED					0x02
+
 /*
  * Structures
  */
@@ -162,6 +166,17 @@ struct ipc_sec_lock_information_response_data {
 	unsigned char retry_count;
 } __attribute__((__packed__));
 
+struct ipc_sec_rsim_cache;
+
+struct ipc_sec_rsim_cache_stats {
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long joined;
+	unsigned long invalidations;
+	unsigned int entries;
+	unsigned int pending;
+};
+
 /*
  * Helpers
  */
@@ -183,9 +198,33 @@ size_t ipc_sec_rsim_access_size_setup(
 void *ipc_sec_rsim_access_setup(
 	struct ipc_sec_rsim_access_request_header *header,
 	const void *sim_io_data, size_t sim_io_size);
+size_t ipc_sec_rsim_access_setup_into(
+	struct ipc_sec_rsim_access_request_header *header,
+	const void *sim_io_data, size_t sim_io_size, void *buffer,
+	size_t buffer_size);
+int ipc_sec_rsim_access_view(const void *data, size_t size,
+			     struct ipc_data_view *view);
 size_t ipc_sec_rsim_access_size_extract(const void *data, size_t size);
 void *ipc_sec_rsim_access_extract(const void *data, size_t size);
 int ipc_sec_lock_information_setup(
 	struct ipc_sec_lock_information_request_data *data, unsigned char type);
 
+struct ipc_sec_rsim_cache *ipc_sec_rsim_cache_create(
+	struct ipc_client *client, unsigned int count, unsigned int timeout,
+	void (*callback)(void *data, unsigned char mseq, const void *response,
+			 size_t response_size),
+	void *callback_data);
+void ipc_sec_rsim_cache_destroy(struct ipc_sec_rsim_cache *cache);
+int ipc_sec_rsim_cache_request(
+	struct ipc_sec_rsim_cache *cache, unsigned char mseq,
+	struct ipc_sec_rsim_access_request_header *header,
+	const void *sim_io_data, size_t sim_io_size);
+int ipc_sec_rsim_cache_handle(struct ipc_sec_rsim_cache *cache,
+			      const struct ipc_message *message);
+int ipc_sec_rsim_cache_invalidate(struct ipc_sec_rsim_cache *cache,
+				  unsigned short file_id);
+int ipc_sec_rsim_cache_flush(struct ipc_sec_rsim_cache *cache);
+int ipc_sec_rsim_cache_stats_get(struct ipc_sec_rsim_cache *cache,
+				 struct ipc_sec_rsim_cache_stats *stats);
+
 #endif /* __SAMSUNG_IPC_SEC_H__ */
@@ -66,6 +66,22 @@
 #define IPC_SMS_STATUS_STO_UNSENT				0x03
 #define IPC_SMS_STATUS_STO_SENT				0x04
 
+#define IPC_SMS_PIPELINE_STATUS_SENT				0x00
+#define IPC_SMS_PIPELINE_STATUS_DELIVERED			0x01
+#define IPC_SMS_PIPELINE_STATUS_FAILED				0x02
+#define IPC_SMS_PIPELINE_STATUS_TIMEOUT			0x03
+#define IPC_SMS_PIPELINE_STATUS_REPORT_TIMEOUT			0x04
+
+#define IPC_SMS_PDU_ALPHABET_GSM7				0x00
+#define IPC_SMS_PDU_ALPHABET_8BIT				0x01
+#define IPC_SMS_PDU_ALPHABET_UCS2				0x02
+
+#define IPC_SMS_PDU_UDH_CONCAT_8				0x00
+#define IPC_SMS_PDU_UDH_CONCAT_16				0x08
+
+#define IPC_SMS_PDU_ADDRESS_SIZE				48
+#define IPC_SMS_PDU_TEXT_SIZE					1024
+
 /*
  * Structures
  */
@@ -131,6 +147,53 @@ struct ipc_sms_svc_center_addr_header {
 	unsigned char length;
 } __attribute__((__packed__));
 
+struct ipc_sms_pipeline;
+
+struct ipc_sms_pipeline_result {
+	unsigned char mseq;
+	unsigned char status;			/* IPC_SMS_PIPELINE_STATUS */
+	unsigned char reference;		/* TP-MR */
+	unsigned short ack;			/* IPC_SMS_ACK */
+	unsigned char report_status;		/* TP-ST */
+	unsigned long latency;			/* ms since the message was sent */
+};
+
+struct ipc_sms_pipeline_stats {
+	unsigned long submitted;
+	unsigned long sent;
+	unsigned long delivered;
+	unsigned long failed;
+	unsigned long timeouts;
+	unsigned int queued;
+	unsigned int outstanding;
+	unsigned int awaiting_report;
+	double rate;				/* sent messages per second */
+};
+
+struct ipc_sms_pdu_concat {
+	unsigned short reference;
+	unsigned char count;
+	unsigned char sequence;
+};
+
+struct ipc_sms_pdu_deliver {
+	char originator[IPC_SMS_PDU_ADDRESS_SIZE];
+	unsigned char originator_type;
+	unsigned char pid;
+	unsigned char dcs;
+	unsigned char alphabet;			/* IPC_SMS_PDU_ALPHABET */
+	unsigned char timestamp[7];
+	unsigned char user_data_length;		/* TP-UDL */
+	const unsigned char *user_data;
+	size_t user_data_size;
+	const unsigned char *header;		/* UDH without its length */
+	size_t header_size;
+	int concatenated;
+	struct ipc_sms_pdu_concat concat;
+};
+
+struct ipc_sms_pdu_concat_store;
+
 /*
  * Helpers
  */
@@ -141,6 +204,12 @@ size_t ipc_sms_send_msg_size_setup(
 void *ipc_sms_send_msg_setup(
 	struct ipc_sms_send_msg_request_header *header,
 	const void *smsc, size_t smsc_size, const void *pdu, size_t pdu_size);
+size_t ipc_sms_send_msg_setup_into(
+	struct ipc_sms_send_msg_request_header *header,
+	const void *smsc, size_t smsc_size, const void *pdu, size_t pdu_size,
+	void *buffer, size_t buffer_size);
+int ipc_sms_incoming_msg_pdu_view(const void *data, size_t size,
+				  struct ipc_data_view *view);
 size_t ipc_sms_incoming_msg_pdu_size_extract(const void *data, size_t size);
 void *ipc_sms_incoming_msg_pdu_extract(const void *data, size_t size);
 size_t ipc_sms_save_msg_size_setup(
@@ -149,9 +218,60 @@ size_t ipc_sms_save_msg_size_setup(
 void *ipc_sms_save_msg_setup(
 	struct ipc_sms_save_msg_request_header *header,
 	const void *smsc, size_t smsc_size, const void *pdu, size_t pdu_size);
+size_t ipc_sms_save_msg_setup_into(
+	struct ipc_sms_save_msg_request_header *header,
+	const void *smsc, size_t smsc_size, const void *pdu, size_t pdu_size,
+	void *buffer, size_t buffer_size);
 int ipc_sms_del_msg_setup(struct ipc_sms_del_msg_request_data *data,
 			  unsigned short index);
+int ipc_sms_svc_center_addr_smsc_view(const void *data, size_t size,
+				      struct ipc_data_view *view);
 size_t ipc_sms_svc_center_addr_smsc_size_extract(const void *data, size_t size);
 void *ipc_sms_svc_center_addr_smsc_extract(const void *data, size_t size);
 
+struct ipc_sms_pipeline *ipc_sms_pipeline_create(
+	struct ipc_client *client, unsigned int window, unsigned int timeout,
+	unsigned int report_timeout,
+	void (*callback)(void *data,
+			 const struct ipc_sms_pipeline_result *result),
+	void *callback_data);
+void ipc_sms_pipeline_destroy(struct ipc_sms_pipeline *pipeline);
+int ipc_sms_pipeline_submit(struct ipc_sms_pipeline *pipeline,
+			    unsigned char mseq, const void *smsc,
+			    size_t smsc_size, const void *pdu, size_t pdu_size);
+int ipc_sms_pipeline_flush(struct ipc_sms_pipeline *pipeline);
+int ipc_sms_pipeline_handle(struct ipc_sms_pipeline *pipeline,
+			    const struct ipc_message *message);
+int ipc_sms_pipeline_timeouts_check(struct ipc_sms_pipeline *pipeline);
+int ipc_sms_pipeline_timeout_get(struct ipc_sms_pipeline *pipeline,
+				 struct timeval *timeout);
+int ipc_sms_pipeline_stats_get(struct ipc_sms_pipeline *pipeline,
+			       struct ipc_sms_pipeline_stats *stats);
+
+size_t ipc_sms_pdu_gsm7_unpack(const void *data, size_t size, size_t fill,
+			       unsigned char *septets, size_t count);
+size_t ipc_sms_pdu_gsm7_pack(const unsigned char *septets, size_t count,
+			     size_t fill, void *buffer, size_t buffer_size);
+int ipc_sms_pdu_gsm7_utf8(const unsigned char *septets, size_t count,
+			  char *buffer, size_t buffer_size);
+int ipc_sms_pdu_utf8_gsm7(const char *text, unsigned char *septets,
+			  size_t count);
+int ipc_sms_pdu_ucs2_utf8(const void *data, size_t size, char *buffer,
+			  size_t buffer_size);
+int ipc_sms_pdu_utf8_ucs2(const char *text, void *buffer, size_t buffer_size);
+int ipc_sms_pdu_udh_concat_parse(const void *header, size_t size,
+				 struct ipc_sms_pdu_concat *concat);
+int ipc_sms_pdu_deliver_parse(const void *pdu, size_t size,
+			      struct ipc_sms_pdu_deliver *deliver);
+int ipc_sms_pdu_deliver_text(const struct ipc_sms_pdu_deliver *deliver,
+			     char *buffer, size_t buffer_size);
+
+struct ipc_sms_pdu_concat_store *ipc_sms_pdu_concat_store_create(
+	unsigned int count, unsigned int timeout);
+void ipc_sms_pdu_concat_store_destroy(struct ipc_sms_pdu_concat_store *store);
+int ipc_sms_pdu_concat_store_add(struct ipc_sms_pdu_concat_store *store,
+				 const struct ipc_sms_pdu_deliver *deliver,
+				 char **text, size_t *text_size);
+int ipc_sms_pdu_concat_store_expire(struct ipc_sms_pdu_concat_store *store);
+
 #endif /* __SAMSUNG_IPC_SMS_H__ */
@@ -128,5 +128,12 @@ unsigned char ipc_svc_display_screen_count_extract(
 	const void *data, size_t size);
 struct ipc_svc_display_screen_entry *ipc_svc_display_screen_extract(
 	const void *data, size_t size, unsigned int index);
+int ipc_svc_display_screen_iterator_setup(struct ipc_list_iterator *iterator,
+					  const void *data, size_t size);
+struct ipc_svc_display_screen_entry *ipc_svc_display_screen_iterator_next(
+	struct ipc_list_iterator *iterator);
+int ipc_svc_display_screen_entry_line_view(
+	const struct ipc_svc_display_screen_entry *entry,
+	struct ipc_data_view *view);
 
 #endif /* __SAMSUNG_IPC_SVC_H__ */
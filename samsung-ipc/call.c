@@ -65,7 +65,7 @@ struct ipc_call_list_entry *ipc_call_list_entry_extract(
 	struct ipc_call_list_entry *entry = NULL;
 	unsigned char count;
 	unsigned char i;
-	unsigned int offset;
+	size_t offset;
 
 	if (data == NULL)
 		return NULL;
@@ -77,6 +77,10 @@ struct ipc_call_list_entry *ipc_call_list_entry_extract(
 	offset = sizeof(struct ipc_call_list_header);
 
 	for (i = 0; i < (index + 1); i++) {
+		/* The entry header must fit before number_length is read */
+		if (offset + sizeof(struct ipc_call_list_entry) > size)
+			return NULL;
+
 		entry = (struct ipc_call_list_entry *) (
 			(unsigned char *) data + offset);
 		offset += sizeof(struct ipc_call_list_entry) +
@@ -89,6 +93,69 @@ struct ipc_call_list_entry *ipc_call_list_entry_extract(
 	return entry;
 }
 
+int ipc_call_list_iterator_setup(struct ipc_list_iterator *iterator,
+				 const void *data, size_t size)
+{
+	const struct ipc_call_list_entry *entry;
+	unsigned char count;
+	unsigned char i;
+	size_t offset;
+
+	if (iterator == NULL || data == NULL)
+		return -1;
+
+	memset(iterator, 0, sizeof(struct ipc_list_iterator));
+
+	if (size < sizeof(struct ipc_call_list_header))
+		return -1;
+
+	count = ipc_call_list_count_extract(data, size);
+
+	/* The entries have a variable length, so they are all checked here
+	 * once and for all.
+	 */
+	offset = sizeof(struct ipc_call_list_header);
+
+	for (i = 0; i < count; i++) {
+		if (size - offset < sizeof(struct ipc_call_list_entry))
+			return -1;
+
+		entry = (const struct ipc_call_list_entry *) (
+			(const unsigned char *) data + offset);
+		offset += sizeof(struct ipc_call_list_entry);
+
+		if (size - offset < entry->number_length)
+			return -1;
+
+		offset += entry->number_length;
+	}
+
+	iterator->data = (const unsigned char *) data;
+	iterator->size = size;
+	iterator->offset = sizeof(struct ipc_call_list_header);
+	iterator->count = count;
+
+	return 0;
+}
+
+struct ipc_call_list_entry *ipc_call_list_iterator_next(
+	struct ipc_list_iterator *iterator)
+{
+	struct ipc_call_list_entry *entry;
+
+	if (iterator == NULL || iterator->index >= iterator->count)
+		return NULL;
+
+	entry = (struct ipc_call_list_entry *) (
+		iterator->data + iterator->offset);
+
+	iterator->offset += sizeof(struct ipc_call_list_entry) +
+		entry->number_length;
+	iterator->index++;
+
+	return entry;
+}
+
 char *ipc_call_list_entry_number_extract(
 	const struct ipc_call_list_entry *entry)
 {
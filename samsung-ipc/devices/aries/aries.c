@@ -79,7 +79,8 @@ int aries_boot(struct ipc_client *client)
 	}
 	ipc_client_log(client, "Opened onedram");
 
-	rc = network_iface_down(ARIES_MODEM_IFACE, AF_PHONET, SOCK_DGRAM);
+	rc = ipc_client_iface_down(client, ARIES_MODEM_IFACE, AF_PHONET,
+				   SOCK_DGRAM);
 	if (rc < 0) {
 		ipc_client_log(client,
 			       "Turning modem network iface down failed");
@@ -262,6 +263,8 @@ int aries_fmt_send(struct ipc_client *client, struct ipc_message *message)
 	ipc_fmt_header_setup(&header, message);
 
 	length = header.length;
+
+	IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
 	buffer = calloc(1, length);
 
 	memcpy(buffer, &header, sizeof(struct ipc_fmt_header));
@@ -279,9 +282,7 @@ int aries_fmt_send(struct ipc_client *client, struct ipc_message *message)
 		chunk = (length - count) < ARIES_BUFFER_LENGTH ?
 			length - count : ARIES_BUFFER_LENGTH;
 
-		rc = client->handlers->write(client,
-					     client->handlers->transport_data,
-					     p, chunk);
+		rc = ipc_client_handlers_write(client, p, chunk);
 		if (rc < 0) {
 			ipc_client_log(client, "Writing FMT data failed");
 			goto error;
@@ -320,10 +321,11 @@ int aries_fmt_recv(struct ipc_client *client, struct ipc_message *message)
 	}
 
 	length = ARIES_BUFFER_LENGTH;
+
+	IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
 	buffer = calloc(1, length);
 
-	rc = client->handlers->read(client, client->handlers->transport_data,
-				    buffer, length);
+	rc = ipc_client_handlers_read(client, buffer, length);
 	if (rc < (int) sizeof(struct ipc_fmt_header)) {
 		ipc_client_log(client, "Reading FMT header failed");
 		goto error;
@@ -336,6 +338,8 @@ int aries_fmt_recv(struct ipc_client *client, struct ipc_message *message)
 	length = header->length - sizeof(struct ipc_fmt_header);
 	if (length > 0) {
 		message->size = length;
+
+		IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
 		message->data = calloc(1, length);
 
 		count = rc - sizeof(struct ipc_fmt_header);
@@ -346,15 +350,17 @@ int aries_fmt_recv(struct ipc_client *client, struct ipc_message *message)
 		}
 	}
 
+	/* The rest of the frame is read in chunks */
+	if (count < length)
+		IPC_CLIENT_COUNTER_ADD(client, partial_reads, 1);
+
 	p = (unsigned char *) message->data + count;
 
 	while (count < length) {
 		chunk = (length - count) < ARIES_BUFFER_LENGTH ?
 			length - count : ARIES_BUFFER_LENGTH;
 
-		rc = client->handlers->read(client,
-					    client->handlers->transport_data, p,
-					    chunk);
+		rc = ipc_client_handlers_read(client, p, chunk);
 		if (rc < 0) {
 			ipc_client_log(client, "Reading FMT data failed");
 			goto error;
@@ -397,6 +403,8 @@ int aries_rfs_send(struct ipc_client *client, struct ipc_message *message)
 	ipc_rfs_header_setup(&header, message);
 
 	length = header.length;
+
+	IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
 	buffer = calloc(1, length);
 
 	memcpy(buffer, &header, sizeof(header));
@@ -413,9 +421,7 @@ int aries_rfs_send(struct ipc_client *client, struct ipc_message *message)
 		chunk = (length - count) < ARIES_BUFFER_LENGTH ?
 			length - count : ARIES_BUFFER_LENGTH;
 
-		rc = client->handlers->write(client,
-					     client->handlers->transport_data,
-					     p, chunk);
+		rc = ipc_client_handlers_write(client, p, chunk);
 		if (rc < 0) {
 			ipc_client_log(client, "Writing RFS data failed");
 			goto error;
@@ -454,10 +460,11 @@ int aries_rfs_recv(struct ipc_client *client, struct ipc_message *message)
 	}
 
 	length = ARIES_BUFFER_LENGTH;
+
+	IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
 	buffer = calloc(1, length);
 
-	rc = client->handlers->read(client, client->handlers->transport_data,
-				    buffer, length);
+	rc = ipc_client_handlers_read(client, buffer, length);
 	if (rc < (int) sizeof(struct ipc_rfs_header)) {
 		ipc_client_log(client, "Reading RFS header failed");
 		goto error;
@@ -467,6 +474,7 @@ int aries_rfs_recv(struct ipc_client *client, struct ipc_message *message)
 	if (header->length > ARIES_DATA_SIZE_LIMIT) {
 		ipc_client_log(client, "Invalid RFS header length: %u",
 			       header->length);
+		IPC_CLIENT_COUNTER_ADD(client, parse_errors, 1);
 		goto error;
 	}
 
@@ -475,6 +483,8 @@ int aries_rfs_recv(struct ipc_client *client, struct ipc_message *message)
 	length = header->length - sizeof(struct ipc_rfs_header);
 	if (length > 0) {
 		message->size = length;
+
+		IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
 		message->data = calloc(1, length);
 
 		count = rc - sizeof(struct ipc_rfs_header);
@@ -485,15 +495,17 @@ int aries_rfs_recv(struct ipc_client *client, struct ipc_message *message)
 		}
 	}
 
+	/* The rest of the frame is read in chunks */
+	if (count < length)
+		IPC_CLIENT_COUNTER_ADD(client, partial_reads, 1);
+
 	p = (unsigned char *) message->data + count;
 
 	while (count < length) {
 		chunk = (length - count) < ARIES_BUFFER_LENGTH ?
 			length - count : ARIES_BUFFER_LENGTH;
 
-		rc = client->handlers->read(client,
-					    client->handlers->transport_data, p,
-					    chunk);
+		rc = ipc_client_handlers_read(client, p, chunk);
 		if (rc < 0) {
 			ipc_client_log(client, "Reading RFS data failed");
 			goto error;
@@ -518,8 +530,7 @@ complete:
 	return rc;
 }
 
-int aries_open(__attribute__((unused)) struct ipc_client *client, void *data,
-	       int type)
+int aries_open(struct ipc_client *client, void *data, int type)
 {
 	struct aries_transport_data *transport_data;
 	struct sockaddr_pn *spn;
@@ -587,7 +598,8 @@ int aries_open(__attribute__((unused)) struct ipc_client *client, void *data,
 			return -1;
 	}
 
-	rc = network_iface_up(ARIES_MODEM_IFACE, AF_PHONET, SOCK_DGRAM);
+	rc = ipc_client_iface_up(client, ARIES_MODEM_IFACE, AF_PHONET,
+				 SOCK_DGRAM);
 	if (rc < 0)
 		return -1;
 
@@ -144,6 +144,7 @@ int crespo_fmt_send(struct ipc_client *client, struct ipc_message *message)
 
 	memset(&mio, 0, sizeof(struct modem_io));
 	mio.size = message->size + sizeof(struct ipc_fmt_header);
+	IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
 	mio.data = calloc(1, mio.size);
 
 	memcpy(mio.data, &header, sizeof(struct ipc_fmt_header));
@@ -156,8 +157,8 @@ int crespo_fmt_send(struct ipc_client *client, struct ipc_message *message)
 
 	ipc_client_log_send(client, message, __func__);
 
-	rc = client->handlers->write(client, client->handlers->transport_data,
-				     (void *) &mio, sizeof(struct modem_io));
+	rc = ipc_client_handlers_write(client, (void *) &mio,
+				       sizeof(struct modem_io));
 	if (rc < 0) {
 		ipc_client_log(client, "Writing FMT data failed");
 		goto error;
@@ -189,14 +190,17 @@ int crespo_fmt_recv(struct ipc_client *client, struct ipc_message *message)
 
 	memset(&mio, 0, sizeof(struct modem_io));
 	mio.size = CRESPO_BUFFER_LENGTH;
+	IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
 	mio.data = calloc(1, mio.size);
 
-	rc = client->handlers->read(client, client->handlers->transport_data,
-				    &mio, sizeof(struct modem_io) + mio.size);
+	rc = ipc_client_handlers_read(client, &mio,
+				      sizeof(struct modem_io) + mio.size);
 	if (rc < 0 || mio.data == NULL ||
 	    mio.size < sizeof(struct ipc_fmt_header) ||
 	    mio.size > CRESPO_BUFFER_LENGTH) {
 		ipc_client_log(client, "Reading FMT data failed");
+		if (rc >= 0)
+			IPC_CLIENT_COUNTER_ADD(client, parse_errors, 1);
 		goto error;
 	}
 
@@ -206,6 +210,7 @@ int crespo_fmt_recv(struct ipc_client *client, struct ipc_message *message)
 
 	if (mio.size > sizeof(struct ipc_fmt_header)) {
 		message->size = mio.size - sizeof(struct ipc_fmt_header);
+		IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
 		message->data = calloc(1, message->size);
 
 		memcpy(message->data,
@@ -245,6 +250,7 @@ int crespo_rfs_send(struct ipc_client *client, struct ipc_message *message)
 	mio.size = message->size;
 
 	if (message->data != NULL && message->size > 0) {
+		IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
 		mio.data = calloc(1, mio.size);
 
 		memcpy(mio.data, message->data, message->size);
@@ -252,8 +258,8 @@ int crespo_rfs_send(struct ipc_client *client, struct ipc_message *message)
 
 	ipc_client_log_send(client, message, __func__);
 
-	rc = client->handlers->write(client, client->handlers->transport_data,
-				     (void *) &mio, sizeof(struct modem_io));
+	rc = ipc_client_handlers_write(client, (void *) &mio,
+				       sizeof(struct modem_io));
 	if (rc < 0) {
 		ipc_client_log(client, "Writing RFS data failed");
 		goto error;
@@ -284,13 +290,16 @@ int crespo_rfs_recv(struct ipc_client *client, struct ipc_message *message)
 
 	memset(&mio, 0, sizeof(struct modem_io));
 	mio.size = CRESPO_BUFFER_LENGTH;
+	IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
 	mio.data = calloc(1, mio.size);
 
-	rc = client->handlers->read(client, client->handlers->transport_data,
-				    &mio, sizeof(struct modem_io) + mio.size);
+	rc = ipc_client_handlers_read(client, &mio,
+				      sizeof(struct modem_io) + mio.size);
 	if (rc < 0 || mio.data == NULL || mio.size <= 0 ||
 	    mio.size > CRESPO_BUFFER_LENGTH) {
 		ipc_client_log(client, "Reading RFS data failed");
+		if (rc >= 0)
+			IPC_CLIENT_COUNTER_ADD(client, parse_errors, 1);
 		goto error;
 	}
 
@@ -300,6 +309,7 @@ int crespo_rfs_recv(struct ipc_client *client, struct ipc_message *message)
 
 	if (mio.size > 0) {
 		message->size = mio.size;
+		IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
 		message->data = calloc(1, message->size);
 
 		memcpy(message->data, mio.data, message->size);
@@ -379,6 +379,18 @@ int galaxys2_poll(__attribute__((unused)) struct ipc_client *client, void *data,
 	return rc;
 }
 
+int galaxys2_fd(__attribute__((unused)) struct ipc_client *client, void *data)
+{
+	struct galaxys2_transport_data *transport_data;
+
+	if (data == NULL)
+		return -1;
+
+	transport_data = (struct galaxys2_transport_data *) data;
+
+	return transport_data->fd;
+}
+
 int galaxys2_power_on(__attribute__((unused)) struct ipc_client *client,
 		      __attribute__((unused)) void *data)
 {
@@ -464,6 +476,7 @@ struct ipc_client_handlers galaxys2_handlers = {
 	.open = galaxys2_open,
 	.close = galaxys2_close,
 	.poll = galaxys2_poll,
+	.fd = galaxys2_fd,
 	.transport_data = NULL,
 	.power_on = galaxys2_power_on,
 	.power_off = galaxys2_power_off,
@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/mman.h>
 
@@ -108,11 +109,13 @@ int xmm626_kernel_linux_modem_hci_power(struct ipc_client *client, int power)
 }
 
 /* xmm626_kernel_poll without the ioctls */
-int generic_kernel_poll(
-	__attribute__((unused)) struct ipc_client *client,
-	int fd, struct ipc_poll_fds *fds, struct timeval *timeout)
+int generic_kernel_poll(struct ipc_client *client, int fd,
+			struct ipc_poll_fds *fds, struct timeval *timeout)
 {
 	fd_set set;
+	fd_set write_set;
+	int writable;
+	int flushed;
 	int fd_max;
 	unsigned int i;
 	unsigned int count;
@@ -121,23 +124,43 @@ int generic_kernel_poll(
 	if (fd < 0)
 		return -1;
 
-	FD_ZERO(&set);
-	FD_SET(fd, &set);
+	do {
+		flushed = 0;
 
-	fd_max = fd;
+		FD_ZERO(&set);
+		FD_SET(fd, &set);
 
-	if (fds != NULL && fds->fds != NULL && fds->count > 0) {
-		for (i = 0; i < fds->count; i++) {
-			if (fds->fds[i] >= 0) {
-				FD_SET(fds->fds[i], &set);
+		fd_max = fd;
+
+		if (fds != NULL && fds->fds != NULL && fds->count > 0) {
+			for (i = 0; i < fds->count; i++) {
+				if (fds->fds[i] >= 0) {
+					FD_SET(fds->fds[i], &set);
 
-				if (fds->fds[i] > fd_max)
-					fd_max = fds->fds[i];
+					if (fds->fds[i] > fd_max)
+						fd_max = fds->fds[i];
+				}
 			}
 		}
-	}
 
-	rc = select(fd_max + 1, &set, NULL, NULL, timeout);
+		writable = ipc_client_output_pending(client) > 0;
+		if (writable) {
+			FD_ZERO(&write_set);
+			FD_SET(fd, &write_set);
+		}
+
+		rc = select(fd_max + 1, &set, writable ? &write_set : NULL,
+			    NULL, timeout);
+
+		if (rc > 0 && writable && FD_ISSET(fd, &write_set)) {
+			rc--;
+
+			if (ipc_client_output_flush(client) < 0)
+				return -1;
+
+			flushed = 1;
+		}
+	} while (rc == 0 && flushed);
 
 	if (FD_ISSET(fd, &set))
 		return -1;
@@ -686,9 +709,14 @@ int generic_write(__attribute__((unused)) struct ipc_client *client,
 
 int generic_poll(__attribute__((unused)) struct ipc_client *client,
 		 void *data, __attribute__((unused)) struct ipc_poll_fds *fds,
-		 __attribute__((unused)) struct timeval *timeout)
+		 struct timeval *timeout)
 {
 	struct generic_transport_data *transport_data;
+	struct timespec start;
+	struct timespec now;
+	long elapsed;
+	int flushed;
+	int ms;
 	int rc;
 	struct pollfd fd;
 
@@ -700,27 +728,55 @@ int generic_poll(__attribute__((unused)) struct ipc_client *client,
 
 	transport_data = (struct generic_transport_data *) data;
 
-	fd.fd = transport_data->fd;
-	// fd.events = POLLRDNORM | POLLIN;
-	// fd.events = POLLIN;
+	ms = timeout == NULL ? -1 :
+		timeout->tv_sec * 1000 + timeout->tv_usec / 1000;
 
-//#if GENERIC_DEBUG
-//	ipc_client_log(client, "%s: transport_data->fd: %d", __func__, transport_data->fd);
-//#endif
-	rc = poll(&fd, 1, -1);
-	if (rc == -1) {
-		rc = errno;
-		ipc_client_log(client,
-			       "%s: poll failed with error %d: %s", __func__,
-			       rc, strerror(rc));
-		return -1;
-	}
+	/* Being only writable isn't a timeout: wait for the rest of it */
+	do {
+		flushed = 0;
+
+		fd.fd = transport_data->fd;
+		fd.events = POLLIN;
+		fd.revents = 0;
+
+		if (ipc_client_output_pending(client) > 0)
+			fd.events |= POLLOUT;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		rc = poll(&fd, 1, ms);
+		if (rc == -1) {
+			rc = errno;
+			ipc_client_log(client,
+				       "%s: poll failed with error %d: %s",
+				       __func__, rc, strerror(rc));
+			return -1;
+		}
+
+		if (fd.revents & POLLOUT) {
+			if (ipc_client_output_flush(client) < 0)
+				return -1;
+
+			if (!(fd.revents & POLLIN)) {
+				rc = 0;
+				flushed = 1;
+			}
+		}
+
+		if (flushed && ms > 0) {
+			clock_gettime(CLOCK_MONOTONIC, &now);
+
+			elapsed = (now.tv_sec - start.tv_sec) * 1000 +
+				(now.tv_nsec - start.tv_nsec) / 1000000;
+			ms = elapsed < ms ? ms - elapsed : 0;
+		}
+	} while (flushed && ms != 0);
 
 #if GENERIC_DEBUG
 	ipc_client_log(client, "%s: poll: %d", __func__, rc);
 #endif
 
-	return 0;
+	return rc;
 }
 
 int generic_smdk_poll(__attribute__((unused)) struct ipc_client *client,
@@ -745,6 +801,18 @@ int generic_smdk_poll(__attribute__((unused)) struct ipc_client *client,
 	return rc;
 }
 
+int generic_fd(__attribute__((unused)) struct ipc_client *client, void *data)
+{
+	struct generic_transport_data *transport_data;
+
+	if (data == NULL)
+		return -1;
+
+	transport_data = (struct generic_transport_data *) data;
+
+	return transport_data->fd;
+}
+
 int generic_power_on(__attribute__((unused)) struct ipc_client *client,
 		     __attribute__((unused)) void *data)
 {
@@ -855,6 +923,7 @@ struct ipc_client_handlers generic_handlers = {
 	.open = generic_open,
 	.close = generic_close,
 	.poll = generic_poll,
+	.fd = generic_fd,
 	.transport_data = NULL,
 	.power_on = generic_power_on,
 	.power_off = generic_power_off,
@@ -490,6 +490,18 @@ int herolte_poll(__attribute__((unused)) struct ipc_client *client, void *data,
 	return rc;
 }
 
+int herolte_fd(__attribute__((unused)) struct ipc_client *client, void *data)
+{
+	struct herolte_transport_data *transport_data;
+
+	if (data == NULL)
+		return -1;
+
+	transport_data = (struct herolte_transport_data *) data;
+
+	return transport_data->fd;
+}
+
 int herolte_power_on(__attribute__((unused)) struct ipc_client *client,
 		   __attribute__((unused)) void *data)
 {
@@ -583,6 +595,7 @@ struct ipc_client_handlers herolte_handlers = {
 	.open = herolte_open,
 	.close = herolte_close,
 	.poll = herolte_poll,
+	.fd = herolte_fd,
 	.transport_data = NULL,
 	.power_on = herolte_power_on,
 	.power_off = herolte_power_off,
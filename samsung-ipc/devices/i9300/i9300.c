@@ -342,6 +342,18 @@ int i9300_poll(__attribute__((unused)) struct ipc_client *client, void *data,
 	return rc;
 }
 
+int i9300_fd(__attribute__((unused)) struct ipc_client *client, void *data)
+{
+	struct i9300_transport_data *transport_data;
+
+	if (data == NULL)
+		return -1;
+
+	transport_data = (struct i9300_transport_data *) data;
+
+	return transport_data->fd;
+}
+
 int i9300_power_on(__attribute__((unused)) struct ipc_client *client,
 		   __attribute__((unused)) void *data)
 {
@@ -427,6 +439,7 @@ struct ipc_client_handlers i9300_handlers = {
 	.open = i9300_open,
 	.close = i9300_close,
 	.poll = i9300_poll,
+	.fd = i9300_fd,
 	.transport_data = NULL,
 	.power_on = i9300_power_on,
 	.power_off = i9300_power_off,
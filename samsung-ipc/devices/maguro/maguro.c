@@ -300,6 +300,18 @@ int maguro_poll(__attribute__((unused)) struct ipc_client *client, void *data,
 	return rc;
 }
 
+int maguro_fd(__attribute__((unused)) struct ipc_client *client, void *data)
+{
+	struct maguro_transport_data *transport_data;
+
+	if (data == NULL)
+		return -1;
+
+	transport_data = (struct maguro_transport_data *) data;
+
+	return transport_data->fd;
+}
+
 int maguro_power_on(__attribute__((unused)) struct ipc_client *client,
 		    __attribute__((unused)) void *data)
 {
@@ -385,6 +397,7 @@ struct ipc_client_handlers maguro_handlers = {
 	.open = maguro_open,
 	.close = maguro_close,
 	.poll = maguro_poll,
+	.fd = maguro_fd,
 	.transport_data = NULL,
 	.power_on = maguro_power_on,
 	.power_off = maguro_power_off,
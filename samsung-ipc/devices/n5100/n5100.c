@@ -343,6 +343,18 @@ int n5100_poll(__attribute__((unused)) struct ipc_client *client, void *data,
 	return rc;
 }
 
+int n5100_fd(__attribute__((unused)) struct ipc_client *client, void *data)
+{
+	struct n5100_transport_data *transport_data;
+
+	if (data == NULL)
+		return -1;
+
+	transport_data = (struct n5100_transport_data *) data;
+
+	return transport_data->fd;
+}
+
 int n5100_power_on(__attribute__((unused)) struct ipc_client *client,
 		   __attribute__((unused)) void *data)
 {
@@ -428,6 +440,7 @@ struct ipc_client_handlers n5100_handlers = {
 	.open = n5100_open,
 	.close = n5100_close,
 	.poll = n5100_poll,
+	.fd = n5100_fd,
 	.transport_data = NULL,
 	.power_on = n5100_power_on,
 	.power_off = n5100_power_off,
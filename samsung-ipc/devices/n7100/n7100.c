@@ -342,6 +342,18 @@ int n7100_poll(__attribute__((unused)) struct ipc_client *client, void *data,
 	return rc;
 }
 
+int n7100_fd(__attribute__((unused)) struct ipc_client *client, void *data)
+{
+	struct n7100_transport_data *transport_data;
+
+	if (data == NULL)
+		return -1;
+
+	transport_data = (struct n7100_transport_data *) data;
+
+	return transport_data->fd;
+}
+
 int n7100_power_on(__attribute__((unused)) struct ipc_client *client,
 		   __attribute__((unused)) void *data)
 {
@@ -427,6 +439,7 @@ struct ipc_client_handlers n7100_handlers = {
 	.open = n7100_open,
 	.close = n7100_close,
 	.poll = n7100_poll,
+	.fd = n7100_fd,
 	.transport_data = NULL,
 	.power_on = n7100_power_on,
 	.power_off = n7100_power_off,
@@ -264,6 +264,18 @@ int piranha_poll(__attribute__((unused)) struct ipc_client *client, void *data,
 	return rc;
 }
 
+int piranha_fd(__attribute__((unused)) struct ipc_client *client, void *data)
+{
+	struct piranha_transport_data *transport_data;
+
+	if (data == NULL)
+		return -1;
+
+	transport_data = (struct piranha_transport_data *) data;
+
+	return transport_data->fd;
+}
+
 int piranha_power_on(__attribute__((unused)) struct ipc_client *client,
 		     __attribute__((unused)) void *data)
 {
@@ -349,6 +361,7 @@ struct ipc_client_handlers piranha_handlers = {
 	.open = piranha_open,
 	.close = piranha_close,
 	.poll = piranha_poll,
+	.fd = piranha_fd,
 	.transport_data = NULL,
 	.power_on = piranha_power_on,
 	.power_off = piranha_power_off,
@@ -0,0 +1,630 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include <samsung-ipc.h>
+
+#include "ipc.h"
+
+/*
+ * GPRS session manager: contexts are activated concurrently, each one going
+ * through its own state machine:
+ * - DEFINING: IPC_GPRS_DEFINE_PDP_CONTEXT was sent, waiting for its
+ *   IPC_GEN_PHONE_RES.
+ * - ACTIVATING: IPC_GPRS_PDP_CONTEXT was sent, waiting for its
+ *   IPC_GEN_PHONE_RES.
+ * - CONFIGURING: waiting for the IPC_GPRS_IP_CONFIGURATION notification,
+ *   which can also arrive before the PDP context response.
+ * - ACTIVE: the device GPRS handler was called and the network interface
+ *   of the context is up.
+ * Failures with a transient IPC_GPRS_FAIL_CAUSE, including steps that time
+ * out, are retried after an exponential backoff. Other failures are final.
+ *
+ * The IPC_GEN_PHONE_RES responses are matched by their aseq and by the
+ * command they answer, and the mseqs of the requests are given by seq_get,
+ * which is called with seq_data.
+ */
+
+#define IPC_GPRS_SESSION_CID_COUNT	3
+
+struct ipc_gprs_session_context {
+	struct ipc_gprs_session_status status;
+	struct ipc_gprs_define_pdp_context_data define;
+	struct ipc_gprs_pdp_context_request_set_data pdp;
+	unsigned char mseq;
+	int configured;
+	int acknowledged;
+	uint64_t start;
+	uint64_t deadline;
+};
+
+struct ipc_gprs_session {
+	struct ipc_client *client;
+	unsigned int retries;
+	unsigned int timeout;
+	unsigned int retry_delay;
+
+	unsigned char (*seq_get)(void *data);
+	void *seq_data;
+	void (*callback)(void *data,
+			 const struct ipc_gprs_session_status *status);
+	void *callback_data;
+
+	struct ipc_gprs_session_context *contexts;
+	unsigned int count;
+};
+
+static uint64_t ipc_gprs_session_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int ipc_gprs_session_fail_cause_transient(unsigned short fail_cause)
+{
+	switch (fail_cause) {
+	case IPC_GPRS_FAIL_CAUSE_LLC_SNDCP:
+	case IPC_GPRS_FAIL_CAUSE_INSUFFICIENT_RESOURCE:
+	case IPC_GPRS_FAIL_CAUSE_ACT_REJ_UNSPECIFIED:
+	case IPC_GPRS_FAIL_CAUSE_NSAPI_USED:
+	case IPC_GPRS_FAIL_CAUSE_NETWORK_FAILURE:
+	case IPC_GPRS_FAIL_CAUSE_REACT_REQUIRED:
+	case IPC_GPRS_FAIL_CAUSE_TIMEOUT_ERROR:
+	case IPC_GPRS_FAIL_CAUSE_UNKNOWN_ERROR:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+struct ipc_gprs_session *ipc_gprs_session_create(
+	struct ipc_client *client, unsigned int retries, unsigned int timeout,
+	unsigned int retry_delay, unsigned char (*seq_get)(void *data),
+	void *seq_data,
+	void (*callback)(void *data,
+			 const struct ipc_gprs_session_status *status),
+	void *callback_data)
+{
+	struct ipc_client_gprs_capabilities capabilities;
+	struct ipc_gprs_session *session;
+	unsigned int i;
+	int rc;
+
+	if (client == NULL || timeout == 0 || seq_get == NULL)
+		return NULL;
+
+	session = calloc(1, sizeof(struct ipc_gprs_session));
+	if (session == NULL)
+		return NULL;
+
+	memset(&capabilities, 0, sizeof(capabilities));
+
+	rc = ipc_client_gprs_get_capabilities(client, &capabilities);
+	if (rc < 0 || capabilities.cid_count == 0)
+		capabilities.cid_count = IPC_GPRS_SESSION_CID_COUNT;
+
+	session->contexts = calloc(capabilities.cid_count,
+				   sizeof(struct ipc_gprs_session_context));
+	if (session->contexts == NULL) {
+		free(session);
+		return NULL;
+	}
+
+	for (i = 0; i < capabilities.cid_count; i++)
+		session->contexts[i].status.cid = i + 1;
+
+	session->client = client;
+	session->count = capabilities.cid_count;
+	session->retries = retries;
+	session->timeout = timeout;
+	session->retry_delay = retry_delay;
+	session->seq_get = seq_get;
+	session->seq_data = seq_data;
+	session->callback = callback;
+	session->callback_data = callback_data;
+
+	return session;
+}
+
+void ipc_gprs_session_destroy(struct ipc_gprs_session *session)
+{
+	if (session == NULL)
+		return;
+
+	free(session->contexts);
+	free(session);
+}
+
+static struct ipc_gprs_session_context *ipc_gprs_session_context_get(
+	struct ipc_gprs_session *session, unsigned int cid)
+{
+	if (cid == 0 || cid > session->count)
+		return NULL;
+
+	return &session->contexts[cid - 1];
+}
+
+static void ipc_gprs_session_report(struct ipc_gprs_session *session,
+				    struct ipc_gprs_session_context *context)
+{
+	if (session->callback != NULL)
+		session->callback(session->callback_data, &context->status);
+}
+
+static int ipc_gprs_session_send(struct ipc_gprs_session *session,
+				 struct ipc_gprs_session_context *context,
+				 unsigned short command, const void *data,
+				 size_t size)
+{
+	int rc;
+
+	context->mseq = session->seq_get(session->seq_data);
+	context->deadline = ipc_gprs_session_now() + session->timeout;
+
+	rc = ipc_client_send(session->client, context->mseq, command,
+			     IPC_TYPE_SET, data, size);
+	if (rc < 0) {
+		ipc_client_log(session->client,
+			       "Sending GPRS command 0x%04x for cid %u failed",
+			       command, context->status.cid);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void ipc_gprs_session_fail(struct ipc_gprs_session *session,
+				  struct ipc_gprs_session_context *context,
+				  unsigned short fail_cause)
+{
+	unsigned int shift;
+
+	context->status.fail_cause = fail_cause;
+
+	if (ipc_gprs_session_fail_cause_transient(fail_cause) &&
+	    context->status.attempts <= session->retries) {
+		shift = context->status.attempts - 1;
+		if (shift > 16)
+			shift = 16;
+
+		context->status.state = IPC_GPRS_SESSION_STATE_RETRY_WAIT;
+		context->deadline = ipc_gprs_session_now() +
+			((uint64_t) session->retry_delay << shift);
+
+		ipc_client_log(session->client,
+			       "GPRS cid %u failed with cause 0x%02x, retrying",
+			       context->status.cid, fail_cause);
+		return;
+	}
+
+	context->status.state = IPC_GPRS_SESSION_STATE_FAILED;
+	context->status.latency = ipc_gprs_session_now() - context->start;
+
+	ipc_gprs_session_report(session, context);
+}
+
+static void ipc_gprs_session_define(struct ipc_gprs_session *session,
+				    struct ipc_gprs_session_context *context)
+{
+	int rc;
+
+	context->status.state = IPC_GPRS_SESSION_STATE_DEFINING;
+	context->status.attempts++;
+	context->configured = 0;
+	context->acknowledged = 0;
+
+	rc = ipc_gprs_session_send(session, context,
+				   IPC_GPRS_DEFINE_PDP_CONTEXT,
+				   &context->define, sizeof(context->define));
+	if (rc < 0)
+		ipc_gprs_session_fail(session, context,
+				      IPC_GPRS_FAIL_CAUSE_UNKNOWN_ERROR);
+}
+
+int ipc_gprs_session_activate(struct ipc_gprs_session *session,
+			      unsigned int cid, const char *apn,
+			      const char *username, const char *password)
+{
+	struct ipc_gprs_session_context *context;
+	int rc;
+
+	if (session == NULL || apn == NULL)
+		return -1;
+
+	context = ipc_gprs_session_context_get(session, cid);
+	if (context == NULL)
+		return -1;
+
+	switch (context->status.state) {
+	case IPC_GPRS_SESSION_STATE_IDLE:
+	case IPC_GPRS_SESSION_STATE_FAILED:
+		break;
+	default:
+		ipc_client_log(session->client, "GPRS cid %u is busy", cid);
+		return -1;
+	}
+
+	rc = ipc_gprs_define_pdp_context_setup(&context->define, 1, cid, apn);
+	if (rc < 0)
+		return -1;
+
+	rc = ipc_gprs_pdp_context_request_set_setup(&context->pdp, 1, cid,
+						    username, password);
+	if (rc < 0)
+		return -1;
+
+	memset(&context->status, 0, sizeof(context->status));
+	context->status.cid = cid;
+	context->start = ipc_gprs_session_now();
+
+	ipc_gprs_session_define(session, context);
+
+	return 0;
+}
+
+static void ipc_gprs_session_down(struct ipc_gprs_session *session,
+				  struct ipc_gprs_session_context *context)
+{
+	unsigned int cid = context->status.cid;
+	char *iface;
+
+	iface = ipc_client_gprs_get_iface(session->client, cid);
+	if (iface != NULL) {
+		ipc_client_iface_down(session->client, iface, AF_INET,
+				      SOCK_DGRAM);
+		free(iface);
+	}
+
+	ipc_client_gprs_deactivate(session->client, cid);
+}
+
+int ipc_gprs_session_deactivate(struct ipc_gprs_session *session,
+				unsigned int cid)
+{
+	struct ipc_gprs_session_context *context;
+	int rc = 0;
+
+	if (session == NULL)
+		return -1;
+
+	context = ipc_gprs_session_context_get(session, cid);
+	if (context == NULL)
+		return -1;
+
+	if (context->status.state == IPC_GPRS_SESSION_STATE_ACTIVE)
+		ipc_gprs_session_down(session, context);
+
+	if (context->status.state != IPC_GPRS_SESSION_STATE_IDLE &&
+	    context->status.state != IPC_GPRS_SESSION_STATE_FAILED) {
+		ipc_gprs_pdp_context_request_set_setup(&context->pdp, 0, cid,
+						       NULL, NULL);
+
+		rc = ipc_gprs_session_send(session, context,
+					   IPC_GPRS_PDP_CONTEXT, &context->pdp,
+					   sizeof(context->pdp));
+	}
+
+	memset(&context->status, 0, sizeof(context->status));
+	context->status.cid = cid;
+	context->mseq = 0;
+
+	return rc;
+}
+
+static void ipc_gprs_session_up(struct ipc_gprs_session *session,
+				struct ipc_gprs_session_context *context)
+{
+	unsigned int cid = context->status.cid;
+	char *iface;
+	int rc;
+
+	rc = ipc_client_gprs_activate(session->client, cid);
+	if (rc < 0)
+		goto error;
+
+	iface = ipc_client_gprs_get_iface(session->client, cid);
+	if (iface == NULL)
+		goto error;
+
+	rc = ipc_client_iface_up(session->client, iface, AF_INET,
+				 SOCK_DGRAM);
+	if (rc < 0) {
+		ipc_client_log(session->client, "Bringing %s up failed", iface);
+		free(iface);
+		goto error;
+	}
+
+	free(iface);
+
+	context->status.state = IPC_GPRS_SESSION_STATE_ACTIVE;
+	context->status.fail_cause = IPC_GPRS_FAIL_CAUSE_NONE;
+	context->status.latency = ipc_gprs_session_now() - context->start;
+
+	ipc_gprs_session_report(session, context);
+
+	return;
+
+error:
+	ipc_gprs_session_fail(session, context,
+			      IPC_GPRS_FAIL_CAUSE_MOBILE_FAILURE_ERROR);
+}
+
+/* Returns the command that the context waits for a response to */
+static unsigned short ipc_gprs_session_command(
+	struct ipc_gprs_session_context *context)
+{
+	switch (context->status.state) {
+	case IPC_GPRS_SESSION_STATE_DEFINING:
+		return IPC_GPRS_DEFINE_PDP_CONTEXT;
+	case IPC_GPRS_SESSION_STATE_ACTIVATING:
+		return IPC_GPRS_PDP_CONTEXT;
+	default:
+		return 0;
+	}
+}
+
+static int ipc_gprs_session_gen_phone_res_handle(
+	struct ipc_gprs_session *session, const struct ipc_message *message)
+{
+	struct ipc_gprs_session_context *context = NULL;
+	struct ipc_gen_phone_res_data *data;
+	unsigned short command;
+	unsigned int i;
+	int rc;
+
+	if (message->data == NULL ||
+	    message->size < sizeof(struct ipc_gen_phone_res_data)) {
+		return 0;
+	}
+
+	data = (struct ipc_gen_phone_res_data *) message->data;
+	command = IPC_COMMAND(data->group, data->index);
+
+	for (i = 0; i < session->count; i++) {
+		if (session->contexts[i].mseq == message->aseq &&
+		    ipc_gprs_session_command(&session->contexts[i]) ==
+		    command) {
+			context = &session->contexts[i];
+			break;
+		}
+	}
+
+	if (context == NULL)
+		return 0;
+
+	rc = ipc_gen_phone_res_check(data);
+	if (rc < 0) {
+		ipc_gprs_session_fail(session, context,
+				      IPC_GPRS_FAIL_CAUSE_UNKNOWN_ERROR);
+		return 1;
+	}
+
+	if (context->status.state == IPC_GPRS_SESSION_STATE_DEFINING) {
+		context->status.state = IPC_GPRS_SESSION_STATE_ACTIVATING;
+
+		rc = ipc_gprs_session_send(session, context,
+					   IPC_GPRS_PDP_CONTEXT, &context->pdp,
+					   sizeof(context->pdp));
+		if (rc < 0)
+			ipc_gprs_session_fail(session, context,
+					      IPC_GPRS_FAIL_CAUSE_UNKNOWN_ERROR);
+
+		return 1;
+	}
+
+	context->acknowledged = 1;
+
+	if (context->configured) {
+		ipc_gprs_session_up(session, context);
+	} else {
+		context->status.state = IPC_GPRS_SESSION_STATE_CONFIGURING;
+		context->deadline = ipc_gprs_session_now() + session->timeout;
+	}
+
+	return 1;
+}
+
+static void ipc_gprs_session_ip_configuration_handle(
+	struct ipc_gprs_session *session, const struct ipc_message *message)
+{
+	struct ipc_gprs_ip_configuration_data *data;
+	struct ipc_gprs_session_context *context;
+
+	if (message->data == NULL ||
+	    message->size < sizeof(struct ipc_gprs_ip_configuration_data)) {
+		return;
+	}
+
+	data = (struct ipc_gprs_ip_configuration_data *) message->data;
+
+	context = ipc_gprs_session_context_get(session, data->cid);
+	if (context == NULL ||
+	    (context->status.state != IPC_GPRS_SESSION_STATE_ACTIVATING &&
+	     context->status.state != IPC_GPRS_SESSION_STATE_CONFIGURING)) {
+		return;
+	}
+
+	if (data->fail_cause != IPC_GPRS_FAIL_CAUSE_NONE) {
+		ipc_gprs_session_fail(session, context, data->fail_cause);
+		return;
+	}
+
+	memcpy(&context->status.ip_configuration, data, sizeof(*data));
+	context->configured = 1;
+
+	if (context->acknowledged)
+		ipc_gprs_session_up(session, context);
+}
+
+static void ipc_gprs_session_call_status_handle(
+	struct ipc_gprs_session *session, const struct ipc_message *message)
+{
+	struct ipc_gprs_call_status_data *data;
+	struct ipc_gprs_session_context *context;
+
+	if (message->data == NULL ||
+	    message->size < sizeof(struct ipc_gprs_call_status_data)) {
+		return;
+	}
+
+	data = (struct ipc_gprs_call_status_data *) message->data;
+	if (data->status == IPC_GPRS_STATUS_ENABLED)
+		return;
+
+	context = ipc_gprs_session_context_get(session, data->cid);
+	if (context == NULL)
+		return;
+
+	switch (context->status.state) {
+	case IPC_GPRS_SESSION_STATE_ACTIVATING:
+	case IPC_GPRS_SESSION_STATE_CONFIGURING:
+		ipc_gprs_session_fail(session, context, data->fail_cause);
+		break;
+	case IPC_GPRS_SESSION_STATE_ACTIVE:
+		/* The network tore the context down */
+		ipc_gprs_session_down(session, context);
+		context->status.attempts = 1;
+		context->start = ipc_gprs_session_now();
+		ipc_gprs_session_fail(session, context, data->fail_cause);
+		break;
+	}
+}
+
+/*
+ * Returns 1 when the message was a response to a request of the session.
+ * IPC_GPRS_IP_CONFIGURATION and IPC_GPRS_CALL_STATUS notifications are only
+ * looked at, so that the caller can still handle them.
+ */
+int ipc_gprs_session_handle(struct ipc_gprs_session *session,
+			    const struct ipc_message *message)
+{
+	if (session == NULL || message == NULL)
+		return -1;
+
+	switch (message->command) {
+	case IPC_GEN_PHONE_RES:
+		return ipc_gprs_session_gen_phone_res_handle(session, message);
+	case IPC_GPRS_IP_CONFIGURATION:
+		ipc_gprs_session_ip_configuration_handle(session, message);
+		return 0;
+	case IPC_GPRS_CALL_STATUS:
+		ipc_gprs_session_call_status_handle(session, message);
+		return 0;
+	default:
+		return 0;
+	}
+}
+
+int ipc_gprs_session_timeouts_check(struct ipc_gprs_session *session)
+{
+	struct ipc_gprs_session_context *context;
+	unsigned int count = 0;
+	unsigned int i;
+	uint64_t now;
+
+	if (session == NULL)
+		return -1;
+
+	now = ipc_gprs_session_now();
+
+	for (i = 0; i < session->count; i++) {
+		context = &session->contexts[i];
+
+		if (context->deadline > now)
+			continue;
+
+		switch (context->status.state) {
+		case IPC_GPRS_SESSION_STATE_DEFINING:
+		case IPC_GPRS_SESSION_STATE_ACTIVATING:
+		case IPC_GPRS_SESSION_STATE_CONFIGURING:
+			ipc_gprs_session_fail(session, context,
+					      IPC_GPRS_FAIL_CAUSE_TIMEOUT_ERROR);
+			count++;
+			break;
+		case IPC_GPRS_SESSION_STATE_RETRY_WAIT:
+			ipc_gprs_session_define(session, context);
+			count++;
+			break;
+		}
+	}
+
+	return count;
+}
+
+int ipc_gprs_session_timeout_get(struct ipc_gprs_session *session,
+				 struct timeval *timeout)
+{
+	struct ipc_gprs_session_context *context;
+	uint64_t deadline = UINT64_MAX;
+	unsigned int i;
+	uint64_t now;
+
+	if (session == NULL || timeout == NULL)
+		return -1;
+
+	for (i = 0; i < session->count; i++) {
+		context = &session->contexts[i];
+
+		switch (context->status.state) {
+		case IPC_GPRS_SESSION_STATE_DEFINING:
+		case IPC_GPRS_SESSION_STATE_ACTIVATING:
+		case IPC_GPRS_SESSION_STATE_CONFIGURING:
+		case IPC_GPRS_SESSION_STATE_RETRY_WAIT:
+			if (context->deadline < deadline)
+				deadline = context->deadline;
+			break;
+		}
+	}
+
+	/* No context is in progress */
+	if (deadline == UINT64_MAX)
+		return 0;
+
+	now = ipc_gprs_session_now();
+	deadline = deadline > now ? deadline - now : 0;
+
+	timeout->tv_sec = deadline / 1000;
+	timeout->tv_usec = (deadline % 1000) * 1000;
+
+	return 1;
+}
+
+int ipc_gprs_session_status_get(struct ipc_gprs_session *session,
+				unsigned int cid,
+				struct ipc_gprs_session_status *status)
+{
+	struct ipc_gprs_session_context *context;
+
+	if (session == NULL || status == NULL)
+		return -1;
+
+	context = ipc_gprs_session_context_get(session, cid);
+	if (context == NULL)
+		return -1;
+
+	memcpy(status, &context->status, sizeof(*status));
+
+	return 0;
+}
@@ -19,11 +19,13 @@
  * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
 #include <stdarg.h>
+#include <time.h>
 #include <unistd.h>
 #include <stdbool.h>
 #include <termios.h>
@@ -31,6 +33,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <sys/ioctl.h>
+#include <sys/select.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <asm/types.h>
@@ -52,7 +55,11 @@ static struct ipc_client *ipc_dummy_client_create(void)
 	struct ipc_client *client = NULL;
 
 	client = (struct ipc_client *) calloc(1, sizeof(struct ipc_client));
+	if (client == NULL)
+		return NULL;
+
 	client->type = IPC_CLIENT_TYPE_DUMMY;
+	pthread_mutex_init(&client->lock, NULL);
 
 	return client;
 }
@@ -75,7 +82,11 @@ static struct ipc_client *ipc_transport_client_create(int type)
 		goto error;
 
 	client = (struct ipc_client *) calloc(1, sizeof(struct ipc_client));
+	if (client == NULL)
+		goto error;
+
 	client->type = type;
+	pthread_mutex_init(&client->lock, NULL);
 
 	switch (type) {
 	case IPC_CLIENT_TYPE_RFS:
@@ -104,6 +115,7 @@ static struct ipc_client *ipc_transport_client_create(int type)
 
 error:
 	if (client != NULL) {
+		pthread_mutex_destroy(&client->lock);
 		free(client);
 		client = NULL;
 	}
@@ -133,6 +145,21 @@ int ipc_client_destroy(struct ipc_client *client)
 	if (client->handlers != NULL)
 		free(client->handlers);
 
+	ipc_client_arena_destroy(client);
+	ipc_client_netlink_close(client);
+	ipc_client_coalesce_destroy(client);
+	ipc_client_state_destroy(client);
+	ipc_client_scheduler_destroy(client);
+	ipc_client_output_destroy(client);
+	ipc_client_input_destroy(client);
+	ipc_client_uring_destroy(client);
+	ipc_client_loopback_destroy(client);
+	ipc_client_capture_destroy(client);
+	ipc_client_stats_destroy(client);
+	ipc_client_submit_destroy(client);
+
+	pthread_mutex_destroy(&client->lock);
+
 	memset(client, 0, sizeof(struct ipc_client));
 	free(client);
 
@@ -154,6 +181,8 @@ int ipc_client_transport_handlers_register(
 	if (client == NULL || client->handlers == NULL)
 		return -1;
 
+	pthread_mutex_lock(&client->lock);
+
 	if (read != NULL)
 		client->handlers->read = read;
 	if (write != NULL)
@@ -164,8 +193,13 @@ int ipc_client_transport_handlers_register(
 		client->handlers->open = open;
 	if (close != NULL)
 		client->handlers->close = close;
-	if (transport_data != NULL)
+	/* The fd of the device transport doesn't apply to another one */
+	if (transport_data != NULL) {
 		client->handlers->transport_data = transport_data;
+		client->handlers->fd = NULL;
+	}
+
+	pthread_mutex_unlock(&client->lock);
 
 	return 0;
 }
@@ -179,6 +213,8 @@ int ipc_client_power_handlers_register(
 	if (client == NULL || client->handlers == NULL)
 		return -1;
 
+	pthread_mutex_lock(&client->lock);
+
 	if (power_on != NULL)
 		client->handlers->power_on = power_on;
 	if (power_off != NULL)
@@ -186,6 +222,8 @@ int ipc_client_power_handlers_register(
 	if (power_data != NULL)
 		client->handlers->power_data = power_data;
 
+	pthread_mutex_unlock(&client->lock);
+
 	return 0;
 }
 
@@ -199,6 +237,8 @@ int ipc_client_gprs_handlers_register(
 	if (client == NULL || client->handlers == NULL)
 		return -1;
 
+	pthread_mutex_lock(&client->lock);
+
 	if (gprs_activate != NULL)
 		client->handlers->gprs_activate = gprs_activate;
 	if (gprs_deactivate != NULL)
@@ -206,20 +246,33 @@ int ipc_client_gprs_handlers_register(
 	if (gprs_data != NULL)
 		client->handlers->gprs_data = gprs_data;
 
+	pthread_mutex_unlock(&client->lock);
+
 	return 0;
 }
 
 void ipc_client_log(struct ipc_client *client, const char *message, ...)
 {
+	void (*log_callback)(void *log_data, const char *message);
+	void *log_data;
 	char buffer[4096];
 	va_list args;
 
-	if (client == NULL || client->log_callback == NULL || message == NULL)
+	if (client == NULL || message == NULL)
+		return;
+
+	/* The callback can be replaced while another thread is logging */
+	pthread_mutex_lock(&client->lock);
+	log_callback = client->log_callback;
+	log_data = client->log_data;
+	pthread_mutex_unlock(&client->lock);
+
+	if (log_callback == NULL)
 		return;
 
 	va_start(args, message);
 	vsnprintf((char *) &buffer, sizeof(buffer), message, args);
-	client->log_callback(client->log_data, buffer);
+	log_callback(log_data, buffer);
 	va_end(args);
 }
 
@@ -231,8 +284,10 @@ int ipc_client_log_callback_register(
 	if (client == NULL)
 		return -1;
 
+	pthread_mutex_lock(&client->lock);
 	client->log_callback = log_callback;
 	client->log_data = log_data;
+	pthread_mutex_unlock(&client->lock);
 
 	return 0;
 }
@@ -245,11 +300,24 @@ int ipc_client_boot(struct ipc_client *client)
 	return client->ops->boot(client);
 }
 
+static size_t ipc_client_header_size(struct ipc_client *client)
+{
+	switch (client->type) {
+	case IPC_CLIENT_TYPE_FMT:
+		return sizeof(struct ipc_fmt_header);
+	case IPC_CLIENT_TYPE_RFS:
+		return sizeof(struct ipc_rfs_header);
+	default:
+		return 0;
+	}
+}
+
 int ipc_client_send(struct ipc_client *client, unsigned char mseq,
 		    unsigned short command, unsigned char type,
 		    const void *data, size_t size)
 {
 	struct ipc_message message;
+	int rc;
 
 	if (client == NULL || client->ops == NULL || client->ops->send == NULL)
 		return -1;
@@ -262,17 +330,143 @@ int ipc_client_send(struct ipc_client *client, unsigned char mseq,
 	message.data = (void *) data;
 	message.size = size;
 
-	return client->ops->send(client, &message);
+	rc = client->ops->send(client, &message);
+
+	if (rc >= 0) {
+		IPC_CLIENT_COUNTER_ADD(client, frames_out, 1);
+		IPC_CLIENT_COUNTER_ADD(client, bytes_out,
+				       ipc_client_header_size(client) + size);
+	}
+
+	if (rc >= 0 && client->capture != NULL)
+		ipc_client_capture_write(client, IPC_CAPTURE_DIRECTION_SEND,
+					 &message);
+
+	if (rc >= 0 && client->stats != NULL)
+		ipc_client_stats_send(client, &message);
+
+	/* The data may come from the arena, and it is not needed anymore */
+	ipc_client_arena_reset(client);
+
+	return rc;
 }
 
-int ipc_client_recv(struct ipc_client *client, struct ipc_message *message)
+int ipc_client_deadline_set(struct timespec *deadline, unsigned int timeout)
+{
+	if (deadline == NULL)
+		return -1;
+
+	if (clock_gettime(CLOCK_MONOTONIC, deadline) < 0)
+		return -1;
+
+	deadline->tv_sec += timeout / 1000;
+	deadline->tv_nsec += (timeout % 1000) * 1000000;
+
+	if (deadline->tv_nsec >= 1000000000) {
+		deadline->tv_sec++;
+		deadline->tv_nsec -= 1000000000;
+	}
+
+	return 0;
+}
+
+/* Returns 0 once the deadline is reached */
+static int ipc_client_deadline_timeout(const struct timespec *deadline,
+				       struct timeval *timeout)
 {
+	struct timespec now;
+	long long remaining;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	remaining = (long long) (deadline->tv_sec - now.tv_sec) * 1000000 +
+		(deadline->tv_nsec - now.tv_nsec) / 1000;
+	if (remaining <= 0) {
+		timeout->tv_sec = 0;
+		timeout->tv_usec = 0;
+		return 0;
+	}
+
+	timeout->tv_sec = remaining / 1000000;
+	timeout->tv_usec = remaining % 1000000;
+
+	return 1;
+}
+
+int ipc_client_recv_buffered(struct ipc_client *client,
+			     struct ipc_message *message)
+{
+	int rc;
+
+	rc = client->ops->recv(client, message);
+	if (rc == 0) {
+		IPC_CLIENT_COUNTER_ADD(client, frames_in, 1);
+		IPC_CLIENT_COUNTER_ADD(client, bytes_in,
+				       ipc_client_header_size(client) +
+				       message->size);
+	}
+
+	return rc;
+}
+
+int ipc_client_recv_frame(struct ipc_client *client,
+			  struct ipc_message *message,
+			  const struct timespec *deadline)
+{
+	int rc;
+
+	while (1) {
+		rc = ipc_client_recv_buffered(client, message);
+		if (rc != IPC_CLIENT_RECV_AGAIN)
+			return rc;
+
+		/* The partial frame is kept until the rest of it arrives */
+		rc = ipc_client_poll_deadline(client, NULL, deadline);
+		if (rc < 0)
+			return -1;
+		else if (rc == 0)
+			return IPC_CLIENT_RECV_TIMEOUT;
+	}
+}
+
+int ipc_client_recv_deadline(struct ipc_client *client,
+			     struct ipc_message *message,
+			     const struct timespec *deadline)
+{
+	int rc;
+
 	if (client == NULL || client->ops == NULL ||
 	    client->ops->recv == NULL || message == NULL) {
 		return -1;
 	}
 
-	return client->ops->recv(client, message);
+	if (client->coalesce != NULL)
+		rc = ipc_client_coalesce_recv(client, message, deadline);
+	else
+		rc = ipc_client_recv_frame(client, message, deadline);
+
+	if (rc != 0)
+		return rc;
+
+	if (client->capture != NULL)
+		ipc_client_capture_write(client, IPC_CAPTURE_DIRECTION_RECV,
+					 message);
+
+	if (client->state != NULL)
+		ipc_client_state_update(client, message);
+
+	if (client->scheduler != NULL)
+		ipc_client_scheduler_recv(client, message);
+
+	if (client->stats != NULL)
+		ipc_client_stats_recv(client, message);
+
+	return 0;
+}
+
+int ipc_client_recv(struct ipc_client *client, struct ipc_message *message)
+{
+	return ipc_client_recv_deadline(client, message, NULL);
 }
 
 int ipc_client_open(struct ipc_client *client)
@@ -312,16 +506,137 @@ int ipc_client_close(struct ipc_client *client)
 				       client->handlers->transport_data);
 }
 
+/* Checks the fds without waiting, the same way the poll handlers do */
+static int ipc_client_poll_fds_check(struct ipc_poll_fds *fds)
+{
+	struct timeval timeout;
+	unsigned int count;
+	unsigned int i;
+	fd_set set;
+	int fd_max = -1;
+	int rc;
+
+	if (fds == NULL)
+		return 0;
+
+	if (fds->fds == NULL || fds->count == 0) {
+		fds->count = 0;
+		return 0;
+	}
+
+	FD_ZERO(&set);
+
+	for (i = 0; i < fds->count; i++) {
+		if (fds->fds[i] >= 0) {
+			FD_SET(fds->fds[i], &set);
+
+			if (fds->fds[i] > fd_max)
+				fd_max = fds->fds[i];
+		}
+	}
+
+	memset(&timeout, 0, sizeof(timeout));
+
+	rc = select(fd_max + 1, &set, NULL, NULL, &timeout);
+	if (rc < 0)
+		return -1;
+
+	count = fds->count;
+
+	for (i = 0; i < fds->count; i++) {
+		if (fds->fds[i] < 0 || !FD_ISSET(fds->fds[i], &set)) {
+			fds->fds[i] = -1;
+			count--;
+		}
+	}
+
+	fds->count = count;
+
+	return rc;
+}
+
 int ipc_client_poll(struct ipc_client *client, struct ipc_poll_fds *fds,
 		    struct timeval *timeout)
 {
+	int rc;
+
 	if (client == NULL || client->handlers == NULL ||
 	    client->handlers->poll == NULL) {
 		return -1;
 	}
 
-	return client->handlers->poll(client, client->handlers->transport_data,
-				      fds, timeout);
+	/*
+	 * The queued messages can be received without waiting, but the other
+	 * fds are still checked so that they don't starve
+	 */
+	if (ipc_client_coalesce_pending(client) > 0 ||
+	    ipc_client_input_pending(client) > 0) {
+		rc = ipc_client_poll_fds_check(fds);
+		if (rc < 0)
+			return -1;
+
+		return rc + 1;
+	}
+
+	rc = client->handlers->poll(client, client->handlers->transport_data,
+				    fds, timeout);
+	if (rc > 0)
+		IPC_CLIENT_COUNTER_ADD(client, poll_wakeups, 1);
+	else if (rc < 0 && errno != EINTR)
+		IPC_CLIENT_COUNTER_ADD(client, transport_errors, 1);
+
+	return rc;
+}
+
+int ipc_client_poll_deadline(struct ipc_client *client,
+			     struct ipc_poll_fds *fds,
+			     const struct timespec *deadline)
+{
+	struct timeval timeout;
+	int *fds_copy = NULL;
+	unsigned int count = 0;
+	int expired;
+	int rc;
+
+	if (client == NULL)
+		return -1;
+
+	/* The poll handlers overwrite the fds, that are needed to retry */
+	if (fds != NULL && fds->fds != NULL && fds->count > 0) {
+		count = fds->count;
+		fds_copy = calloc(count, sizeof(int));
+		if (fds_copy == NULL)
+			return -1;
+
+		memcpy(fds_copy, fds->fds, count * sizeof(int));
+	}
+
+	while (1) {
+		expired = 0;
+		if (deadline != NULL)
+			expired = !ipc_client_deadline_timeout(deadline,
+							       &timeout);
+
+		errno = 0;
+
+		rc = ipc_client_poll(client, fds,
+				     deadline != NULL ? &timeout : NULL);
+		if (rc > 0 || expired)
+			break;
+		else if (rc < 0 && errno != EINTR)
+			break;
+
+		/* Interrupted, or woken up by something else than input */
+		if (fds_copy != NULL) {
+			memcpy(fds->fds, fds_copy, count * sizeof(int));
+			fds->count = count;
+		}
+	}
+
+	if (fds_copy != NULL)
+		free(fds_copy);
+
+	return rc < 0 ? -1 : rc;
 }
 
 int ipc_client_power_on(struct ipc_client *client)
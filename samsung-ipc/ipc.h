@@ -19,6 +19,7 @@
  *
  */
 
+#include <pthread.h>
 #include <time.h>
 
 #include <samsung-ipc.h>
@@ -26,6 +27,13 @@
 #ifndef __IPC_H__
 #define __IPC_H__
 
+/*
+ * Values
+ */
+
+/* Returned by the recv ops while the frame isn't complete yet */
+#define IPC_CLIENT_RECV_AGAIN					2
+
 /*
  * Structures
  */
@@ -47,6 +55,8 @@ struct ipc_client_handlers {
 		     const void *buffer, size_t length);
 	int (*poll)(struct ipc_client *client, void *transport_data,
 		    struct ipc_poll_fds *fds, struct timeval *timeout);
+	/* Optional, gives the fd of the transport to the io_uring backend */
+	int (*fd)(struct ipc_client *client, void *transport_data);
 
 	void *transport_data;
 
@@ -88,9 +98,31 @@ struct ipc_client_nv_data_specs {
 	size_t nv_data_chunk_size;
 };
 
+struct ipc_client_arena_block;
+
+struct ipc_client_arena {
+	struct ipc_client_arena_block *blocks;
+	struct ipc_client_arena_block *current;
+};
+
+struct ipc_client_netlink;
+struct ipc_client_coalesce;
+struct ipc_client_state_store;
+struct ipc_client_scheduler;
+struct ipc_client_output;
+struct ipc_client_input;
+struct ipc_client_loopback;
+struct ipc_client_capture;
+struct ipc_client_stats_store;
+struct ipc_client_submit;
+struct ipc_client_uring;
+
 struct ipc_client {
 	int type;
 
+	/* Held while registering the handlers and the log callback */
+	pthread_mutex_t lock;
+
 	void (*log_callback)(void *log_data, const char *message);
 	void *log_data;
 
@@ -98,6 +130,21 @@ struct ipc_client {
 	struct ipc_client_handlers *handlers;
 	struct ipc_client_gprs_specs *gprs_specs;
 	struct ipc_client_nv_data_specs *nv_data_specs;
+
+	struct ipc_client_arena *arena;
+	struct ipc_client_netlink *netlink;
+	struct ipc_client_coalesce *coalesce;
+	struct ipc_client_state_store *state;
+	struct ipc_client_scheduler *scheduler;
+	struct ipc_client_output *output;
+	struct ipc_client_input *input;
+	struct ipc_client_loopback *loopback;
+	struct ipc_client_capture *capture;
+	struct ipc_client_stats_store *stats;
+	struct ipc_client_submit *submit;
+	struct ipc_client_uring *uring;
+
+	struct ipc_client_counters counters;
 };
 
 /*
@@ -106,4 +153,60 @@ struct ipc_client {
 
 void ipc_client_log(struct ipc_client *client, const char *message, ...);
 
+#define IPC_CLIENT_COUNTER_ADD(client, counter, value) \
+	__atomic_fetch_add(&(client)->counters.counter, (value), \
+			   __ATOMIC_RELAXED)
+
+int ipc_client_handlers_read(struct ipc_client *client, void *buffer,
+			     size_t length);
+int ipc_client_handlers_write(struct ipc_client *client, const void *buffer,
+			      size_t length);
+
+int ipc_client_coalesce_recv(struct ipc_client *client,
+			     struct ipc_message *message,
+			     const struct timespec *deadline);
+int ipc_client_coalesce_pending(struct ipc_client *client);
+void ipc_client_coalesce_destroy(struct ipc_client *client);
+
+void ipc_client_state_update(struct ipc_client *client,
+			     const struct ipc_message *message);
+void ipc_client_state_destroy(struct ipc_client *client);
+
+void ipc_client_scheduler_recv(struct ipc_client *client,
+			       const struct ipc_message *message);
+void ipc_client_scheduler_destroy(struct ipc_client *client);
+
+int ipc_client_transport_write(struct ipc_client *client, const void *data,
+			       size_t size);
+void ipc_client_output_destroy(struct ipc_client *client);
+
+int ipc_client_transport_frame_read(struct ipc_client *client, size_t limit,
+				    const void **frame, size_t *size);
+int ipc_client_input_pending(struct ipc_client *client);
+void ipc_client_input_destroy(struct ipc_client *client);
+int ipc_client_recv_buffered(struct ipc_client *client,
+			     struct ipc_message *message);
+int ipc_client_recv_frame(struct ipc_client *client,
+			  struct ipc_message *message,
+			  const struct timespec *deadline);
+
+void ipc_client_loopback_destroy(struct ipc_client *client);
+
+int ipc_client_netlink_loopback_open(struct ipc_client *client);
+
+void ipc_client_capture_write(struct ipc_client *client,
+			      unsigned char direction,
+			      const struct ipc_message *message);
+void ipc_client_capture_destroy(struct ipc_client *client);
+
+void ipc_client_stats_send(struct ipc_client *client,
+			   const struct ipc_message *message);
+void ipc_client_stats_recv(struct ipc_client *client,
+			   const struct ipc_message *message);
+void ipc_client_stats_destroy(struct ipc_client *client);
+
+void ipc_client_submit_destroy(struct ipc_client *client);
+
+void ipc_client_uring_destroy(struct ipc_client *client);
+
 #endif /* __IPC_H__ */
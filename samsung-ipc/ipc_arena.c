@@ -0,0 +1,197 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <samsung-ipc.h>
+
+#include "ipc.h"
+
+/*
+ * The arena is a list of blocks: allocations are carved out of the last one
+ * and a new block is only added when it is full. On reset, the blocks are
+ * merged into a single one that is big enough for all of them, so once the
+ * largest message has been built, no more allocations are done.
+ */
+
+struct ipc_client_arena_block {
+	struct ipc_client_arena_block *next;
+	size_t size;
+	size_t used;
+	unsigned char data[] __attribute__((aligned(IPC_CLIENT_ARENA_ALIGN)));
+};
+
+static size_t ipc_client_arena_align(size_t size)
+{
+	return (size + IPC_CLIENT_ARENA_ALIGN - 1) &
+		~((size_t) IPC_CLIENT_ARENA_ALIGN - 1);
+}
+
+static struct ipc_client_arena_block *ipc_client_arena_block_create(
+	size_t size)
+{
+	struct ipc_client_arena_block *block;
+	int rc;
+
+	/* malloc only aligns on 8 bytes on some architectures */
+	rc = posix_memalign((void **) &block, IPC_CLIENT_ARENA_ALIGN,
+			    sizeof(struct ipc_client_arena_block) + size);
+	if (rc != 0)
+		return NULL;
+
+	memset(block, 0, sizeof(struct ipc_client_arena_block));
+	block->size = size;
+
+	return block;
+}
+
+static void ipc_client_arena_blocks_free(struct ipc_client_arena_block *block)
+{
+	struct ipc_client_arena_block *next;
+
+	while (block != NULL) {
+		next = block->next;
+		free(block);
+		block = next;
+	}
+}
+
+int ipc_client_arena_create(struct ipc_client *client, size_t size)
+{
+	struct ipc_client_arena *arena;
+
+	if (client == NULL)
+		return -1;
+
+	if (client->arena != NULL)
+		return 0;
+
+	if (size == 0)
+		size = IPC_CLIENT_ARENA_SIZE;
+
+	arena = calloc(1, sizeof(struct ipc_client_arena));
+	if (arena == NULL)
+		return -1;
+
+	arena->blocks = ipc_client_arena_block_create(
+		ipc_client_arena_align(size));
+	if (arena->blocks == NULL) {
+		free(arena);
+		return -1;
+	}
+
+	arena->current = arena->blocks;
+	client->arena = arena;
+
+	return 0;
+}
+
+int ipc_client_arena_destroy(struct ipc_client *client)
+{
+	if (client == NULL)
+		return -1;
+
+	if (client->arena == NULL)
+		return 0;
+
+	ipc_client_arena_blocks_free(client->arena->blocks);
+	free(client->arena);
+	client->arena = NULL;
+
+	return 0;
+}
+
+void *ipc_client_arena_alloc(struct ipc_client *client, size_t size)
+{
+	struct ipc_client_arena *arena;
+	struct ipc_client_arena_block *block;
+	void *data;
+	size_t block_size;
+	int rc;
+
+	if (client == NULL || size == 0)
+		return NULL;
+
+	/* The aligned size and the block would not fit in a size_t */
+	if (size > SIZE_MAX - sizeof(struct ipc_client_arena_block) -
+	    IPC_CLIENT_ARENA_ALIGN) {
+		return NULL;
+	}
+
+	if (client->arena == NULL) {
+		rc = ipc_client_arena_create(client, 0);
+		if (rc < 0)
+			return NULL;
+	}
+
+	arena = client->arena;
+	size = ipc_client_arena_align(size);
+	block = arena->current;
+
+	if (block->size - block->used < size) {
+		block_size = block->size > size ? block->size : size;
+
+		IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
+		block = ipc_client_arena_block_create(block_size);
+		if (block == NULL)
+			return NULL;
+
+		arena->current->next = block;
+		arena->current = block;
+	}
+
+	data = block->data + block->used;
+	block->used += size;
+
+	/* Callers get zeroed memory, like with calloc */
+	memset(data, 0, size);
+
+	return data;
+}
+
+void ipc_client_arena_reset(struct ipc_client *client)
+{
+	struct ipc_client_arena *arena;
+	struct ipc_client_arena_block *block;
+	size_t size = 0;
+
+	if (client == NULL || client->arena == NULL)
+		return;
+
+	arena = client->arena;
+
+	if (arena->blocks->next != NULL) {
+		for (block = arena->blocks; block != NULL; block = block->next)
+			size += block->size;
+
+		IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
+		block = ipc_client_arena_block_create(size);
+		if (block != NULL) {
+			ipc_client_arena_blocks_free(arena->blocks);
+			arena->blocks = block;
+		} else {
+			/* Keep the first block and drop the others */
+			ipc_client_arena_blocks_free(arena->blocks->next);
+			arena->blocks->next = NULL;
+		}
+	}
+
+	arena->blocks->used = 0;
+	arena->current = arena->blocks;
+}
@@ -0,0 +1,180 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <samsung-ipc.h>
+
+#include "ipc.h"
+
+/*
+ * The capture file starts with a struct ipc_capture_header, followed by a
+ * struct ipc_capture_record for each message, itself followed by the raw
+ * header of the message and its data. The records are written through the
+ * stdio buffer, so that capturing doesn't add a system call per message.
+ */
+
+struct ipc_client_capture {
+	FILE *file;
+	struct timespec start;
+};
+
+static unsigned long long ipc_client_capture_time(
+	const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (unsigned long long) (now.tv_sec - start->tv_sec) * 1000000 +
+		(now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+int ipc_client_capture_open(struct ipc_client *client, const char *path)
+{
+	struct ipc_client_capture *capture = NULL;
+	struct ipc_capture_header header;
+	int rc;
+
+	if (client == NULL || path == NULL)
+		return -1;
+
+	if (client->capture != NULL)
+		ipc_client_capture_close(client);
+
+	capture = calloc(1, sizeof(struct ipc_client_capture));
+	if (capture == NULL)
+		return -1;
+
+	capture->file = fopen(path, "wb");
+	if (capture->file == NULL) {
+		ipc_client_log(client, "Opening %s failed: %s", path,
+			       strerror(errno));
+		goto error;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, IPC_CAPTURE_MAGIC, sizeof(header.magic));
+	header.version = IPC_CAPTURE_VERSION;
+
+	rc = fwrite(&header, sizeof(header), 1, capture->file);
+	if (rc != 1) {
+		ipc_client_log(client, "Writing capture header failed");
+		goto error;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &capture->start);
+
+	client->capture = capture;
+
+	rc = 0;
+	goto complete;
+
+error:
+	if (capture->file != NULL)
+		fclose(capture->file);
+
+	free(capture);
+
+	rc = -1;
+
+complete:
+	return rc;
+}
+
+int ipc_client_capture_close(struct ipc_client *client)
+{
+	struct ipc_client_capture *capture;
+	int rc;
+
+	if (client == NULL || client->capture == NULL)
+		return -1;
+
+	capture = client->capture;
+	client->capture = NULL;
+
+	rc = fclose(capture->file);
+	if (rc != 0)
+		ipc_client_log(client, "Closing capture failed");
+
+	free(capture);
+
+	return rc == 0 ? 0 : -1;
+}
+
+void ipc_client_capture_write(struct ipc_client *client,
+			      unsigned char direction,
+			      const struct ipc_message *message)
+{
+	struct ipc_client_capture *capture;
+	struct ipc_capture_record record;
+	struct ipc_fmt_header fmt_header;
+	struct ipc_rfs_header rfs_header;
+	const void *header;
+	size_t count;
+
+	if (client == NULL || client->capture == NULL || message == NULL)
+		return;
+
+	capture = client->capture;
+
+	switch (client->type) {
+	case IPC_CLIENT_TYPE_FMT:
+		ipc_fmt_header_setup(&fmt_header, message);
+		header = &fmt_header;
+		record.header_size = sizeof(fmt_header);
+		break;
+	case IPC_CLIENT_TYPE_RFS:
+		ipc_rfs_header_setup(&rfs_header, message);
+		header = &rfs_header;
+		record.header_size = sizeof(rfs_header);
+		break;
+	default:
+		return;
+	}
+
+	record.timestamp = ipc_client_capture_time(&capture->start);
+	record.direction = direction;
+	record.client_type = client->type;
+	record.data_size = message->data != NULL ? message->size : 0;
+
+	count = fwrite(&record, sizeof(record), 1, capture->file);
+	count += fwrite(header, record.header_size, 1, capture->file);
+	if (record.data_size > 0)
+		count += fwrite(message->data, record.data_size, 1,
+				capture->file);
+	else
+		count++;
+
+	/* A partial record would make the rest of the file unreadable */
+	if (count != 3) {
+		ipc_client_log(client, "Writing capture record failed");
+		ipc_client_capture_close(client);
+	}
+}
+
+void ipc_client_capture_destroy(struct ipc_client *client)
+{
+	if (client == NULL || client->capture == NULL)
+		return;
+
+	ipc_client_capture_close(client);
+}
@@ -0,0 +1,266 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <samsung-ipc.h>
+
+#include "ipc.h"
+
+/*
+ * The received messages go through a small queue: each receive reads what
+ * is already available from the transport, without blocking, and a
+ * notification of a coalesced command drops the older one of the same
+ * command that is still queued. The newer one is queued at the end, so the
+ * order of the messages is kept.
+ */
+
+#define IPC_CLIENT_COALESCE_QUEUE_SIZE	32
+
+struct ipc_client_coalesce_command {
+	unsigned short command;
+	unsigned long dropped;
+};
+
+struct ipc_client_coalesce {
+	struct ipc_client_coalesce_command *commands;
+	unsigned int count;
+
+	struct ipc_message queue[IPC_CLIENT_COALESCE_QUEUE_SIZE];
+	unsigned int queued;
+
+	unsigned long received;
+	unsigned long dropped;
+};
+
+int ipc_client_coalesce_set(struct ipc_client *client,
+			    const unsigned short *commands,
+			    unsigned int count)
+{
+	struct ipc_client_coalesce_command *copy = NULL;
+	struct ipc_client_coalesce *coalesce;
+	unsigned int i;
+
+	if (client == NULL || (commands == NULL && count > 0))
+		return -1;
+
+	if (client->coalesce == NULL) {
+		client->coalesce = calloc(1,
+					  sizeof(struct ipc_client_coalesce));
+		if (client->coalesce == NULL)
+			return -1;
+	}
+
+	coalesce = client->coalesce;
+
+	if (count > 0) {
+		copy = calloc(count,
+			      sizeof(struct ipc_client_coalesce_command));
+		if (copy == NULL)
+			return -1;
+
+		for (i = 0; i < count; i++)
+			copy[i].command = commands[i];
+	}
+
+	if (coalesce->commands != NULL)
+		free(coalesce->commands);
+
+	/* Already queued messages are still delivered without coalescing */
+	coalesce->commands = copy;
+	coalesce->count = count;
+
+	return 0;
+}
+
+void ipc_client_coalesce_destroy(struct ipc_client *client)
+{
+	struct ipc_client_coalesce *coalesce;
+	unsigned int i;
+
+	if (client == NULL || client->coalesce == NULL)
+		return;
+
+	coalesce = client->coalesce;
+
+	for (i = 0; i < coalesce->queued; i++) {
+		if (coalesce->queue[i].data != NULL)
+			free(coalesce->queue[i].data);
+	}
+
+	if (coalesce->commands != NULL)
+		free(coalesce->commands);
+
+	free(coalesce);
+	client->coalesce = NULL;
+}
+
+static struct ipc_client_coalesce_command *ipc_client_coalesce_command_get(
+	struct ipc_client_coalesce *coalesce,
+	const struct ipc_message *message)
+{
+	unsigned int i;
+
+	if (message->type != IPC_TYPE_NOTI && message->type != IPC_TYPE_INDI)
+		return NULL;
+
+	for (i = 0; i < coalesce->count; i++) {
+		if (coalesce->commands[i].command == message->command)
+			return &coalesce->commands[i];
+	}
+
+	return NULL;
+}
+
+static void ipc_client_coalesce_queue(struct ipc_client *client,
+				      struct ipc_message *message)
+{
+	struct ipc_client_coalesce *coalesce = client->coalesce;
+	struct ipc_client_coalesce_command *command;
+	struct ipc_message *queued;
+	unsigned int i;
+
+	coalesce->received++;
+
+	command = ipc_client_coalesce_command_get(coalesce, message);
+	if (command == NULL)
+		goto append;
+
+	for (i = 0; i < coalesce->queued; i++) {
+		queued = &coalesce->queue[i];
+
+		if (queued->command != message->command ||
+		    (queued->type != IPC_TYPE_NOTI &&
+		     queued->type != IPC_TYPE_INDI)) {
+			continue;
+		}
+
+		if (queued->data != NULL)
+			free(queued->data);
+
+		coalesce->queued--;
+		memmove(queued, queued + 1,
+			(coalesce->queued - i) * sizeof(struct ipc_message));
+
+		command->dropped++;
+		coalesce->dropped++;
+
+		/* There is at most one queued message per command */
+		break;
+	}
+
+append:
+	memcpy(&coalesce->queue[coalesce->queued++], message,
+	       sizeof(struct ipc_message));
+}
+
+int ipc_client_coalesce_recv(struct ipc_client *client,
+			     struct ipc_message *message,
+			     const struct timespec *deadline)
+{
+	struct ipc_client_coalesce *coalesce = client->coalesce;
+	struct ipc_message received;
+	struct timeval timeout;
+	int rc;
+
+	if (coalesce->queued == 0) {
+		memset(&received, 0, sizeof(received));
+
+		rc = ipc_client_recv_frame(client, &received, deadline);
+		if (rc != 0)
+			return rc;
+
+		ipc_client_coalesce_queue(client, &received);
+	}
+
+	/* Only read what is already there */
+	while (coalesce->queued < IPC_CLIENT_COALESCE_QUEUE_SIZE &&
+	       client->handlers != NULL && client->handlers->poll != NULL) {
+		if (ipc_client_input_pending(client) == 0) {
+			memset(&timeout, 0, sizeof(timeout));
+
+			rc = client->handlers->poll(
+				client, client->handlers->transport_data,
+				NULL, &timeout);
+			if (rc <= 0)
+				break;
+		}
+
+		memset(&received, 0, sizeof(received));
+
+		/* A partial frame stays buffered for the next receive */
+		rc = ipc_client_recv_buffered(client, &received);
+		if (rc != 0)
+			break;
+
+		ipc_client_coalesce_queue(client, &received);
+	}
+
+	memcpy(message, &coalesce->queue[0], sizeof(struct ipc_message));
+
+	coalesce->queued--;
+	memmove(&coalesce->queue[0], &coalesce->queue[1],
+		coalesce->queued * sizeof(struct ipc_message));
+
+	return 0;
+}
+
+int ipc_client_coalesce_pending(struct ipc_client *client)
+{
+	if (client == NULL || client->coalesce == NULL)
+		return 0;
+
+	return client->coalesce->queued;
+}
+
+int ipc_client_coalesce_stats_get(struct ipc_client *client,
+				  struct ipc_client_coalesce_stats *stats)
+{
+	if (client == NULL || stats == NULL)
+		return -1;
+
+	memset(stats, 0, sizeof(struct ipc_client_coalesce_stats));
+
+	if (client->coalesce == NULL)
+		return 0;
+
+	stats->received = client->coalesce->received;
+	stats->dropped = client->coalesce->dropped;
+	stats->queued = client->coalesce->queued;
+
+	return 0;
+}
+
+int ipc_client_coalesce_dropped_get(struct ipc_client *client,
+				    unsigned short command,
+				    unsigned long *dropped)
+{
+	unsigned int i;
+
+	if (client == NULL || client->coalesce == NULL || dropped == NULL)
+		return -1;
+
+	for (i = 0; i < client->coalesce->count; i++) {
+		if (client->coalesce->commands[i].command == command) {
+			*dropped = client->coalesce->commands[i].dropped;
+			return 0;
+		}
+	}
+
+	return -1;
+}
@@ -0,0 +1,118 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <samsung-ipc.h>
+
+#include "ipc.h"
+
+/*
+ * The counters are updated with relaxed atomic operations, so that they can
+ * be read from another thread than the one that sends and receives. A
+ * snapshot is therefore not consistent across the counters, but each of them
+ * is exact.
+ */
+
+#define IPC_CLIENT_COUNTER_COPY(counters, source, counter, reset)	\
+	do {								\
+		if (reset)						\
+			(counters)->counter = __atomic_exchange_n(	\
+				&(source)->counter, 0,			\
+				__ATOMIC_RELAXED);			\
+		else							\
+			(counters)->counter = __atomic_load_n(		\
+				&(source)->counter,			\
+				__ATOMIC_RELAXED);			\
+	} while (0)
+
+static void ipc_client_counters_copy(struct ipc_client_counters *counters,
+				     struct ipc_client_counters *source,
+				     int reset)
+{
+	IPC_CLIENT_COUNTER_COPY(counters, source, frames_in, reset);
+	IPC_CLIENT_COUNTER_COPY(counters, source, frames_out, reset);
+	IPC_CLIENT_COUNTER_COPY(counters, source, bytes_in, reset);
+	IPC_CLIENT_COUNTER_COPY(counters, source, bytes_out, reset);
+	IPC_CLIENT_COUNTER_COPY(counters, source, reads, reset);
+	IPC_CLIENT_COUNTER_COPY(counters, source, writes, reset);
+	IPC_CLIENT_COUNTER_COPY(counters, source, partial_reads, reset);
+	IPC_CLIENT_COUNTER_COPY(counters, source, allocations, reset);
+	IPC_CLIENT_COUNTER_COPY(counters, source, parse_errors, reset);
+	IPC_CLIENT_COUNTER_COPY(counters, source, transport_errors, reset);
+	IPC_CLIENT_COUNTER_COPY(counters, source, poll_wakeups, reset);
+}
+
+int ipc_client_counters_get(struct ipc_client *client,
+			    struct ipc_client_counters *counters)
+{
+	if (client == NULL || counters == NULL)
+		return -1;
+
+	ipc_client_counters_copy(counters, &client->counters, 0);
+
+	return 0;
+}
+
+int ipc_client_counters_reset(struct ipc_client *client)
+{
+	struct ipc_client_counters counters;
+
+	if (client == NULL)
+		return -1;
+
+	ipc_client_counters_copy(&counters, &client->counters, 1);
+
+	return 0;
+}
+
+static int ipc_client_transport_error(int rc)
+{
+	return rc < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+		errno != EINTR;
+}
+
+int ipc_client_handlers_read(struct ipc_client *client, void *buffer,
+			     size_t length)
+{
+	int rc;
+
+	rc = client->handlers->read(client, client->handlers->transport_data,
+				    buffer, length);
+
+	IPC_CLIENT_COUNTER_ADD(client, reads, 1);
+	if (ipc_client_transport_error(rc))
+		IPC_CLIENT_COUNTER_ADD(client, transport_errors, 1);
+
+	return rc;
+}
+
+int ipc_client_handlers_write(struct ipc_client *client, const void *buffer,
+			      size_t length)
+{
+	int rc;
+
+	rc = client->handlers->write(client, client->handlers->transport_data,
+				     buffer, length);
+
+	IPC_CLIENT_COUNTER_ADD(client, writes, 1);
+	if (ipc_client_transport_error(rc))
+		IPC_CLIENT_COUNTER_ADD(client, transport_errors, 1);
+
+	return rc;
+}
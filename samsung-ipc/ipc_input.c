@@ -0,0 +1,189 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <samsung-ipc.h>
+
+#include "ipc.h"
+
+/*
+ * The frames are reassembled in a per-client buffer: the bytes that were
+ * read stay there until the frame they belong to is complete, so that a
+ * receive that couldn't get the whole frame doesn't lose what it read. The
+ * bytes that follow the frame are kept for the next one.
+ */
+
+#define IPC_CLIENT_INPUT_CHUNK_SIZE	0x1000
+
+struct ipc_client_input {
+	unsigned char *buffer;
+	size_t size;
+	size_t count;
+	size_t consumed;
+};
+
+void ipc_client_input_destroy(struct ipc_client *client)
+{
+	if (client == NULL || client->input == NULL)
+		return;
+
+	if (client->input->buffer != NULL)
+		free(client->input->buffer);
+
+	free(client->input);
+	client->input = NULL;
+}
+
+/* Returns the length of the frame, 0 when the header isn't complete yet */
+static size_t ipc_client_input_length(struct ipc_client *client,
+				      const unsigned char *data, size_t count)
+{
+	const struct ipc_fmt_header *fmt_header;
+	const struct ipc_rfs_header *rfs_header;
+
+	switch (client->type) {
+	case IPC_CLIENT_TYPE_FMT:
+		if (count < sizeof(struct ipc_fmt_header))
+			return 0;
+
+		fmt_header = (const struct ipc_fmt_header *) data;
+
+		if (fmt_header->length < sizeof(struct ipc_fmt_header))
+			return (size_t) -1;
+
+		return fmt_header->length;
+	case IPC_CLIENT_TYPE_RFS:
+		if (count < sizeof(struct ipc_rfs_header))
+			return 0;
+
+		rfs_header = (const struct ipc_rfs_header *) data;
+
+		if (rfs_header->length < sizeof(struct ipc_rfs_header))
+			return (size_t) -1;
+
+		return rfs_header->length;
+	default:
+		return (size_t) -1;
+	}
+}
+
+int ipc_client_input_pending(struct ipc_client *client)
+{
+	struct ipc_client_input *input;
+	size_t length;
+	size_t count;
+
+	if (client == NULL || client->input == NULL)
+		return 0;
+
+	input = client->input;
+	count = input->count - input->consumed;
+
+	length = ipc_client_input_length(client,
+					 input->buffer + input->consumed,
+					 count);
+
+	return length > 0 && length != (size_t) -1 && count >= length;
+}
+
+int ipc_client_transport_frame_read(struct ipc_client *client, size_t limit,
+				    const void **frame, size_t *size)
+{
+	struct ipc_client_input *input;
+	unsigned char *buffer;
+	size_t length;
+	size_t needed;
+	int rc;
+
+	if (client == NULL || client->handlers == NULL ||
+	    client->handlers->read == NULL || frame == NULL || size == NULL)
+		return -1;
+
+	if (client->input == NULL) {
+		client->input = calloc(1, sizeof(struct ipc_client_input));
+		if (client->input == NULL)
+			return -1;
+	}
+
+	input = client->input;
+
+	/* The previous frame is only released now, as it was handed out */
+	if (input->consumed > 0) {
+		memmove(input->buffer, input->buffer + input->consumed,
+			input->count - input->consumed);
+		input->count -= input->consumed;
+		input->consumed = 0;
+	}
+
+	while (1) {
+		length = ipc_client_input_length(client, input->buffer,
+						 input->count);
+		if (length == (size_t) -1 || length > limit) {
+			ipc_client_log(client, "Invalid frame length");
+			IPC_CLIENT_COUNTER_ADD(client, parse_errors, 1);
+			input->count = 0;
+			return -1;
+		}
+
+		if (length > 0 && input->count >= length) {
+			*frame = input->buffer;
+			*size = length;
+			input->consumed = length;
+
+			return 0;
+		}
+
+		needed = input->count + IPC_CLIENT_INPUT_CHUNK_SIZE;
+		if (needed < length)
+			needed = length;
+
+		if (input->size < needed) {
+			IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
+
+			buffer = realloc(input->buffer, needed);
+			if (buffer == NULL)
+				return -1;
+
+			input->buffer = buffer;
+			input->size = needed;
+		}
+
+		errno = 0;
+
+		rc = ipc_client_handlers_read(client,
+					      input->buffer + input->count,
+					      input->size - input->count);
+		if (rc > 0) {
+			input->count += rc;
+			continue;
+		}
+
+		if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+			       errno == EINTR)) {
+			if (input->count > 0)
+				IPC_CLIENT_COUNTER_ADD(client, partial_reads,
+						       1);
+
+			return IPC_CLIENT_RECV_AGAIN;
+		}
+
+		return -1;
+	}
+}
@@ -0,0 +1,240 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+#include <samsung-ipc.h>
+
+#include "ipc.h"
+
+/*
+ * The loopback transport replaces the modem with the other end of a stream
+ * socketpair, so that whatever plays the modem side sees exactly the frames
+ * that would be written to the modem device.
+ */
+
+struct ipc_client_loopback {
+	int fd;
+};
+
+static int ipc_client_loopback_transport_open(
+	__attribute__((unused)) struct ipc_client *client, void *data,
+	__attribute__((unused)) int type)
+{
+	struct ipc_client_loopback *loopback = data;
+
+	if (loopback == NULL || loopback->fd < 0)
+		return -1;
+
+	return 0;
+}
+
+static int ipc_client_loopback_transport_close(
+	__attribute__((unused)) struct ipc_client *client, void *data)
+{
+	struct ipc_client_loopback *loopback = data;
+
+	if (loopback == NULL || loopback->fd < 0)
+		return -1;
+
+	close(loopback->fd);
+	loopback->fd = -1;
+
+	return 0;
+}
+
+static int ipc_client_loopback_transport_read(
+	__attribute__((unused)) struct ipc_client *client, void *data,
+	void *buffer, size_t length)
+{
+	struct ipc_client_loopback *loopback = data;
+
+	if (loopback == NULL || loopback->fd < 0 || buffer == NULL)
+		return -1;
+
+	return read(loopback->fd, buffer, length);
+}
+
+static int ipc_client_loopback_transport_write(
+	__attribute__((unused)) struct ipc_client *client, void *data,
+	const void *buffer, size_t length)
+{
+	struct ipc_client_loopback *loopback = data;
+
+	if (loopback == NULL || loopback->fd < 0 || buffer == NULL)
+		return -1;
+
+	return send(loopback->fd, buffer, length, MSG_NOSIGNAL);
+}
+
+static int ipc_client_loopback_transport_poll(struct ipc_client *client,
+					      void *data,
+					      struct ipc_poll_fds *fds,
+					      struct timeval *timeout)
+{
+	struct ipc_client_loopback *loopback = data;
+	fd_set write_set;
+	fd_set set;
+	unsigned int count;
+	unsigned int i;
+	int writable;
+	int flushed;
+	int fd_max;
+	int rc;
+
+	if (loopback == NULL || loopback->fd < 0)
+		return -1;
+
+	/* Being only writable isn't a timeout: wait again after the flush */
+	do {
+		flushed = 0;
+
+		FD_ZERO(&set);
+		FD_SET(loopback->fd, &set);
+
+		fd_max = loopback->fd;
+
+		if (fds != NULL && fds->fds != NULL && fds->count > 0) {
+			for (i = 0; i < fds->count; i++) {
+				if (fds->fds[i] >= 0) {
+					FD_SET(fds->fds[i], &set);
+
+					if (fds->fds[i] > fd_max)
+						fd_max = fds->fds[i];
+				}
+			}
+		}
+
+		writable = ipc_client_output_pending(client) > 0;
+		if (writable) {
+			FD_ZERO(&write_set);
+			FD_SET(loopback->fd, &write_set);
+		}
+
+		rc = select(fd_max + 1, &set, writable ? &write_set : NULL,
+			    NULL, timeout);
+		if (rc <= 0)
+			return rc;
+
+		if (writable && FD_ISSET(loopback->fd, &write_set)) {
+			rc--;
+
+			if (ipc_client_output_flush(client) < 0)
+				return -1;
+
+			flushed = 1;
+		}
+	} while (rc == 0 && flushed);
+
+	if (fds != NULL && fds->fds != NULL && fds->count > 0) {
+		count = fds->count;
+
+		for (i = 0; i < fds->count; i++) {
+			if (fds->fds[i] < 0 || !FD_ISSET(fds->fds[i], &set)) {
+				fds->fds[i] = -1;
+				count--;
+			}
+		}
+
+		fds->count = count;
+	}
+
+	return rc;
+}
+
+static int ipc_client_loopback_transport_fd(
+	__attribute__((unused)) struct ipc_client *client, void *data)
+{
+	struct ipc_client_loopback *loopback = data;
+
+	if (loopback == NULL)
+		return -1;
+
+	return loopback->fd;
+}
+
+int ipc_client_loopback_open(struct ipc_client *client)
+{
+	struct ipc_client_loopback *loopback;
+	int fds[2];
+	int flags;
+	int rc;
+
+	if (client == NULL || client->loopback != NULL)
+		return -1;
+
+	rc = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+	if (rc < 0) {
+		ipc_client_log(client, "Creating the loopback failed: %s",
+			       strerror(errno));
+		return -1;
+	}
+
+	/* The client side behaves like the modem nodes, opened non-blocking */
+	flags = fcntl(fds[0], F_GETFL);
+	if (flags < 0 || fcntl(fds[0], F_SETFL, flags | O_NONBLOCK) < 0)
+		goto error;
+
+	loopback = calloc(1, sizeof(struct ipc_client_loopback));
+	if (loopback == NULL)
+		goto error;
+
+	loopback->fd = fds[0];
+
+	rc = ipc_client_transport_handlers_register(
+		client, ipc_client_loopback_transport_open,
+		ipc_client_loopback_transport_close,
+		ipc_client_loopback_transport_read,
+		ipc_client_loopback_transport_write,
+		ipc_client_loopback_transport_poll, loopback);
+	if (rc < 0) {
+		free(loopback);
+		goto error;
+	}
+
+	pthread_mutex_lock(&client->lock);
+	client->handlers->fd = ipc_client_loopback_transport_fd;
+	pthread_mutex_unlock(&client->lock);
+
+	client->loopback = loopback;
+
+	return fds[1];
+
+error:
+	close(fds[0]);
+	close(fds[1]);
+
+	return -1;
+}
+
+void ipc_client_loopback_destroy(struct ipc_client *client)
+{
+	if (client == NULL || client->loopback == NULL)
+		return;
+
+	if (client->loopback->fd >= 0)
+		close(client->loopback->fd);
+
+	free(client->loopback);
+	client->loopback = NULL;
+}
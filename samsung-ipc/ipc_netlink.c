@@ -0,0 +1,678 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <asm/types.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+/* linux/netlink.h needs to be included after sys/socket.h */
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <samsung-ipc.h>
+
+#include "ipc.h"
+
+/*
+ * The requests are queued in the buffer, each with NLM_F_ACK, and sent in
+ * a single datagram: the kernel then answers with one ack per request.
+ * Outside of batches, the queue is sent right away.
+ *
+ * The link changes are also kept aside, so that they can be replayed through
+ * ioctl when the security policy denies the rtnetlink writes, which is only
+ * known once the queue is sent. The addresses can't be replayed.
+ *
+ * The acks are waited for up to the ack timeout, in milliseconds, after which
+ * the requests fail with ETIMEDOUT.
+ */
+
+#define IPC_CLIENT_NETLINK_BUFFER_SIZE	4096
+#define IPC_CLIENT_NETLINK_ACK_TIMEOUT	1000
+#define IPC_CLIENT_NETLINK_LINKS	\
+	(IPC_CLIENT_NETLINK_BUFFER_SIZE / NLMSG_SPACE(sizeof(struct ifinfomsg)))
+
+struct ipc_client_netlink_link {
+	char iface[IF_NAMESIZE];
+	int domain;
+	int type;
+	int up;
+};
+
+struct ipc_client_netlink {
+	int fd;
+	int events_fd;
+	int disabled;
+	int batch;
+	unsigned int seq;
+	unsigned int count;
+	size_t size;
+	unsigned char buffer[IPC_CLIENT_NETLINK_BUFFER_SIZE];
+	struct ipc_client_netlink_link links[IPC_CLIENT_NETLINK_LINKS];
+	unsigned int links_count;
+};
+
+int ipc_client_netlink_open(struct ipc_client *client)
+{
+	struct ipc_client_netlink *netlink;
+	struct sockaddr_nl address;
+	int rc;
+
+	if (client == NULL)
+		return -1;
+
+	if (client->netlink != NULL)
+		return client->netlink->disabled ? -1 : 0;
+
+	netlink = calloc(1, sizeof(struct ipc_client_netlink));
+	if (netlink == NULL)
+		return -1;
+
+	netlink->events_fd = -1;
+	netlink->seq = 1;
+	client->netlink = netlink;
+
+	netlink->fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC,
+			     NETLINK_ROUTE);
+	if (netlink->fd < 0)
+		goto error;
+
+	memset(&address, 0, sizeof(address));
+	address.nl_family = AF_NETLINK;
+
+	rc = bind(netlink->fd, (struct sockaddr *) &address, sizeof(address));
+	if (rc < 0)
+		goto error;
+
+	return 0;
+
+error:
+	ipc_client_log(client, "Opening rtnetlink socket failed: %s",
+		       strerror(errno));
+
+	/* Don't try again on every call */
+	if (netlink->fd >= 0)
+		close(netlink->fd);
+
+	netlink->fd = -1;
+	netlink->disabled = 1;
+
+	return -1;
+}
+
+/*
+ * Replaces the rtnetlink socket with one end of a socketpair and returns the
+ * other end, which then plays the kernel side.
+ */
+int ipc_client_netlink_loopback_open(struct ipc_client *client)
+{
+	struct ipc_client_netlink *netlink;
+	int fds[2];
+	int rc;
+
+	if (client == NULL)
+		return -1;
+
+	ipc_client_netlink_close(client);
+
+	netlink = calloc(1, sizeof(struct ipc_client_netlink));
+	if (netlink == NULL)
+		return -1;
+
+	rc = socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds);
+	if (rc < 0) {
+		free(netlink);
+		return -1;
+	}
+
+	netlink->fd = fds[0];
+	netlink->events_fd = -1;
+	netlink->seq = 1;
+	client->netlink = netlink;
+
+	return fds[1];
+}
+
+int ipc_client_netlink_close(struct ipc_client *client)
+{
+	struct ipc_client_netlink *netlink;
+
+	if (client == NULL)
+		return -1;
+
+	netlink = client->netlink;
+	if (netlink == NULL)
+		return 0;
+
+	if (netlink->fd >= 0)
+		close(netlink->fd);
+
+	if (netlink->events_fd >= 0)
+		close(netlink->events_fd);
+
+	free(netlink);
+	client->netlink = NULL;
+
+	return 0;
+}
+
+static struct nlmsghdr *ipc_client_netlink_message_add(
+	struct ipc_client_netlink *netlink, unsigned short type,
+	unsigned short flags, const void *data, size_t size)
+{
+	struct nlmsghdr *header;
+	size_t length;
+
+	length = NLMSG_SPACE(size);
+	if (netlink->size + length > sizeof(netlink->buffer))
+		return NULL;
+
+	header = (struct nlmsghdr *) (netlink->buffer + netlink->size);
+	memset(header, 0, length);
+
+	header->nlmsg_len = NLMSG_LENGTH(size);
+	header->nlmsg_type = type;
+	header->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK | flags;
+	header->nlmsg_seq = netlink->seq++;
+	memcpy(NLMSG_DATA(header), data, size);
+
+	netlink->size += length;
+	netlink->count++;
+
+	return header;
+}
+
+static int ipc_client_netlink_attribute_add(
+	struct ipc_client_netlink *netlink, struct nlmsghdr *header,
+	unsigned short type, const void *data, size_t size)
+{
+	struct rtattr *attribute;
+	size_t length;
+
+	length = RTA_SPACE(size);
+	if (netlink->size + length > sizeof(netlink->buffer))
+		return -1;
+
+	attribute = (struct rtattr *) ((unsigned char *) header +
+				       NLMSG_ALIGN(header->nlmsg_len));
+	memset(attribute, 0, length);
+
+	attribute->rta_type = type;
+	attribute->rta_len = RTA_LENGTH(size);
+	memcpy(RTA_DATA(attribute), data, size);
+
+	header->nlmsg_len = NLMSG_ALIGN(header->nlmsg_len) + length;
+	netlink->size += length;
+
+	return 0;
+}
+
+/* Returns -1 when a link change failed or addresses were queued as well */
+static int ipc_client_netlink_replay(struct ipc_client *client,
+				     unsigned int count)
+{
+	struct ipc_client_netlink *netlink = client->netlink;
+	struct ipc_client_netlink_link *link;
+	unsigned int failed = 0;
+	unsigned int i;
+	int rc;
+
+	ipc_client_log(client, "rtnetlink denied, using ioctl");
+	netlink->disabled = 1;
+
+	for (i = 0; i < netlink->links_count; i++) {
+		link = &netlink->links[i];
+
+		if (link->up)
+			rc = network_iface_up(link->iface, link->domain,
+					      link->type);
+		else
+			rc = network_iface_down(link->iface, link->domain,
+						link->type);
+
+		if (rc < 0) {
+			ipc_client_log(client, "Setting %s %s failed",
+				       link->iface, link->up ? "up" : "down");
+			failed++;
+		}
+	}
+
+	if (failed > 0 || count > netlink->links_count) {
+		errno = EACCES;
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Returns 0 once the deadline is reached */
+static int ipc_client_netlink_wait(int fd, const struct timespec *deadline)
+{
+	struct pollfd pollfd;
+	struct timespec now;
+	long long remaining;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	remaining = (long long) (deadline->tv_sec - now.tv_sec) * 1000 +
+		(deadline->tv_nsec - now.tv_nsec) / 1000000;
+	if (remaining <= 0)
+		return 0;
+
+	memset(&pollfd, 0, sizeof(pollfd));
+	pollfd.fd = fd;
+	pollfd.events = POLLIN;
+
+	return poll(&pollfd, 1, (int) remaining);
+}
+
+static int ipc_client_netlink_send(struct ipc_client *client)
+{
+	struct ipc_client_netlink *netlink = client->netlink;
+	unsigned char buffer[IPC_CLIENT_NETLINK_BUFFER_SIZE];
+	struct sockaddr_nl address;
+	struct timespec deadline;
+	struct nlmsghdr *header;
+	struct nlmsgerr *error;
+	unsigned int requests;
+	unsigned int count;
+	ssize_t length;
+	int err = 0;
+	int rc;
+
+	if (netlink->count == 0)
+		return 0;
+
+	memset(&address, 0, sizeof(address));
+	address.nl_family = AF_NETLINK;
+
+	requests = netlink->count;
+	count = requests;
+	netlink->count = 0;
+
+	rc = sendto(netlink->fd, netlink->buffer, netlink->size, 0,
+		    (struct sockaddr *) &address, sizeof(address));
+	netlink->size = 0;
+
+	if (rc < 0) {
+		err = errno;
+		goto complete;
+	}
+
+	ipc_client_deadline_set(&deadline, IPC_CLIENT_NETLINK_ACK_TIMEOUT);
+
+	while (count > 0) {
+		rc = ipc_client_netlink_wait(netlink->fd, &deadline);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+
+			err = errno;
+			goto complete;
+		}
+
+		if (rc == 0) {
+			err = ETIMEDOUT;
+			goto complete;
+		}
+
+		length = recv(netlink->fd, buffer, sizeof(buffer), 0);
+		if (length < 0) {
+			if (errno == EINTR)
+				continue;
+
+			err = errno;
+			goto complete;
+		}
+
+		if (length == 0) {
+			err = ECONNRESET;
+			goto complete;
+		}
+
+		for (header = (struct nlmsghdr *) buffer;
+		     NLMSG_OK(header, (size_t) length);
+		     header = NLMSG_NEXT(header, length)) {
+			if (header->nlmsg_type != NLMSG_ERROR)
+				continue;
+
+			error = (struct nlmsgerr *) NLMSG_DATA(header);
+
+			/* Only the first error is reported */
+			if (error->error != 0 && err == 0)
+				err = -error->error;
+
+			count--;
+		}
+	}
+
+complete:
+	/* Netlink writes can be denied by the security policy */
+	if (err == EACCES) {
+		rc = ipc_client_netlink_replay(client, requests);
+	} else if (err != 0) {
+		ipc_client_log(client, "rtnetlink request failed: %s",
+			       strerror(err));
+		errno = err;
+		rc = -1;
+	} else {
+		rc = 0;
+	}
+
+	netlink->links_count = 0;
+
+	return rc;
+}
+
+int ipc_client_netlink_batch_begin(struct ipc_client *client)
+{
+	int rc;
+
+	rc = ipc_client_netlink_open(client);
+	if (rc < 0)
+		return -1;
+
+	client->netlink->batch = 1;
+
+	return 0;
+}
+
+int ipc_client_netlink_batch_commit(struct ipc_client *client)
+{
+	if (client == NULL || client->netlink == NULL ||
+	    client->netlink->fd < 0) {
+		return -1;
+	}
+
+	client->netlink->batch = 0;
+
+	return ipc_client_netlink_send(client);
+}
+
+static int ipc_client_netlink_request(struct ipc_client *client)
+{
+	if (client->netlink->batch)
+		return 0;
+
+	return ipc_client_netlink_send(client);
+}
+
+static int ipc_client_netlink_link_set(struct ipc_client *client,
+				       const char *iface, int domain, int type,
+				       int up)
+{
+	struct ipc_client_netlink_link *link;
+	struct ifinfomsg message;
+	struct nlmsghdr *header;
+	unsigned int index;
+
+	index = if_nametoindex(iface);
+	if (index == 0) {
+		ipc_client_log(client, "Finding %s failed", iface);
+		return -1;
+	}
+
+	memset(&message, 0, sizeof(message));
+	message.ifi_family = AF_UNSPEC;
+	message.ifi_index = index;
+	message.ifi_flags = up ? IFF_UP : 0;
+	message.ifi_change = IFF_UP;
+
+	header = ipc_client_netlink_message_add(client->netlink, RTM_NEWLINK,
+						0, &message, sizeof(message));
+	if (header == NULL) {
+		/* The batch is full: send what was queued so far */
+		if (ipc_client_netlink_send(client) < 0)
+			return -1;
+
+		header = ipc_client_netlink_message_add(client->netlink,
+							RTM_NEWLINK, 0,
+							&message,
+							sizeof(message));
+		if (header == NULL)
+			return -1;
+	}
+
+	link = &client->netlink->links[client->netlink->links_count++];
+	strncpy(link->iface, iface, sizeof(link->iface) - 1);
+	link->iface[sizeof(link->iface) - 1] = '\0';
+	link->domain = domain;
+	link->type = type;
+	link->up = up;
+
+	return ipc_client_netlink_request(client);
+}
+
+static int ipc_client_iface_set(struct ipc_client *client, const char *iface,
+				int domain, int type, int up)
+{
+	int rc;
+
+	if (client == NULL || iface == NULL)
+		return -1;
+
+	/* Opening fails once rtnetlink was denied */
+	rc = ipc_client_netlink_open(client);
+	if (rc < 0)
+		goto fallback;
+
+	return ipc_client_netlink_link_set(client, iface, domain, type, up);
+
+fallback:
+	if (up)
+		return network_iface_up(iface, domain, type);
+	else
+		return network_iface_down(iface, domain, type);
+}
+
+int ipc_client_iface_up(struct ipc_client *client, const char *iface,
+			int domain, int type)
+{
+	return ipc_client_iface_set(client, iface, domain, type, 1);
+}
+
+int ipc_client_iface_down(struct ipc_client *client, const char *iface,
+			  int domain, int type)
+{
+	return ipc_client_iface_set(client, iface, domain, type, 0);
+}
+
+int ipc_client_iface_address_add(struct ipc_client *client, const char *iface,
+				 int family, const void *address,
+				 unsigned char prefix_length)
+{
+	struct ifaddrmsg message;
+	struct nlmsghdr *header;
+	unsigned int index;
+	size_t offset;
+	size_t size;
+	int rc;
+
+	if (client == NULL || iface == NULL || address == NULL)
+		return -1;
+
+	switch (family) {
+	case AF_INET:
+		size = 4;
+		break;
+	case AF_INET6:
+		size = 16;
+		break;
+	default:
+		return -1;
+	}
+
+	if (prefix_length > size * 8)
+		return -1;
+
+	/* There is no ioctl fallback for addresses */
+	rc = ipc_client_netlink_open(client);
+	if (rc < 0)
+		return -1;
+
+	index = if_nametoindex(iface);
+	if (index == 0) {
+		ipc_client_log(client, "Finding %s failed", iface);
+		return -1;
+	}
+
+	memset(&message, 0, sizeof(message));
+	message.ifa_family = family;
+	message.ifa_prefixlen = prefix_length;
+	message.ifa_index = index;
+
+	if (client->netlink->size + NLMSG_SPACE(sizeof(message)) +
+	    2 * RTA_SPACE(size) > sizeof(client->netlink->buffer)) {
+		rc = ipc_client_netlink_send(client);
+		if (rc < 0)
+			return -1;
+	}
+
+	offset = client->netlink->size;
+
+	header = ipc_client_netlink_message_add(client->netlink, RTM_NEWADDR,
+						NLM_F_CREATE | NLM_F_REPLACE,
+						&message, sizeof(message));
+	if (header == NULL)
+		return -1;
+
+	rc = ipc_client_netlink_attribute_add(client->netlink, header,
+					      IFA_LOCAL, address, size);
+	if (rc < 0)
+		goto error;
+
+	rc = ipc_client_netlink_attribute_add(client->netlink, header,
+					      IFA_ADDRESS, address, size);
+	if (rc < 0)
+		goto error;
+
+	return ipc_client_netlink_request(client);
+
+error:
+	/* The incomplete request isn't sent */
+	client->netlink->size = offset;
+	client->netlink->count--;
+
+	return -1;
+}
+
+/*
+ * Returns a non-blocking file descriptor to poll for link events, which are
+ * then read with ipc_client_netlink_event_read.
+ */
+int ipc_client_netlink_subscribe(struct ipc_client *client)
+{
+	struct ipc_client_netlink *netlink;
+	struct sockaddr_nl address;
+	int fd;
+	int rc;
+
+	rc = ipc_client_netlink_open(client);
+	if (rc < 0)
+		return -1;
+
+	netlink = client->netlink;
+	if (netlink->events_fd >= 0)
+		return netlink->events_fd;
+
+	fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK,
+		    NETLINK_ROUTE);
+	if (fd < 0)
+		return -1;
+
+	memset(&address, 0, sizeof(address));
+	address.nl_family = AF_NETLINK;
+	address.nl_groups = RTMGRP_LINK;
+
+	rc = bind(fd, (struct sockaddr *) &address, sizeof(address));
+	if (rc < 0) {
+		ipc_client_log(client, "Subscribing to link events failed: %s",
+			       strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	netlink->events_fd = fd;
+
+	return fd;
+}
+
+/*
+ * Returns the number of events read, which is 0 when none is pending. The
+ * events of a single datagram that don't fit in the array are dropped.
+ */
+int ipc_client_netlink_event_read(struct ipc_client *client,
+				  struct ipc_netlink_link_event *events,
+				  unsigned int count)
+{
+	unsigned char buffer[IPC_CLIENT_NETLINK_BUFFER_SIZE];
+	struct ipc_netlink_link_event *event;
+	struct nlmsghdr *header;
+	struct ifinfomsg *message;
+	struct rtattr *attribute;
+	unsigned int index = 0;
+	ssize_t length;
+	int size;
+
+	if (client == NULL || client->netlink == NULL ||
+	    client->netlink->events_fd < 0 || events == NULL) {
+		return -1;
+	}
+
+	length = recv(client->netlink->events_fd, buffer, sizeof(buffer), 0);
+	if (length < 0)
+		return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+
+	for (header = (struct nlmsghdr *) buffer;
+	     NLMSG_OK(header, (size_t) length) && index < count;
+	     header = NLMSG_NEXT(header, length)) {
+		if (header->nlmsg_type != RTM_NEWLINK &&
+		    header->nlmsg_type != RTM_DELLINK) {
+			continue;
+		}
+
+		if (header->nlmsg_len < NLMSG_LENGTH(sizeof(*message)))
+			continue;
+
+		message = (struct ifinfomsg *) NLMSG_DATA(header);
+
+		event = &events[index++];
+		memset(event, 0, sizeof(*event));
+		event->index = message->ifi_index;
+		event->flags = message->ifi_flags;
+		event->removed = header->nlmsg_type == RTM_DELLINK;
+
+		size = IFLA_PAYLOAD(header);
+		for (attribute = IFLA_RTA(message); RTA_OK(attribute, size);
+		     attribute = RTA_NEXT(attribute, size)) {
+			if (attribute->rta_type != IFLA_IFNAME)
+				continue;
+
+			strncpy(event->iface, RTA_DATA(attribute),
+				sizeof(event->iface) - 1);
+		}
+	}
+
+	return index;
+}
@@ -0,0 +1,241 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <samsung-ipc.h>
+
+#include "ipc.h"
+
+/*
+ * Without the output queue, the frames are written in full before the send
+ * returns. With the queue, what the transport doesn't accept right away is
+ * kept, in order, until ipc_client_output_flush manages to write it.
+ */
+
+struct ipc_client_output_frame {
+	struct ipc_client_output_frame *next;
+	size_t size;
+	size_t offset;
+	unsigned char data[];
+};
+
+struct ipc_client_output {
+	struct ipc_client_output_frame *head;
+	struct ipc_client_output_frame *tail;
+	size_t queued;
+
+	size_t high_watermark;
+	int above;
+	void (*callback)(void *data, size_t queued);
+	void *callback_data;
+};
+
+int ipc_client_output_enable(struct ipc_client *client, size_t high_watermark,
+			     void (*callback)(void *data, size_t queued),
+			     void *data)
+{
+	struct ipc_client_output *output;
+
+	if (client == NULL)
+		return -1;
+
+	if (client->output == NULL) {
+		client->output = calloc(1, sizeof(struct ipc_client_output));
+		if (client->output == NULL)
+			return -1;
+	}
+
+	output = client->output;
+
+	output->high_watermark = high_watermark;
+	output->callback = callback;
+	output->callback_data = data;
+
+	return 0;
+}
+
+void ipc_client_output_destroy(struct ipc_client *client)
+{
+	struct ipc_client_output_frame *frame;
+	struct ipc_client_output_frame *next;
+
+	if (client == NULL || client->output == NULL)
+		return;
+
+	frame = client->output->head;
+	while (frame != NULL) {
+		next = frame->next;
+		free(frame);
+		frame = next;
+	}
+
+	free(client->output);
+	client->output = NULL;
+}
+
+size_t ipc_client_output_pending(struct ipc_client *client)
+{
+	if (client == NULL || client->output == NULL)
+		return 0;
+
+	return client->output->queued;
+}
+
+/* Returns the count of written bytes, 0 when the transport would block */
+static int ipc_client_output_write(struct ipc_client *client,
+				   const void *data, size_t size)
+{
+	int rc;
+
+	errno = 0;
+
+	rc = ipc_client_handlers_write(client, data, size);
+	if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		return 0;
+
+	return rc;
+}
+
+static void ipc_client_output_watermark(struct ipc_client *client)
+{
+	struct ipc_client_output *output = client->output;
+	int above;
+
+	if (output->high_watermark == 0)
+		return;
+
+	above = output->queued >= output->high_watermark;
+	if (above == output->above)
+		return;
+
+	output->above = above;
+
+	if (output->callback != NULL)
+		output->callback(output->callback_data, output->queued);
+}
+
+int ipc_client_transport_write(struct ipc_client *client, const void *data,
+			       size_t size)
+{
+	struct ipc_client_output_frame *frame;
+	struct ipc_client_output *output;
+	const unsigned char *p = data;
+	size_t count = 0;
+	int rc;
+
+	if (client == NULL || client->handlers == NULL ||
+	    client->handlers->write == NULL || data == NULL)
+		return -1;
+
+	output = client->output;
+
+	if (output == NULL) {
+		while (count < size) {
+			rc = ipc_client_handlers_write(client, p + count,
+						       size - count);
+			if (rc <= 0)
+				return -1;
+
+			count += rc;
+		}
+
+		return 0;
+	}
+
+	/* The frames must not overtake the ones that are already queued */
+	while (output->head == NULL && count < size) {
+		rc = ipc_client_output_write(client, p + count, size - count);
+		if (rc < 0)
+			return -1;
+		else if (rc == 0)
+			break;
+
+		count += rc;
+	}
+
+	if (count == size)
+		return 0;
+
+	IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
+
+	frame = malloc(sizeof(struct ipc_client_output_frame) + size - count);
+	if (frame == NULL)
+		return -1;
+
+	memcpy(frame->data, p + count, size - count);
+	frame->size = size - count;
+	frame->offset = 0;
+	frame->next = NULL;
+
+	if (output->tail != NULL)
+		output->tail->next = frame;
+	else
+		output->head = frame;
+
+	output->tail = frame;
+	output->queued += frame->size;
+
+	ipc_client_output_watermark(client);
+
+	return IPC_CLIENT_SEND_QUEUED;
+}
+
+int ipc_client_output_flush(struct ipc_client *client)
+{
+	struct ipc_client_output_frame *frame;
+	struct ipc_client_output *output;
+	int rc;
+
+	if (client == NULL || client->handlers == NULL ||
+	    client->handlers->write == NULL || client->output == NULL)
+		return -1;
+
+	output = client->output;
+
+	while (output->head != NULL) {
+		frame = output->head;
+
+		rc = ipc_client_output_write(client,
+					     frame->data + frame->offset,
+					     frame->size - frame->offset);
+		if (rc < 0) {
+			ipc_client_log(client, "Writing queued data failed");
+			return -1;
+		} else if (rc == 0) {
+			break;
+		}
+
+		frame->offset += rc;
+		output->queued -= rc;
+
+		if (frame->offset < frame->size)
+			continue;
+
+		output->head = frame->next;
+		if (output->head == NULL)
+			output->tail = NULL;
+
+		free(frame);
+	}
+
+	ipc_client_output_watermark(client);
+
+	return output->queued;
+}
@@ -0,0 +1,335 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <samsung-ipc.h>
+
+#include "ipc.h"
+
+/*
+ * Each priority class has its own queue, and draining always starts with the
+ * highest priority class. A class that reached its limit of outstanding
+ * requests doesn't hold back the lower priority classes. The requests are
+ * outstanding from the time they are sent until the response with the same
+ * sequence is received, or until they time out.
+ */
+
+struct ipc_client_scheduler_entry {
+	unsigned char mseq;
+	unsigned short command;
+	unsigned char type;
+	void *data;
+	size_t size;
+	unsigned long long queued;
+
+	struct ipc_client_scheduler_entry *next;
+};
+
+struct ipc_client_scheduler_class {
+	struct ipc_client_scheduler_entry *head;
+	struct ipc_client_scheduler_entry *tail;
+	unsigned int limit;
+
+	struct ipc_client_scheduler_stats stats;
+};
+
+struct ipc_client_scheduler_outstanding {
+	unsigned char pending;
+	unsigned char priority;
+	unsigned long long sent;
+};
+
+struct ipc_client_scheduler {
+	struct ipc_client_scheduler_class classes[IPC_CLIENT_PRIORITY_COUNT];
+	unsigned int timeout;
+
+	/* Indexed by mseq */
+	struct ipc_client_scheduler_outstanding outstanding[256];
+};
+
+static unsigned long long ipc_client_scheduler_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (unsigned long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int ipc_client_priority_get(unsigned short command)
+{
+	switch (IPC_GROUP(command)) {
+	case IPC_GROUP_CALL:
+	case IPC_GROUP_SS:
+		return IPC_CLIENT_PRIORITY_CALL;
+	case IPC_GROUP_SEC:
+		return IPC_CLIENT_PRIORITY_SEC;
+	case IPC_GROUP_NET:
+	case IPC_GROUP_GPRS:
+		return IPC_CLIENT_PRIORITY_NET;
+	default:
+		return IPC_CLIENT_PRIORITY_BULK;
+	}
+}
+
+int ipc_client_scheduler_enable(struct ipc_client *client,
+				const unsigned int *limits,
+				unsigned int timeout)
+{
+	struct ipc_client_scheduler *scheduler;
+	unsigned int i;
+
+	if (client == NULL)
+		return -1;
+
+	if (client->scheduler == NULL) {
+		client->scheduler = calloc(1,
+					   sizeof(struct ipc_client_scheduler));
+		if (client->scheduler == NULL)
+			return -1;
+	}
+
+	scheduler = client->scheduler;
+
+	for (i = 0; i < IPC_CLIENT_PRIORITY_COUNT; i++)
+		scheduler->classes[i].limit = limits != NULL ? limits[i] : 0;
+
+	scheduler->timeout = timeout;
+
+	return 0;
+}
+
+void ipc_client_scheduler_destroy(struct ipc_client *client)
+{
+	struct ipc_client_scheduler_entry *entry;
+	struct ipc_client_scheduler_entry *next;
+	unsigned int i;
+
+	if (client == NULL || client->scheduler == NULL)
+		return;
+
+	for (i = 0; i < IPC_CLIENT_PRIORITY_COUNT; i++) {
+		entry = client->scheduler->classes[i].head;
+		while (entry != NULL) {
+			next = entry->next;
+			if (entry->data != NULL)
+				free(entry->data);
+			free(entry);
+			entry = next;
+		}
+	}
+
+	free(client->scheduler);
+	client->scheduler = NULL;
+}
+
+int ipc_client_queue(struct ipc_client *client, unsigned char mseq,
+		     unsigned short command, unsigned char type,
+		     const void *data, size_t size)
+{
+	struct ipc_client_scheduler_entry *entry;
+	struct ipc_client_scheduler_class *class;
+
+	if (client == NULL)
+		return -1;
+
+	if (client->scheduler == NULL)
+		return ipc_client_send(client, mseq, command, type, data,
+				       size);
+
+	IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
+	entry = calloc(1, sizeof(struct ipc_client_scheduler_entry));
+	if (entry == NULL)
+		return -1;
+
+	if (data != NULL && size > 0) {
+		IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
+		entry->data = malloc(size);
+		if (entry->data == NULL) {
+			free(entry);
+			return -1;
+		}
+
+		memcpy(entry->data, data, size);
+		entry->size = size;
+	}
+
+	entry->mseq = mseq;
+	entry->command = command;
+	entry->type = type;
+	entry->queued = ipc_client_scheduler_now();
+
+	class = &client->scheduler->classes[ipc_client_priority_get(command)];
+
+	if (class->tail != NULL)
+		class->tail->next = entry;
+	else
+		class->head = entry;
+
+	class->tail = entry;
+	class->stats.queued++;
+
+	return 0;
+}
+
+static void ipc_client_scheduler_release(
+	struct ipc_client_scheduler *scheduler,
+	struct ipc_client_scheduler_outstanding *outstanding)
+{
+	outstanding->pending = 0;
+	scheduler->classes[outstanding->priority].stats.outstanding--;
+}
+
+static void ipc_client_scheduler_expire(struct ipc_client *client,
+					unsigned long long now)
+{
+	struct ipc_client_scheduler *scheduler = client->scheduler;
+	struct ipc_client_scheduler_outstanding *outstanding;
+	unsigned int i;
+
+	if (scheduler->timeout == 0)
+		return;
+
+	for (i = 0; i < 256; i++) {
+		outstanding = &scheduler->outstanding[i];
+		if (!outstanding->pending ||
+		    now - outstanding->sent <
+		    (unsigned long long) scheduler->timeout * 1000)
+			continue;
+
+		ipc_client_log(client, "Request with sequence 0x%x timed out",
+			       i);
+
+		scheduler->classes[outstanding->priority].stats.expired++;
+		ipc_client_scheduler_release(scheduler, outstanding);
+	}
+}
+
+int ipc_client_scheduler_drain(struct ipc_client *client)
+{
+	struct ipc_client_scheduler_outstanding *outstanding;
+	struct ipc_client_scheduler_entry *entry;
+	struct ipc_client_scheduler_class *class;
+	struct ipc_client_scheduler *scheduler;
+	unsigned long long delay;
+	unsigned long long now;
+	int count = 0;
+	int rc;
+	int i;
+
+	if (client == NULL || client->scheduler == NULL)
+		return -1;
+
+	scheduler = client->scheduler;
+
+	now = ipc_client_scheduler_now();
+	ipc_client_scheduler_expire(client, now);
+
+	for (i = 0; i < IPC_CLIENT_PRIORITY_COUNT; i++) {
+		class = &scheduler->classes[i];
+
+		while (class->head != NULL) {
+			if (class->limit > 0 &&
+			    class->stats.outstanding >= class->limit)
+				break;
+
+			entry = class->head;
+
+			rc = ipc_client_send(client, entry->mseq,
+					     entry->command, entry->type,
+					     entry->data, entry->size);
+			if (rc < 0)
+				return -1;
+
+			class->head = entry->next;
+			if (class->head == NULL)
+				class->tail = NULL;
+
+			now = ipc_client_scheduler_now();
+			delay = now - entry->queued;
+
+			class->stats.queued--;
+			class->stats.sent++;
+			class->stats.delay_total += delay;
+			if (delay > class->stats.delay_max)
+				class->stats.delay_max = delay;
+
+			/* Only the requests get a response from the modem */
+			if (entry->type == IPC_TYPE_EXEC ||
+			    entry->type == IPC_TYPE_GET ||
+			    entry->type == IPC_TYPE_SET) {
+				outstanding =
+					&scheduler->outstanding[entry->mseq];
+				if (outstanding->pending)
+					ipc_client_scheduler_release(
+						scheduler, outstanding);
+
+				outstanding->pending = 1;
+				outstanding->priority = i;
+				outstanding->sent = now;
+				class->stats.outstanding++;
+			}
+
+			if (entry->data != NULL)
+				free(entry->data);
+			free(entry);
+
+			count++;
+		}
+	}
+
+	return count;
+}
+
+void ipc_client_scheduler_recv(struct ipc_client *client,
+			       const struct ipc_message *message)
+{
+	struct ipc_client_scheduler_outstanding *outstanding;
+	struct ipc_client_scheduler *scheduler;
+
+	if (client == NULL || client->scheduler == NULL || message == NULL)
+		return;
+
+	if (message->type != IPC_TYPE_RESP &&
+	    message->command != IPC_GEN_PHONE_RES)
+		return;
+
+	scheduler = client->scheduler;
+
+	outstanding = &scheduler->outstanding[message->aseq];
+	if (!outstanding->pending)
+		return;
+
+	ipc_client_scheduler_release(scheduler, outstanding);
+}
+
+int ipc_client_scheduler_stats_get(struct ipc_client *client,
+				   unsigned int priority,
+				   struct ipc_client_scheduler_stats *stats)
+{
+	if (client == NULL || client->scheduler == NULL ||
+	    priority >= IPC_CLIENT_PRIORITY_COUNT || stats == NULL)
+		return -1;
+
+	memcpy(stats, &client->scheduler->classes[priority].stats,
+	       sizeof(struct ipc_client_scheduler_stats));
+
+	return 0;
+}
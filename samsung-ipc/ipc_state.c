@@ -0,0 +1,390 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <samsung-ipc.h>
+
+#include "ipc.h"
+
+/*
+ * The state is only written from the receive path and is published with a
+ * sequence counter: it is odd while the state is being copied, and readers
+ * retry until they get a copy that was made with the same even sequence on
+ * both ends. Readers therefore never block the receive path, and the receive
+ * path never waits for the readers. The published copy is made of words that
+ * are only accessed atomically, so that a torn copy is discarded without the
+ * reader and the writer ever racing. The receive path keeps its own copy of
+ * the state, that it compares the updates with.
+ *
+ * The subscriptions are protected by a lock, but the callbacks are called
+ * from a copy of the table, without holding it.
+ */
+
+#define IPC_CLIENT_STATE_SUBSCRIPTIONS	8
+
+#define IPC_CLIENT_STATE_WORDS						\
+	((sizeof(struct ipc_client_state) + sizeof(unsigned long) - 1) /	\
+	 sizeof(unsigned long))
+
+union ipc_client_state_words {
+	struct ipc_client_state state;
+	unsigned long words[IPC_CLIENT_STATE_WORDS];
+};
+
+struct ipc_client_state_subscription {
+	unsigned int mask;
+	void (*callback)(void *data, unsigned int changed,
+			 const struct ipc_client_state *state);
+	void *data;
+};
+
+struct ipc_client_state_store {
+	unsigned int sequence;
+	unsigned long published[IPC_CLIENT_STATE_WORDS];
+
+	/* Only used by the receive path */
+	struct ipc_client_state state;
+
+	pthread_mutex_t lock;
+	struct ipc_client_state_subscription
+		subscriptions[IPC_CLIENT_STATE_SUBSCRIPTIONS];
+};
+
+static unsigned long long ipc_client_state_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (unsigned long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int ipc_client_state_enable(struct ipc_client *client)
+{
+	if (client == NULL)
+		return -1;
+
+	if (client->state != NULL)
+		return 0;
+
+	client->state = calloc(1, sizeof(struct ipc_client_state_store));
+	if (client->state == NULL)
+		return -1;
+
+	pthread_mutex_init(&client->state->lock, NULL);
+
+	return 0;
+}
+
+void ipc_client_state_destroy(struct ipc_client *client)
+{
+	if (client == NULL || client->state == NULL)
+		return;
+
+	pthread_mutex_destroy(&client->state->lock);
+	free(client->state);
+	client->state = NULL;
+}
+
+int ipc_client_state_get(struct ipc_client *client,
+			 struct ipc_client_state *state)
+{
+	struct ipc_client_state_store *store;
+	union ipc_client_state_words copy;
+	unsigned int begin;
+	unsigned int end;
+	unsigned int i;
+
+	if (client == NULL || client->state == NULL || state == NULL)
+		return -1;
+
+	store = client->state;
+
+	do {
+		begin = __atomic_load_n(&store->sequence, __ATOMIC_ACQUIRE);
+		if (begin & 1)
+			continue;
+
+		for (i = 0; i < IPC_CLIENT_STATE_WORDS; i++)
+			copy.words[i] = __atomic_load_n(&store->published[i],
+							__ATOMIC_RELAXED);
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		end = __atomic_load_n(&store->sequence, __ATOMIC_RELAXED);
+	} while ((begin & 1) || begin != end);
+
+	memcpy(state, &copy.state, sizeof(struct ipc_client_state));
+
+	return 0;
+}
+
+int ipc_client_state_subscribe(
+	struct ipc_client *client, unsigned int mask,
+	void (*callback)(void *data, unsigned int changed,
+			 const struct ipc_client_state *state),
+	void *data)
+{
+	struct ipc_client_state_subscription *subscription;
+	int i;
+
+	if (client == NULL || client->state == NULL || callback == NULL ||
+	    mask == 0)
+		return -1;
+
+	pthread_mutex_lock(&client->state->lock);
+
+	for (i = 0; i < IPC_CLIENT_STATE_SUBSCRIPTIONS; i++) {
+		subscription = &client->state->subscriptions[i];
+		if (subscription->callback != NULL)
+			continue;
+
+		subscription->mask = mask;
+		subscription->callback = callback;
+		subscription->data = data;
+
+		pthread_mutex_unlock(&client->state->lock);
+
+		return i;
+	}
+
+	pthread_mutex_unlock(&client->state->lock);
+
+	ipc_client_log(client, "No subscription left for the state");
+
+	return -1;
+}
+
+int ipc_client_state_unsubscribe(struct ipc_client *client, int id)
+{
+	if (client == NULL || client->state == NULL || id < 0 ||
+	    id >= IPC_CLIENT_STATE_SUBSCRIPTIONS)
+		return -1;
+
+	pthread_mutex_lock(&client->state->lock);
+	memset(&client->state->subscriptions[id], 0,
+	       sizeof(struct ipc_client_state_subscription));
+	pthread_mutex_unlock(&client->state->lock);
+
+	return 0;
+}
+
+static void ipc_client_state_regist_setup(
+	struct ipc_client_state_regist *regist,
+	const struct ipc_net_regist_response_data *data)
+{
+	regist->act = data->act;
+	regist->status = data->status;
+	regist->edge = data->edge;
+	regist->lac = data->lac;
+	regist->cid = data->cid;
+	regist->fail_cause = data->fail_cause;
+}
+
+/* Returns the mask of the fields that the message reports */
+static unsigned int ipc_client_state_parse(struct ipc_client_state *state,
+					   const struct ipc_message *message)
+{
+	const struct ipc_disp_icon_info_response_data *icon_info;
+	const struct ipc_disp_rssi_info_data *rssi_info;
+	const struct ipc_net_regist_response_data *regist;
+	const struct ipc_net_serving_network_data *serving_network;
+	const struct ipc_gprs_hsdpa_status_data *hsdpa_status;
+	unsigned int fields = 0;
+
+	if (message->data == NULL)
+		return 0;
+
+	switch (message->command) {
+	case IPC_DISP_ICON_INFO:
+		if (message->size < sizeof(*icon_info))
+			break;
+
+		icon_info = message->data;
+
+		/* The flags select one icon, or all of them, not a set */
+		if (icon_info->flags == IPC_DISP_ICON_INFO_FLAG_RSSI ||
+		    icon_info->flags == IPC_DISP_ICON_INFO_FLAG_ALL) {
+			state->rssi = icon_info->rssi;
+			fields |= IPC_CLIENT_STATE_MASK(IPC_CLIENT_STATE_RSSI);
+		}
+		if (icon_info->flags == IPC_DISP_ICON_INFO_FLAG_HDR_RSSI ||
+		    icon_info->flags == IPC_DISP_ICON_INFO_FLAG_ALL) {
+			state->hdr_rssi = icon_info->hdr_rssi;
+			fields |= IPC_CLIENT_STATE_MASK(
+				IPC_CLIENT_STATE_HDR_RSSI);
+		}
+		if (icon_info->flags == IPC_DISP_ICON_INFO_FLAG_BATTERY ||
+		    icon_info->flags == IPC_DISP_ICON_INFO_FLAG_ALL) {
+			state->battery = icon_info->battery;
+			fields |= IPC_CLIENT_STATE_MASK(
+				IPC_CLIENT_STATE_BATTERY);
+		}
+		break;
+	case IPC_DISP_RSSI_INFO:
+		if (message->size < sizeof(*rssi_info))
+			break;
+
+		rssi_info = message->data;
+		state->rssi = rssi_info->rssi;
+		fields |= IPC_CLIENT_STATE_MASK(IPC_CLIENT_STATE_RSSI);
+		break;
+	case IPC_NET_REGIST:
+		if (message->type == IPC_TYPE_GET ||
+		    message->size < sizeof(*regist))
+			break;
+
+		regist = message->data;
+
+		if (regist->domain == IPC_NET_SERVICE_DOMAIN_GSM) {
+			ipc_client_state_regist_setup(&state->regist_gsm,
+						      regist);
+			fields |= IPC_CLIENT_STATE_MASK(
+				IPC_CLIENT_STATE_REGIST_GSM);
+		} else if (regist->domain == IPC_NET_SERVICE_DOMAIN_GPRS) {
+			ipc_client_state_regist_setup(&state->regist_gprs,
+						      regist);
+			fields |= IPC_CLIENT_STATE_MASK(
+				IPC_CLIENT_STATE_REGIST_GPRS);
+		}
+		break;
+	case IPC_NET_SERVING_NETWORK:
+		if (message->size < sizeof(*serving_network))
+			break;
+
+		serving_network = message->data;
+
+		memset(state->plmn, 0, sizeof(state->plmn));
+		memcpy(state->plmn, serving_network->plmn,
+		       sizeof(serving_network->plmn));
+		state->lac = serving_network->lac;
+		fields |= IPC_CLIENT_STATE_MASK(
+			IPC_CLIENT_STATE_SERVING_NETWORK);
+		break;
+	case IPC_GPRS_HSDPA_STATUS:
+		if (message->size < sizeof(*hsdpa_status))
+			break;
+
+		hsdpa_status = message->data;
+		state->hsdpa_status = hsdpa_status->status;
+		fields |= IPC_CLIENT_STATE_MASK(IPC_CLIENT_STATE_HSDPA_STATUS);
+		break;
+	}
+
+	return fields;
+}
+
+static unsigned int ipc_client_state_changed(
+	const struct ipc_client_state *old, const struct ipc_client_state *new,
+	unsigned int fields)
+{
+	unsigned int changed;
+
+	changed = fields & ~old->valid;
+	if (old->rssi != new->rssi)
+		changed |= IPC_CLIENT_STATE_MASK(IPC_CLIENT_STATE_RSSI);
+	if (old->hdr_rssi != new->hdr_rssi)
+		changed |= IPC_CLIENT_STATE_MASK(IPC_CLIENT_STATE_HDR_RSSI);
+	if (old->battery != new->battery)
+		changed |= IPC_CLIENT_STATE_MASK(IPC_CLIENT_STATE_BATTERY);
+	if (memcmp(&old->regist_gsm, &new->regist_gsm,
+		   sizeof(struct ipc_client_state_regist)))
+		changed |= IPC_CLIENT_STATE_MASK(IPC_CLIENT_STATE_REGIST_GSM);
+	if (memcmp(&old->regist_gprs, &new->regist_gprs,
+		   sizeof(struct ipc_client_state_regist)))
+		changed |= IPC_CLIENT_STATE_MASK(IPC_CLIENT_STATE_REGIST_GPRS);
+	if (memcmp(old->plmn, new->plmn, sizeof(old->plmn)) ||
+	    old->lac != new->lac)
+		changed |= IPC_CLIENT_STATE_MASK(
+			IPC_CLIENT_STATE_SERVING_NETWORK);
+	if (old->hsdpa_status != new->hsdpa_status)
+		changed |= IPC_CLIENT_STATE_MASK(
+			IPC_CLIENT_STATE_HSDPA_STATUS);
+
+	return changed & fields;
+}
+
+void ipc_client_state_update(struct ipc_client *client,
+			     const struct ipc_message *message)
+{
+	struct ipc_client_state_subscription
+		subscriptions[IPC_CLIENT_STATE_SUBSCRIPTIONS];
+	struct ipc_client_state_subscription *subscription;
+	struct ipc_client_state_store *store;
+	union ipc_client_state_words copy;
+	struct ipc_client_state state;
+	unsigned long long now;
+	unsigned int sequence;
+	unsigned int changed;
+	unsigned int fields;
+	unsigned int i;
+
+	if (client == NULL || client->state == NULL || message == NULL)
+		return;
+
+	store = client->state;
+
+	memcpy(&state, &store->state, sizeof(struct ipc_client_state));
+
+	fields = ipc_client_state_parse(&state, message);
+	if (fields == 0)
+		return;
+
+	changed = ipc_client_state_changed(&store->state, &state, fields);
+
+	now = ipc_client_state_now();
+	for (i = 0; i < IPC_CLIENT_STATE_COUNT; i++) {
+		if (fields & IPC_CLIENT_STATE_MASK(i))
+			state.timestamps[i] = now;
+	}
+	state.valid |= fields;
+
+	memcpy(&store->state, &state, sizeof(struct ipc_client_state));
+
+	memset(&copy, 0, sizeof(copy));
+	memcpy(&copy.state, &state, sizeof(struct ipc_client_state));
+
+	sequence = store->sequence;
+	__atomic_store_n(&store->sequence, sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	for (i = 0; i < IPC_CLIENT_STATE_WORDS; i++)
+		__atomic_store_n(&store->published[i], copy.words[i],
+				 __ATOMIC_RELAXED);
+
+	__atomic_store_n(&store->sequence, sequence + 2, __ATOMIC_RELEASE);
+
+	if (changed == 0)
+		return;
+
+	pthread_mutex_lock(&store->lock);
+	memcpy(subscriptions, store->subscriptions, sizeof(subscriptions));
+	pthread_mutex_unlock(&store->lock);
+
+	for (i = 0; i < IPC_CLIENT_STATE_SUBSCRIPTIONS; i++) {
+		subscription = &subscriptions[i];
+		if (subscription->callback == NULL ||
+		    !(subscription->mask & changed))
+			continue;
+
+		subscription->callback(subscription->data,
+				       subscription->mask & changed, &state);
+	}
+}
@@ -0,0 +1,337 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <samsung-ipc.h>
+
+#include "ipc.h"
+
+/*
+ * The requests are timestamped when they are sent, in a table indexed by
+ * their sequence, and the round trip time is recorded when the response with
+ * the same sequence is received. Each command has a log-linear histogram:
+ * values below IPC_CLIENT_STATS_SUB_BUCKETS microseconds are exact, and each
+ * power of two above it is split in IPC_CLIENT_STATS_SUB_BUCKETS buckets, so
+ * the error is below 1/IPC_CLIENT_STATS_SUB_BUCKETS. The commands are kept in
+ * a fixed size table from the time they are first sent, and the ones that
+ * don't fit anymore are only counted.
+ */
+
+#define IPC_CLIENT_STATS_SUB_BITS	3
+#define IPC_CLIENT_STATS_SUB_BUCKETS	(1 << IPC_CLIENT_STATS_SUB_BITS)
+#define IPC_CLIENT_STATS_VALUE_MAX	0xFFFFFFFFULL
+
+struct ipc_client_stats_outstanding {
+	unsigned char pending;
+	unsigned short command;
+	unsigned long long sent;
+};
+
+struct ipc_client_stats_entry {
+	unsigned char used;
+	struct ipc_client_stats stats;
+	unsigned int buckets[IPC_CLIENT_STATS_BUCKETS];
+};
+
+struct ipc_client_stats_store {
+	struct ipc_client_stats_entry entries[IPC_CLIENT_STATS_COMMANDS];
+	unsigned long dropped;
+
+	/* Indexed by mseq */
+	struct ipc_client_stats_outstanding outstanding[256];
+};
+
+static unsigned long long ipc_client_stats_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (unsigned long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static unsigned int ipc_client_stats_bucket(unsigned long long value)
+{
+	unsigned int msb;
+
+	if (value < IPC_CLIENT_STATS_SUB_BUCKETS)
+		return value;
+
+	if (value > IPC_CLIENT_STATS_VALUE_MAX)
+		value = IPC_CLIENT_STATS_VALUE_MAX;
+
+	msb = 63 - __builtin_clzll(value);
+
+	return (msb - IPC_CLIENT_STATS_SUB_BITS + 1) *
+		IPC_CLIENT_STATS_SUB_BUCKETS +
+		(value >> (msb - IPC_CLIENT_STATS_SUB_BITS)) -
+		IPC_CLIENT_STATS_SUB_BUCKETS;
+}
+
+unsigned long long ipc_client_stats_bucket_value(unsigned int bucket)
+{
+	unsigned int shift;
+
+	if (bucket < IPC_CLIENT_STATS_SUB_BUCKETS)
+		return bucket;
+
+	if (bucket >= IPC_CLIENT_STATS_BUCKETS)
+		bucket = IPC_CLIENT_STATS_BUCKETS - 1;
+
+	shift = bucket / IPC_CLIENT_STATS_SUB_BUCKETS - 1;
+
+	/* The highest value that falls in the bucket */
+	return (((unsigned long long) IPC_CLIENT_STATS_SUB_BUCKETS +
+		 bucket % IPC_CLIENT_STATS_SUB_BUCKETS + 1) << shift) - 1;
+}
+
+static struct ipc_client_stats_entry *ipc_client_stats_entry_find(
+	struct ipc_client_stats_store *store, unsigned short command,
+	int create)
+{
+	struct ipc_client_stats_entry *entry;
+	unsigned int index;
+	unsigned int i;
+
+	index = (command ^ (command >> 8) * 7) % IPC_CLIENT_STATS_COMMANDS;
+
+	for (i = 0; i < IPC_CLIENT_STATS_COMMANDS; i++) {
+		entry = &store->entries[(index + i) %
+					IPC_CLIENT_STATS_COMMANDS];
+
+		if (entry->used && entry->stats.command == command)
+			return entry;
+
+		if (!entry->used) {
+			if (!create)
+				return NULL;
+
+			entry->used = 1;
+			entry->stats.command = command;
+
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+int ipc_client_stats_enable(struct ipc_client *client)
+{
+	if (client == NULL)
+		return -1;
+
+	if (client->stats != NULL)
+		return 0;
+
+	client->stats = calloc(1, sizeof(struct ipc_client_stats_store));
+	if (client->stats == NULL)
+		return -1;
+
+	return 0;
+}
+
+void ipc_client_stats_destroy(struct ipc_client *client)
+{
+	if (client == NULL || client->stats == NULL)
+		return;
+
+	free(client->stats);
+	client->stats = NULL;
+}
+
+int ipc_client_stats_reset(struct ipc_client *client)
+{
+	if (client == NULL || client->stats == NULL)
+		return -1;
+
+	memset(client->stats, 0, sizeof(struct ipc_client_stats_store));
+
+	return 0;
+}
+
+void ipc_client_stats_send(struct ipc_client *client,
+			   const struct ipc_message *message)
+{
+	struct ipc_client_stats_outstanding *outstanding;
+	struct ipc_client_stats_entry *entry;
+	struct ipc_client_stats_store *store;
+
+	if (client == NULL || client->stats == NULL || message == NULL)
+		return;
+
+	/* Only the requests get a response from the modem */
+	if (message->type != IPC_TYPE_EXEC && message->type != IPC_TYPE_GET &&
+	    message->type != IPC_TYPE_SET)
+		return;
+
+	store = client->stats;
+
+	/* The commands that never get a response are counted as well */
+	ipc_client_stats_entry_find(store, message->command, 1);
+
+	outstanding = &store->outstanding[message->mseq];
+	if (outstanding->pending) {
+		entry = ipc_client_stats_entry_find(store,
+						    outstanding->command, 0);
+		if (entry != NULL)
+			entry->stats.unanswered++;
+	}
+
+	outstanding->pending = 1;
+	outstanding->command = message->command;
+	outstanding->sent = ipc_client_stats_now();
+}
+
+void ipc_client_stats_recv(struct ipc_client *client,
+			   const struct ipc_message *message)
+{
+	struct ipc_client_stats_outstanding *outstanding;
+	struct ipc_gen_phone_res_data *data;
+	struct ipc_client_stats_entry *entry;
+	struct ipc_client_stats_store *store;
+	unsigned long long rtt;
+	unsigned short command;
+
+	if (client == NULL || client->stats == NULL || message == NULL)
+		return;
+
+	if (message->command == IPC_GEN_PHONE_RES) {
+		if (message->data == NULL ||
+		    message->size < sizeof(struct ipc_gen_phone_res_data))
+			return;
+
+		data = (struct ipc_gen_phone_res_data *) message->data;
+		command = IPC_COMMAND(data->group, data->index);
+	} else if (message->type == IPC_TYPE_RESP) {
+		command = message->command;
+	} else {
+		return;
+	}
+
+	store = client->stats;
+
+	outstanding = &store->outstanding[message->aseq];
+	if (!outstanding->pending || outstanding->command != command)
+		return;
+
+	outstanding->pending = 0;
+
+	rtt = ipc_client_stats_now() - outstanding->sent;
+
+	entry = ipc_client_stats_entry_find(store, command, 1);
+	if (entry == NULL) {
+		store->dropped++;
+		return;
+	}
+
+	if (entry->stats.count == 0 || rtt < entry->stats.min)
+		entry->stats.min = rtt;
+	if (rtt > entry->stats.max)
+		entry->stats.max = rtt;
+
+	entry->stats.count++;
+	entry->stats.total += rtt;
+	entry->buckets[ipc_client_stats_bucket(rtt)]++;
+}
+
+static unsigned long long ipc_client_stats_percentile(
+	const struct ipc_client_stats_entry *entry, unsigned int percentile)
+{
+	unsigned long long target;
+	unsigned long long count = 0;
+	unsigned long long value;
+	unsigned int i;
+
+	if (entry->stats.count == 0)
+		return 0;
+
+	target = ((unsigned long long) entry->stats.count * percentile + 99) /
+		100;
+
+	for (i = 0; i < IPC_CLIENT_STATS_BUCKETS; i++) {
+		count += entry->buckets[i];
+		if (count >= target)
+			break;
+	}
+
+	value = ipc_client_stats_bucket_value(i);
+
+	return value < entry->stats.max ? value : entry->stats.max;
+}
+
+int ipc_client_stats_get(struct ipc_client *client,
+			 struct ipc_client_stats *stats, unsigned int count)
+{
+	struct ipc_client_stats_entry *entry;
+	unsigned int found = 0;
+	unsigned int i;
+
+	if (client == NULL || client->stats == NULL ||
+	    (stats == NULL && count > 0))
+		return -1;
+
+	for (i = 0; i < IPC_CLIENT_STATS_COMMANDS; i++) {
+		entry = &client->stats->entries[i];
+		if (!entry->used)
+			continue;
+
+		if (found < count) {
+			memcpy(&stats[found], &entry->stats,
+			       sizeof(struct ipc_client_stats));
+			stats[found].p50 = ipc_client_stats_percentile(entry,
+								       50);
+			stats[found].p90 = ipc_client_stats_percentile(entry,
+								       90);
+			stats[found].p99 = ipc_client_stats_percentile(entry,
+								       99);
+		}
+
+		found++;
+	}
+
+	return found;
+}
+
+int ipc_client_stats_histogram_get(struct ipc_client *client,
+				   unsigned short command,
+				   unsigned int *buckets)
+{
+	struct ipc_client_stats_entry *entry;
+
+	if (client == NULL || client->stats == NULL || buckets == NULL)
+		return -1;
+
+	entry = ipc_client_stats_entry_find(client->stats, command, 0);
+	if (entry == NULL)
+		return -1;
+
+	memcpy(buckets, entry->buckets, sizeof(entry->buckets));
+
+	return 0;
+}
+
+unsigned long ipc_client_stats_dropped_get(struct ipc_client *client)
+{
+	if (client == NULL || client->stats == NULL)
+		return 0;
+
+	return client->stats->dropped;
+}
@@ -22,9 +22,15 @@
 
 #include <samsung-ipc.h>
 
+/*
+ * The strings of the unknown values are formatted in thread local buffers, so
+ * that they can be used from several threads at once. They are only valid
+ * until the next call of the same function in the same thread.
+ */
+
 const char *ipc_request_type_string(unsigned char type)
 {
-	static char type_string[5] = { 0 };
+	static __thread char type_string[5] = { 0 };
 
 	switch (type) {
 	case IPC_TYPE_EXEC:
@@ -46,7 +52,7 @@ const char *ipc_request_type_string(unsigned char type)
 
 const char *ipc_response_type_string(unsigned char type)
 {
-	static char type_string[5] = { 0 };
+	static __thread char type_string[5] = { 0 };
 
 	switch (type) {
 	case IPC_TYPE_INDI:
@@ -64,7 +70,7 @@ const char *ipc_response_type_string(unsigned char type)
 
 const char *ipc_command_string(unsigned short command)
 {
-	static char command_string[7] = { 0 };
+	static __thread char command_string[7] = { 0 };
 
 	switch (command) {
 	case IPC_PWR_PHONE_PWR_UP:
@@ -340,7 +346,7 @@ const char *ipc_command_string(unsigned short command)
 
 const char *ipc_group_string(unsigned char group)
 {
-	static char group_string[5] = { 0 };
+	static __thread char group_string[5] = { 0 };
 
 	switch (group) {
 	case IPC_GROUP_PWR:
@@ -383,14 +389,14 @@ const char *ipc_group_string(unsigned char group)
 		return "IPC_GROUP_GEN";
 	default:
 		snprintf((char *) &group_string, sizeof(group_string), "0x%02x",
-			 (unsigned int)group_string);
+			 group);
 		return group_string;
 	}
 }
 
 const char *ipc_client_type_string(unsigned char client_type)
 {
-	static char client_type_string[5] = { 0 };
+	static __thread char client_type_string[5] = { 0 };
 
 	switch (client_type) {
 	case IPC_CLIENT_TYPE_FMT:
@@ -400,8 +406,8 @@ const char *ipc_client_type_string(unsigned char client_type)
 	case IPC_CLIENT_TYPE_DUMMY:
 		return "IPC_CLIENT_TYPE_DUMMY";
 	default:
-		snprintf((char *) &client_type_string, sizeof(client_type_string), "0x%02x",
-			 (unsigned int)client_type_string);
+		snprintf((char *) &client_type_string,
+			 sizeof(client_type_string), "0x%02x", client_type);
 		return client_type_string;
 	}
 }
@@ -0,0 +1,397 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/eventfd.h>
+
+#include <samsung-ipc.h>
+
+#include "ipc.h"
+
+/*
+ * The submission queue is a linked list that the producers append to with a
+ * single atomic exchange of its head, while the writer consumes it from its
+ * tail. The tail is always a frame that was already sent, or the initial
+ * stub, so that the producers never touch a frame that the writer frees.
+ *
+ * Between the exchange and the link from the previous frame, the frames that
+ * follow can't be reached yet: the writer then yields until the link is made,
+ * which only takes the producer a few instructions.
+ *
+ * The tokens are taken before appending, so that consecutive frames of
+ * different producers may be appended out of order. The writer keeps the
+ * tokens that were sent before a lower one in a sorted array, and only
+ * advances the done token once all the lower ones were sent.
+ *
+ * The stats are updated with relaxed atomic operations, as they are updated
+ * by both the producers and the writer, and can be read from any thread.
+ */
+
+#define IPC_CLIENT_SUBMIT_STATS_ADD(submit, field, value)		\
+	__atomic_add_fetch(&(submit)->stats.field, (value), __ATOMIC_RELAXED)
+
+#define IPC_CLIENT_SUBMIT_STATS_COPY(stats, submit, field)		\
+	(stats)->field = __atomic_load_n(&(submit)->stats.field,	\
+					 __ATOMIC_RELAXED)
+
+struct ipc_client_submit_frame {
+	struct ipc_client_submit_frame *next;
+	unsigned long long token;
+	unsigned long long queued;
+
+	unsigned char mseq;
+	unsigned short command;
+	unsigned char type;
+	size_t size;
+	unsigned char data[];
+};
+
+struct ipc_client_submit {
+	/* Producers side */
+	struct ipc_client_submit_frame *head;
+	unsigned long long tokens;
+	long depth;
+	int fd;
+
+	/* Writer side */
+	struct ipc_client_submit_frame *tail;
+	unsigned long long *pending;
+	unsigned int pending_count;
+	unsigned int pending_size;
+	unsigned long long done;
+
+	struct ipc_client_submit_stats stats;
+};
+
+static unsigned long long ipc_client_submit_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (unsigned long long) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int ipc_client_submit_enable(struct ipc_client *client)
+{
+	struct ipc_client_submit *submit;
+
+	if (client == NULL)
+		return -1;
+
+	if (client->submit != NULL)
+		return 0;
+
+	submit = calloc(1, sizeof(struct ipc_client_submit));
+	if (submit == NULL)
+		return -1;
+
+	submit->tail = calloc(1, sizeof(struct ipc_client_submit_frame));
+	if (submit->tail == NULL)
+		goto error;
+
+	submit->head = submit->tail;
+
+	submit->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (submit->fd < 0) {
+		ipc_client_log(client, "Creating the submit eventfd failed");
+		goto error;
+	}
+
+	client->submit = submit;
+
+	return 0;
+
+error:
+	if (submit->tail != NULL)
+		free(submit->tail);
+
+	free(submit);
+
+	return -1;
+}
+
+void ipc_client_submit_destroy(struct ipc_client *client)
+{
+	struct ipc_client_submit_frame *frame;
+	struct ipc_client_submit_frame *next;
+	struct ipc_client_submit *submit;
+
+	if (client == NULL || client->submit == NULL)
+		return;
+
+	submit = client->submit;
+
+	frame = submit->tail;
+	while (frame != NULL) {
+		next = frame->next;
+		free(frame);
+		frame = next;
+	}
+
+	if (submit->pending != NULL)
+		free(submit->pending);
+
+	close(submit->fd);
+
+	free(submit);
+	client->submit = NULL;
+}
+
+int ipc_client_submit_fd(struct ipc_client *client)
+{
+	if (client == NULL || client->submit == NULL)
+		return -1;
+
+	return client->submit->fd;
+}
+
+static void ipc_client_submit_max(unsigned long long *max,
+				  unsigned long long value)
+{
+	unsigned long long current;
+
+	current = __atomic_load_n(max, __ATOMIC_RELAXED);
+
+	while (value > current) {
+		if (__atomic_compare_exchange_n(max, &current, value, 1,
+						__ATOMIC_RELAXED,
+						__ATOMIC_RELAXED))
+			break;
+	}
+}
+
+int ipc_client_submit(struct ipc_client *client, unsigned char mseq,
+		      unsigned short command, unsigned char type,
+		      const void *data, size_t size,
+		      unsigned long long *token)
+{
+	struct ipc_client_submit_frame *previous;
+	struct ipc_client_submit_frame *frame;
+	struct ipc_client_submit *submit;
+	unsigned long long start;
+	unsigned long long elapsed;
+	uint64_t value = 1;
+	long depth;
+
+	if (client == NULL || client->submit == NULL ||
+	    (data == NULL && size > 0))
+		return -1;
+
+	submit = client->submit;
+
+	start = ipc_client_submit_now();
+
+	IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
+
+	frame = malloc(sizeof(struct ipc_client_submit_frame) + size);
+	if (frame == NULL)
+		return -1;
+
+	frame->next = NULL;
+	frame->mseq = mseq;
+	frame->command = command;
+	frame->type = type;
+	frame->size = size;
+
+	if (size > 0)
+		memcpy(frame->data, data, size);
+
+	/* The frame belongs to the writer as soon as it is linked */
+	frame->token = __atomic_add_fetch(&submit->tokens, 1,
+					  __ATOMIC_RELAXED);
+	if (token != NULL)
+		*token = frame->token;
+
+	frame->queued = ipc_client_submit_now();
+
+	previous = __atomic_exchange_n(&submit->head, frame,
+				       __ATOMIC_ACQ_REL);
+	__atomic_store_n(&previous->next, frame, __ATOMIC_RELEASE);
+
+	/* Only the frame that makes the queue non-empty wakes the writer */
+	depth = __atomic_add_fetch(&submit->depth, 1, __ATOMIC_ACQ_REL);
+	if (depth == 1 && write(submit->fd, &value, sizeof(value)) < 0 &&
+	    errno != EAGAIN)
+		ipc_client_log(client, "Waking the submit writer failed");
+
+	if (depth > 0)
+		ipc_client_submit_max(&submit->stats.depth_max,
+				      (unsigned long long) depth);
+
+	elapsed = ipc_client_submit_now() - start;
+
+	IPC_CLIENT_SUBMIT_STATS_ADD(submit, submitted, 1);
+	IPC_CLIENT_SUBMIT_STATS_ADD(submit, enqueue_total, elapsed);
+	ipc_client_submit_max(&submit->stats.enqueue_max, elapsed);
+
+	return 0;
+}
+
+static int ipc_client_submit_complete(struct ipc_client_submit *submit,
+				      unsigned long long token)
+{
+	unsigned long long *pending;
+	unsigned int size;
+	unsigned int i;
+
+	if (token == submit->done + 1) {
+		submit->done++;
+
+		for (i = 0; i < submit->pending_count; i++) {
+			if (submit->pending[i] != submit->done + 1)
+				break;
+
+			submit->done++;
+		}
+
+		if (i > 0) {
+			submit->pending_count -= i;
+			memmove(submit->pending, submit->pending + i,
+				submit->pending_count *
+				sizeof(unsigned long long));
+		}
+
+		__atomic_store_n(&submit->stats.done, submit->done,
+				 __ATOMIC_RELEASE);
+
+		return 0;
+	}
+
+	if (submit->pending_count == submit->pending_size) {
+		size = submit->pending_size > 0 ? submit->pending_size * 2 : 16;
+
+		pending = realloc(submit->pending,
+				  size * sizeof(unsigned long long));
+		if (pending == NULL)
+			return -1;
+
+		submit->pending = pending;
+		submit->pending_size = size;
+	}
+
+	for (i = submit->pending_count; i > 0; i--) {
+		if (submit->pending[i - 1] < token)
+			break;
+
+		submit->pending[i] = submit->pending[i - 1];
+	}
+
+	submit->pending[i] = token;
+	submit->pending_count++;
+
+	return 0;
+}
+
+int ipc_client_submit_drain(struct ipc_client *client)
+{
+	struct ipc_client_submit_frame *frame;
+	struct ipc_client_submit *submit;
+	unsigned long long delay;
+	uint64_t value;
+	int count = 0;
+	int rc;
+
+	if (client == NULL || client->submit == NULL)
+		return -1;
+
+	submit = client->submit;
+
+	/* Frames submitted from now on wake the writer again */
+	if (read(submit->fd, &value, sizeof(value)) < 0 && errno != EAGAIN)
+		return -1;
+
+	while (1) {
+		frame = __atomic_load_n(&submit->tail->next, __ATOMIC_ACQUIRE);
+		if (frame == NULL) {
+			if (__atomic_load_n(&submit->head, __ATOMIC_ACQUIRE) ==
+			    submit->tail)
+				break;
+
+			/* A producer is between the exchange and the link */
+			sched_yield();
+			continue;
+		}
+
+		rc = ipc_client_send(client, frame->mseq, frame->command,
+				     frame->type, frame->size > 0 ?
+				     frame->data : NULL, frame->size);
+		if (rc < 0)
+			return -1;
+
+		free(submit->tail);
+		submit->tail = frame;
+
+		__atomic_sub_fetch(&submit->depth, 1, __ATOMIC_ACQ_REL);
+
+		delay = (ipc_client_submit_now() - frame->queued) / 1000;
+
+		IPC_CLIENT_SUBMIT_STATS_ADD(submit, sent, 1);
+		IPC_CLIENT_SUBMIT_STATS_ADD(submit, delay_total, delay);
+		ipc_client_submit_max(&submit->stats.delay_max, delay);
+
+		if (ipc_client_submit_complete(submit, frame->token) < 0)
+			return -1;
+
+		count++;
+	}
+
+	return count;
+}
+
+int ipc_client_submit_done(struct ipc_client *client,
+			   unsigned long long token)
+{
+	if (client == NULL || client->submit == NULL)
+		return -1;
+
+	return __atomic_load_n(&client->submit->stats.done,
+			       __ATOMIC_ACQUIRE) >= token;
+}
+
+int ipc_client_submit_stats_get(struct ipc_client *client,
+				struct ipc_client_submit_stats *stats)
+{
+	struct ipc_client_submit *submit;
+	long depth;
+
+	if (client == NULL || client->submit == NULL || stats == NULL)
+		return -1;
+
+	submit = client->submit;
+
+	IPC_CLIENT_SUBMIT_STATS_COPY(stats, submit, depth_max);
+	IPC_CLIENT_SUBMIT_STATS_COPY(stats, submit, submitted);
+	IPC_CLIENT_SUBMIT_STATS_COPY(stats, submit, sent);
+	IPC_CLIENT_SUBMIT_STATS_COPY(stats, submit, done);
+	IPC_CLIENT_SUBMIT_STATS_COPY(stats, submit, enqueue_total);
+	IPC_CLIENT_SUBMIT_STATS_COPY(stats, submit, enqueue_max);
+	IPC_CLIENT_SUBMIT_STATS_COPY(stats, submit, delay_total);
+	IPC_CLIENT_SUBMIT_STATS_COPY(stats, submit, delay_max);
+
+	depth = __atomic_load_n(&submit->depth, __ATOMIC_RELAXED);
+	stats->depth = depth > 0 ? depth : 0;
+
+	return 0;
+}
@@ -0,0 +1,1142 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <samsung-ipc.h>
+
+#include "ipc.h"
+
+/*
+ * The io_uring transport keeps a multishot read posted on the transport fd,
+ * so that the kernel fills the provided buffers as the data arrives, without
+ * any read call. Each completion is handed out as a chunk of the stream, and
+ * its buffer goes back to the ring once it was consumed.
+ *
+ * Only one write is in flight at a time, so that the frames can't overtake
+ * each other, and each write waits for its own completion: its result is the
+ * one of the frame, and a short write is returned as such, so that the rest
+ * of the frame is written before the next one. The io_uring_enter of a write
+ * also submits the posted reads and reaps their completions, and the polls
+ * wait with the same call when there is nothing else to poll.
+ *
+ * The fd is made blocking for the multishot read to wait for the data, and
+ * its flags are restored when the ring stops using it. The writes on an fd
+ * that was non-blocking are made with RWF_NOWAIT instead, so that they still
+ * fail with EAGAIN, and the output queue then waits for it to be writable
+ * with a poll request.
+ *
+ * The ring is only driven by the thread that uses the client, and the kernel
+ * interface is used directly, as the C library headers may predate it.
+ */
+
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup		425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter		426
+#endif
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register		427
+#endif
+
+#define IPC_URING_OFF_SQ_RING		0ULL
+#define IPC_URING_OFF_SQES		0x10000000ULL
+
+#define IPC_URING_FEAT_SINGLE_MMAP	(1U << 0)
+#define IPC_URING_FEAT_RW_CUR_POS	(1U << 3)
+#define IPC_URING_FEAT_EXT_ARG		(1U << 8)
+
+#define IPC_URING_ENTER_GETEVENTS	(1U << 0)
+#define IPC_URING_ENTER_EXT_ARG		(1U << 3)
+
+#define IPC_URING_REGISTER_PROBE	8
+#define IPC_URING_REGISTER_PBUF_RING	22
+
+#define IPC_URING_OP_POLL_ADD		6
+#define IPC_URING_OP_ASYNC_CANCEL	14
+#define IPC_URING_OP_WRITE		23
+#define IPC_URING_OP_READ_MULTISHOT	49
+#define IPC_URING_OP_SUPPORTED		(1U << 0)
+
+#define IPC_URING_SQE_BUFFER_SELECT	(1U << 5)
+
+#define IPC_URING_RWF_NOWAIT		0x00000008
+
+#define IPC_URING_CQE_F_BUFFER		(1U << 0)
+#define IPC_URING_CQE_F_MORE		(1U << 1)
+#define IPC_URING_CQE_BUFFER_SHIFT	16
+
+#define IPC_URING_ENTRIES		64
+#define IPC_URING_BUFFERS		16
+#define IPC_URING_BUFFER_SIZE		0x1000
+#define IPC_URING_GROUP			0
+
+#define IPC_URING_DATA_READ		1
+#define IPC_URING_DATA_CANCEL		2
+#define IPC_URING_DATA_WRITE		3
+#define IPC_URING_DATA_POLLOUT		4
+
+struct ipc_uring_sqe {
+	uint8_t opcode;
+	uint8_t flags;
+	uint16_t ioprio;
+	int32_t fd;
+	uint64_t off;
+	uint64_t addr;
+	uint32_t len;
+	uint32_t op_flags;
+	uint64_t user_data;
+	uint16_t buf_group;
+	uint16_t personality;
+	int32_t splice_fd_in;
+	uint64_t pad[2];
+};
+
+struct ipc_uring_cqe {
+	uint64_t user_data;
+	int32_t res;
+	uint32_t flags;
+};
+
+struct ipc_uring_sqring_offsets {
+	uint32_t head;
+	uint32_t tail;
+	uint32_t ring_mask;
+	uint32_t ring_entries;
+	uint32_t flags;
+	uint32_t dropped;
+	uint32_t array;
+	uint32_t resv1;
+	uint64_t resv2;
+};
+
+struct ipc_uring_cqring_offsets {
+	uint32_t head;
+	uint32_t tail;
+	uint32_t ring_mask;
+	uint32_t ring_entries;
+	uint32_t overflow;
+	uint32_t cqes;
+	uint32_t flags;
+	uint32_t resv1;
+	uint64_t resv2;
+};
+
+struct ipc_uring_params {
+	uint32_t sq_entries;
+	uint32_t cq_entries;
+	uint32_t flags;
+	uint32_t sq_thread_cpu;
+	uint32_t sq_thread_idle;
+	uint32_t features;
+	uint32_t wq_fd;
+	uint32_t resv[3];
+	struct ipc_uring_sqring_offsets sq_off;
+	struct ipc_uring_cqring_offsets cq_off;
+};
+
+struct ipc_uring_probe_op {
+	uint8_t op;
+	uint8_t resv;
+	uint16_t flags;
+	uint32_t resv2;
+};
+
+struct ipc_uring_probe {
+	uint8_t last_op;
+	uint8_t ops_len;
+	uint16_t resv;
+	uint32_t resv2[3];
+	struct ipc_uring_probe_op ops[256];
+};
+
+/* The tail of the buffer ring overlays the reserved field of its first entry */
+struct ipc_uring_buf {
+	uint64_t addr;
+	uint32_t len;
+	uint16_t bid;
+	uint16_t tail;
+};
+
+struct ipc_uring_buf_reg {
+	uint64_t ring_addr;
+	uint32_t ring_entries;
+	uint16_t bgid;
+	uint16_t flags;
+	uint64_t resv[3];
+};
+
+struct ipc_uring_timespec {
+	int64_t tv_sec;
+	int64_t tv_nsec;
+};
+
+struct ipc_uring_getevents_arg {
+	uint64_t sigmask;
+	uint32_t sigmask_sz;
+	uint32_t pad;
+	uint64_t ts;
+};
+
+struct ipc_client_uring_chunk {
+	unsigned short bid;
+	unsigned int size;
+	unsigned int offset;
+};
+
+struct ipc_client_uring {
+	/* Handlers of the transport that the ring took over */
+	int (*open)(struct ipc_client *client, void *transport_data, int type);
+	int (*close)(struct ipc_client *client, void *transport_data);
+
+	int fd;
+	int fd_flags;
+	int ring_fd;
+
+	void *ring;
+	size_t ring_size;
+	struct ipc_uring_sqe *sqes;
+	size_t sqes_size;
+
+	unsigned int *sq_head;
+	unsigned int *sq_tail;
+	unsigned int *sq_mask;
+	unsigned int *sq_entries;
+	unsigned int *sq_array;
+	unsigned int sq_pending;
+
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int *cq_mask;
+	struct ipc_uring_cqe *cqes;
+
+	struct ipc_uring_buf *buf_ring;
+	size_t buf_ring_size;
+	unsigned char *buffers;
+	unsigned short buf_tail;
+
+	/* Completed reads, in the order of the stream */
+	struct ipc_client_uring_chunk chunks[IPC_URING_BUFFERS];
+	unsigned int chunks_head;
+	unsigned int chunks_count;
+
+	/* The write in flight copies the frame, as it may outlive the call */
+	unsigned char *write_buffer;
+	size_t write_size;
+	int write_result;
+	int writes;
+	int nowait;
+	int pollout;
+
+	int armed;
+	int eof;
+	int read_error;
+
+	struct ipc_client_uring_stats stats;
+};
+
+static int ipc_uring_setup(unsigned int entries,
+			   struct ipc_uring_params *params)
+{
+	return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int ipc_uring_enter(int fd, unsigned int submit, unsigned int wait,
+			   unsigned int flags, void *arg, size_t size)
+{
+	return syscall(__NR_io_uring_enter, fd, submit, wait, flags, arg,
+		       size);
+}
+
+static int ipc_uring_register(int fd, unsigned int opcode, void *arg,
+			      unsigned int count)
+{
+	return syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+static void ipc_client_uring_recycle(struct ipc_client_uring *uring,
+				     unsigned short bid)
+{
+	struct ipc_uring_buf *buf;
+
+	buf = &uring->buf_ring[uring->buf_tail & (IPC_URING_BUFFERS - 1)];
+	buf->addr = (uintptr_t) (uring->buffers + bid * IPC_URING_BUFFER_SIZE);
+	buf->len = IPC_URING_BUFFER_SIZE;
+	buf->bid = bid;
+
+	uring->buf_tail++;
+
+	__atomic_store_n(&uring->buf_ring[0].tail, uring->buf_tail,
+			 __ATOMIC_RELEASE);
+}
+
+/* Submits the queued entries and waits for up to wait completions */
+static int ipc_client_uring_submit_wait(struct ipc_client *client,
+					struct ipc_client_uring *uring,
+					unsigned int wait,
+					const struct timespec *timeout)
+{
+	struct ipc_uring_getevents_arg arg;
+	struct ipc_uring_timespec ts;
+	unsigned int flags = 0;
+	int rc;
+
+	if (uring->sq_pending == 0 && wait == 0)
+		return 0;
+
+	memset(&arg, 0, sizeof(arg));
+
+	if (wait > 0) {
+		flags |= IPC_URING_ENTER_GETEVENTS;
+
+		if (timeout != NULL) {
+			ts.tv_sec = timeout->tv_sec;
+			ts.tv_nsec = timeout->tv_nsec;
+			arg.ts = (uintptr_t) &ts;
+		}
+	}
+
+	/* The extended argument is only used for its timeout */
+	flags |= IPC_URING_ENTER_EXT_ARG;
+
+	rc = ipc_uring_enter(uring->ring_fd, uring->sq_pending, wait, flags,
+			     &arg, sizeof(arg));
+	uring->stats.enters++;
+
+	if (rc < 0) {
+		if (errno == ETIME)
+			return 0;
+		if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+			ipc_client_log(client, "Entering the io_uring failed: %s",
+				       strerror(errno));
+		}
+		return -1;
+	}
+
+	uring->sq_pending -= rc;
+
+	return 0;
+}
+
+static int ipc_client_uring_queue(struct ipc_client *client,
+				  struct ipc_client_uring *uring,
+				  unsigned char opcode, unsigned char flags,
+				  uint64_t addr, unsigned int length,
+				  unsigned int op_flags, uint64_t user_data)
+{
+	struct ipc_uring_sqe *sqe;
+	unsigned int index;
+	unsigned int tail;
+
+	tail = *uring->sq_tail;
+
+	if (tail - __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE) >=
+	    *uring->sq_entries) {
+		if (ipc_client_uring_submit_wait(client, uring, 0, NULL) < 0)
+			return -1;
+
+		if (tail - __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE) >=
+		    *uring->sq_entries) {
+			errno = EAGAIN;
+			return -1;
+		}
+	}
+
+	index = tail & *uring->sq_mask;
+	sqe = &uring->sqes[index];
+
+	memset(sqe, 0, sizeof(struct ipc_uring_sqe));
+	sqe->opcode = opcode;
+	sqe->flags = flags;
+	sqe->fd = opcode == IPC_URING_OP_ASYNC_CANCEL ? -1 : uring->fd;
+	sqe->off = (uint64_t) -1;
+	sqe->addr = addr;
+	sqe->len = length;
+	sqe->op_flags = op_flags;
+	sqe->user_data = user_data;
+	sqe->buf_group = IPC_URING_GROUP;
+
+	if (opcode == IPC_URING_OP_ASYNC_CANCEL)
+		sqe->off = 0;
+
+	uring->sq_array[index] = index;
+
+	__atomic_store_n(uring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	uring->sq_pending++;
+
+	return 0;
+}
+
+/* The read is only posted while some buffers are free to take the data */
+static int ipc_client_uring_arm(struct ipc_client *client,
+				struct ipc_client_uring *uring)
+{
+	int rc;
+
+	if (uring->armed || uring->fd < 0 || uring->eof ||
+	    uring->read_error != 0 || uring->chunks_count == IPC_URING_BUFFERS)
+		return 0;
+
+	rc = ipc_client_uring_queue(client, uring, IPC_URING_OP_READ_MULTISHOT,
+				    IPC_URING_SQE_BUFFER_SELECT, 0, 0, 0,
+				    IPC_URING_DATA_READ);
+	if (rc < 0)
+		return -1;
+
+	uring->armed = 1;
+	uring->stats.arms++;
+
+	return 0;
+}
+
+static void ipc_client_uring_complete(struct ipc_client_uring *uring,
+				      const struct ipc_uring_cqe *cqe)
+{
+	struct ipc_client_uring_chunk *chunk;
+
+	switch (cqe->user_data) {
+	case IPC_URING_DATA_READ:
+		break;
+	case IPC_URING_DATA_WRITE:
+		uring->write_result = cqe->res;
+		uring->writes = 0;
+		uring->stats.writes++;
+		return;
+	case IPC_URING_DATA_POLLOUT:
+		uring->pollout = 0;
+		return;
+	default:
+		return;
+	}
+
+	/* Without more completions to come, the read has to be posted again */
+	if (!(cqe->flags & IPC_URING_CQE_F_MORE))
+		uring->armed = 0;
+
+	if (cqe->res > 0 && (cqe->flags & IPC_URING_CQE_F_BUFFER)) {
+		chunk = &uring->chunks[(uring->chunks_head + uring->chunks_count) %
+				     IPC_URING_BUFFERS];
+		chunk->bid = cqe->flags >> IPC_URING_CQE_BUFFER_SHIFT;
+		chunk->size = cqe->res;
+		chunk->offset = 0;
+
+		uring->chunks_count++;
+		uring->stats.reads++;
+	} else if (cqe->res == 0) {
+		uring->eof = 1;
+	} else if (cqe->res < 0 && cqe->res != -ENOBUFS &&
+		   cqe->res != -ECANCELED) {
+		uring->read_error = -cqe->res;
+	}
+}
+
+static void ipc_client_uring_reap(struct ipc_client_uring *uring)
+{
+	unsigned int head;
+	unsigned int tail;
+
+	head = *uring->cq_head;
+	tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+
+	if (head == tail)
+		return;
+
+	while (head != tail) {
+		ipc_client_uring_complete(uring,
+					  &uring->cqes[head & *uring->cq_mask]);
+		head++;
+	}
+
+	__atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+}
+
+static int ipc_client_uring_ready(struct ipc_client_uring *uring)
+{
+	return uring->chunks_count > 0 || uring->eof || uring->read_error != 0;
+}
+
+/* Takes the transport fd, and posts the read on it */
+static int ipc_client_uring_start(struct ipc_client *client,
+				  struct ipc_client_uring *uring, void *data)
+{
+	int flags;
+	int fd;
+
+	if (uring->fd >= 0)
+		return 0;
+
+	if (client->handlers->fd == NULL)
+		return -1;
+
+	fd = client->handlers->fd(client, data);
+	if (fd < 0)
+		return -1;
+
+	flags = fcntl(fd, F_GETFL);
+	if (flags < 0 ||
+	    ((flags & O_NONBLOCK) &&
+	     fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) < 0)) {
+		ipc_client_log(client, "Setting up the io_uring fd failed");
+		return -1;
+	}
+
+	uring->fd = fd;
+	uring->fd_flags = flags;
+	uring->nowait = flags & O_NONBLOCK ? 1 : 0;
+	uring->eof = 0;
+	uring->read_error = 0;
+
+	return ipc_client_uring_arm(client, uring);
+}
+
+/* Cancels the requests and restores the fd, before it is closed */
+static void ipc_client_uring_stop(struct ipc_client *client,
+				  struct ipc_client_uring *uring)
+{
+	struct ipc_client_uring_chunk *chunk;
+
+	if (uring->armed &&
+	    ipc_client_uring_queue(client, uring, IPC_URING_OP_ASYNC_CANCEL,
+				   0, IPC_URING_DATA_READ, 0, 0,
+				   IPC_URING_DATA_CANCEL) < 0)
+		ipc_client_log(client, "Canceling the io_uring read failed");
+
+	if (uring->pollout &&
+	    ipc_client_uring_queue(client, uring, IPC_URING_OP_ASYNC_CANCEL,
+				   0, IPC_URING_DATA_POLLOUT, 0, 0,
+				   IPC_URING_DATA_CANCEL) < 0)
+		ipc_client_log(client, "Canceling the io_uring poll failed");
+
+	while (uring->armed || uring->writes > 0 || uring->pollout) {
+		if (ipc_client_uring_submit_wait(client, uring, 1, NULL) < 0 &&
+		    errno != EINTR)
+			break;
+
+		ipc_client_uring_reap(uring);
+	}
+
+	while (uring->chunks_count > 0) {
+		chunk = &uring->chunks[uring->chunks_head];
+		ipc_client_uring_recycle(uring, chunk->bid);
+
+		uring->chunks_head = (uring->chunks_head + 1) % IPC_URING_BUFFERS;
+		uring->chunks_count--;
+	}
+
+	if (uring->fd >= 0 && fcntl(uring->fd, F_SETFL, uring->fd_flags) < 0)
+		ipc_client_log(client, "Restoring the io_uring fd failed");
+
+	uring->fd = -1;
+}
+
+static int ipc_client_uring_transport_open(struct ipc_client *client,
+					   void *data, int type)
+{
+	struct ipc_client_uring *uring = client->uring;
+	int rc;
+
+	if (uring == NULL || uring->open == NULL)
+		return -1;
+
+	rc = uring->open(client, data, type);
+	if (rc < 0)
+		return rc;
+
+	uring->fd = -1;
+
+	return ipc_client_uring_start(client, uring, data);
+}
+
+static int ipc_client_uring_transport_close(struct ipc_client *client,
+					    void *data)
+{
+	struct ipc_client_uring *uring = client->uring;
+
+	if (uring == NULL || uring->close == NULL)
+		return -1;
+
+	if (uring->fd >= 0)
+		ipc_client_uring_stop(client, uring);
+
+	return uring->close(client, data);
+}
+
+static int ipc_client_uring_transport_read(struct ipc_client *client,
+					   void *data, void *buffer,
+					   size_t length)
+{
+	struct ipc_client_uring *uring = client->uring;
+	struct ipc_client_uring_chunk *chunk;
+	size_t count;
+
+	if (uring == NULL || buffer == NULL)
+		return -1;
+
+	if (ipc_client_uring_start(client, uring, data) < 0)
+		return -1;
+
+	if (uring->chunks_count == 0)
+		ipc_client_uring_reap(uring);
+
+	if (uring->chunks_count == 0) {
+		if (uring->read_error != 0) {
+			errno = uring->read_error;
+			return -1;
+		} else if (uring->eof) {
+			return 0;
+		}
+
+		if (ipc_client_uring_arm(client, uring) < 0 ||
+		    ipc_client_uring_submit_wait(client, uring, 0, NULL) < 0)
+			return -1;
+
+		errno = EAGAIN;
+		return -1;
+	}
+
+	chunk = &uring->chunks[uring->chunks_head];
+
+	count = chunk->size - chunk->offset;
+	if (count > length)
+		count = length;
+
+	memcpy(buffer, uring->buffers + chunk->bid * IPC_URING_BUFFER_SIZE +
+	       chunk->offset, count);
+	chunk->offset += count;
+
+	if (chunk->offset == chunk->size) {
+		ipc_client_uring_recycle(uring, chunk->bid);
+
+		uring->chunks_head = (uring->chunks_head + 1) % IPC_URING_BUFFERS;
+		uring->chunks_count--;
+
+		if (ipc_client_uring_arm(client, uring) < 0)
+			return -1;
+	}
+
+	return count;
+}
+
+/* Waits for the completion of the write in flight, if any */
+static int ipc_client_uring_write_wait(struct ipc_client *client,
+				       struct ipc_client_uring *uring)
+{
+	while (uring->writes > 0) {
+		if (ipc_client_uring_submit_wait(client, uring, 1, NULL) < 0 &&
+		    errno != EINTR)
+			return -1;
+
+		ipc_client_uring_reap(uring);
+	}
+
+	return 0;
+}
+
+static int ipc_client_uring_transport_write(struct ipc_client *client,
+					    void *data, const void *buffer,
+					    size_t length)
+{
+	struct ipc_client_uring *uring = client->uring;
+	unsigned char *copy;
+	int rc;
+
+	if (uring == NULL || buffer == NULL)
+		return -1;
+
+	if (ipc_client_uring_start(client, uring, data) < 0)
+		return -1;
+
+	if (ipc_client_uring_write_wait(client, uring) < 0)
+		return -1;
+
+	if (uring->write_size < length) {
+		IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
+
+		copy = realloc(uring->write_buffer, length);
+		if (copy == NULL)
+			return -1;
+
+		uring->write_buffer = copy;
+		uring->write_size = length;
+	}
+
+	memcpy(uring->write_buffer, buffer, length);
+
+	do {
+		rc = ipc_client_uring_queue(client, uring, IPC_URING_OP_WRITE,
+					    0, (uintptr_t) uring->write_buffer,
+					    length,
+					    uring->nowait ?
+					    IPC_URING_RWF_NOWAIT : 0,
+					    IPC_URING_DATA_WRITE);
+		if (rc < 0)
+			return -1;
+
+		uring->writes = 1;
+
+		if (ipc_client_uring_write_wait(client, uring) < 0)
+			return -1;
+
+		/* Devices that can't fail the writes early just wait */
+		if (uring->write_result != -EOPNOTSUPP || !uring->nowait)
+			break;
+
+		uring->nowait = 0;
+	} while (1);
+
+	if (uring->write_result < 0) {
+		errno = -uring->write_result;
+		return -1;
+	}
+
+	return uring->write_result;
+}
+
+static void ipc_client_uring_remaining(const struct timespec *deadline,
+				       struct timespec *remaining)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	remaining->tv_sec = deadline->tv_sec - now.tv_sec;
+	remaining->tv_nsec = deadline->tv_nsec - now.tv_nsec;
+
+	if (remaining->tv_nsec < 0) {
+		remaining->tv_sec--;
+		remaining->tv_nsec += 1000000000;
+	}
+
+	if (remaining->tv_sec < 0) {
+		remaining->tv_sec = 0;
+		remaining->tv_nsec = 0;
+	}
+}
+
+/* The ring fd is polled along with the other fds, once the entries are in */
+static int ipc_client_uring_poll_fds(struct ipc_client *client,
+				     struct ipc_client_uring *uring,
+				     struct ipc_poll_fds *fds,
+				     const struct timespec *timeout)
+{
+	struct pollfd *pfds;
+	unsigned int count;
+	unsigned int i;
+	int ms = -1;
+	int rc;
+
+	if (ipc_client_uring_submit_wait(client, uring, 0, NULL) < 0)
+		return -1;
+
+	pfds = calloc(fds->count + 1, sizeof(struct pollfd));
+	if (pfds == NULL)
+		return -1;
+
+	pfds[0].fd = uring->ring_fd;
+	pfds[0].events = POLLIN;
+
+	for (i = 0; i < fds->count; i++) {
+		pfds[i + 1].fd = fds->fds[i];
+		pfds[i + 1].events = POLLIN;
+	}
+
+	if (timeout != NULL)
+		ms = timeout->tv_sec * 1000 + (timeout->tv_nsec + 999999) /
+			1000000;
+
+	rc = poll(pfds, fds->count + 1, ms);
+	uring->stats.polls++;
+
+	if (rc < 0)
+		goto complete;
+
+	count = 0;
+
+	for (i = 0; i < fds->count; i++) {
+		if (fds->fds[i] >= 0 && (pfds[i + 1].revents & POLLIN))
+			count++;
+	}
+
+	/* The fds are polled again as they are if none of them is ready */
+	if (count > 0) {
+		for (i = 0; i < fds->count; i++) {
+			if (fds->fds[i] < 0 || !(pfds[i + 1].revents & POLLIN))
+				fds->fds[i] = -1;
+		}
+
+		fds->count = count;
+	}
+
+	rc = count;
+
+complete:
+	free(pfds);
+
+	return rc;
+}
+
+/* Writes the queued output, or waits for the fd to be writable again */
+static int ipc_client_uring_output(struct ipc_client *client,
+				   struct ipc_client_uring *uring)
+{
+	if (ipc_client_output_pending(client) <= 0 || uring->pollout)
+		return 0;
+
+	if (ipc_client_output_flush(client) < 0)
+		return -1;
+
+	if (ipc_client_output_pending(client) <= 0)
+		return 0;
+
+	if (ipc_client_uring_queue(client, uring, IPC_URING_OP_POLL_ADD, 0, 0,
+				   0, POLLOUT, IPC_URING_DATA_POLLOUT) < 0)
+		return -1;
+
+	uring->pollout = 1;
+
+	return 0;
+}
+
+static int ipc_client_uring_transport_poll(struct ipc_client *client,
+					   void *data,
+					   struct ipc_poll_fds *fds,
+					   struct timeval *timeout)
+{
+	struct ipc_client_uring *uring = client->uring;
+	struct timespec remaining;
+	struct timespec deadline;
+	unsigned int count = 0;
+	unsigned int ready = 0;
+	int extra;
+	int wait;
+	int rc;
+
+	if (uring == NULL)
+		return -1;
+
+	if (ipc_client_uring_start(client, uring, data) < 0)
+		return -1;
+
+	extra = fds != NULL && fds->fds != NULL && fds->count > 0;
+
+	if (timeout != NULL) {
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec += timeout->tv_sec;
+		deadline.tv_nsec += timeout->tv_usec * 1000;
+
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+	}
+
+	do {
+		ipc_client_uring_reap(uring);
+
+		if (ipc_client_uring_arm(client, uring) < 0 ||
+		    ipc_client_uring_output(client, uring) < 0)
+			return -1;
+
+		if (timeout != NULL)
+			ipc_client_uring_remaining(&deadline, &remaining);
+
+		wait = !ipc_client_uring_ready(uring) &&
+			(timeout == NULL || remaining.tv_sec > 0 ||
+			 remaining.tv_nsec > 0);
+
+		if (extra) {
+			if (!wait) {
+				remaining.tv_sec = 0;
+				remaining.tv_nsec = 0;
+			}
+
+			rc = ipc_client_uring_poll_fds(
+				client, uring, fds,
+				timeout != NULL || !wait ? &remaining : NULL);
+			if (rc < 0)
+				return -1;
+
+			ready = rc;
+			count = rc;
+		} else {
+			rc = ipc_client_uring_submit_wait(
+				client, uring, wait,
+				timeout != NULL ? &remaining : NULL);
+			if (rc < 0)
+				return -1;
+		}
+
+		ipc_client_uring_reap(uring);
+
+		if (ipc_client_uring_ready(uring)) {
+			count++;
+			break;
+		}
+	} while (wait && count == 0);
+
+	/* Only the transport is ready */
+	if (count > 0 && ready == 0 && fds != NULL)
+		fds->count = 0;
+
+	return count;
+}
+
+static void ipc_client_uring_free(struct ipc_client_uring *uring)
+{
+	if (uring->write_buffer != NULL)
+		free(uring->write_buffer);
+
+	if (uring->buf_ring != NULL)
+		munmap(uring->buf_ring, uring->buf_ring_size);
+
+	if (uring->buffers != NULL)
+		free(uring->buffers);
+
+	if (uring->sqes != NULL)
+		munmap(uring->sqes, uring->sqes_size);
+
+	if (uring->ring != NULL)
+		munmap(uring->ring, uring->ring_size);
+
+	if (uring->ring_fd >= 0)
+		close(uring->ring_fd);
+
+	free(uring);
+}
+
+/* Returns IPC_CLIENT_URING_UNAVAILABLE when the kernel lacks a feature */
+static int ipc_client_uring_setup(struct ipc_client *client,
+				  struct ipc_client_uring *uring)
+{
+	struct ipc_uring_params params;
+	struct ipc_uring_probe *probe;
+	struct ipc_uring_buf_reg reg;
+	unsigned int features;
+	unsigned char *ring;
+	size_t size;
+	unsigned int i;
+	int rc;
+
+	memset(&params, 0, sizeof(params));
+
+	uring->ring_fd = ipc_uring_setup(IPC_URING_ENTRIES, &params);
+	if (uring->ring_fd < 0) {
+		ipc_client_log(client, "io_uring is unavailable: %s",
+			       strerror(errno));
+		return IPC_CLIENT_URING_UNAVAILABLE;
+	}
+
+	features = IPC_URING_FEAT_SINGLE_MMAP | IPC_URING_FEAT_RW_CUR_POS |
+		IPC_URING_FEAT_EXT_ARG;
+	if ((params.features & features) != features) {
+		ipc_client_log(client, "io_uring lacks the needed features");
+		return IPC_CLIENT_URING_UNAVAILABLE;
+	}
+
+	probe = calloc(1, sizeof(struct ipc_uring_probe));
+	if (probe == NULL)
+		return -1;
+
+	rc = ipc_uring_register(uring->ring_fd, IPC_URING_REGISTER_PROBE,
+				probe, 256);
+	if (rc < 0 || probe->last_op < IPC_URING_OP_READ_MULTISHOT ||
+	    !(probe->ops[IPC_URING_OP_READ_MULTISHOT].flags &
+	      IPC_URING_OP_SUPPORTED)) {
+		ipc_client_log(client, "io_uring lacks multishot reads");
+		free(probe);
+		return IPC_CLIENT_URING_UNAVAILABLE;
+	}
+
+	free(probe);
+
+	uring->ring_size = params.sq_off.array +
+		params.sq_entries * sizeof(unsigned int);
+	size = params.cq_off.cqes +
+		params.cq_entries * sizeof(struct ipc_uring_cqe);
+	if (size > uring->ring_size)
+		uring->ring_size = size;
+
+	uring->ring = mmap(NULL, uring->ring_size, PROT_READ | PROT_WRITE,
+			   MAP_SHARED | MAP_POPULATE, uring->ring_fd,
+			   IPC_URING_OFF_SQ_RING);
+	if (uring->ring == MAP_FAILED) {
+		uring->ring = NULL;
+		goto error;
+	}
+
+	uring->sqes_size = params.sq_entries * sizeof(struct ipc_uring_sqe);
+	uring->sqes = mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE,
+			   MAP_SHARED | MAP_POPULATE, uring->ring_fd,
+			   IPC_URING_OFF_SQES);
+	if (uring->sqes == MAP_FAILED) {
+		uring->sqes = NULL;
+		goto error;
+	}
+
+	ring = (unsigned char *) uring->ring;
+
+	uring->sq_head = (unsigned int *) (ring + params.sq_off.head);
+	uring->sq_tail = (unsigned int *) (ring + params.sq_off.tail);
+	uring->sq_mask = (unsigned int *) (ring + params.sq_off.ring_mask);
+	uring->sq_entries = (unsigned int *)
+		(ring + params.sq_off.ring_entries);
+	uring->sq_array = (unsigned int *) (ring + params.sq_off.array);
+
+	uring->cq_head = (unsigned int *) (ring + params.cq_off.head);
+	uring->cq_tail = (unsigned int *) (ring + params.cq_off.tail);
+	uring->cq_mask = (unsigned int *) (ring + params.cq_off.ring_mask);
+	uring->cqes = (struct ipc_uring_cqe *) (ring + params.cq_off.cqes);
+
+	/* The buffer ring has to be page aligned */
+	uring->buf_ring_size = IPC_URING_BUFFERS * sizeof(struct ipc_uring_buf);
+	uring->buf_ring = mmap(NULL, uring->buf_ring_size,
+			       PROT_READ | PROT_WRITE,
+			       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (uring->buf_ring == MAP_FAILED) {
+		uring->buf_ring = NULL;
+		goto error;
+	}
+
+	uring->buffers = malloc(IPC_URING_BUFFERS * IPC_URING_BUFFER_SIZE);
+	if (uring->buffers == NULL)
+		goto error;
+
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (uintptr_t) uring->buf_ring;
+	reg.ring_entries = IPC_URING_BUFFERS;
+	reg.bgid = IPC_URING_GROUP;
+
+	rc = ipc_uring_register(uring->ring_fd, IPC_URING_REGISTER_PBUF_RING,
+				&reg, 1);
+	if (rc < 0) {
+		ipc_client_log(client, "io_uring lacks provided buffer rings");
+		return IPC_CLIENT_URING_UNAVAILABLE;
+	}
+
+	for (i = 0; i < IPC_URING_BUFFERS; i++)
+		ipc_client_uring_recycle(uring, i);
+
+	return 0;
+
+error:
+	ipc_client_log(client, "Setting up the io_uring failed: %s",
+		       strerror(errno));
+
+	return -1;
+}
+
+int ipc_client_uring_enable(struct ipc_client *client)
+{
+	struct ipc_client_uring *uring;
+	int rc;
+
+	if (client == NULL || client->handlers == NULL)
+		return -1;
+
+	if (client->uring != NULL)
+		return 0;
+
+	if (client->handlers->fd == NULL || client->handlers->read == NULL ||
+	    client->handlers->write == NULL || client->handlers->poll == NULL) {
+		ipc_client_log(client,
+			       "The transport doesn't support io_uring");
+		return IPC_CLIENT_URING_UNAVAILABLE;
+	}
+
+	uring = calloc(1, sizeof(struct ipc_client_uring));
+	if (uring == NULL)
+		return -1;
+
+	uring->fd = -1;
+	uring->ring_fd = -1;
+
+	rc = ipc_client_uring_setup(client, uring);
+	if (rc != 0) {
+		ipc_client_uring_free(uring);
+		return rc;
+	}
+
+	uring->open = client->handlers->open;
+	uring->close = client->handlers->close;
+
+	client->uring = uring;
+
+	/* The transport data stays the one of the transport */
+	rc = ipc_client_transport_handlers_register(
+		client, ipc_client_uring_transport_open,
+		ipc_client_uring_transport_close,
+		ipc_client_uring_transport_read,
+		ipc_client_uring_transport_write,
+		ipc_client_uring_transport_poll, NULL);
+	if (rc < 0) {
+		client->uring = NULL;
+		ipc_client_uring_free(uring);
+		return -1;
+	}
+
+	return 0;
+}
+
+int ipc_client_uring_submit(struct ipc_client *client)
+{
+	struct ipc_client_uring *uring;
+
+	if (client == NULL || client->uring == NULL)
+		return -1;
+
+	uring = client->uring;
+
+	if (ipc_client_uring_submit_wait(client, uring, 0, NULL) < 0)
+		return -1;
+
+	ipc_client_uring_reap(uring);
+
+	return 0;
+}
+
+int ipc_client_uring_stats_get(struct ipc_client *client,
+			       struct ipc_client_uring_stats *stats)
+{
+	if (client == NULL || client->uring == NULL || stats == NULL)
+		return -1;
+
+	memcpy(stats, &client->uring->stats,
+	       sizeof(struct ipc_client_uring_stats));
+
+	return 0;
+}
+
+void ipc_client_uring_destroy(struct ipc_client *client)
+{
+	if (client == NULL || client->uring == NULL)
+		return;
+
+	ipc_client_uring_stop(client, client->uring);
+	ipc_client_uring_free(client->uring);
+	client->uring = NULL;
+}
@@ -23,7 +23,6 @@
 #include <stdint.h>
 #include <string.h>
 #include <fcntl.h>
-#include <ctype.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -41,139 +40,99 @@ int ipc_seq_valid(unsigned char seq)
 	return 1;
 }
 
-int ipc_data_dump(struct ipc_client *client, const void *data, size_t size)
+/*
+ * A dump line is laid out in place in the caller buffer: the padding is
+ * written once and each byte then takes a couple of stores, for its digits
+ * and for its printable character.
+ */
+int ipc_data_dump_line(const void *data, size_t size, size_t offset,
+		       char *line, size_t length)
 {
-	unsigned int cols = 8;
-	unsigned int cols_count = 2;
-	int spacer;
-	char string[81] = { 0 };
-	char final[161] = { 0 };
-	size_t length;
-	char *print;
-	unsigned char *p;
-	unsigned int offset;
-	unsigned int rollback;
-	unsigned int i, j, k;
-	int rc;
-
-	if (data == NULL || size == 0)
+	static const char offset_digits[] = "0123456789abcdef";
+	static const char data_digits[] = "0123456789ABCDEF";
+	const unsigned char *p;
+	unsigned int digits;
+	unsigned int count;
+	size_t value;
+	char *hex;
+	char *ascii;
+	unsigned int i;
+
+	if (data == NULL || line == NULL || offset >= size)
 		return -1;
 
+	digits = 4;
+	while (digits < sizeof(size_t) * 2 && (offset >> (digits * 4)) != 0)
+		digits++;
+
 	/*
-	 * spacer = string length - offset print length - data print length -
-	 *	    ascii print length
+	 * [offset], 3 spaces, 2 groups of 8 bytes, 3 spaces, the printable
+	 * characters of the 2 groups and the terminating null byte
 	 */
-	spacer = (sizeof(string) - 1) - 6 -
-		(3 * cols * cols_count - 1 + (cols_count - 1)) -
-		(cols * cols_count + cols_count - 1);
-
-	/* Need 3 spacers */
-	spacer /= 3;
-
-	if (spacer <= 0)
+	if (length < digits + 2 + 3 + IPC_DATA_DUMP_LINE_BYTES * 3 + 3 +
+	    IPC_DATA_DUMP_LINE_BYTES + 1 + 1)
 		return -1;
 
-	p = (unsigned char *) data;
-	offset = 0;
+	count = size - offset;
+	if (count > IPC_DATA_DUMP_LINE_BYTES)
+		count = IPC_DATA_DUMP_LINE_BYTES;
 
-	while (offset < size) {
-		rollback = 0;
+	hex = line + digits + 2 + 3;
+	ascii = hex + IPC_DATA_DUMP_LINE_BYTES * 3 + 3;
 
-		print = (char *) &string;
-		length = sizeof(string);
+	memset(line, ' ', ascii - line);
 
-		/* Offset print */
+	line[0] = '[';
+	value = offset;
+	for (i = digits; i > 0; i--) {
+		line[i] = offset_digits[value & 0x0f];
+		value >>= 4;
+	}
+	line[digits + 1] = ']';
 
-		rc = snprintf(print, length, "[%04x]", offset);
-		print += rc;
-		length -= rc;
+	p = (const unsigned char *) data + offset;
 
-		/* Spacer print */
+	for (i = 0; i < count; i++) {
+		hex[0] = data_digits[p[i] >> 4];
+		hex[1] = data_digits[p[i] & 0x0f];
+		hex += 3;
 
-		for (i = 0; i < (unsigned int) spacer; i++) {
-			*print++ = ' ';
-			length--;
-		}
+		if (p[i] >= 0x20 && p[i] < 0x7f)
+			*ascii++ = p[i];
+		else
+			*ascii++ = '.';
 
-		/* Data print */
-
-		for (i = 0; i < cols_count; i++) {
-			for (j = 0; j < cols; j++) {
-				if (offset < size) {
-					rc = snprintf(print, length, "%02X",
-						      *p);
-					print += rc;
-					length -= rc;
-
-					p++;
-					offset++;
-					rollback++;
-				} else {
-					for (k = 0; k < 2; k++) {
-						*print++ = ' ';
-						length--;
-					}
-				}
-
-				if (j != (cols - 1)) {
-					*print++ = ' ';
-					length--;
-				}
-			}
-
-			if (i != (cols_count - 1)) {
-				for (k = 0; k < 2; k++) {
-					*print++ = ' ';
-					length--;
-				}
-			}
+		if (i == IPC_DATA_DUMP_LINE_BYTES / 2 - 1) {
+			hex++;
+			if (count > IPC_DATA_DUMP_LINE_BYTES / 2)
+				*ascii++ = ' ';
 		}
+	}
 
-		/* Spacer print */
-		for (i = 0; i < (unsigned int) spacer; i++) {
-			*print++ = ' ';
-			length--;
-		}
+	*ascii = '\0';
 
-		/* ASCII print */
-		p -= rollback;
-		offset -= rollback;
-
-		for (i = 0; i < cols_count; i++) {
-			for (j = 0; j < cols; j++) {
-				if (offset < size) {
-					if (isascii(*p) && isprint(*p))
-						*print = *p;
-					else
-						*print = '.';
-
-					print++;
-					length--;
-
-					p++;
-					offset++;
-					rollback++;
-				}
-			}
-
-			if (i != (cols_count - 1) && offset < size) {
-				*print++ = ' ';
-				length--;
-			}
-		}
+	return count;
+}
 
-		*print = '\0';
+int ipc_data_dump(struct ipc_client *client, const void *data, size_t size)
+{
+	char line[IPC_DATA_DUMP_LINE_LENGTH];
+	size_t offset;
+	int rc;
 
-		/* Escape string */
-		j = 0;
-		for (i = 0; i < sizeof(string); i++) {
-			if (string[i] == '%')
-				final[j++] = string[i];
+	if (data == NULL || size == 0)
+		return -1;
 
-			final[j++] = string[i];
-		}
+	offset = 0;
+
+	while (offset < size) {
+		rc = ipc_data_dump_line(data, size, offset, line,
+					sizeof(line));
+		if (rc < 0)
+			return -1;
 
-		ipc_client_log(client, final);
+		ipc_client_log(client, "%s", line);
+		offset += rc;
 	}
 
 	return 0;
@@ -34,43 +34,86 @@ int ipc_misc_me_version_setup(struct ipc_misc_me_version_request_data *data)
 	return 0;
 }
 
+int ipc_misc_me_imsi_imsi_view(const void *data, size_t size,
+			       struct ipc_data_view *view)
+{
+	const struct ipc_misc_me_imsi_header *header;
+
+	if (data == NULL || view == NULL ||
+	    size < sizeof(struct ipc_misc_me_imsi_header)) {
+		return -1;
+	}
+
+	header = (const struct ipc_misc_me_imsi_header *) data;
+	if (header->length > size - sizeof(struct ipc_misc_me_imsi_header))
+		return -1;
+
+	view->data = (const unsigned char *) data +
+		sizeof(struct ipc_misc_me_imsi_header);
+	view->size = header->length;
+
+	return 0;
+}
+
 char *ipc_misc_me_imsi_imsi_extract(const void *data, size_t size)
 {
-	struct ipc_misc_me_imsi_header *header;
+	struct ipc_data_view view;
 	char *imsi;
-	size_t imsi_length;
+	int rc;
 
-	if (data == NULL || size < sizeof(struct ipc_misc_me_imsi_header))
+	rc = ipc_misc_me_imsi_imsi_view(data, size, &view);
+	if (rc < 0)
 		return NULL;
 
-	header = (struct ipc_misc_me_imsi_header *) data;
+	/* The IMSI length doesn't count the final null character */
+	imsi = (char *) calloc(1, view.size + sizeof(char));
+	if (imsi == NULL)
+		return NULL;
 
-	/* header->length doesn't count the final null character */
-	imsi_length = header->length + sizeof(char);
+	memcpy(imsi, view.data, view.size);
+	imsi[view.size] = '\0';
 
-	imsi = (char *) calloc(1, imsi_length);
+	return imsi;
+}
 
-	strncpy(imsi, (char *) data + sizeof(struct ipc_misc_me_imsi_header),
-		header->length);
-	imsi[header->length] = '\0';
+int ipc_misc_me_sn_view(const void *data, size_t size,
+			struct ipc_data_view *view)
+{
+	const struct ipc_misc_me_sn_response_data *sn;
 
-	return imsi;
+	if (data == NULL || view == NULL ||
+	    size < sizeof(struct ipc_misc_me_sn_response_data)) {
+		return -1;
+	}
+
+	sn = (const struct ipc_misc_me_sn_response_data *) data;
+	if (sn->length > sizeof(sn->data))
+		return -1;
+
+	view->data = sn->data;
+	view->size = sn->length;
+
+	return 0;
 }
 
 char *ipc_misc_me_sn_extract(const struct ipc_misc_me_sn_response_data *data)
 {
+	struct ipc_data_view view;
 	char *string;
-	size_t length;
+	int rc;
 
-	if (data == NULL || data->length > sizeof(data->data))
+	rc = ipc_misc_me_sn_view(data,
+				 sizeof(struct ipc_misc_me_sn_response_data),
+				 &view);
+	if (rc < 0)
 		return NULL;
 
-	length = data->length + sizeof(char);
-
-	string = (char *) calloc(1, length);
+	string = (char *) calloc(1, view.size + sizeof(char));
+	if (string == NULL)
+		return NULL;
 
-	strncpy(string, (char *) &data->data, data->length);
-	string[data->length] = '\0';
+	memcpy(string, view.data, view.size);
+	string[view.size] = '\0';
 
 	return string;
 }
@@ -55,6 +55,9 @@ int xmm626_hsic_psi_send(struct ipc_client *client, int device_fd,
 int xmm626_hsic_ebl_send(struct ipc_client *client, int device_fd,
 			 const void *ebl_data, size_t ebl_size);
 
+int xmm626_hsic_command_send(struct ipc_client *client, int device_fd,
+			     unsigned short code, const void *data, size_t size,
+			     size_t command_data_size, int ack);
 int xmm626_hsic_port_config_send(struct ipc_client *client, int device_fd);
 int xmm626_hsic_sec_start_send(struct ipc_client *client, int device_fd,
 			       const void *sec_data, size_t sec_size);
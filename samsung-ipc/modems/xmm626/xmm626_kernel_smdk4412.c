@@ -189,8 +189,6 @@ int xmm626_kernel_smdk4412_fmt_send(struct ipc_client *client,
 	struct ipc_fmt_header header;
 	void *buffer;
 	size_t length;
-	size_t count;
-	unsigned char *p;
 	int rc;
 
 	if (client == NULL || client->handlers == NULL ||
@@ -201,6 +199,8 @@ int xmm626_kernel_smdk4412_fmt_send(struct ipc_client *client,
 	ipc_fmt_header_setup(&header, message);
 
 	length = header.length;
+
+	IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
 	buffer = calloc(1, length);
 
 	memcpy(buffer, &header, sizeof(struct ipc_fmt_header));
@@ -212,23 +212,12 @@ int xmm626_kernel_smdk4412_fmt_send(struct ipc_client *client,
 
 	ipc_client_log_send(client, message, __func__);
 
-	p = (unsigned char *) buffer;
-
-	count = 0;
-	while (count < length) {
-		rc = client->handlers->write(client,
-					     client->handlers->transport_data,
-					     p, length - count);
-		if (rc <= 0) {
-			ipc_client_log(client, "Writing FMT data failed");
-			goto error;
-		}
-
-		count += rc;
-		p += rc;
+	rc = ipc_client_transport_write(client, buffer, length);
+	if (rc < 0) {
+		ipc_client_log(client, "Writing FMT data failed");
+		goto error;
 	}
 
-	rc = 0;
 	goto complete;
 
 error:
@@ -244,11 +233,9 @@ complete:
 int xmm626_kernel_smdk4412_fmt_recv(struct ipc_client *client,
 				    struct ipc_message *message)
 {
-	struct ipc_fmt_header *header;
-	void *buffer = NULL;
+	const struct ipc_fmt_header *header;
+	const void *frame;
 	size_t length;
-	size_t count;
-	unsigned char *p;
 	int rc;
 
 	if (client == NULL || client->handlers == NULL ||
@@ -256,63 +243,35 @@ int xmm626_kernel_smdk4412_fmt_recv(struct ipc_client *client,
 		return -1;
 	}
 
-	length = XMM626_DATA_SIZE;
-	buffer = calloc(1, length);
-
-	rc = client->handlers->read(client, client->handlers->transport_data,
-				    buffer, length);
-	if (rc < (int) sizeof(struct ipc_fmt_header)) {
-		ipc_client_log(client, "Reading FMT header failed");
-		goto error;
+	rc = ipc_client_transport_frame_read(client, XMM626_DATA_SIZE_LIMIT,
+					     &frame, &length);
+	if (rc == IPC_CLIENT_RECV_AGAIN) {
+		return rc;
+	} else if (rc < 0) {
+		ipc_client_log(client, "Reading FMT data failed");
+		return -1;
 	}
 
-	header = (struct ipc_fmt_header *) buffer;
+	header = (const struct ipc_fmt_header *) frame;
 
 	ipc_fmt_message_setup(header, message);
 
 	if (header->length > sizeof(struct ipc_fmt_header)) {
 		message->size = header->length - sizeof(struct ipc_fmt_header);
+		IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
 		message->data = calloc(1, message->size);
+		if (message->data == NULL)
+			return -1;
 
-		p = (unsigned char *) message->data;
-
-		count = rc - sizeof(struct ipc_fmt_header);
-		if (count > 0) {
-			memcpy(p,
-			       (void *) ((unsigned char *) buffer +
-					 sizeof(struct ipc_fmt_header)),
-			       count);
-			p += count;
-		}
-
-		while (count < message->size) {
-			rc = client->handlers->read(
-				client, client->handlers->transport_data, p,
-				message->size - count);
-			if (rc <= 0) {
-				ipc_client_log(client,
-					       "Reading FMT data failed");
-				goto error;
-			}
-
-			count += rc;
-			p += rc;
-		}
+		memcpy(message->data,
+		       (const unsigned char *) frame +
+		       sizeof(struct ipc_fmt_header),
+		       message->size);
 	}
 
 	ipc_client_log_recv(client, message, __func__);
 
-	rc = 0;
-	goto complete;
-
-error:
-	rc = -1;
-
-complete:
-	if (buffer != NULL)
-		free(buffer);
-
-	return rc;
+	return 0;
 }
 
 int xmm626_kernel_smdk4412_rfs_send(struct ipc_client *client,
@@ -321,8 +280,6 @@ int xmm626_kernel_smdk4412_rfs_send(struct ipc_client *client,
 	struct ipc_rfs_header header;
 	void *buffer;
 	size_t length;
-	size_t count;
-	unsigned char *p;
 	int rc;
 
 	if (client == NULL || client->handlers == NULL ||
@@ -333,6 +290,8 @@ int xmm626_kernel_smdk4412_rfs_send(struct ipc_client *client,
 	ipc_rfs_header_setup(&header, message);
 
 	length = header.length;
+
+	IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
 	buffer = calloc(1, length);
 
 	memcpy(buffer, &header, sizeof(struct ipc_rfs_header));
@@ -346,23 +305,12 @@ int xmm626_kernel_smdk4412_rfs_send(struct ipc_client *client,
 
 	ipc_client_log_send(client, message, __func__);
 
-	p = (unsigned char *) buffer;
-
-	count = 0;
-	while (count < length) {
-		rc = client->handlers->write(client,
-					     client->handlers->transport_data,
-					     p, length - count);
-		if (rc <= 0) {
-			ipc_client_log(client, "Writing RFS data failed");
-			goto error;
-		}
-
-		count += rc;
-		p += rc;
+	rc = ipc_client_transport_write(client, buffer, length);
+	if (rc < 0) {
+		ipc_client_log(client, "Writing RFS data failed");
+		goto error;
 	}
 
-	rc = 0;
 	goto complete;
 
 error:
@@ -378,11 +326,9 @@ complete:
 int xmm626_kernel_smdk4412_rfs_recv(struct ipc_client *client,
 				    struct ipc_message *message)
 {
-	struct ipc_rfs_header *header;
-	void *buffer = NULL;
+	const struct ipc_rfs_header *header;
+	const void *frame;
 	size_t length;
-	size_t count;
-	unsigned char *p;
 	int rc;
 
 	if (client == NULL || client->handlers == NULL ||
@@ -390,68 +336,35 @@ int xmm626_kernel_smdk4412_rfs_recv(struct ipc_client *client,
 		return -1;
 	}
 
-	length = XMM626_DATA_SIZE;
-	buffer = calloc(1, length);
-
-	rc = client->handlers->read(client, client->handlers->transport_data,
-				    buffer, length);
-	if (rc < (int) sizeof(struct ipc_rfs_header)) {
-		ipc_client_log(client, "Reading RFS header failed");
-		goto error;
+	rc = ipc_client_transport_frame_read(client, XMM626_DATA_SIZE_LIMIT,
+					     &frame, &length);
+	if (rc == IPC_CLIENT_RECV_AGAIN) {
+		return rc;
+	} else if (rc < 0) {
+		ipc_client_log(client, "Reading RFS data failed");
+		return -1;
 	}
 
-	header = (struct ipc_rfs_header *) buffer;
-	if (header->length > XMM626_DATA_SIZE_LIMIT) {
-		ipc_client_log(client, "Invalid RFS header length: %u",
-			       header->length);
-		goto error;
-	}
+	header = (const struct ipc_rfs_header *) frame;
 
 	ipc_rfs_message_setup(header, message);
 
 	if (header->length > sizeof(struct ipc_rfs_header)) {
 		message->size = header->length - sizeof(struct ipc_rfs_header);
+		IPC_CLIENT_COUNTER_ADD(client, allocations, 1);
 		message->data = calloc(1, message->size);
+		if (message->data == NULL)
+			return -1;
 
-		p = (unsigned char *) message->data;
-
-		count = rc - sizeof(struct ipc_rfs_header);
-		if (count > 0) {
-			memcpy(p,
-			       (void *) ((unsigned char *) buffer +
-					 sizeof(struct ipc_rfs_header)),
-			       count);
-			p += count;
-		}
-
-		while (count < message->size) {
-			rc = client->handlers->read(
-				client, client->handlers->transport_data, p,
-				message->size - count);
-			if (rc <= 0) {
-				ipc_client_log(client,
-					       "Reading RFS data failed");
-				goto error;
-			}
-
-			count += rc;
-			p += rc;
-		}
+		memcpy(message->data,
+		       (const unsigned char *) frame +
+		       sizeof(struct ipc_rfs_header),
+		       message->size);
 	}
 
 	ipc_client_log_recv(client, message, __func__);
 
-	rc = 0;
-	goto complete;
-
-error:
-	rc = -1;
-
-complete:
-	if (buffer != NULL)
-		free(buffer);
-
-	return rc;
+	return 0;
 }
 
 int xmm626_kernel_smdk4412_open(
@@ -524,12 +437,15 @@ int xmm626_kernel_smdk4412_write(
 	return rc;
 }
 
-int xmm626_kernel_smdk4412_poll(
-	__attribute__((unused)) struct ipc_client *client,
-	int fd, struct ipc_poll_fds *fds, struct timeval *timeout)
+int xmm626_kernel_smdk4412_poll(struct ipc_client *client, int fd,
+				struct ipc_poll_fds *fds,
+				struct timeval *timeout)
 {
 	int status;
 	fd_set set;
+	fd_set write_set;
+	int writable;
+	int flushed;
 	int fd_max;
 	unsigned int i;
 	unsigned int count;
@@ -538,23 +454,48 @@ int xmm626_kernel_smdk4412_poll(
 	if (fd < 0)
 		return -1;
 
-	FD_ZERO(&set);
-	FD_SET(fd, &set);
+	/*
+	 * Being only writable isn't a timeout: the wait goes on after the
+	 * flush, select leaving the remaining time in the timeout
+	 */
+	do {
+		flushed = 0;
 
-	fd_max = fd;
+		FD_ZERO(&set);
+		FD_SET(fd, &set);
 
-	if (fds != NULL && fds->fds != NULL && fds->count > 0) {
-		for (i = 0; i < fds->count; i++) {
-			if (fds->fds[i] >= 0) {
-				FD_SET(fds->fds[i], &set);
+		fd_max = fd;
 
-				if (fds->fds[i] > fd_max)
-					fd_max = fds->fds[i];
+		if (fds != NULL && fds->fds != NULL && fds->count > 0) {
+			for (i = 0; i < fds->count; i++) {
+				if (fds->fds[i] >= 0) {
+					FD_SET(fds->fds[i], &set);
+
+					if (fds->fds[i] > fd_max)
+						fd_max = fds->fds[i];
+				}
 			}
 		}
-	}
 
-	rc = select(fd_max + 1, &set, NULL, NULL, timeout);
+		/* Wait for the queued output to be writable as well */
+		writable = ipc_client_output_pending(client) > 0;
+		if (writable) {
+			FD_ZERO(&write_set);
+			FD_SET(fd, &write_set);
+		}
+
+		rc = select(fd_max + 1, &set, writable ? &write_set : NULL,
+			    NULL, timeout);
+
+		if (rc > 0 && writable && FD_ISSET(fd, &write_set)) {
+			rc--;
+
+			if (ipc_client_output_flush(client) < 0)
+				return -1;
+
+			flushed = 1;
+		}
+	} while (rc == 0 && flushed);
 
 	if (FD_ISSET(fd, &set)) {
 		status = ioctl(fd, IOCTL_MODEM_STATUS, 0);
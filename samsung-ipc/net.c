@@ -74,6 +74,49 @@ int ipc_net_regist_setup(struct ipc_net_regist_request_data *data,
 	return 0;
 }
 
+/* The PLMN is padded with '#' when it is only 5 digits long */
+static size_t ipc_net_plmn_length(const char *plmn, size_t size)
+{
+	size_t length = 0;
+
+	while (length < size && plmn[length] != '#' && plmn[length] != '\0')
+		length++;
+
+	return length;
+}
+
+int ipc_net_serving_network_plmn_view(const void *data, size_t size,
+				      struct ipc_data_view *view)
+{
+	const struct ipc_net_serving_network_data *serving_network;
+
+	if (data == NULL || view == NULL ||
+	    size < sizeof(struct ipc_net_serving_network_data)) {
+		return -1;
+	}
+
+	serving_network = (const struct ipc_net_serving_network_data *) data;
+
+	view->data = serving_network->plmn;
+	view->size = ipc_net_plmn_length(serving_network->plmn,
+					 sizeof(serving_network->plmn));
+
+	return 0;
+}
+
+int ipc_net_plmn_list_entry_plmn_view(
+	const struct ipc_net_plmn_list_entry *entry,
+	struct ipc_data_view *view)
+{
+	if (entry == NULL || view == NULL)
+		return -1;
+
+	view->data = entry->plmn;
+	view->size = ipc_net_plmn_length(entry->plmn, sizeof(entry->plmn));
+
+	return 0;
+}
+
 unsigned char ipc_net_plmn_list_count_extract(const void *data, size_t size)
 {
 	struct ipc_net_plmn_list_header *header;
@@ -89,10 +132,8 @@ unsigned char ipc_net_plmn_list_count_extract(const void *data, size_t size)
 struct ipc_net_plmn_list_entry *ipc_net_plmn_list_entry_extract(
 	const void *data, size_t size, unsigned int index)
 {
-	struct ipc_net_plmn_list_entry *entry = NULL;
 	unsigned char count;
-	unsigned char i;
-	unsigned int offset;
+	size_t offset;
 
 	if (data == NULL)
 		return NULL;
@@ -101,16 +142,56 @@ struct ipc_net_plmn_list_entry *ipc_net_plmn_list_entry_extract(
 	if (count == 0 || index >= count)
 		return NULL;
 
-	offset = sizeof(struct ipc_net_plmn_list_header);
+	offset = sizeof(struct ipc_net_plmn_list_header) +
+		index * sizeof(struct ipc_net_plmn_list_entry);
 
-	for (i = 0; i < (index + 1); i++) {
-		entry = (struct ipc_net_plmn_list_entry *) (
-			(unsigned char *) data + offset);
-		offset += sizeof(struct ipc_net_plmn_list_entry);
+	if (offset + sizeof(struct ipc_net_plmn_list_entry) > size)
+		return NULL;
+
+	return (struct ipc_net_plmn_list_entry *) (
+		(unsigned char *) data + offset);
+}
+
+int ipc_net_plmn_list_iterator_setup(struct ipc_list_iterator *iterator,
+				     const void *data, size_t size)
+{
+	unsigned char count;
+
+	if (iterator == NULL || data == NULL)
+		return -1;
+
+	memset(iterator, 0, sizeof(struct ipc_list_iterator));
+
+	if (size < sizeof(struct ipc_net_plmn_list_header))
+		return -1;
+
+	count = ipc_net_plmn_list_count_extract(data, size);
+	if (size - sizeof(struct ipc_net_plmn_list_header) <
+	    count * sizeof(struct ipc_net_plmn_list_entry)) {
+		return -1;
 	}
 
-	if (offset > size)
+	iterator->data = (const unsigned char *) data;
+	iterator->size = size;
+	iterator->offset = sizeof(struct ipc_net_plmn_list_header);
+	iterator->count = count;
+
+	return 0;
+}
+
+struct ipc_net_plmn_list_entry *ipc_net_plmn_list_iterator_next(
+	struct ipc_list_iterator *iterator)
+{
+	struct ipc_net_plmn_list_entry *entry;
+
+	if (iterator == NULL || iterator->index >= iterator->count)
 		return NULL;
 
+	entry = (struct ipc_net_plmn_list_entry *) (
+		iterator->data + iterator->offset);
+
+	iterator->offset += sizeof(struct ipc_net_plmn_list_entry);
+	iterator->index++;
+
 	return entry;
 }
@@ -24,6 +24,7 @@
 #include <fcntl.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include <openssl/md5.h>
@@ -34,15 +35,109 @@
 
 #define MD5_DIGEST_LENGTH_ASCII (2 * MD5_DIGEST_LENGTH)
 
+struct ipc_nv_data_md5_context {
+	struct ipc_client *client;
+	MD5_CTX ctx;
+};
+
+struct ipc_nv_data_md5_context *ipc_nv_data_md5_context_create(
+	struct ipc_client *client)
+{
+	struct ipc_nv_data_md5_context *context;
+
+	context = calloc(1, sizeof(struct ipc_nv_data_md5_context));
+	if (context == NULL) {
+		ipc_client_log(client, "%s: Failed to allocate the context",
+			       __func__);
+		return NULL;
+	}
+
+	context->client = client;
+	MD5_Init(&context->ctx);
+
+	return context;
+}
+
+void ipc_nv_data_md5_context_destroy(struct ipc_nv_data_md5_context *context)
+{
+	if (context == NULL)
+		return;
+
+	memset(context, 0, sizeof(struct ipc_nv_data_md5_context));
+	free(context);
+}
+
+int ipc_nv_data_md5_update(struct ipc_nv_data_md5_context *context,
+			   const void *data, size_t size)
+{
+	if (context == NULL || (data == NULL && size > 0))
+		return -1;
+
+	MD5_Update(&context->ctx, data, size);
+
+	return 0;
+}
+
+char *ipc_nv_data_md5_final(struct ipc_nv_data_md5_context *context,
+			    const char *secret)
+{
+	unsigned char md5_hash[MD5_DIGEST_LENGTH] = { 0 };
+
+	if (context == NULL)
+		return NULL;
+
+	if (secret == NULL) {
+		ipc_client_log(context->client, "%s: Failed: secret is NULL",
+			       __func__);
+		return NULL;
+	}
+
+	MD5_Update(&context->ctx, secret, strlen(secret));
+	MD5_Final((unsigned char *) &md5_hash, &context->ctx);
+
+	return data2string(&md5_hash, sizeof(md5_hash));
+}
+
+char *ipc_nv_data_md5_data_calculate(struct ipc_client *client,
+				     const void *data, size_t size,
+				     const char *secret)
+{
+	struct ipc_nv_data_md5_context *context;
+	char *md5_string = NULL;
+	int rc;
+
+	if (secret == NULL) {
+		ipc_client_log(client, "%s: Failed: secret is NULL", __func__);
+		return NULL;
+	}
+
+	context = ipc_nv_data_md5_context_create(client);
+	if (context == NULL)
+		return NULL;
+
+	rc = ipc_nv_data_md5_update(context, data, size);
+	if (rc < 0)
+		goto complete;
+
+	md5_string = ipc_nv_data_md5_final(context, secret);
+
+complete:
+	ipc_nv_data_md5_context_destroy(context);
+
+	return md5_string;
+}
+
 char *ipc_nv_data_md5_calculate(struct ipc_client *client,
 				const char *path, const char *secret,
 				size_t size, size_t chunk_size)
 {
+	struct ipc_nv_data_md5_context *context = NULL;
 	struct stat st;
-	void *data = NULL;
+	unsigned char *data = MAP_FAILED;
 	char *md5_string = NULL;
-	unsigned char md5_hash[MD5_DIGEST_LENGTH] = { 0 };
-	MD5_CTX ctx;
+	size_t offset;
+	size_t count;
+	int fd = -1;
 	int rc;
 
 	if (secret == NULL) {
@@ -50,12 +145,23 @@ char *ipc_nv_data_md5_calculate(struct ipc_client *client,
 		return NULL;
 	}
 
-	rc = stat(path, &st);
+	if (chunk_size == 0)
+		chunk_size = size;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		rc = errno;
+		ipc_client_log(client, "%s: open failed with error %d: %s",
+			       __func__, rc, strerror(rc));
+		goto complete;
+	}
+
+	rc = fstat(fd, &st);
 	if (rc == -1) {
 		rc = errno;
-		ipc_client_log(client, "%s: stat failed with error %d",
+		ipc_client_log(client, "%s: stat failed with error %d: %s",
 			       __func__, rc, strerror(rc));
-		return NULL;
+		goto complete;
 	}
 
 	if ((unsigned long)st.st_size != size) {
@@ -63,21 +169,43 @@ char *ipc_nv_data_md5_calculate(struct ipc_client *client,
 			       "%s: Checking %s size failed: "
 			       "requested size: %d, file size: %d\n",
 			       __func__, path, size, st.st_size);
-		return NULL;
+		goto complete;
 	}
 
-	data = file_data_read(client, path, size, chunk_size, 0);
-	if (data == NULL) {
-		ipc_client_log(client, "%s failed: data is NULL", __func__);
-		return NULL;
+	/* The file is hashed straight from the page cache instead of being
+	 * copied in a buffer first.
+	 */
+	data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED) {
+		rc = errno;
+		ipc_client_log(client, "%s: mmap failed with error %d: %s",
+			       __func__, rc, strerror(rc));
+		goto complete;
 	}
 
-	MD5_Init(&ctx);
-	MD5_Update(&ctx, data, size);
-	MD5_Update(&ctx, secret, strlen(secret));
-	MD5_Final((unsigned char *) &md5_hash, &ctx);
+	context = ipc_nv_data_md5_context_create(client);
+	if (context == NULL)
+		goto complete;
 
-	md5_string = data2string(&md5_hash, sizeof(md5_hash));
+	for (offset = 0; offset < size; offset += count) {
+		count = size - offset < chunk_size ? size - offset : chunk_size;
+
+		rc = ipc_nv_data_md5_update(context, data + offset, count);
+		if (rc < 0)
+			goto complete;
+	}
+
+	md5_string = ipc_nv_data_md5_final(context, secret);
+
+complete:
+	if (context != NULL)
+		ipc_nv_data_md5_context_destroy(context);
+
+	if (data != MAP_FAILED)
+		munmap(data, size);
+
+	if (fd >= 0)
+		close(fd);
 
 	return md5_string;
 }
@@ -713,29 +841,26 @@ size_t ipc_rfs_nv_data_item_size_setup(
 	if (header == NULL || nv_data == NULL || nv_size == 0)
 		return 0;
 
-	size = sizeof(struct ipc_rfs_nv_read_item_response_header) + size;
+	size = sizeof(struct ipc_rfs_nv_read_item_response_header) + nv_size;
 
 	return size;
 }
 
-void *ipc_rfs_nv_read_item_setup(
+size_t ipc_rfs_nv_read_item_setup_into(
 	struct ipc_rfs_nv_read_item_response_header *header,
-	const void *nv_data, size_t nv_size)
+	const void *nv_data, size_t nv_size, void *buffer, size_t buffer_size)
 {
-	void *data;
 	size_t size;
 	unsigned char *p;
 
-	if (header == NULL || nv_data == NULL || nv_size == 0)
-		return NULL;
+	if (header == NULL || nv_data == NULL || nv_size == 0 || buffer == NULL)
+		return 0;
 
 	size = ipc_rfs_nv_data_item_size_setup(header, nv_data, nv_size);
-	if (size == 0)
-		return NULL;
-
-	data = calloc(1, size);
+	if (size == 0 || size > buffer_size)
+		return 0;
 
-	p = (unsigned char *) data;
+	p = (unsigned char *) buffer;
 
 	memcpy(p, header, sizeof(struct ipc_rfs_nv_read_item_response_header));
 	p += sizeof(struct ipc_rfs_nv_read_item_response_header);
@@ -743,6 +868,31 @@ void *ipc_rfs_nv_read_item_setup(
 	memcpy(p, nv_data, nv_size);
 	p += nv_size;
 
+	return size;
+}
+
+void *ipc_rfs_nv_read_item_setup(
+	struct ipc_rfs_nv_read_item_response_header *header,
+	const void *nv_data, size_t nv_size)
+{
+	void *data;
+	size_t size;
+
+	size = ipc_rfs_nv_data_item_size_setup(header, nv_data, nv_size);
+	if (size == 0)
+		return NULL;
+
+	data = calloc(1, size);
+	if (data == NULL)
+		return NULL;
+
+	size = ipc_rfs_nv_read_item_setup_into(header, nv_data, nv_size, data,
+					       size);
+	if (size == 0) {
+		free(data);
+		return NULL;
+	}
+
 	return data;
 }
 
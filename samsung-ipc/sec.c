@@ -142,27 +142,25 @@ size_t ipc_sec_rsim_access_size_setup(
 	return size;
 }
 
-void *ipc_sec_rsim_access_setup(
+size_t ipc_sec_rsim_access_setup_into(
 	struct ipc_sec_rsim_access_request_header *header,
-	const void *sim_io_data, size_t sim_io_size)
+	const void *sim_io_data, size_t sim_io_size, void *buffer,
+	size_t buffer_size)
 {
-	void *data;
 	size_t size;
 	unsigned char *p;
 
-	if (header == NULL)
-		return NULL;
+	if (header == NULL || buffer == NULL)
+		return 0;
 
 	if (sim_io_data == NULL)
 		sim_io_size = 0;
 
 	size = ipc_sec_rsim_access_size_setup(header, sim_io_data, sim_io_size);
-	if (size == 0)
-		return NULL;
-
-	data = calloc(1, size);
+	if (size == 0 || size > buffer_size)
+		return 0;
 
-	p = (unsigned char *) data;
+	p = (unsigned char *) buffer;
 
 	memcpy(p, header, sizeof(struct ipc_sec_rsim_access_request_header));
 	p += sizeof(struct ipc_sec_rsim_access_request_header);
@@ -172,50 +170,80 @@ void *ipc_sec_rsim_access_setup(
 		p += sim_io_size;
 	}
 
-	return data;
+	return size;
 }
 
-size_t ipc_sec_rsim_access_size_extract(const void *data, size_t size)
+void *ipc_sec_rsim_access_setup(
+	struct ipc_sec_rsim_access_request_header *header,
+	const void *sim_io_data, size_t sim_io_size)
 {
-	struct ipc_sec_rsim_access_response_header *header;
+	void *data;
+	size_t size;
 
-	if (data == NULL ||
-	    size < sizeof(struct ipc_sec_rsim_access_response_header)) {
-		return 0;
-	}
+	size = ipc_sec_rsim_access_size_setup(header, sim_io_data, sim_io_size);
+	if (size == 0)
+		return NULL;
 
-	header = (struct ipc_sec_rsim_access_response_header *) data;
-	if (header->length == 0 ||
-	    header->length > size -
-	    sizeof(struct ipc_sec_rsim_access_response_header)) {
-		return 0;
+	data = calloc(1, size);
+	if (data == NULL)
+		return NULL;
+
+	size = ipc_sec_rsim_access_setup_into(header, sim_io_data, sim_io_size,
+					      data, size);
+	if (size == 0) {
+		free(data);
+		return NULL;
 	}
 
-	return (size_t) header->length;
+	return data;
 }
 
-void *ipc_sec_rsim_access_extract(const void *data, size_t size)
+int ipc_sec_rsim_access_view(const void *data, size_t size,
+			     struct ipc_data_view *view)
 {
-	struct ipc_sec_rsim_access_response_header *header;
-	void *rsim_data;
+	const struct ipc_sec_rsim_access_response_header *header;
 
-	if (data == NULL ||
+	if (data == NULL || view == NULL ||
 	    size < sizeof(struct ipc_sec_rsim_access_response_header)) {
-		return NULL;
+		return -1;
 	}
 
-	header = (struct ipc_sec_rsim_access_response_header *) data;
+	header = (const struct ipc_sec_rsim_access_response_header *) data;
 	if (header->length == 0 ||
 	    header->length > size -
 	    sizeof(struct ipc_sec_rsim_access_response_header)) {
-		return NULL;
+		return -1;
 	}
 
-	rsim_data = (void *) (
-		(unsigned char *) data +
-		sizeof(struct ipc_sec_rsim_access_response_header));
+	view->data = (const unsigned char *) data +
+		sizeof(struct ipc_sec_rsim_access_response_header);
+	view->size = header->length;
+
+	return 0;
+}
+
+size_t ipc_sec_rsim_access_size_extract(const void *data, size_t size)
+{
+	struct ipc_data_view view;
+	int rc;
+
+	rc = ipc_sec_rsim_access_view(data, size, &view);
+	if (rc < 0)
+		return 0;
+
+	return view.size;
+}
+
+void *ipc_sec_rsim_access_extract(const void *data, size_t size)
+{
+	struct ipc_data_view view;
+	int rc;
+
+	rc = ipc_sec_rsim_access_view(data, size, &view);
+	if (rc < 0)
+		return NULL;
 
-	return rsim_data;
+	return (void *) view.data;
 }
 
 int ipc_sec_lock_information_setup(
@@ -0,0 +1,751 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <samsung-ipc.h>
+
+#include "ipc.h"
+
+/*
+ * SIM elementary files cache in front of IPC_SEC_RSIM_ACCESS:
+ * - Successful READ BINARY, READ RECORD and GET RESPONSE results are cached
+ *   by their request header: command, file id, p1, p2 and p3. The least
+ *   recently used entry is evicted when the cache is full.
+ * - An identical request that is already in flight isn't sent again: the
+ *   response is given to every requester. A request that got no response
+ *   within the timeout, in milliseconds, fails instead of being joined.
+ * - Writes invalidate the file they target. SIM status changes that
+ *   involve the card going away, and SAT REFRESH proactive commands
+ *   invalidate either the files they list or the whole cache.
+ * - EF ICCID is always read from the card: a different ICCID means that the
+ *   card was swapped while the modem was off, which flushes the cache.
+ *
+ * Responses, from the cache or from the modem, are passed to the callback
+ * as the IPC_SEC_RSIM_ACCESS response data, or NULL on failure. Flushing the
+ * cache fails the requests in flight, as their responses may never come.
+ */
+
+#define SIM_EF_ICCID				0x2FE2
+#define SIM_MF					0x3F00
+
+/* ETSI TS 102 223 */
+#define SAT_PROACTIVE_COMMAND_TAG		0xD0
+#define SAT_COMMAND_DETAILS_TAG		0x01
+#define SAT_FILE_LIST_TAG			0x12
+#define SAT_COMMAND_REFRESH			0x01
+#define SAT_REFRESH_FILE_CHANGE		0x01
+
+struct ipc_sec_rsim_cache_entry {
+	struct ipc_sec_rsim_access_request_header key;
+	uint64_t used;
+	void *data;
+	size_t size;
+};
+
+struct ipc_sec_rsim_cache_pending {
+	struct ipc_sec_rsim_cache_pending *next;
+	struct ipc_sec_rsim_access_request_header key;
+	unsigned int generation;
+	uint64_t sent;
+	unsigned char mseq;
+	unsigned char *waiters;
+	unsigned int waiters_count;
+};
+
+struct ipc_sec_rsim_cache {
+	struct ipc_client *client;
+	void (*callback)(void *data, unsigned char mseq, const void *response,
+			 size_t response_size);
+	void *callback_data;
+
+	struct ipc_sec_rsim_cache_entry *entries;
+	unsigned int count;
+	uint64_t tick;
+
+	struct ipc_sec_rsim_cache_pending *pending;
+	unsigned int generation;
+	unsigned int timeout;
+
+	unsigned char iccid[10];
+	size_t iccid_size;
+
+	struct ipc_sec_rsim_cache_stats stats;
+};
+
+static uint64_t ipc_sec_rsim_cache_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int ipc_sec_rsim_cache_key_compare(
+	const struct ipc_sec_rsim_access_request_header *a,
+	const struct ipc_sec_rsim_access_request_header *b)
+{
+	return memcmp(a, b, sizeof(struct ipc_sec_rsim_access_request_header));
+}
+
+static void ipc_sec_rsim_cache_entry_free(
+	struct ipc_sec_rsim_cache_entry *entry)
+{
+	if (entry->data == NULL)
+		return;
+
+	free(entry->data);
+	memset(entry, 0, sizeof(struct ipc_sec_rsim_cache_entry));
+}
+
+struct ipc_sec_rsim_cache *ipc_sec_rsim_cache_create(
+	struct ipc_client *client, unsigned int count, unsigned int timeout,
+	void (*callback)(void *data, unsigned char mseq, const void *response,
+			 size_t response_size),
+	void *callback_data)
+{
+	struct ipc_sec_rsim_cache *cache;
+
+	if (client == NULL || count == 0 || callback == NULL)
+		return NULL;
+
+	cache = calloc(1, sizeof(struct ipc_sec_rsim_cache));
+	if (cache == NULL)
+		return NULL;
+
+	cache->entries = calloc(count, sizeof(struct ipc_sec_rsim_cache_entry));
+	if (cache->entries == NULL) {
+		free(cache);
+		return NULL;
+	}
+
+	cache->client = client;
+	cache->count = count;
+	cache->timeout = timeout;
+	cache->callback = callback;
+	cache->callback_data = callback_data;
+
+	return cache;
+}
+
+static void ipc_sec_rsim_cache_pending_free(
+	struct ipc_sec_rsim_cache_pending *pending)
+{
+	if (pending->waiters != NULL)
+		free(pending->waiters);
+
+	free(pending);
+}
+
+void ipc_sec_rsim_cache_destroy(struct ipc_sec_rsim_cache *cache)
+{
+	struct ipc_sec_rsim_cache_pending *pending;
+	struct ipc_sec_rsim_cache_pending *next;
+	unsigned int i;
+
+	if (cache == NULL)
+		return;
+
+	for (i = 0; i < cache->count; i++) {
+		if (cache->entries[i].data != NULL)
+			free(cache->entries[i].data);
+	}
+
+	for (pending = cache->pending; pending != NULL; pending = next) {
+		next = pending->next;
+		ipc_sec_rsim_cache_pending_free(pending);
+	}
+
+	free(cache->entries);
+	free(cache);
+}
+
+static struct ipc_sec_rsim_cache_entry *ipc_sec_rsim_cache_lookup(
+	struct ipc_sec_rsim_cache *cache,
+	const struct ipc_sec_rsim_access_request_header *key)
+{
+	unsigned int i;
+
+	for (i = 0; i < cache->count; i++) {
+		if (cache->entries[i].data != NULL &&
+		    !ipc_sec_rsim_cache_key_compare(&cache->entries[i].key,
+						    key)) {
+			return &cache->entries[i];
+		}
+	}
+
+	return NULL;
+}
+
+static int ipc_sec_rsim_cache_store(
+	struct ipc_sec_rsim_cache *cache,
+	const struct ipc_sec_rsim_access_request_header *key,
+	const void *data, size_t size)
+{
+	struct ipc_sec_rsim_cache_entry *entry;
+	unsigned int i;
+	void *copy;
+
+	copy = malloc(size);
+	if (copy == NULL)
+		return -1;
+
+	memcpy(copy, data, size);
+
+	entry = ipc_sec_rsim_cache_lookup(cache, key);
+	if (entry == NULL) {
+		entry = &cache->entries[0];
+
+		for (i = 0; i < cache->count; i++) {
+			if (cache->entries[i].data == NULL) {
+				entry = &cache->entries[i];
+				break;
+			}
+
+			if (cache->entries[i].used < entry->used)
+				entry = &cache->entries[i];
+		}
+	}
+
+	ipc_sec_rsim_cache_entry_free(entry);
+
+	memcpy(&entry->key, key, sizeof(entry->key));
+	entry->used = ++cache->tick;
+	entry->data = copy;
+	entry->size = size;
+
+	return 0;
+}
+
+static void ipc_sec_rsim_cache_complete(
+	struct ipc_sec_rsim_cache *cache,
+	struct ipc_sec_rsim_cache_pending *pending, const void *data,
+	size_t size)
+{
+	unsigned int i;
+
+	cache->callback(cache->callback_data, pending->mseq, data, size);
+
+	for (i = 0; i < pending->waiters_count; i++) {
+		cache->callback(cache->callback_data, pending->waiters[i], data,
+				size);
+	}
+
+	ipc_sec_rsim_cache_pending_free(pending);
+}
+
+/* Fails the requests in flight: all of them, or the ones that timed out */
+static void ipc_sec_rsim_cache_pending_fail(struct ipc_sec_rsim_cache *cache,
+					    int all)
+{
+	struct ipc_sec_rsim_cache_pending **pending;
+	struct ipc_sec_rsim_cache_pending *failed = NULL;
+	struct ipc_sec_rsim_cache_pending *next;
+	uint64_t now;
+
+	now = ipc_sec_rsim_cache_now();
+
+	pending = &cache->pending;
+	while (*pending != NULL) {
+		if (!all && (cache->timeout == 0 ||
+			     now - (*pending)->sent < cache->timeout)) {
+			pending = &(*pending)->next;
+			continue;
+		}
+
+		next = (*pending)->next;
+		(*pending)->next = failed;
+		failed = *pending;
+		*pending = next;
+	}
+
+	/* The callbacks may send new requests */
+	while (failed != NULL) {
+		next = failed->next;
+		ipc_sec_rsim_cache_complete(cache, failed, NULL, 0);
+		failed = next;
+	}
+}
+
+int ipc_sec_rsim_cache_invalidate(struct ipc_sec_rsim_cache *cache,
+				  unsigned short file_id)
+{
+	unsigned int count = 0;
+	unsigned int i;
+
+	if (cache == NULL)
+		return -1;
+
+	for (i = 0; i < cache->count; i++) {
+		if (cache->entries[i].data != NULL &&
+		    cache->entries[i].key.file_id == file_id) {
+			ipc_sec_rsim_cache_entry_free(&cache->entries[i]);
+			count++;
+		}
+	}
+
+	/* Reads in flight might return the old content */
+	cache->generation++;
+	cache->stats.invalidations += count;
+
+	return count;
+}
+
+int ipc_sec_rsim_cache_flush(struct ipc_sec_rsim_cache *cache)
+{
+	unsigned int count = 0;
+	unsigned int i;
+
+	if (cache == NULL)
+		return -1;
+
+	for (i = 0; i < cache->count; i++) {
+		if (cache->entries[i].data != NULL) {
+			ipc_sec_rsim_cache_entry_free(&cache->entries[i]);
+			count++;
+		}
+	}
+
+	cache->generation++;
+	cache->stats.invalidations += count;
+
+	/* The responses to the requests in flight may never come */
+	ipc_sec_rsim_cache_pending_fail(cache, 1);
+
+	return count;
+}
+
+static int ipc_sec_rsim_cache_send(
+	struct ipc_sec_rsim_cache *cache, unsigned char mseq,
+	struct ipc_sec_rsim_access_request_header *header,
+	const void *sim_io_data, size_t sim_io_size)
+{
+	void *data;
+	size_t size;
+	int rc;
+
+	size = ipc_sec_rsim_access_size_setup(header, sim_io_data,
+					      sim_io_size);
+
+	data = ipc_client_arena_alloc(cache->client, size);
+	if (data == NULL)
+		return -1;
+
+	size = ipc_sec_rsim_access_setup_into(header, sim_io_data,
+					      sim_io_size, data, size);
+	if (size == 0)
+		return -1;
+
+	rc = ipc_client_send(cache->client, mseq, IPC_SEC_RSIM_ACCESS,
+			     IPC_TYPE_GET, data, size);
+	if (rc < 0) {
+		ipc_client_log(cache->client,
+			       "Sending SIM access for file 0x%04x failed",
+			       header->file_id);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Returns IPC_SEC_RSIM_CACHE_SENT when the request was sent to the modem,
+ * IPC_SEC_RSIM_CACHE_HIT when the callback was already called with the
+ * cached response and IPC_SEC_RSIM_CACHE_JOINED when the response of an
+ * identical request in flight will be used.
+ */
+int ipc_sec_rsim_cache_request(
+	struct ipc_sec_rsim_cache *cache, unsigned char mseq,
+	struct ipc_sec_rsim_access_request_header *header,
+	const void *sim_io_data, size_t sim_io_size)
+{
+	struct ipc_sec_rsim_cache_pending *pending;
+	struct ipc_sec_rsim_cache_entry *entry;
+	unsigned char *waiters;
+	int rc;
+
+	if (cache == NULL || header == NULL)
+		return -1;
+
+	switch (header->command) {
+	case IPC_SEC_RSIM_COMMAND_UPDATE_BINARY:
+	case IPC_SEC_RSIM_COMMAND_UPDATE_RECORD:
+	case IPC_SEC_RSIM_COMMAND_SET_DATA:
+		ipc_sec_rsim_cache_invalidate(cache, header->file_id);
+		/* Fallthrough */
+	default:
+		rc = ipc_sec_rsim_cache_send(cache, mseq, header, sim_io_data,
+					     sim_io_size);
+		if (rc < 0)
+			return -1;
+
+		return IPC_SEC_RSIM_CACHE_SENT;
+	case IPC_SEC_RSIM_COMMAND_READ_BINARY:
+	case IPC_SEC_RSIM_COMMAND_READ_RECORD:
+	case IPC_SEC_RSIM_COMMAND_GET_RESPONSE:
+		break;
+	}
+
+	if (header->file_id != SIM_EF_ICCID) {
+		entry = ipc_sec_rsim_cache_lookup(cache, header);
+		if (entry != NULL) {
+			entry->used = ++cache->tick;
+			cache->stats.hits++;
+
+			cache->callback(cache->callback_data, mseq, entry->data,
+					entry->size);
+
+			return IPC_SEC_RSIM_CACHE_HIT;
+		}
+	}
+
+	/* A request that timed out is failed rather than joined */
+	ipc_sec_rsim_cache_pending_fail(cache, 0);
+
+	for (pending = cache->pending; pending != NULL;
+	     pending = pending->next) {
+		if (!ipc_sec_rsim_cache_key_compare(&pending->key, header))
+			break;
+	}
+
+	if (pending != NULL) {
+		waiters = realloc(pending->waiters,
+				  pending->waiters_count + 1);
+		if (waiters == NULL)
+			return -1;
+
+		waiters[pending->waiters_count++] = mseq;
+		pending->waiters = waiters;
+		cache->stats.joined++;
+
+		return IPC_SEC_RSIM_CACHE_JOINED;
+	}
+
+	pending = calloc(1, sizeof(struct ipc_sec_rsim_cache_pending));
+	if (pending == NULL)
+		return -1;
+
+	rc = ipc_sec_rsim_cache_send(cache, mseq, header, sim_io_data,
+				     sim_io_size);
+	if (rc < 0) {
+		free(pending);
+		return -1;
+	}
+
+	memcpy(&pending->key, header, sizeof(pending->key));
+	pending->generation = cache->generation;
+	pending->sent = ipc_sec_rsim_cache_now();
+	pending->mseq = mseq;
+	pending->next = cache->pending;
+	cache->pending = pending;
+
+	cache->stats.misses++;
+
+	return IPC_SEC_RSIM_CACHE_SENT;
+}
+
+static struct ipc_sec_rsim_cache_pending *ipc_sec_rsim_cache_pending_take(
+	struct ipc_sec_rsim_cache *cache, unsigned char aseq)
+{
+	struct ipc_sec_rsim_cache_pending **pending;
+	struct ipc_sec_rsim_cache_pending *taken;
+
+	for (pending = &cache->pending; *pending != NULL;
+	     pending = &(*pending)->next) {
+		if ((*pending)->mseq == aseq) {
+			taken = *pending;
+			*pending = taken->next;
+			return taken;
+		}
+	}
+
+	return NULL;
+}
+
+static void ipc_sec_rsim_cache_iccid_check(struct ipc_sec_rsim_cache *cache,
+					   const struct ipc_data_view *view)
+{
+	if (view->size > sizeof(cache->iccid))
+		return;
+
+	if (cache->iccid_size != 0 && (cache->iccid_size != view->size ||
+	    memcmp(cache->iccid, view->data, view->size))) {
+		ipc_client_log(cache->client,
+			       "SIM card changed, flushing the cache");
+		ipc_sec_rsim_cache_flush(cache);
+	}
+
+	memcpy(cache->iccid, view->data, view->size);
+	cache->iccid_size = view->size;
+}
+
+static int ipc_sec_rsim_cache_access_handle(
+	struct ipc_sec_rsim_cache *cache, const struct ipc_message *message)
+{
+	const struct ipc_sec_rsim_access_response_header *header;
+	struct ipc_sec_rsim_cache_pending *pending;
+	struct ipc_data_view view;
+	int rc;
+
+	pending = ipc_sec_rsim_cache_pending_take(cache, message->aseq);
+	if (pending == NULL)
+		return 0;
+
+	rc = ipc_sec_rsim_access_view(message->data, message->size, &view);
+	if (rc < 0) {
+		ipc_sec_rsim_cache_complete(cache, pending, message->data,
+					    message->size);
+		return 1;
+	}
+
+	header = (const struct ipc_sec_rsim_access_response_header *)
+		message->data;
+
+	if (header->sw1 == 0x90 || header->sw1 == 0x91) {
+		if (pending->key.file_id == SIM_EF_ICCID &&
+		    pending->key.command == IPC_SEC_RSIM_COMMAND_READ_BINARY) {
+			ipc_sec_rsim_cache_iccid_check(cache, &view);
+		}
+
+		/* The file was invalidated while the request was in flight */
+		if (pending->generation == cache->generation) {
+			ipc_sec_rsim_cache_store(cache, &pending->key,
+						 message->data,
+						 sizeof(*header) + view.size);
+		}
+	}
+
+	ipc_sec_rsim_cache_complete(cache, pending, message->data,
+				    message->size);
+
+	return 1;
+}
+
+static int ipc_sec_rsim_cache_gen_phone_res_handle(
+	struct ipc_sec_rsim_cache *cache, const struct ipc_message *message)
+{
+	struct ipc_gen_phone_res_data *data;
+	struct ipc_sec_rsim_cache_pending *pending;
+
+	if (message->data == NULL ||
+	    message->size < sizeof(struct ipc_gen_phone_res_data)) {
+		return 0;
+	}
+
+	data = (struct ipc_gen_phone_res_data *) message->data;
+	if (IPC_COMMAND(data->group, data->index) != IPC_SEC_RSIM_ACCESS ||
+	    ipc_gen_phone_res_check(data) == 0) {
+		return 0;
+	}
+
+	pending = ipc_sec_rsim_cache_pending_take(cache, message->aseq);
+	if (pending == NULL)
+		return 0;
+
+	ipc_sec_rsim_cache_complete(cache, pending, NULL, 0);
+
+	return 1;
+}
+
+static void ipc_sec_rsim_cache_pin_status_handle(
+	struct ipc_sec_rsim_cache *cache, const struct ipc_message *message)
+{
+	struct ipc_sec_pin_status_response_data *data;
+
+	if (message->data == NULL ||
+	    message->size < sizeof(struct ipc_sec_pin_status_response_data)) {
+		return;
+	}
+
+	data = (struct ipc_sec_pin_status_response_data *) message->data;
+
+	switch (data->status) {
+	case IPC_SEC_PIN_STATUS_CARD_NOT_PRESENT:
+	case IPC_SEC_PIN_STATUS_CARD_ERROR:
+		ipc_sec_rsim_cache_flush(cache);
+		cache->iccid_size = 0;
+		break;
+	}
+}
+
+static size_t sat_length_parse(const unsigned char *p, size_t size,
+			       size_t *length)
+{
+	if (size < 1)
+		return 0;
+
+	if (p[0] < 0x80) {
+		*length = p[0];
+		return 1;
+	}
+
+	if (p[0] != 0x81 || size < 2)
+		return 0;
+
+	*length = p[1];
+
+	return 2;
+}
+
+/*
+ * Only REFRESH with the file change notification qualifier lists the files
+ * that changed: every other refresh mode, and commands that can't be
+ * parsed, flush the whole cache.
+ */
+static void ipc_sec_rsim_cache_sat_handle(struct ipc_sec_rsim_cache *cache,
+					  const struct ipc_message *message)
+{
+	const unsigned char *p = message->data;
+	const unsigned char *files = NULL;
+	size_t files_size = 0;
+	size_t offset = 0;
+	size_t length;
+	size_t size;
+	size_t n;
+	unsigned short file_id;
+	unsigned char tag;
+	int command = -1;
+	int qualifier = -1;
+
+	if (message->command == IPC_SAT_REFRESH)
+		goto flush;
+
+	if (p == NULL)
+		return;
+
+	/* The proactive command can be preceded by its length */
+	while (offset < 3 && offset < message->size &&
+	       p[offset] != SAT_PROACTIVE_COMMAND_TAG) {
+		offset++;
+	}
+
+	if (offset >= message->size || p[offset] != SAT_PROACTIVE_COMMAND_TAG)
+		goto flush;
+
+	offset++;
+	n = sat_length_parse(p + offset, message->size - offset, &size);
+	if (n == 0 || offset + n + size > message->size)
+		goto flush;
+
+	offset += n;
+	p += offset;
+
+	for (offset = 0; offset + 2 <= size; offset += length) {
+		tag = p[offset++] & 0x7F;
+
+		n = sat_length_parse(p + offset, size - offset, &length);
+		if (n == 0 || offset + n + length > size)
+			goto flush;
+
+		offset += n;
+
+		if (tag == SAT_COMMAND_DETAILS_TAG && length >= 3) {
+			command = p[offset + 1];
+			qualifier = p[offset + 2];
+		} else if (tag == SAT_FILE_LIST_TAG && length >= 1) {
+			files = p + offset + 1;
+			files_size = length - 1;
+		}
+	}
+
+	if (command != SAT_COMMAND_REFRESH)
+		return;
+
+	if (qualifier != SAT_REFRESH_FILE_CHANGE || files == NULL)
+		goto flush;
+
+	/* Every path starts from the MF: the last id of a path is the EF */
+	for (offset = 0; offset + 2 <= files_size; offset += 2) {
+		if (offset + 4 <= files_size &&
+		    (files[offset + 2] << 8 | files[offset + 3]) != SIM_MF) {
+			continue;
+		}
+
+		file_id = files[offset] << 8 | files[offset + 1];
+		ipc_sec_rsim_cache_invalidate(cache, file_id);
+	}
+
+	return;
+
+flush:
+	ipc_client_log(cache->client, "SIM refresh, flushing the cache");
+	ipc_sec_rsim_cache_flush(cache);
+}
+
+/*
+ * Returns 1 when the message was the response to a request of the cache,
+ * which is then complete. SIM status and SAT messages are only looked at
+ * and always have to be handled by the caller as well.
+ */
+int ipc_sec_rsim_cache_handle(struct ipc_sec_rsim_cache *cache,
+			      const struct ipc_message *message)
+{
+	if (cache == NULL || message == NULL)
+		return -1;
+
+	switch (message->command) {
+	case IPC_SEC_RSIM_ACCESS:
+		if (message->type != IPC_TYPE_RESP)
+			return 0;
+
+		return ipc_sec_rsim_cache_access_handle(cache, message);
+	case IPC_GEN_PHONE_RES:
+		return ipc_sec_rsim_cache_gen_phone_res_handle(cache, message);
+	case IPC_SEC_PIN_STATUS:
+		ipc_sec_rsim_cache_pin_status_handle(cache, message);
+		return 0;
+	case IPC_SAT_PROACTIVE_CMD:
+	case IPC_SAT_REFRESH:
+		if (message->type == IPC_TYPE_RESP)
+			return 0;
+
+		ipc_sec_rsim_cache_sat_handle(cache, message);
+		return 0;
+	default:
+		return 0;
+	}
+}
+
+int ipc_sec_rsim_cache_stats_get(struct ipc_sec_rsim_cache *cache,
+				 struct ipc_sec_rsim_cache_stats *stats)
+{
+	struct ipc_sec_rsim_cache_pending *pending;
+	unsigned int i;
+
+	if (cache == NULL || stats == NULL)
+		return -1;
+
+	memcpy(stats, &cache->stats, sizeof(struct ipc_sec_rsim_cache_stats));
+	stats->entries = 0;
+	stats->pending = 0;
+
+	for (i = 0; i < cache->count; i++) {
+		if (cache->entries[i].data != NULL)
+			stats->entries++;
+	}
+
+	for (pending = cache->pending; pending != NULL;
+	     pending = pending->next) {
+		stats->pending++;
+	}
+
+	return 0;
+}
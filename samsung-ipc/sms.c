@@ -40,33 +40,32 @@ size_t ipc_sms_send_msg_size_setup(
 	return size;
 }
 
-void *ipc_sms_send_msg_setup(struct ipc_sms_send_msg_request_header *header,
-			     const void *smsc, size_t smsc_size,
-			     const void *pdu, size_t pdu_size)
+size_t ipc_sms_send_msg_setup_into(
+	struct ipc_sms_send_msg_request_header *header,
+	const void *smsc, size_t smsc_size, const void *pdu, size_t pdu_size,
+	void *buffer, size_t buffer_size)
 {
-	void *data;
 	size_t size;
 	unsigned char smsc_length;
 	unsigned char *p;
 
 	if (header == NULL || smsc == NULL || smsc_size == 0 || pdu == NULL ||
-	    pdu_size == 0) {
-		return NULL;
+	    pdu_size == 0 || buffer == NULL) {
+		return 0;
 	}
 
 	smsc_length = (unsigned char) smsc_size;
 
-	header->length = (unsigned char) (
-		sizeof(unsigned char) + smsc_size + pdu_size);
-
+	/* The header is left untouched when the buffer is too small */
 	size = ipc_sms_send_msg_size_setup(header, smsc, smsc_size, pdu,
 					   pdu_size);
-	if (size == 0)
-		return NULL;
+	if (size == 0 || size > buffer_size)
+		return 0;
 
-	data = calloc(1, size);
+	header->length = (unsigned char) (
+		sizeof(unsigned char) + smsc_size + pdu_size);
 
-	p = (unsigned char *) data;
+	p = (unsigned char *) buffer;
 
 	memcpy(p, header, sizeof(struct ipc_sms_send_msg_request_header));
 	p += sizeof(struct ipc_sms_send_msg_request_header);
@@ -80,42 +79,81 @@ void *ipc_sms_send_msg_setup(struct ipc_sms_send_msg_request_header *header,
 	memcpy(p, pdu, pdu_size);
 	p += pdu_size;
 
-	return data;
+	return size;
 }
 
-size_t ipc_sms_incoming_msg_pdu_size_extract(const void *data, size_t size)
+void *ipc_sms_send_msg_setup(struct ipc_sms_send_msg_request_header *header,
+			     const void *smsc, size_t smsc_size,
+			     const void *pdu, size_t pdu_size)
 {
-	struct ipc_sms_incoming_msg_header *header;
+	void *data;
+	size_t size;
 
-	header = (struct ipc_sms_incoming_msg_header *) data;
-	if (header->length == 0 ||
-	    header->length > size -
-	    sizeof(struct ipc_sms_incoming_msg_header)) {
-		return 0;
+	size = ipc_sms_send_msg_size_setup(header, smsc, smsc_size, pdu,
+					   pdu_size);
+	if (size == 0)
+		return NULL;
+
+	data = calloc(1, size);
+	if (data == NULL)
+		return NULL;
+
+	size = ipc_sms_send_msg_setup_into(header, smsc, smsc_size, pdu,
+					   pdu_size, data, size);
+	if (size == 0) {
+		free(data);
+		return NULL;
 	}
 
-	return (size_t) header->length;
+	return data;
 }
 
-void *ipc_sms_incoming_msg_pdu_extract(const void *data, size_t size)
+int ipc_sms_incoming_msg_pdu_view(const void *data, size_t size,
+				  struct ipc_data_view *view)
 {
-	struct ipc_sms_incoming_msg_header *header;
-	void *pdu;
+	const struct ipc_sms_incoming_msg_header *header;
 
-	if (data == NULL || size < sizeof(struct ipc_sms_incoming_msg_header))
-		return NULL;
+	if (data == NULL || view == NULL ||
+	    size < sizeof(struct ipc_sms_incoming_msg_header)) {
+		return -1;
+	}
 
-	header = (struct ipc_sms_incoming_msg_header *) data;
+	header = (const struct ipc_sms_incoming_msg_header *) data;
 	if (header->length == 0 ||
 	    header->length > size -
 	    sizeof(struct ipc_sms_incoming_msg_header)) {
-		return NULL;
+		return -1;
 	}
 
-	pdu = (void *) ((unsigned char *) data +
-			sizeof(struct ipc_sms_incoming_msg_header));
+	view->data = (const unsigned char *) data +
+		sizeof(struct ipc_sms_incoming_msg_header);
+	view->size = header->length;
 
-	return pdu;
+	return 0;
+}
+
+size_t ipc_sms_incoming_msg_pdu_size_extract(const void *data, size_t size)
+{
+	struct ipc_data_view view;
+	int rc;
+
+	rc = ipc_sms_incoming_msg_pdu_view(data, size, &view);
+	if (rc < 0)
+		return 0;
+
+	return view.size;
+}
+
+void *ipc_sms_incoming_msg_pdu_extract(const void *data, size_t size)
+{
+	struct ipc_data_view view;
+	int rc;
+
+	rc = ipc_sms_incoming_msg_pdu_view(data, size, &view);
+	if (rc < 0)
+		return NULL;
+
+	return (void *) view.data;
 }
 
 size_t ipc_sms_save_msg_size_setup(
@@ -136,36 +174,35 @@ size_t ipc_sms_save_msg_size_setup(
 	return size;
 }
 
-void *ipc_sms_save_msg_setup(struct ipc_sms_save_msg_request_header *header,
-			     const void *smsc, size_t smsc_size,
-			     const void *pdu, size_t pdu_size)
+size_t ipc_sms_save_msg_setup_into(
+	struct ipc_sms_save_msg_request_header *header,
+	const void *smsc, size_t smsc_size, const void *pdu, size_t pdu_size,
+	void *buffer, size_t buffer_size)
 {
-	void *data;
 	size_t size;
 	unsigned char smsc_length;
 	unsigned char *p;
 
-	if (header == NULL || pdu == NULL || pdu_size == 0)
-		return NULL;
+	if (header == NULL || pdu == NULL || pdu_size == 0 || buffer == NULL)
+		return 0;
 
 	if (smsc == NULL)
 		smsc_size = 0;
 
 	smsc_length = (unsigned char) smsc_size;
 
-	header->magic = 2;
-	header->index = 12 - 1,
-		header->length = (unsigned char) (
-			sizeof(unsigned char) + smsc_size + pdu_size);
-
+	/* The header is left untouched when the buffer is too small */
 	size = ipc_sms_save_msg_size_setup(header, smsc, smsc_size, pdu,
 					   pdu_size);
-	if (size == 0)
-		return NULL;
+	if (size == 0 || size > buffer_size)
+		return 0;
 
-	data = calloc(1, size);
+	header->magic = 2;
+	header->index = 12 - 1;
+	header->length = (unsigned char) (
+		sizeof(unsigned char) + smsc_size + pdu_size);
 
-	p = (unsigned char *) data;
+	p = (unsigned char *) buffer;
 
 	memcpy(p, header, sizeof(struct ipc_sms_save_msg_request_header));
 	p += sizeof(struct ipc_sms_save_msg_request_header);
@@ -181,6 +218,32 @@ void *ipc_sms_save_msg_setup(struct ipc_sms_save_msg_request_header *header,
 	memcpy(p, pdu, pdu_size);
 	p += pdu_size;
 
+	return size;
+}
+
+void *ipc_sms_save_msg_setup(struct ipc_sms_save_msg_request_header *header,
+			     const void *smsc, size_t smsc_size,
+			     const void *pdu, size_t pdu_size)
+{
+	void *data;
+	size_t size;
+
+	size = ipc_sms_save_msg_size_setup(header, smsc, smsc_size, pdu,
+					   pdu_size);
+	if (size == 0)
+		return NULL;
+
+	data = calloc(1, size);
+	if (data == NULL)
+		return NULL;
+
+	size = ipc_sms_save_msg_setup_into(header, smsc, smsc_size, pdu,
+					   pdu_size, data, size);
+	if (size == 0) {
+		free(data);
+		return NULL;
+	}
+
 	return data;
 }
 
@@ -197,44 +260,50 @@ int ipc_sms_del_msg_setup(struct ipc_sms_del_msg_request_data *data,
 	return 0;
 }
 
-size_t ipc_sms_svc_center_addr_smsc_size_extract(const void *data, size_t size)
+int ipc_sms_svc_center_addr_smsc_view(const void *data, size_t size,
+				      struct ipc_data_view *view)
 {
-	struct ipc_sms_svc_center_addr_header *header;
+	const struct ipc_sms_svc_center_addr_header *header;
 
-	if (data == NULL ||
+	if (data == NULL || view == NULL ||
 	    size < sizeof(struct ipc_sms_svc_center_addr_header)) {
-		return 0;
+		return -1;
 	}
 
-	header = (struct ipc_sms_svc_center_addr_header *) data;
+	header = (const struct ipc_sms_svc_center_addr_header *) data;
 	if (header->length == 0 ||
 	    header->length > size -
 	    sizeof(struct ipc_sms_svc_center_addr_header)) {
-		return 0;
+		return -1;
 	}
 
-	return (size_t) header->length;
+	view->data = (const unsigned char *) data +
+		sizeof(struct ipc_sms_svc_center_addr_header);
+	view->size = header->length;
+
+	return 0;
 }
 
-void *ipc_sms_svc_center_addr_smsc_extract(const void *data, size_t size)
+size_t ipc_sms_svc_center_addr_smsc_size_extract(const void *data, size_t size)
 {
-	struct ipc_sms_svc_center_addr_header *header;
-	void *smsc;
+	struct ipc_data_view view;
+	int rc;
 
-	if (data == NULL ||
-	    size < sizeof(struct ipc_sms_svc_center_addr_header)) {
-		return NULL;
-	}
+	rc = ipc_sms_svc_center_addr_smsc_view(data, size, &view);
+	if (rc < 0)
+		return 0;
 
-	header = (struct ipc_sms_svc_center_addr_header *) data;
-	if (header->length == 0 ||
-	    header->length > size -
-	    sizeof(struct ipc_sms_svc_center_addr_header)) {
-		return NULL;
-	}
+	return view.size;
+}
 
-	smsc = (void *) ((unsigned char *) data +
-			 sizeof(struct ipc_sms_svc_center_addr_header));
+void *ipc_sms_svc_center_addr_smsc_extract(const void *data, size_t size)
+{
+	struct ipc_data_view view;
+	int rc;
+
+	rc = ipc_sms_svc_center_addr_smsc_view(data, size, &view);
+	if (rc < 0)
+		return NULL;
 
-	return smsc;
+	return (void *) view.data;
 }
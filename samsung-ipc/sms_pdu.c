@@ -0,0 +1,954 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <samsung-ipc.h>
+
+/*
+ * GSM 03.38 default alphabet and its extension table, as Unicode code
+ * points. Extension entries that are 0 fall back to the default alphabet.
+ */
+
+#define GSM7_ESCAPE	0x1B
+
+static const unsigned short gsm7_default[128] = {
+	0x0040, 0x00A3, 0x0024, 0x00A5, 0x00E8, 0x00E9, 0x00F9, 0x00EC,
+	0x00F2, 0x00C7, 0x000A, 0x00D8, 0x00F8, 0x000D, 0x00C5, 0x00E5,
+	0x0394, 0x005F, 0x03A6, 0x0393, 0x039B, 0x03A9, 0x03A0, 0x03A8,
+	0x03A3, 0x0398, 0x039E, 0x00A0, 0x00C6, 0x00E6, 0x00DF, 0x00C9,
+	0x0020, 0x0021, 0x0022, 0x0023, 0x00A4, 0x0025, 0x0026, 0x0027,
+	0x0028, 0x0029, 0x002A, 0x002B, 0x002C, 0x002D, 0x002E, 0x002F,
+	0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+	0x0038, 0x0039, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F,
+	0x00A1, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+	0x0048, 0x0049, 0x004A, 0x004B, 0x004C, 0x004D, 0x004E, 0x004F,
+	0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+	0x0058, 0x0059, 0x005A, 0x00C4, 0x00D6, 0x00D1, 0x00DC, 0x00A7,
+	0x00BF, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+	0x0068, 0x0069, 0x006A, 0x006B, 0x006C, 0x006D, 0x006E, 0x006F,
+	0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+	0x0078, 0x0079, 0x007A, 0x00E4, 0x00F6, 0x00F1, 0x00FC, 0x00E0,
+};
+
+static const unsigned short gsm7_extension[128] = {
+	[0x0A] = 0x000C,
+	[0x14] = 0x005E,
+	[0x28] = 0x007B,
+	[0x29] = 0x007D,
+	[0x2F] = 0x005C,
+	[0x3C] = 0x005B,
+	[0x3D] = 0x007E,
+	[0x3E] = 0x005D,
+	[0x40] = 0x007C,
+	[0x65] = 0x20AC,
+};
+
+/* Semi-octet digits of addresses, 0xF being the filler */
+static const char address_digits[15] = {
+	'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '*', '#', 'a', 'b',
+	'c',
+};
+
+static uint64_t ipc_sms_pdu_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * UTF-8 helpers
+ */
+
+static size_t utf8_encode(unsigned int code, char *buffer)
+{
+	if (code < 0x80) {
+		buffer[0] = code;
+		return 1;
+	} else if (code < 0x800) {
+		buffer[0] = 0xC0 | (code >> 6);
+		buffer[1] = 0x80 | (code & 0x3F);
+		return 2;
+	} else if (code < 0x10000) {
+		buffer[0] = 0xE0 | (code >> 12);
+		buffer[1] = 0x80 | ((code >> 6) & 0x3F);
+		buffer[2] = 0x80 | (code & 0x3F);
+		return 3;
+	}
+
+	buffer[0] = 0xF0 | (code >> 18);
+	buffer[1] = 0x80 | ((code >> 12) & 0x3F);
+	buffer[2] = 0x80 | ((code >> 6) & 0x3F);
+	buffer[3] = 0x80 | (code & 0x3F);
+
+	return 4;
+}
+
+/* Returns the size of the sequence, or 0 when it isn't valid UTF-8 */
+static size_t utf8_decode(const unsigned char *p, unsigned int *code)
+{
+	size_t size;
+	size_t i;
+
+	if (p[0] < 0x80) {
+		*code = p[0];
+		return 1;
+	} else if ((p[0] & 0xE0) == 0xC0) {
+		*code = p[0] & 0x1F;
+		size = 2;
+	} else if ((p[0] & 0xF0) == 0xE0) {
+		*code = p[0] & 0x0F;
+		size = 3;
+	} else if ((p[0] & 0xF8) == 0xF0) {
+		*code = p[0] & 0x07;
+		size = 4;
+	} else {
+		return 0;
+	}
+
+	for (i = 1; i < size; i++) {
+		if ((p[i] & 0xC0) != 0x80)
+			return 0;
+
+		*code = (*code << 6) | (p[i] & 0x3F);
+	}
+
+	return size;
+}
+
+/*
+ * GSM 7-bit
+ */
+
+size_t ipc_sms_pdu_gsm7_unpack(const void *data, size_t size, size_t fill,
+			       unsigned char *septets, size_t count)
+{
+	const unsigned char *p = data;
+	size_t available;
+	size_t bit = fill;
+	size_t byte;
+	size_t shift;
+	size_t i = 0;
+	uint64_t v;
+
+	if (data == NULL || septets == NULL || fill > 6 || size * 8 < fill)
+		return 0;
+
+	available = (size * 8 - fill) / 7;
+	if (count > available)
+		count = available;
+
+	/* Aligned data: every 7 octets hold exactly 8 septets */
+	if (fill == 0) {
+		for (; i + 8 <= count; i += 8) {
+			v = (uint64_t) p[0] | (uint64_t) p[1] << 8 |
+				(uint64_t) p[2] << 16 | (uint64_t) p[3] << 24 |
+				(uint64_t) p[4] << 32 | (uint64_t) p[5] << 40 |
+				(uint64_t) p[6] << 48;
+
+			septets[i] = v & 0x7F;
+			septets[i + 1] = (v >> 7) & 0x7F;
+			septets[i + 2] = (v >> 14) & 0x7F;
+			septets[i + 3] = (v >> 21) & 0x7F;
+			septets[i + 4] = (v >> 28) & 0x7F;
+			septets[i + 5] = (v >> 35) & 0x7F;
+			septets[i + 6] = (v >> 42) & 0x7F;
+			septets[i + 7] = (v >> 49) & 0x7F;
+
+			p += 7;
+		}
+
+		bit = 0;
+	}
+
+	for (; i < count; i++) {
+		byte = bit >> 3;
+		shift = bit & 7;
+
+		v = p[byte] >> shift;
+		if (shift > 1)
+			v |= p[byte + 1] << (8 - shift);
+
+		septets[i] = v & 0x7F;
+		bit += 7;
+	}
+
+	return count;
+}
+
+size_t ipc_sms_pdu_gsm7_pack(const unsigned char *septets, size_t count,
+			     size_t fill, void *buffer, size_t buffer_size)
+{
+	unsigned char *p = buffer;
+	size_t size;
+	size_t bit = fill;
+	size_t byte;
+	size_t shift;
+	size_t i = 0;
+	uint64_t v;
+
+	if (septets == NULL || buffer == NULL || fill > 6)
+		return 0;
+
+	size = (fill + count * 7 + 7) / 8;
+	if (size > buffer_size)
+		return 0;
+
+	memset(buffer, 0, size);
+
+	if (fill == 0) {
+		for (; i + 8 <= count; i += 8) {
+			v = (uint64_t) (septets[i] & 0x7F) |
+				(uint64_t) (septets[i + 1] & 0x7F) << 7 |
+				(uint64_t) (septets[i + 2] & 0x7F) << 14 |
+				(uint64_t) (septets[i + 3] & 0x7F) << 21 |
+				(uint64_t) (septets[i + 4] & 0x7F) << 28 |
+				(uint64_t) (septets[i + 5] & 0x7F) << 35 |
+				(uint64_t) (septets[i + 6] & 0x7F) << 42 |
+				(uint64_t) (septets[i + 7] & 0x7F) << 49;
+
+			p[0] = v;
+			p[1] = v >> 8;
+			p[2] = v >> 16;
+			p[3] = v >> 24;
+			p[4] = v >> 32;
+			p[5] = v >> 40;
+			p[6] = v >> 48;
+
+			p += 7;
+		}
+
+		bit = 0;
+	}
+
+	for (; i < count; i++) {
+		byte = bit >> 3;
+		shift = bit & 7;
+
+		p[byte] |= (septets[i] & 0x7F) << shift;
+		if (shift > 1)
+			p[byte + 1] |= (septets[i] & 0x7F) >> (8 - shift);
+
+		bit += 7;
+	}
+
+	return size;
+}
+
+int ipc_sms_pdu_gsm7_utf8(const unsigned char *septets, size_t count,
+			  char *buffer, size_t buffer_size)
+{
+	unsigned int code;
+	size_t length = 0;
+	size_t i;
+
+	if (septets == NULL || buffer == NULL || buffer_size == 0)
+		return -1;
+
+	for (i = 0; i < count; i++) {
+		code = gsm7_default[septets[i] & 0x7F];
+
+		if ((septets[i] & 0x7F) == GSM7_ESCAPE && i + 1 < count) {
+			i++;
+			code = gsm7_extension[septets[i] & 0x7F];
+			if (code == 0)
+				code = gsm7_default[septets[i] & 0x7F];
+		}
+
+		/* Room for the longest sequence and the terminating NUL */
+		if (length + 4 >= buffer_size)
+			return -1;
+
+		if (code < 0x80)
+			buffer[length++] = code;
+		else
+			length += utf8_encode(code, buffer + length);
+	}
+
+	buffer[length] = '\0';
+
+	return length;
+}
+
+static int gsm7_lookup(unsigned int code, unsigned char *septet,
+		       int *extension)
+{
+	unsigned int i;
+
+	/* Most of the ASCII range maps to the same values */
+	if ((code >= 0x20 && code <= 0x5A && code != 0x24 && code != 0x40) ||
+	    (code >= 0x61 && code <= 0x7A)) {
+		*septet = code;
+		*extension = 0;
+		return 0;
+	}
+
+	for (i = 0; i < 128; i++) {
+		if (gsm7_default[i] == code && i != GSM7_ESCAPE) {
+			*septet = i;
+			*extension = 0;
+			return 0;
+		}
+	}
+
+	for (i = 0; i < 128; i++) {
+		if (gsm7_extension[i] == code && code != 0) {
+			*septet = i;
+			*extension = 1;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+int ipc_sms_pdu_utf8_gsm7(const char *text, unsigned char *septets,
+			  size_t count)
+{
+	const unsigned char *p = (const unsigned char *) text;
+	unsigned char septet;
+	unsigned int code;
+	size_t length = 0;
+	size_t size;
+	int extension;
+	int rc;
+
+	if (text == NULL || septets == NULL)
+		return -1;
+
+	while (*p != '\0') {
+		size = utf8_decode(p, &code);
+		if (size == 0)
+			return -1;
+
+		rc = gsm7_lookup(code, &septet, &extension);
+		if (rc < 0)
+			return -1;
+
+		if (length + extension + 1 > count)
+			return -1;
+
+		if (extension)
+			septets[length++] = GSM7_ESCAPE;
+
+		septets[length++] = septet;
+		p += size;
+	}
+
+	return length;
+}
+
+/*
+ * UCS2
+ */
+
+int ipc_sms_pdu_ucs2_utf8(const void *data, size_t size, char *buffer,
+			  size_t buffer_size)
+{
+	const unsigned char *p = data;
+	unsigned int code;
+	unsigned int low;
+	size_t length = 0;
+	size_t i;
+
+	if (data == NULL || buffer == NULL || buffer_size == 0)
+		return -1;
+
+	for (i = 0; i + 1 < size; i += 2) {
+		code = p[i] << 8 | p[i + 1];
+
+		/* UTF-16 surrogate pairs are used for characters beyond BMP */
+		if (code >= 0xD800 && code < 0xDC00 && i + 3 < size) {
+			low = p[i + 2] << 8 | p[i + 3];
+			if (low >= 0xDC00 && low < 0xE000) {
+				code = 0x10000 + ((code - 0xD800) << 10) +
+					(low - 0xDC00);
+				i += 2;
+			}
+		}
+
+		if (code >= 0xD800 && code < 0xE000)
+			code = 0xFFFD;
+
+		if (length + 4 >= buffer_size)
+			return -1;
+
+		if (code < 0x80)
+			buffer[length++] = code;
+		else
+			length += utf8_encode(code, buffer + length);
+	}
+
+	buffer[length] = '\0';
+
+	return length;
+}
+
+int ipc_sms_pdu_utf8_ucs2(const char *text, void *buffer, size_t buffer_size)
+{
+	const unsigned char *p = (const unsigned char *) text;
+	unsigned char *b = buffer;
+	unsigned int code;
+	size_t length = 0;
+	size_t size;
+
+	if (text == NULL || buffer == NULL)
+		return -1;
+
+	while (*p != '\0') {
+		size = utf8_decode(p, &code);
+		if (size == 0)
+			return -1;
+
+		if (code >= 0x10000) {
+			if (length + 4 > buffer_size)
+				return -1;
+
+			code -= 0x10000;
+			b[length++] = (0xD800 | (code >> 10)) >> 8;
+			b[length++] = (0xD800 | (code >> 10)) & 0xFF;
+			b[length++] = (0xDC00 | (code & 0x3FF)) >> 8;
+			b[length++] = (0xDC00 | (code & 0x3FF)) & 0xFF;
+		} else {
+			if (length + 2 > buffer_size)
+				return -1;
+
+			b[length++] = code >> 8;
+			b[length++] = code & 0xFF;
+		}
+
+		p += size;
+	}
+
+	return length;
+}
+
+/*
+ * SMS-DELIVER
+ */
+
+int ipc_sms_pdu_udh_concat_parse(const void *header, size_t size,
+				 struct ipc_sms_pdu_concat *concat)
+{
+	const unsigned char *p = header;
+	size_t offset = 0;
+	size_t length;
+
+	if (header == NULL || concat == NULL)
+		return -1;
+
+	while (offset + 2 <= size) {
+		length = p[offset + 1];
+		if (offset + 2 + length > size)
+			return -1;
+
+		if (p[offset] == IPC_SMS_PDU_UDH_CONCAT_8 && length == 3) {
+			concat->reference = p[offset + 2];
+			concat->count = p[offset + 3];
+			concat->sequence = p[offset + 4];
+		} else if (p[offset] == IPC_SMS_PDU_UDH_CONCAT_16 &&
+			   length == 4) {
+			concat->reference = p[offset + 2] << 8 | p[offset + 3];
+			concat->count = p[offset + 4];
+			concat->sequence = p[offset + 5];
+		} else {
+			offset += 2 + length;
+			continue;
+		}
+
+		/* Invalid information elements are to be ignored */
+		if (concat->count == 0 || concat->sequence == 0 ||
+		    concat->sequence > concat->count) {
+			offset += 2 + length;
+			continue;
+		}
+
+		return 1;
+	}
+
+	return 0;
+}
+
+static int ipc_sms_pdu_address_parse(const unsigned char *p, size_t digits,
+				     unsigned char type, char *address,
+				     size_t address_size)
+{
+	unsigned char septets[IPC_SMS_PDU_ADDRESS_SIZE / 2];
+	unsigned char digit;
+	size_t count;
+	size_t length = 0;
+	size_t i;
+	int rc;
+
+	/* Alphanumeric addresses are GSM 7-bit packed */
+	if ((type & 0x70) == 0x50) {
+		count = digits * 4 / 7;
+		if (count > sizeof(septets))
+			return -1;
+
+		count = ipc_sms_pdu_gsm7_unpack(p, (digits + 1) / 2, 0,
+						septets, count);
+
+		rc = ipc_sms_pdu_gsm7_utf8(septets, count, address,
+					   address_size);
+		if (rc < 0)
+			return -1;
+
+		return 0;
+	}
+
+	if (digits + 2 > address_size)
+		return -1;
+
+	if ((type & 0x70) == 0x10)
+		address[length++] = '+';
+
+	for (i = 0; i < digits; i++) {
+		if (i & 1)
+			digit = p[i / 2] >> 4;
+		else
+			digit = p[i / 2] & 0x0F;
+
+		/* Some senders count the filler as a digit */
+		if (digit >= sizeof(address_digits))
+			continue;
+
+		address[length++] = address_digits[digit];
+	}
+
+	address[length] = '\0';
+
+	return 0;
+}
+
+static unsigned char ipc_sms_pdu_alphabet(unsigned char dcs)
+{
+	switch (dcs & 0xF0) {
+	case 0x00:
+	case 0x10:
+	case 0x40:
+	case 0x50:
+		/* Compressed data can't be decoded as text */
+		if (dcs & 0x20)
+			return IPC_SMS_PDU_ALPHABET_8BIT;
+
+		switch (dcs & 0x0C) {
+		case 0x04:
+			return IPC_SMS_PDU_ALPHABET_8BIT;
+		case 0x08:
+			return IPC_SMS_PDU_ALPHABET_UCS2;
+		default:
+			return IPC_SMS_PDU_ALPHABET_GSM7;
+		}
+	case 0x20:
+	case 0x30:
+	case 0x60:
+	case 0x70:
+		return IPC_SMS_PDU_ALPHABET_8BIT;
+	case 0xC0:
+	case 0xD0:
+		return IPC_SMS_PDU_ALPHABET_GSM7;
+	case 0xE0:
+		return IPC_SMS_PDU_ALPHABET_UCS2;
+	case 0xF0:
+		return (dcs & 0x04) ? IPC_SMS_PDU_ALPHABET_8BIT :
+			IPC_SMS_PDU_ALPHABET_GSM7;
+	default:
+		return IPC_SMS_PDU_ALPHABET_8BIT;
+	}
+}
+
+/*
+ * The PDU starts with the SMSC address, as given by the modem in
+ * IPC_SMS_INCOMING_MSG.
+ */
+int ipc_sms_pdu_deliver_parse(const void *pdu, size_t size,
+			      struct ipc_sms_pdu_deliver *deliver)
+{
+	const unsigned char *p = pdu;
+	unsigned char first;
+	size_t digits;
+	size_t offset;
+	int rc;
+
+	if (pdu == NULL || size == 0 || deliver == NULL)
+		return -1;
+
+	memset(deliver, 0, sizeof(struct ipc_sms_pdu_deliver));
+
+	offset = sizeof(unsigned char) + p[0];
+	if (offset + 3 > size)
+		return -1;
+
+	first = p[offset++];
+
+	/* TP-MTI: SMS-DELIVER */
+	if ((first & 0x03) != 0x00)
+		return -1;
+
+	digits = p[offset];
+	deliver->originator_type = p[offset + 1];
+	offset += 2;
+
+	if (offset + (digits + 1) / 2 + 10 > size)
+		return -1;
+
+	rc = ipc_sms_pdu_address_parse(p + offset, digits,
+				       deliver->originator_type,
+				       deliver->originator,
+				       sizeof(deliver->originator));
+	if (rc < 0)
+		return -1;
+
+	offset += (digits + 1) / 2;
+
+	deliver->pid = p[offset++];
+	deliver->dcs = p[offset++];
+	deliver->alphabet = ipc_sms_pdu_alphabet(deliver->dcs);
+	memcpy(deliver->timestamp, p + offset, sizeof(deliver->timestamp));
+	offset += sizeof(deliver->timestamp);
+
+	deliver->user_data_length = p[offset++];
+	deliver->user_data = p + offset;
+
+	if (deliver->alphabet == IPC_SMS_PDU_ALPHABET_GSM7)
+		deliver->user_data_size = (deliver->user_data_length * 7 + 7) / 8;
+	else
+		deliver->user_data_size = deliver->user_data_length;
+
+	if (offset + deliver->user_data_size > size)
+		return -1;
+
+	/* TP-UDHI */
+	if (first & 0x40) {
+		if (deliver->user_data_size == 0 ||
+		    deliver->user_data[0] + sizeof(unsigned char) >
+		    deliver->user_data_size) {
+			return -1;
+		}
+
+		deliver->header = deliver->user_data + sizeof(unsigned char);
+		deliver->header_size = deliver->user_data[0];
+
+		rc = ipc_sms_pdu_udh_concat_parse(deliver->header,
+						  deliver->header_size,
+						  &deliver->concat);
+		if (rc < 0)
+			return -1;
+
+		deliver->concatenated = rc;
+	}
+
+	return 0;
+}
+
+int ipc_sms_pdu_deliver_text(const struct ipc_sms_pdu_deliver *deliver,
+			     char *buffer, size_t buffer_size)
+{
+	unsigned char septets[0xFF];
+	size_t header_size = 0;
+	size_t count;
+
+	if (deliver == NULL || deliver->user_data == NULL || buffer == NULL)
+		return -1;
+
+	if (deliver->header != NULL)
+		header_size = deliver->header_size + sizeof(unsigned char);
+
+	switch (deliver->alphabet) {
+	case IPC_SMS_PDU_ALPHABET_GSM7:
+		/*
+		 * The text starts on the septet boundary following the UDH,
+		 * so unpacking from the start of the user data avoids having
+		 * to deal with the fill bits.
+		 */
+		count = ipc_sms_pdu_gsm7_unpack(deliver->user_data,
+						deliver->user_data_size, 0,
+						septets,
+						deliver->user_data_length);
+
+		header_size = (header_size * 8 + 6) / 7;
+		if (header_size > count)
+			return -1;
+
+		return ipc_sms_pdu_gsm7_utf8(septets + header_size,
+					     count - header_size, buffer,
+					     buffer_size);
+	case IPC_SMS_PDU_ALPHABET_UCS2:
+		return ipc_sms_pdu_ucs2_utf8(deliver->user_data + header_size,
+					     deliver->user_data_size -
+					     header_size, buffer, buffer_size);
+	default:
+		count = deliver->user_data_size - header_size;
+		if (count >= buffer_size)
+			return -1;
+
+		memcpy(buffer, deliver->user_data + header_size, count);
+		buffer[count] = '\0';
+
+		return count;
+	}
+}
+
+/*
+ * Concatenated messages reassembly: the messages that got no new part for
+ * the timeout, in milliseconds, are dropped by ipc_sms_pdu_concat_store_expire
+ */
+
+struct ipc_sms_pdu_concat_fragment {
+	char *data;
+	size_t size;
+};
+
+struct ipc_sms_pdu_concat_entry {
+	char originator[IPC_SMS_PDU_ADDRESS_SIZE];
+	unsigned short reference;
+	unsigned char count;
+	unsigned char received;
+	uint64_t updated;
+	struct ipc_sms_pdu_concat_fragment *fragments;
+};
+
+struct ipc_sms_pdu_concat_store {
+	unsigned int count;
+	unsigned int timeout;
+	struct ipc_sms_pdu_concat_entry *entries;
+};
+
+static void ipc_sms_pdu_concat_entry_free(
+	struct ipc_sms_pdu_concat_entry *entry)
+{
+	unsigned int i;
+
+	if (entry->fragments == NULL)
+		return;
+
+	for (i = 0; i < entry->count; i++) {
+		if (entry->fragments[i].data != NULL)
+			free(entry->fragments[i].data);
+	}
+
+	free(entry->fragments);
+	memset(entry, 0, sizeof(struct ipc_sms_pdu_concat_entry));
+}
+
+struct ipc_sms_pdu_concat_store *ipc_sms_pdu_concat_store_create(
+	unsigned int count, unsigned int timeout)
+{
+	struct ipc_sms_pdu_concat_store *store;
+
+	if (count == 0)
+		return NULL;
+
+	store = calloc(1, sizeof(struct ipc_sms_pdu_concat_store));
+	if (store == NULL)
+		return NULL;
+
+	store->entries = calloc(count, sizeof(struct ipc_sms_pdu_concat_entry));
+	if (store->entries == NULL) {
+		free(store);
+		return NULL;
+	}
+
+	store->count = count;
+	store->timeout = timeout;
+
+	return store;
+}
+
+void ipc_sms_pdu_concat_store_destroy(struct ipc_sms_pdu_concat_store *store)
+{
+	unsigned int i;
+
+	if (store == NULL)
+		return;
+
+	for (i = 0; i < store->count; i++)
+		ipc_sms_pdu_concat_entry_free(&store->entries[i]);
+
+	free(store->entries);
+	free(store);
+}
+
+static struct ipc_sms_pdu_concat_entry *ipc_sms_pdu_concat_entry_get(
+	struct ipc_sms_pdu_concat_store *store,
+	const struct ipc_sms_pdu_deliver *deliver)
+{
+	struct ipc_sms_pdu_concat_entry *oldest = NULL;
+	struct ipc_sms_pdu_concat_entry *entry;
+	struct ipc_sms_pdu_concat_entry *free_entry = NULL;
+	unsigned int i;
+
+	for (i = 0; i < store->count; i++) {
+		entry = &store->entries[i];
+
+		if (entry->fragments == NULL) {
+			if (free_entry == NULL)
+				free_entry = entry;
+			continue;
+		}
+
+		if (entry->reference == deliver->concat.reference &&
+		    entry->count == deliver->concat.count &&
+		    !strcmp(entry->originator, deliver->originator)) {
+			return entry;
+		}
+
+		if (oldest == NULL || entry->updated < oldest->updated)
+			oldest = entry;
+	}
+
+	/* The store is full: evict the least recently updated message */
+	if (free_entry == NULL) {
+		ipc_sms_pdu_concat_entry_free(oldest);
+		free_entry = oldest;
+	}
+
+	entry = free_entry;
+
+	entry->fragments = calloc(deliver->concat.count,
+				  sizeof(struct ipc_sms_pdu_concat_fragment));
+	if (entry->fragments == NULL)
+		return NULL;
+
+	memcpy(entry->originator, deliver->originator,
+	       sizeof(entry->originator));
+	entry->originator[sizeof(entry->originator) - 1] = '\0';
+	entry->reference = deliver->concat.reference;
+	entry->count = deliver->concat.count;
+
+	return entry;
+}
+
+/*
+ * Returns 1 and the complete text when the message is complete, 0 when more
+ * parts are needed and -1 on error. The text has to be freed by the caller.
+ */
+int ipc_sms_pdu_concat_store_add(struct ipc_sms_pdu_concat_store *store,
+				 const struct ipc_sms_pdu_deliver *deliver,
+				 char **text, size_t *text_size)
+{
+	struct ipc_sms_pdu_concat_fragment *fragment;
+	struct ipc_sms_pdu_concat_entry *entry;
+	char buffer[IPC_SMS_PDU_TEXT_SIZE];
+	size_t size = 0;
+	char *data;
+	unsigned int i;
+	int length;
+
+	if (store == NULL || deliver == NULL || text == NULL ||
+	    text_size == NULL) {
+		return -1;
+	}
+
+	length = ipc_sms_pdu_deliver_text(deliver, buffer, sizeof(buffer));
+	if (length < 0)
+		return -1;
+
+	if (!deliver->concatenated) {
+		data = malloc(length + 1);
+		if (data == NULL)
+			return -1;
+
+		memcpy(data, buffer, length + 1);
+
+		*text = data;
+		*text_size = length;
+
+		return 1;
+	}
+
+	entry = ipc_sms_pdu_concat_entry_get(store, deliver);
+	if (entry == NULL)
+		return -1;
+
+	entry->updated = ipc_sms_pdu_now();
+
+	fragment = &entry->fragments[deliver->concat.sequence - 1];
+
+	/* Duplicates are expected when the network retries */
+	if (fragment->data != NULL)
+		return 0;
+
+	/* Empty parts still need data, to tell that they were received */
+	fragment->data = malloc(length + 1);
+	if (fragment->data == NULL)
+		return -1;
+
+	memcpy(fragment->data, buffer, length);
+	fragment->size = length;
+	entry->received++;
+
+	if (entry->received < entry->count)
+		return 0;
+
+	for (i = 0; i < entry->count; i++)
+		size += entry->fragments[i].size;
+
+	data = malloc(size + 1);
+	if (data == NULL)
+		return -1;
+
+	size = 0;
+	for (i = 0; i < entry->count; i++) {
+		memcpy(data + size, entry->fragments[i].data,
+		       entry->fragments[i].size);
+		size += entry->fragments[i].size;
+	}
+
+	data[size] = '\0';
+
+	ipc_sms_pdu_concat_entry_free(entry);
+
+	*text = data;
+	*text_size = size;
+
+	return 1;
+}
+
+int ipc_sms_pdu_concat_store_expire(struct ipc_sms_pdu_concat_store *store)
+{
+	struct ipc_sms_pdu_concat_entry *entry;
+	unsigned int count = 0;
+	unsigned int i;
+	uint64_t now;
+
+	if (store == NULL)
+		return -1;
+
+	now = ipc_sms_pdu_now();
+
+	for (i = 0; i < store->count; i++) {
+		entry = &store->entries[i];
+
+		if (entry->fragments == NULL ||
+		    entry->updated + store->timeout > now) {
+			continue;
+		}
+
+		ipc_sms_pdu_concat_entry_free(entry);
+		count++;
+	}
+
+	return count;
+}
@@ -0,0 +1,687 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <samsung-ipc.h>
+
+#include "ipc.h"
+
+/*
+ * The SMS pipeline keeps up to window IPC_SMS_SEND_MSG requests in flight
+ * instead of waiting for each response before sending the next message:
+ * - Submitted messages are queued and sent as soon as the window allows it.
+ *   All the messages but the last one of the queue are sent with
+ *   IPC_SMS_MSG_TYPE_MULTIPLE so the modem can keep the link open.
+ * - The IPC_SMS_SEND_MSG responses are matched by their aseq, which is the
+ *   mseq of the request, and give the TP-MR of the message.
+ * - When the PDU requests a status report (TP-SRR), the message then waits
+ *   for the IPC_SMS_INCOMING_MSG status report with that TP-MR.
+ * Every message has a deadline: it is reported as timed out if it isn't
+ * acknowledged in time, which also frees its slot in the window.
+ *
+ * The mseq of a message must not be used by another queued or outstanding
+ * message. When the message can't be sent at once, submitting it fails and it
+ * isn't kept, so that it can be submitted again without being sent twice.
+ *
+ * The status reports still need to be acknowledged with an
+ * IPC_SMS_DELIVER_REPORT request by the caller, like any other incoming
+ * message.
+ */
+
+#define IPC_SMS_PIPELINE_STATE_QUEUED		0
+#define IPC_SMS_PIPELINE_STATE_OUTSTANDING	1
+#define IPC_SMS_PIPELINE_STATE_REPORT		2
+
+/* SMS-SUBMIT first octet: TP-Status-Report-Request */
+#define SMS_TP_SRR				0x20
+
+struct ipc_sms_pipeline_message {
+	struct ipc_sms_pipeline_message *next;
+	unsigned char mseq;
+	unsigned char reference;
+	int state;
+	int report;
+	uint64_t sent;
+	uint64_t deadline;
+	size_t smsc_size;
+	size_t pdu_size;
+	unsigned char data[];
+};
+
+struct ipc_sms_pipeline_list {
+	struct ipc_sms_pipeline_message *head;
+	struct ipc_sms_pipeline_message *tail;
+	unsigned int count;
+};
+
+struct ipc_sms_pipeline {
+	struct ipc_client *client;
+	unsigned int window;
+	unsigned int timeout;
+	unsigned int report_timeout;
+
+	void (*callback)(void *data,
+			 const struct ipc_sms_pipeline_result *result);
+	void *callback_data;
+
+	struct ipc_sms_pipeline_list queued;
+	struct ipc_sms_pipeline_list outstanding;
+	struct ipc_sms_pipeline_list report;
+
+	struct ipc_sms_pipeline_stats stats;
+	uint64_t start;
+};
+
+static uint64_t ipc_sms_pipeline_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void ipc_sms_pipeline_list_append(
+	struct ipc_sms_pipeline_list *list,
+	struct ipc_sms_pipeline_message *message)
+{
+	message->next = NULL;
+
+	if (list->tail != NULL)
+		list->tail->next = message;
+	else
+		list->head = message;
+
+	list->tail = message;
+	list->count++;
+}
+
+static void ipc_sms_pipeline_list_remove(
+	struct ipc_sms_pipeline_list *list,
+	struct ipc_sms_pipeline_message *message,
+	struct ipc_sms_pipeline_message *previous)
+{
+	if (previous != NULL)
+		previous->next = message->next;
+	else
+		list->head = message->next;
+
+	if (list->tail == message)
+		list->tail = previous;
+
+	message->next = NULL;
+	list->count--;
+}
+
+static void ipc_sms_pipeline_list_free(struct ipc_sms_pipeline_list *list)
+{
+	struct ipc_sms_pipeline_message *message;
+	struct ipc_sms_pipeline_message *next;
+
+	for (message = list->head; message != NULL; message = next) {
+		next = message->next;
+		free(message);
+	}
+
+	memset(list, 0, sizeof(struct ipc_sms_pipeline_list));
+}
+
+static void ipc_sms_pipeline_complete(
+	struct ipc_sms_pipeline *pipeline,
+	struct ipc_sms_pipeline_message *message, unsigned char status,
+	unsigned short ack, unsigned char report_status)
+{
+	struct ipc_sms_pipeline_result result;
+
+	switch (status) {
+	case IPC_SMS_PIPELINE_STATUS_DELIVERED:
+		pipeline->stats.delivered++;
+		break;
+	case IPC_SMS_PIPELINE_STATUS_FAILED:
+		pipeline->stats.failed++;
+		break;
+	case IPC_SMS_PIPELINE_STATUS_TIMEOUT:
+	case IPC_SMS_PIPELINE_STATUS_REPORT_TIMEOUT:
+		pipeline->stats.timeouts++;
+		break;
+	}
+
+	if (pipeline->callback == NULL)
+		return;
+
+	memset(&result, 0, sizeof(result));
+	result.mseq = message->mseq;
+	result.status = status;
+	result.reference = message->reference;
+	result.ack = ack;
+	result.report_status = report_status;
+	result.latency = (unsigned long) (ipc_sms_pipeline_now() -
+					  message->sent);
+
+	pipeline->callback(pipeline->callback_data, &result);
+}
+
+struct ipc_sms_pipeline *ipc_sms_pipeline_create(
+	struct ipc_client *client, unsigned int window, unsigned int timeout,
+	unsigned int report_timeout,
+	void (*callback)(void *data,
+			 const struct ipc_sms_pipeline_result *result),
+	void *callback_data)
+{
+	struct ipc_sms_pipeline *pipeline;
+
+	if (client == NULL || window == 0 || timeout == 0)
+		return NULL;
+
+	pipeline = calloc(1, sizeof(struct ipc_sms_pipeline));
+	if (pipeline == NULL)
+		return NULL;
+
+	pipeline->client = client;
+	pipeline->window = window;
+	pipeline->timeout = timeout;
+	pipeline->report_timeout = report_timeout ? report_timeout : timeout;
+	pipeline->callback = callback;
+	pipeline->callback_data = callback_data;
+
+	return pipeline;
+}
+
+void ipc_sms_pipeline_destroy(struct ipc_sms_pipeline *pipeline)
+{
+	if (pipeline == NULL)
+		return;
+
+	ipc_sms_pipeline_list_free(&pipeline->queued);
+	ipc_sms_pipeline_list_free(&pipeline->outstanding);
+	ipc_sms_pipeline_list_free(&pipeline->report);
+
+	free(pipeline);
+}
+
+static struct ipc_sms_pipeline_message *ipc_sms_pipeline_list_find(
+	struct ipc_sms_pipeline_list *list, unsigned char mseq)
+{
+	struct ipc_sms_pipeline_message *message;
+
+	for (message = list->head; message != NULL; message = message->next) {
+		if (message->mseq == mseq)
+			return message;
+	}
+
+	return NULL;
+}
+
+int ipc_sms_pipeline_submit(struct ipc_sms_pipeline *pipeline,
+			    unsigned char mseq, const void *smsc,
+			    size_t smsc_size, const void *pdu, size_t pdu_size)
+{
+	struct ipc_sms_pipeline_message *previous;
+	struct ipc_sms_pipeline_message *message;
+	int rc;
+
+	if (pipeline == NULL || smsc == NULL || smsc_size == 0 ||
+	    pdu == NULL || pdu_size == 0) {
+		return -1;
+	}
+
+	/* The lengths are sent in a single byte */
+	if (sizeof(unsigned char) + smsc_size + pdu_size > 0xff)
+		return -1;
+
+	/* The responses are matched by mseq */
+	if (ipc_sms_pipeline_list_find(&pipeline->queued, mseq) != NULL ||
+	    ipc_sms_pipeline_list_find(&pipeline->outstanding, mseq) != NULL) {
+		ipc_client_log(pipeline->client,
+			       "SMS with mseq 0x%02x is already pending", mseq);
+		return -1;
+	}
+
+	message = calloc(1, sizeof(struct ipc_sms_pipeline_message) +
+			 smsc_size + pdu_size);
+	if (message == NULL)
+		return -1;
+
+	message->mseq = mseq;
+	message->state = IPC_SMS_PIPELINE_STATE_QUEUED;
+	message->report = !!(((const unsigned char *) pdu)[0] & SMS_TP_SRR);
+	message->smsc_size = smsc_size;
+	message->pdu_size = pdu_size;
+	memcpy(message->data, smsc, smsc_size);
+	memcpy(message->data + smsc_size, pdu, pdu_size);
+
+	ipc_sms_pipeline_list_append(&pipeline->queued, message);
+
+	rc = ipc_sms_pipeline_flush(pipeline);
+	if (rc < 0) {
+		/* The queue is sent in order: the message is still its tail */
+		for (previous = pipeline->queued.head;
+		     previous != NULL && previous->next != message;
+		     previous = previous->next);
+
+		ipc_sms_pipeline_list_remove(&pipeline->queued, message,
+					     previous);
+		free(message);
+		return -1;
+	}
+
+	if (pipeline->stats.submitted == 0)
+		pipeline->start = ipc_sms_pipeline_now();
+
+	pipeline->stats.submitted++;
+
+	return rc;
+}
+
+int ipc_sms_pipeline_flush(struct ipc_sms_pipeline *pipeline)
+{
+	struct ipc_sms_send_msg_request_header header;
+	struct ipc_sms_pipeline_message *message;
+	unsigned int count = 0;
+	void *data;
+	size_t size;
+	int rc;
+
+	if (pipeline == NULL)
+		return -1;
+
+	while (pipeline->queued.head != NULL &&
+	       pipeline->outstanding.count < pipeline->window) {
+		message = pipeline->queued.head;
+
+		memset(&header, 0, sizeof(header));
+		header.type = IPC_SMS_TYPE_OUTGOING;
+		header.msg_type = message->next != NULL ?
+			IPC_SMS_MSG_TYPE_MULTIPLE : IPC_SMS_MSG_TYPE_SINGLE;
+
+		size = ipc_sms_send_msg_size_setup(
+			&header, message->data, message->smsc_size,
+			message->data + message->smsc_size, message->pdu_size);
+
+		data = ipc_client_arena_alloc(pipeline->client, size);
+		if (data == NULL)
+			return -1;
+
+		size = ipc_sms_send_msg_setup_into(
+			&header, message->data, message->smsc_size,
+			message->data + message->smsc_size, message->pdu_size,
+			data, size);
+		if (size == 0)
+			return -1;
+
+		rc = ipc_client_send(pipeline->client, message->mseq,
+				     IPC_SMS_SEND_MSG, IPC_TYPE_EXEC, data,
+				     size);
+		if (rc < 0) {
+			ipc_client_log(pipeline->client,
+				       "Sending SMS with mseq 0x%02x failed",
+				       message->mseq);
+			return -1;
+		}
+
+		ipc_sms_pipeline_list_remove(&pipeline->queued, message,
+					     NULL);
+
+		message->state = IPC_SMS_PIPELINE_STATE_OUTSTANDING;
+		message->sent = ipc_sms_pipeline_now();
+		message->deadline = message->sent + pipeline->timeout;
+
+		ipc_sms_pipeline_list_append(&pipeline->outstanding, message);
+		count++;
+	}
+
+	return count;
+}
+
+static struct ipc_sms_pipeline_message *ipc_sms_pipeline_outstanding_take(
+	struct ipc_sms_pipeline *pipeline, unsigned char mseq)
+{
+	struct ipc_sms_pipeline_message *previous = NULL;
+	struct ipc_sms_pipeline_message *message;
+
+	for (message = pipeline->outstanding.head; message != NULL;
+	     message = message->next) {
+		if (message->mseq == mseq) {
+			ipc_sms_pipeline_list_remove(&pipeline->outstanding,
+						     message, previous);
+			return message;
+		}
+
+		previous = message;
+	}
+
+	return NULL;
+}
+
+static int ipc_sms_pipeline_send_msg_handle(
+	struct ipc_sms_pipeline *pipeline, const struct ipc_message *message)
+{
+	struct ipc_sms_send_msg_response_data *data;
+	struct ipc_sms_pipeline_message *sms;
+	struct ipc_sms_pipeline_message *previous = NULL;
+	struct ipc_sms_pipeline_message *stale;
+
+	sms = ipc_sms_pipeline_outstanding_take(pipeline, message->aseq);
+	if (sms == NULL)
+		return 0;
+
+	if (message->data == NULL ||
+	    message->size < sizeof(struct ipc_sms_send_msg_response_data)) {
+		ipc_sms_pipeline_complete(pipeline, sms,
+					  IPC_SMS_PIPELINE_STATUS_FAILED,
+					  IPC_SMS_ACK_UNSPEC_ERROR, 0);
+		free(sms);
+		return 1;
+	}
+
+	data = (struct ipc_sms_send_msg_response_data *) message->data;
+
+	if (data->ack != IPC_SMS_ACK_NO_ERROR) {
+		ipc_sms_pipeline_complete(pipeline, sms,
+					  IPC_SMS_PIPELINE_STATUS_FAILED,
+					  data->ack, 0);
+		free(sms);
+		return 1;
+	}
+
+	sms->reference = data->id;
+	pipeline->stats.sent++;
+
+	ipc_sms_pipeline_complete(pipeline, sms, IPC_SMS_PIPELINE_STATUS_SENT,
+				  data->ack, 0);
+
+	if (!sms->report) {
+		free(sms);
+		return 1;
+	}
+
+	/* The TP-MR wrapped around: the old report will never be matched */
+	for (stale = pipeline->report.head; stale != NULL;
+	     stale = stale->next) {
+		if (stale->reference == sms->reference) {
+			ipc_sms_pipeline_list_remove(&pipeline->report, stale,
+						     previous);
+			ipc_sms_pipeline_complete(
+				pipeline, stale,
+				IPC_SMS_PIPELINE_STATUS_REPORT_TIMEOUT, 0, 0);
+			free(stale);
+			break;
+		}
+
+		previous = stale;
+	}
+
+	sms->state = IPC_SMS_PIPELINE_STATE_REPORT;
+	sms->deadline = ipc_sms_pipeline_now() + pipeline->report_timeout;
+	ipc_sms_pipeline_list_append(&pipeline->report, sms);
+
+	return 1;
+}
+
+static int ipc_sms_pipeline_gen_phone_res_handle(
+	struct ipc_sms_pipeline *pipeline, const struct ipc_message *message)
+{
+	struct ipc_gen_phone_res_data *data;
+	struct ipc_sms_pipeline_message *sms;
+
+	if (message->data == NULL ||
+	    message->size < sizeof(struct ipc_gen_phone_res_data)) {
+		return 0;
+	}
+
+	data = (struct ipc_gen_phone_res_data *) message->data;
+	if (IPC_COMMAND(data->group, data->index) != IPC_SMS_SEND_MSG)
+		return 0;
+
+	/* Successful requests also get an IPC_SMS_SEND_MSG response */
+	if (ipc_gen_phone_res_check(data) == 0)
+		return 0;
+
+	sms = ipc_sms_pipeline_outstanding_take(pipeline, message->aseq);
+	if (sms == NULL)
+		return 0;
+
+	ipc_sms_pipeline_complete(pipeline, sms,
+				  IPC_SMS_PIPELINE_STATUS_FAILED, data->code,
+				  0);
+	free(sms);
+
+	return 1;
+}
+
+/*
+ * The PDU of an SMS-STATUS-REPORT starts with the SMSC address, then has the
+ * first octet, TP-MR, TP-RA, TP-SCTS, TP-DT and TP-ST.
+ */
+static int ipc_sms_pipeline_status_report_parse(
+	const struct ipc_data_view *pdu, unsigned char *reference,
+	unsigned char *status)
+{
+	const unsigned char *p = pdu->data;
+	size_t offset;
+	size_t address_size;
+
+	offset = sizeof(unsigned char) + p[0];
+	if (offset + 3 > pdu->size)
+		return -1;
+
+	/* First octet, then TP-MR */
+	*reference = p[offset + 1];
+	offset += 2;
+
+	/* TP-RA: number of digits, type of address, semi-octets */
+	address_size = (p[offset] + 1) / 2;
+	offset += 2 + address_size;
+
+	/* TP-SCTS and TP-DT */
+	offset += 7 + 7;
+
+	if (offset >= pdu->size)
+		return -1;
+
+	*status = p[offset];
+
+	return 0;
+}
+
+static int ipc_sms_pipeline_status_report_handle(
+	struct ipc_sms_pipeline *pipeline, const struct ipc_message *message)
+{
+	struct ipc_sms_incoming_msg_header *header;
+	struct ipc_sms_pipeline_message *previous = NULL;
+	struct ipc_sms_pipeline_message *sms;
+	struct ipc_data_view pdu;
+	unsigned char reference;
+	unsigned char status;
+	int rc;
+
+	rc = ipc_sms_incoming_msg_pdu_view(message->data, message->size, &pdu);
+	if (rc < 0)
+		return 0;
+
+	header = (struct ipc_sms_incoming_msg_header *) message->data;
+	if (header->type != IPC_SMS_TYPE_STATUS_REPORT)
+		return 0;
+
+	rc = ipc_sms_pipeline_status_report_parse(&pdu, &reference, &status);
+	if (rc < 0)
+		return 0;
+
+	for (sms = pipeline->report.head; sms != NULL; sms = sms->next) {
+		if (sms->reference == reference)
+			break;
+
+		previous = sms;
+	}
+
+	if (sms == NULL)
+		return 0;
+
+	/* The SC is still trying to deliver the message */
+	if (status >= 0x20 && status < 0x40)
+		return 1;
+
+	ipc_sms_pipeline_list_remove(&pipeline->report, sms, previous);
+	ipc_sms_pipeline_complete(pipeline, sms,
+				  status < 0x20 ?
+				  IPC_SMS_PIPELINE_STATUS_DELIVERED :
+				  IPC_SMS_PIPELINE_STATUS_FAILED,
+				  0, status);
+	free(sms);
+
+	return 1;
+}
+
+int ipc_sms_pipeline_handle(struct ipc_sms_pipeline *pipeline,
+			    const struct ipc_message *message)
+{
+	int rc;
+
+	if (pipeline == NULL || message == NULL)
+		return -1;
+
+	switch (message->command) {
+	case IPC_SMS_SEND_MSG:
+		if (message->type != IPC_TYPE_RESP)
+			return 0;
+
+		rc = ipc_sms_pipeline_send_msg_handle(pipeline, message);
+		break;
+	case IPC_GEN_PHONE_RES:
+		rc = ipc_sms_pipeline_gen_phone_res_handle(pipeline, message);
+		break;
+	case IPC_SMS_INCOMING_MSG:
+		return ipc_sms_pipeline_status_report_handle(pipeline,
+							     message);
+	default:
+		return 0;
+	}
+
+	/* A slot of the window might have been released */
+	if (rc > 0)
+		ipc_sms_pipeline_flush(pipeline);
+
+	return rc;
+}
+
+static unsigned int ipc_sms_pipeline_list_expire(
+	struct ipc_sms_pipeline *pipeline, struct ipc_sms_pipeline_list *list,
+	uint64_t now, unsigned char status)
+{
+	struct ipc_sms_pipeline_message *previous = NULL;
+	struct ipc_sms_pipeline_message *message;
+	struct ipc_sms_pipeline_message *next;
+	unsigned int count = 0;
+
+	for (message = list->head; message != NULL; message = next) {
+		next = message->next;
+
+		if (message->deadline > now) {
+			previous = message;
+			continue;
+		}
+
+		ipc_sms_pipeline_list_remove(list, message, previous);
+		ipc_sms_pipeline_complete(pipeline, message, status, 0, 0);
+		free(message);
+		count++;
+	}
+
+	return count;
+}
+
+int ipc_sms_pipeline_timeouts_check(struct ipc_sms_pipeline *pipeline)
+{
+	unsigned int count;
+	uint64_t now;
+
+	if (pipeline == NULL)
+		return -1;
+
+	now = ipc_sms_pipeline_now();
+
+	count = ipc_sms_pipeline_list_expire(pipeline, &pipeline->outstanding,
+					     now,
+					     IPC_SMS_PIPELINE_STATUS_TIMEOUT);
+	count += ipc_sms_pipeline_list_expire(
+		pipeline, &pipeline->report, now,
+		IPC_SMS_PIPELINE_STATUS_REPORT_TIMEOUT);
+
+	if (count > 0)
+		ipc_sms_pipeline_flush(pipeline);
+
+	return count;
+}
+
+int ipc_sms_pipeline_timeout_get(struct ipc_sms_pipeline *pipeline,
+				 struct timeval *timeout)
+{
+	struct ipc_sms_pipeline_message *message;
+	uint64_t deadline = UINT64_MAX;
+	uint64_t now;
+
+	if (pipeline == NULL || timeout == NULL)
+		return -1;
+
+	for (message = pipeline->outstanding.head; message != NULL;
+	     message = message->next) {
+		if (message->deadline < deadline)
+			deadline = message->deadline;
+	}
+
+	for (message = pipeline->report.head; message != NULL;
+	     message = message->next) {
+		if (message->deadline < deadline)
+			deadline = message->deadline;
+	}
+
+	/* Nothing is waiting for an answer */
+	if (deadline == UINT64_MAX)
+		return 0;
+
+	now = ipc_sms_pipeline_now();
+	deadline = deadline > now ? deadline - now : 0;
+
+	timeout->tv_sec = deadline / 1000;
+	timeout->tv_usec = (deadline % 1000) * 1000;
+
+	return 1;
+}
+
+int ipc_sms_pipeline_stats_get(struct ipc_sms_pipeline *pipeline,
+			       struct ipc_sms_pipeline_stats *stats)
+{
+	uint64_t elapsed;
+
+	if (pipeline == NULL || stats == NULL)
+		return -1;
+
+	memcpy(stats, &pipeline->stats, sizeof(struct ipc_sms_pipeline_stats));
+	stats->queued = pipeline->queued.count;
+	stats->outstanding = pipeline->outstanding.count;
+	stats->awaiting_report = pipeline->report.count;
+
+	elapsed = pipeline->stats.submitted ?
+		ipc_sms_pipeline_now() - pipeline->start : 0;
+	stats->rate = elapsed ? stats->sent * 1000.0 / elapsed : 0;
+
+	return 0;
+}
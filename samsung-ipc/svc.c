@@ -56,10 +56,8 @@ unsigned char ipc_svc_display_screen_count_extract(const void *data,
 struct ipc_svc_display_screen_entry *ipc_svc_display_screen_extract(
 	const void *data, size_t size, unsigned int index)
 {
-	struct ipc_svc_display_screen_entry *entry = NULL;
 	unsigned char count;
-	unsigned char i;
-	unsigned int offset;
+	size_t offset;
 
 	if (data == NULL)
 		return NULL;
@@ -68,16 +66,69 @@ struct ipc_svc_display_screen_entry *ipc_svc_display_screen_extract(
 	if (count == 0 || index >= count)
 		return NULL;
 
-	offset = sizeof(struct ipc_svc_display_screen_header);
+	offset = sizeof(struct ipc_svc_display_screen_header) +
+		index * sizeof(struct ipc_svc_display_screen_entry);
 
-	for (i = 0; i < (index + 1); i++) {
-		entry = (struct ipc_svc_display_screen_entry *) (
-			(unsigned char *) data + offset);
-		offset += sizeof(struct ipc_svc_display_screen_entry);
+	if (offset + sizeof(struct ipc_svc_display_screen_entry) > size)
+		return NULL;
+
+	return (struct ipc_svc_display_screen_entry *) (
+		(unsigned char *) data + offset);
+}
+
+int ipc_svc_display_screen_iterator_setup(struct ipc_list_iterator *iterator,
+					  const void *data, size_t size)
+{
+	unsigned char count;
+
+	if (iterator == NULL || data == NULL)
+		return -1;
+
+	memset(iterator, 0, sizeof(struct ipc_list_iterator));
+
+	if (size < sizeof(struct ipc_svc_display_screen_header))
+		return -1;
+
+	count = ipc_svc_display_screen_count_extract(data, size);
+	if (size - sizeof(struct ipc_svc_display_screen_header) <
+	    count * sizeof(struct ipc_svc_display_screen_entry)) {
+		return -1;
 	}
 
-	if (offset > size)
+	iterator->data = (const unsigned char *) data;
+	iterator->size = size;
+	iterator->offset = sizeof(struct ipc_svc_display_screen_header);
+	iterator->count = count;
+
+	return 0;
+}
+
+struct ipc_svc_display_screen_entry *ipc_svc_display_screen_iterator_next(
+	struct ipc_list_iterator *iterator)
+{
+	struct ipc_svc_display_screen_entry *entry;
+
+	if (iterator == NULL || iterator->index >= iterator->count)
 		return NULL;
 
+	entry = (struct ipc_svc_display_screen_entry *) (
+		iterator->data + iterator->offset);
+
+	iterator->offset += sizeof(struct ipc_svc_display_screen_entry);
+	iterator->index++;
+
 	return entry;
 }
+
+int ipc_svc_display_screen_entry_line_view(
+	const struct ipc_svc_display_screen_entry *entry,
+	struct ipc_data_view *view)
+{
+	if (entry == NULL || view == NULL)
+		return -1;
+
+	view->data = entry->line;
+	view->size = strnlen(entry->line, sizeof(entry->line));
+
+	return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <samsung-ipc.h>
+
+#include "arena.h"
+
+#define ARENA_SIZE	64
+#define ARENA_ALLOCS	8
+
+static unsigned long long arena_allocations(struct ipc_client *client)
+{
+	struct ipc_client_counters counters;
+
+	ipc_client_counters_get(client, &counters);
+
+	return counters.allocations;
+}
+
+/*
+ * The allocations are aligned, zeroed and don't overlap. Once the arena grew
+ * for a set of allocations, the same set doesn't allocate anymore after a
+ * reset.
+ */
+int test_arena_alloc(struct ipc_client *client)
+{
+	const size_t sizes[ARENA_ALLOCS] = { 1, 16, 17, 40, 100, 3, 64, 200 };
+	unsigned char *data[ARENA_ALLOCS];
+	struct ipc_client *arena_client;
+	unsigned long long allocations;
+	unsigned int round;
+	unsigned int i;
+	size_t j;
+	int rc = -1;
+
+	arena_client = ipc_client_create(IPC_CLIENT_TYPE_DUMMY);
+	if (arena_client == NULL)
+		return -1;
+
+	if (ipc_client_arena_create(arena_client, ARENA_SIZE) < 0)
+		goto complete;
+
+	for (round = 0; round < 2; round++) {
+		allocations = arena_allocations(arena_client);
+
+		for (i = 0; i < ARENA_ALLOCS; i++) {
+			data[i] = ipc_client_arena_alloc(arena_client,
+							 sizes[i]);
+			if (data[i] == NULL ||
+			    (uintptr_t) data[i] % IPC_CLIENT_ARENA_ALIGN) {
+				ipc_client_log(client, "%s: allocation %u"
+					       " failed or unaligned\n",
+					       __func__, i);
+				goto complete;
+			}
+
+			for (j = 0; j < sizes[i]; j++) {
+				if (data[i][j] != 0) {
+					ipc_client_log(client, "%s: allocation"
+						       " %u not zeroed\n",
+						       __func__, i);
+					goto complete;
+				}
+			}
+
+			memset(data[i], i + 1, sizes[i]);
+		}
+
+		for (i = 0; i < ARENA_ALLOCS; i++) {
+			for (j = 0; j < sizes[i]; j++) {
+				if (data[i][j] != i + 1) {
+					ipc_client_log(client, "%s: allocation"
+						       " %u overwritten\n",
+						       __func__, i);
+					goto complete;
+				}
+			}
+		}
+
+		/* The blocks were merged by the previous reset */
+		if (round > 0 &&
+		    arena_allocations(arena_client) != allocations) {
+			ipc_client_log(client, "%s: allocated again after"
+				       " reset\n", __func__);
+			goto complete;
+		}
+
+		ipc_client_arena_reset(arena_client);
+	}
+
+	if (ipc_client_arena_alloc(arena_client, SIZE_MAX) != NULL ||
+	    ipc_client_arena_alloc(arena_client, 0) != NULL) {
+		ipc_client_log(client, "%s: invalid size allocated\n",
+			       __func__);
+		goto complete;
+	}
+
+	rc = 0;
+
+complete:
+	ipc_client_destroy(arena_client);
+
+	return rc;
+}
+
+/* The header is only set once the message is known to fit in the buffer */
+int test_arena_setup_into(struct ipc_client *client)
+{
+	const unsigned char smsc[] = { 0x07, 0x91, 0x13, 0x26 };
+	const unsigned char pdu[] = { 0x01, 0x00, 0x02, 0x81, 0x21 };
+	struct ipc_sms_send_msg_request_header send_header;
+	struct ipc_sms_save_msg_request_header save_header;
+	unsigned char buffer[0x20];
+	size_t size;
+
+	memset(&send_header, 0, sizeof(send_header));
+	send_header.length = 0xaa;
+
+	size = ipc_sms_send_msg_size_setup(&send_header, smsc, sizeof(smsc),
+					   pdu, sizeof(pdu));
+
+	if (ipc_sms_send_msg_setup_into(&send_header, smsc, sizeof(smsc),
+					pdu, sizeof(pdu), buffer,
+					size - 1) != 0 ||
+	    send_header.length != 0xaa) {
+		ipc_client_log(client, "%s: send header changed on failure\n",
+			       __func__);
+		return -1;
+	}
+
+	if (ipc_sms_send_msg_setup_into(&send_header, smsc, sizeof(smsc),
+					pdu, sizeof(pdu), buffer,
+					sizeof(buffer)) != size ||
+	    send_header.length != 1 + sizeof(smsc) + sizeof(pdu) ||
+	    buffer[sizeof(send_header)] != sizeof(smsc) ||
+	    memcmp(buffer + size - sizeof(pdu), pdu, sizeof(pdu))) {
+		ipc_client_log(client, "%s: send message not set up\n",
+			       __func__);
+		return -1;
+	}
+
+	memset(&save_header, 0, sizeof(save_header));
+	save_header.length = 0xaa;
+
+	size = ipc_sms_save_msg_size_setup(&save_header, smsc, sizeof(smsc),
+					   pdu, sizeof(pdu));
+
+	if (ipc_sms_save_msg_setup_into(&save_header, smsc, sizeof(smsc),
+					pdu, sizeof(pdu), buffer,
+					size - 1) != 0 ||
+	    save_header.length != 0xaa || save_header.magic != 0) {
+		ipc_client_log(client, "%s: save header changed on failure\n",
+			       __func__);
+		return -1;
+	}
+
+	if (ipc_sms_save_msg_setup_into(&save_header, smsc, sizeof(smsc),
+					pdu, sizeof(pdu), buffer,
+					sizeof(buffer)) != size ||
+	    save_header.length != 1 + sizeof(smsc) + sizeof(pdu) ||
+	    memcmp(buffer + size - sizeof(pdu), pdu, sizeof(pdu))) {
+		ipc_client_log(client, "%s: save message not set up\n",
+			       __func__);
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,821 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <samsung-ipc.h>
+
+#include "modems/xmm626/xmm626.h"
+#include "modems/xmm626/xmm626_hsic.h"
+#include "hex.h"
+#include "sms_pdu.h"
+
+/*
+ * Micro-benchmarks of the hot paths of the library, run over the same
+ * corpus as the tests. They are run with make bench, not by make check:
+ * timings on shared build machines are meaningless.
+ *
+ * Each benchmark returns the count of bytes processed by one operation, or
+ * BENCH_SKIPPED when it can't run on this system. The output has one line
+ * per benchmark with tab separated values, so that runs can be compared by
+ * scripts.
+ */
+
+#define BENCH_ITERATIONS	100000
+#define BENCH_SKIPPED		((size_t) -1)
+
+struct bench {
+	const char *name;
+	size_t (*func)(unsigned int iterations);
+	/* The heavier benchmarks only run for a fraction of the iterations */
+	unsigned int divider;
+};
+
+static unsigned long bench_allocs;
+
+#ifdef __GLIBC__
+/*
+ * The allocations are counted by interposing the allocator, which glibc
+ * supports: the library gets these too.
+ */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+
+void *malloc(size_t size)
+{
+	bench_allocs++;
+
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+	bench_allocs++;
+
+	return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+	bench_allocs++;
+
+	return __libc_realloc(pointer, size);
+}
+#endif
+
+static uint64_t bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Keeps the compiler from optimizing the benchmarked calls away */
+static volatile size_t bench_sink;
+
+static size_t bench_gsm7_unpack(unsigned int iterations)
+{
+	unsigned char septets[160];
+	unsigned char packed[140];
+	unsigned int i;
+
+	for (i = 0; i < sizeof(septets); i++)
+		septets[i] = (i * 37 + 11) & 0x7F;
+
+	ipc_sms_pdu_gsm7_pack(septets, sizeof(septets), 0, packed,
+			      sizeof(packed));
+
+	for (i = 0; i < iterations; i++) {
+		bench_sink += ipc_sms_pdu_gsm7_unpack(packed, sizeof(packed), 0,
+						      septets,
+						      sizeof(septets));
+	}
+
+	return sizeof(packed);
+}
+
+static size_t bench_gsm7_pack(unsigned int iterations)
+{
+	unsigned char septets[160];
+	unsigned char packed[140];
+	unsigned int i;
+
+	for (i = 0; i < sizeof(septets); i++)
+		septets[i] = (i * 37 + 11) & 0x7F;
+
+	for (i = 0; i < iterations; i++) {
+		bench_sink += ipc_sms_pdu_gsm7_pack(septets, sizeof(septets), 0,
+						    packed, sizeof(packed));
+	}
+
+	return sizeof(packed);
+}
+
+static size_t bench_sms_pdu_decode(unsigned int iterations)
+{
+	struct ipc_sms_pdu_deliver deliver;
+	char text[IPC_SMS_PDU_TEXT_SIZE];
+	const struct sms_pdu_sample *sample;
+	size_t size = 0;
+	unsigned int i;
+
+	for (i = 0; i < sms_pdu_corpus_count; i++)
+		size += sms_pdu_corpus[i].pdu_size;
+
+	for (i = 0; i < iterations; i++) {
+		sample = &sms_pdu_corpus[i % sms_pdu_corpus_count];
+
+		ipc_sms_pdu_deliver_parse(sample->pdu, sample->pdu_size,
+					  &deliver);
+		bench_sink += ipc_sms_pdu_deliver_text(&deliver, text,
+						       sizeof(text));
+	}
+
+	return size / sms_pdu_corpus_count;
+}
+
+static size_t bench_sms_pdu_reassembly(unsigned int iterations)
+{
+	struct ipc_sms_pdu_concat_store *store;
+	struct ipc_sms_pdu_deliver deliver;
+	const struct sms_pdu_sample *sample;
+	size_t text_size;
+	size_t size = 0;
+	unsigned int i;
+	char *text;
+	int rc;
+
+	store = ipc_sms_pdu_concat_store_create(16, 60000);
+	if (store == NULL)
+		return 0;
+
+	for (i = 0; i < sms_pdu_corpus_count; i++)
+		size += sms_pdu_corpus[i].pdu_size;
+
+	for (i = 0; i < iterations; i++) {
+		sample = &sms_pdu_corpus[i % sms_pdu_corpus_count];
+
+		ipc_sms_pdu_deliver_parse(sample->pdu, sample->pdu_size,
+					  &deliver);
+
+		rc = ipc_sms_pdu_concat_store_add(store, &deliver, &text,
+						  &text_size);
+		if (rc == 1) {
+			bench_sink += text_size;
+			free(text);
+		}
+	}
+
+	ipc_sms_pdu_concat_store_destroy(store);
+
+	return size / sms_pdu_corpus_count;
+}
+
+/* Memory transport, where the written frames are read back */
+struct bench_transport {
+	unsigned char buffer[0x10000];
+	size_t head;
+	size_t tail;
+};
+
+static int bench_transport_read(
+	__attribute__((unused)) struct ipc_client *client, void *data,
+	void *buffer, size_t size)
+{
+	struct bench_transport *transport = data;
+	size_t count = transport->head - transport->tail;
+
+	if (count > size)
+		count = size;
+
+	memcpy(buffer, transport->buffer + transport->tail, count);
+	transport->tail += count;
+
+	if (transport->tail == transport->head) {
+		transport->head = 0;
+		transport->tail = 0;
+	}
+
+	return count;
+}
+
+static int bench_transport_write(
+	__attribute__((unused)) struct ipc_client *client, void *data,
+	const void *buffer, size_t size)
+{
+	struct bench_transport *transport = data;
+
+	if (size > sizeof(transport->buffer) - transport->head)
+		return -1;
+
+	memcpy(transport->buffer + transport->head, buffer, size);
+	transport->head += size;
+
+	return size;
+}
+
+static int bench_transport_poll(
+	__attribute__((unused)) struct ipc_client *client, void *data,
+	__attribute__((unused)) struct ipc_poll_fds *fds,
+	__attribute__((unused)) struct timeval *timeout)
+{
+	struct bench_transport *transport = data;
+
+	return transport->head > transport->tail;
+}
+
+static size_t bench_framing(int type, unsigned short command,
+			    unsigned int iterations)
+{
+	struct bench_transport *transport;
+	struct ipc_client *client;
+	struct ipc_message message;
+	unsigned char data[64];
+	unsigned int i;
+	size_t size = BENCH_SKIPPED;
+	int rc;
+
+	transport = calloc(1, sizeof(struct bench_transport));
+	if (transport == NULL)
+		return BENCH_SKIPPED;
+
+	client = ipc_client_create(type);
+	if (client == NULL)
+		goto complete;
+
+	ipc_client_transport_handlers_register(client, NULL, NULL,
+					       bench_transport_read,
+					       bench_transport_write,
+					       bench_transport_poll,
+					       transport);
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i;
+
+	for (i = 0; i < iterations; i++) {
+		rc = ipc_client_send(client, i & 0xff, command, IPC_TYPE_EXEC,
+				     data, sizeof(data));
+		if (rc < 0)
+			goto complete;
+
+		memset(&message, 0, sizeof(message));
+
+		rc = ipc_client_recv(client, &message);
+		if (rc < 0)
+			goto complete;
+
+		bench_sink += message.size;
+		if (message.data != NULL)
+			free(message.data);
+	}
+
+	if (type == IPC_CLIENT_TYPE_FMT)
+		size = sizeof(struct ipc_fmt_header) + sizeof(data);
+	else
+		size = sizeof(struct ipc_rfs_header) + sizeof(data);
+
+complete:
+	if (client != NULL)
+		ipc_client_destroy(client);
+
+	free(transport);
+
+	return size;
+}
+
+static size_t bench_fmt_framing(unsigned int iterations)
+{
+	return bench_framing(IPC_CLIENT_TYPE_FMT, IPC_SMS_SEND_MSG,
+			     iterations);
+}
+
+static size_t bench_rfs_framing(unsigned int iterations)
+{
+	return bench_framing(IPC_CLIENT_TYPE_RFS, IPC_RFS_NV_READ_ITEM,
+			     iterations);
+}
+
+static size_t bench_fmt_header_setup(unsigned int iterations)
+{
+	struct ipc_fmt_header header;
+	struct ipc_message message;
+	unsigned int i;
+
+	memset(&message, 0, sizeof(message));
+	message.command = IPC_NET_REGIST;
+	message.type = IPC_TYPE_GET;
+	message.size = 64;
+
+	for (i = 0; i < iterations; i++) {
+		message.mseq = i & 0xff;
+
+		ipc_fmt_header_setup(&header, &message);
+		ipc_fmt_message_setup(&header, &message);
+
+		bench_sink += header.length;
+	}
+
+	return sizeof(header);
+}
+
+static size_t bench_xmm626_crc(unsigned int iterations)
+{
+	unsigned char data[0x1000];
+	unsigned int i;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i * 7;
+
+	for (i = 0; i < iterations; i++)
+		bench_sink += xmm626_crc_calculate(data, sizeof(data));
+
+	return sizeof(data);
+}
+
+/* The command checksum is computed when the command is sent */
+static size_t bench_xmm626_hsic_checksum(unsigned int iterations)
+{
+	unsigned char data[0x800];
+	unsigned int i;
+	int fd;
+
+	fd = open("/dev/null", O_WRONLY);
+	if (fd < 0)
+		return BENCH_SKIPPED;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i * 7;
+
+	for (i = 0; i < iterations; i++) {
+		bench_sink += xmm626_hsic_command_send(
+			NULL, fd, XMM626_COMMAND_SEC_START, data,
+			sizeof(data), sizeof(data), 0);
+	}
+
+	close(fd);
+
+	return sizeof(data);
+}
+
+static size_t bench_nv_data_md5(unsigned int iterations)
+{
+	char path[] = "/tmp/libsamsung-ipc-bench-XXXXXX";
+	unsigned char data[0x4000];
+	struct ipc_client *client;
+	unsigned int i;
+	char *md5;
+	int fd;
+
+	fd = mkstemp(path);
+	if (fd < 0)
+		return BENCH_SKIPPED;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i * 7;
+
+	if (write(fd, data, sizeof(data)) != (ssize_t) sizeof(data)) {
+		close(fd);
+		unlink(path);
+		return BENCH_SKIPPED;
+	}
+
+	close(fd);
+
+	client = ipc_client_create(IPC_CLIENT_TYPE_DUMMY);
+
+	for (i = 0; i < iterations; i++) {
+		md5 = ipc_nv_data_md5_calculate(client, path, "Samsung_Android",
+						sizeof(data), 0x1000);
+		if (md5 != NULL) {
+			bench_sink += md5[0];
+			free(md5);
+		}
+	}
+
+	if (client != NULL)
+		ipc_client_destroy(client);
+
+	unlink(path);
+
+	return sizeof(data);
+}
+
+static size_t bench_data2string(unsigned int iterations)
+{
+	unsigned char data[256];
+	unsigned int i;
+	char *string;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i;
+
+	for (i = 0; i < iterations; i++) {
+		string = data2string(data, sizeof(data));
+		if (string != NULL) {
+			bench_sink += string[0];
+			free(string);
+		}
+	}
+
+	return sizeof(data);
+}
+
+static size_t bench_string2data(unsigned int iterations)
+{
+	unsigned char data[256];
+	unsigned int i;
+	char *string;
+	void *buffer;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i;
+
+	string = data2string(data, sizeof(data));
+	if (string == NULL)
+		return BENCH_SKIPPED;
+
+	for (i = 0; i < iterations; i++) {
+		buffer = string2data(string);
+		if (buffer != NULL) {
+			bench_sink += *((unsigned char *) buffer);
+			free(buffer);
+		}
+	}
+
+	free(string);
+
+	return sizeof(data);
+}
+
+static size_t bench_data2string_sprintf(unsigned int iterations)
+{
+	unsigned char data[256];
+	unsigned int i;
+	char *string;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i;
+
+	for (i = 0; i < iterations; i++) {
+		string = hex_reference_data2string(data, sizeof(data));
+		if (string != NULL) {
+			bench_sink += string[0];
+			free(string);
+		}
+	}
+
+	return sizeof(data);
+}
+
+static size_t bench_data2string_into(unsigned int iterations)
+{
+	unsigned char data[256];
+	char string[sizeof(data) * 2 + 1];
+	unsigned int i;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i;
+
+	for (i = 0; i < iterations; i++) {
+		bench_sink += data2string_into(data, sizeof(data), string,
+					       sizeof(string));
+		bench_sink += string[i % sizeof(data)];
+	}
+
+	return sizeof(data);
+}
+
+static size_t bench_string2data_sscanf(unsigned int iterations)
+{
+	unsigned char data[256];
+	unsigned int i;
+	char *string;
+	void *buffer;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i;
+
+	string = data2string(data, sizeof(data));
+	if (string == NULL)
+		return BENCH_SKIPPED;
+
+	for (i = 0; i < iterations; i++) {
+		buffer = hex_reference_string2data(string);
+		if (buffer != NULL) {
+			bench_sink += *((unsigned char *) buffer);
+			free(buffer);
+		}
+	}
+
+	free(string);
+
+	return sizeof(data);
+}
+
+static size_t bench_string2data_into(unsigned int iterations)
+{
+	unsigned char data[256];
+	unsigned int i;
+	char *string;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i;
+
+	string = data2string(data, sizeof(data));
+	if (string == NULL)
+		return BENCH_SKIPPED;
+
+	for (i = 0; i < iterations; i++) {
+		bench_sink += string2data_into(string, data, sizeof(data));
+		bench_sink += data[i % sizeof(data)];
+	}
+
+	free(string);
+
+	return sizeof(data);
+}
+
+static size_t bench_data_dump_line(unsigned int iterations)
+{
+	unsigned char data[256];
+	char line[IPC_DATA_DUMP_LINE_LENGTH];
+	size_t offset;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i;
+
+	for (i = 0; i < iterations; i++) {
+		for (offset = 0; offset < sizeof(data); offset += 16) {
+			bench_sink += ipc_data_dump_line(data, sizeof(data),
+							 offset, line,
+							 sizeof(line));
+		}
+	}
+
+	return sizeof(data);
+}
+
+static size_t bench_data_dump_line_snprintf(unsigned int iterations)
+{
+	unsigned char data[256];
+	char line[IPC_DATA_DUMP_LINE_LENGTH];
+	size_t offset;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i;
+
+	for (i = 0; i < iterations; i++) {
+		for (offset = 0; offset < sizeof(data); offset += 16) {
+			bench_sink += hex_reference_dump_line(data,
+							      sizeof(data),
+							      offset, line,
+							      sizeof(line));
+		}
+	}
+
+	return sizeof(data);
+}
+
+static size_t bench_command_string(unsigned int iterations)
+{
+	static const unsigned short commands[] = {
+		IPC_PWR_PHONE_PWR_UP,
+		IPC_CALL_INCOMING,
+		IPC_SMS_INCOMING_MSG,
+		IPC_SEC_RSIM_ACCESS,
+		IPC_DISP_ICON_INFO,
+		IPC_NET_REGIST,
+		IPC_GPRS_IP_CONFIGURATION,
+		IPC_GEN_PHONE_RES,
+		IPC_RFS_NV_READ_ITEM,
+		0xFFFF,
+	};
+	unsigned int count = sizeof(commands) / sizeof(unsigned short);
+	unsigned int i;
+
+	for (i = 0; i < iterations; i++)
+		bench_sink += (size_t) ipc_command_string(commands[i % count]);
+
+	return 0;
+}
+
+static size_t bench_extract(unsigned int iterations)
+{
+	struct ipc_sms_incoming_msg_header *sms_header;
+	struct ipc_sec_rsim_access_response_header *rsim_header;
+	struct ipc_net_plmn_list_entry *entry;
+	unsigned char sms[sizeof(*sms_header) + 160];
+	unsigned char rsim[sizeof(*rsim_header) + 128];
+	unsigned char plmn_list[1 + 8 * sizeof(*entry)];
+	unsigned int i;
+
+	memset(sms, 0, sizeof(sms));
+	sms_header = (struct ipc_sms_incoming_msg_header *) sms;
+	sms_header->length = sizeof(sms) - sizeof(*sms_header);
+
+	memset(rsim, 0, sizeof(rsim));
+	rsim_header = (struct ipc_sec_rsim_access_response_header *) rsim;
+	rsim_header->length = sizeof(rsim) - sizeof(*rsim_header);
+
+	memset(plmn_list, 0, sizeof(plmn_list));
+	plmn_list[0] = 8;
+
+	for (i = 0; i < iterations; i++) {
+		bench_sink += ipc_sms_incoming_msg_pdu_size_extract(
+			sms, sizeof(sms));
+		bench_sink += (size_t) ipc_sms_incoming_msg_pdu_extract(
+			sms, sizeof(sms));
+		bench_sink += ipc_sec_rsim_access_size_extract(rsim,
+							       sizeof(rsim));
+		bench_sink += (size_t) ipc_sec_rsim_access_extract(
+			rsim, sizeof(rsim));
+		bench_sink += (size_t) ipc_net_plmn_list_entry_extract(
+			plmn_list, sizeof(plmn_list), i % 8);
+	}
+
+	return sizeof(sms) + sizeof(rsim) + sizeof(plmn_list);
+}
+
+static struct bench benches[] = {
+	{
+		"gsm7_unpack",
+		bench_gsm7_unpack,
+		1
+	},
+	{
+		"gsm7_pack",
+		bench_gsm7_pack,
+		1
+	},
+	{
+		"sms_pdu_decode",
+		bench_sms_pdu_decode,
+		1
+	},
+	{
+		"sms_pdu_reassembly",
+		bench_sms_pdu_reassembly,
+		1
+	},
+	{
+		"fmt_header_setup",
+		bench_fmt_header_setup,
+		1
+	},
+	{
+		"fmt_framing",
+		bench_fmt_framing,
+		1
+	},
+	{
+		"rfs_framing",
+		bench_rfs_framing,
+		1
+	},
+	{
+		"xmm626_crc",
+		bench_xmm626_crc,
+		10
+	},
+	{
+		"xmm626_hsic_checksum",
+		bench_xmm626_hsic_checksum,
+		10
+	},
+	{
+		"nv_data_md5",
+		bench_nv_data_md5,
+		100
+	},
+	{
+		"data2string",
+		bench_data2string,
+		1
+	},
+	{
+		"data2string_sprintf",
+		bench_data2string_sprintf,
+		1
+	},
+	{
+		"data2string_into",
+		bench_data2string_into,
+		1
+	},
+	{
+		"string2data",
+		bench_string2data,
+		1
+	},
+	{
+		"string2data_sscanf",
+		bench_string2data_sscanf,
+		10
+	},
+	{
+		"string2data_into",
+		bench_string2data_into,
+		1
+	},
+	{
+		"data_dump_line",
+		bench_data_dump_line,
+		1
+	},
+	{
+		"data_dump_line_snprintf",
+		bench_data_dump_line_snprintf,
+		10
+	},
+	{
+		"command_string",
+		bench_command_string,
+		1
+	},
+	{
+		"extract",
+		bench_extract,
+		1
+	},
+};
+
+int main(int argc, char *argv[])
+{
+	unsigned int iterations = BENCH_ITERATIONS;
+	unsigned int count;
+	uint64_t start;
+	uint64_t elapsed;
+	double ns;
+	size_t size;
+	unsigned int i;
+
+	if (argc > 2) {
+		printf("Usage: %s [ITERATIONS]\n", argv[0]);
+		return EX_USAGE;
+	}
+
+	if (argc == 2) {
+		iterations = strtoul(argv[1], NULL, 0);
+		if (iterations == 0) {
+			printf("Invalid iterations count: %s\n", argv[1]);
+			return EX_USAGE;
+		}
+	}
+
+	printf("# name\tops\tns/op\tbytes/s\tallocs/op\n");
+
+	for (i = 0; i < sizeof(benches) / sizeof(struct bench); i++) {
+		count = iterations / benches[i].divider;
+		if (count == 0)
+			count = 1;
+
+		bench_allocs = 0;
+
+		start = bench_now();
+		size = benches[i].func(count);
+		elapsed = bench_now() - start;
+
+		if (size == BENCH_SKIPPED) {
+			printf("%s\tskipped\n", benches[i].name);
+			continue;
+		}
+
+		ns = (double) elapsed / count;
+
+		printf("%s\t%u\t%.1f\t%.0f\t", benches[i].name, count, ns,
+		       ns > 0 ? size * 1000000000.0 / ns : 0);
+#ifdef __GLIBC__
+		printf("%.2f\n", (double) bench_allocs / count);
+#else
+		printf("-\n");
+#endif
+	}
+
+	return 0;
+}
@@ -0,0 +1,297 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <samsung-ipc.h>
+
+#include "coalesce.h"
+
+/*
+ * The frames are written on the modem side of a loopback transport before
+ * receiving, so that they are all available at once.
+ */
+
+static int coalesce_frame_write(int fd, unsigned short command,
+				unsigned char type, unsigned char value)
+{
+	unsigned char frame[sizeof(struct ipc_fmt_header) + 1];
+	struct ipc_fmt_header header;
+	struct ipc_message message;
+
+	memset(&message, 0, sizeof(message));
+	message.command = command;
+	message.type = type;
+	message.size = sizeof(value);
+
+	ipc_fmt_header_setup(&header, &message);
+
+	memcpy(frame, &header, sizeof(header));
+	frame[sizeof(header)] = value;
+
+	if (write(fd, frame, sizeof(frame)) != sizeof(frame))
+		return -1;
+
+	return 0;
+}
+
+static struct ipc_client *coalesce_client_create(int *fd)
+{
+	const unsigned short commands[] = { IPC_DISP_RSSI_INFO };
+	struct ipc_client *client;
+
+	client = ipc_client_create(IPC_CLIENT_TYPE_FMT);
+	if (client == NULL)
+		return NULL;
+
+	*fd = ipc_client_loopback_open(client);
+	if (*fd < 0)
+		goto error;
+
+	if (ipc_client_coalesce_set(client, commands, 1) < 0) {
+		close(*fd);
+		goto error;
+	}
+
+	return client;
+
+error:
+	ipc_client_destroy(client);
+
+	return NULL;
+}
+
+static int coalesce_recv(struct ipc_client *client, unsigned short command,
+			 unsigned char value)
+{
+	struct ipc_message message;
+	int rc;
+
+	memset(&message, 0, sizeof(message));
+
+	rc = ipc_client_recv(client, &message);
+	if (rc < 0)
+		return -1;
+
+	if (message.command != command || message.size != 1 ||
+	    ((unsigned char *) message.data)[0] != value) {
+		rc = -1;
+	}
+
+	if (message.data != NULL)
+		free(message.data);
+
+	return rc;
+}
+
+/*
+ * Only the last of the RSSI notifications that were received at once is
+ * delivered, in the place of the last one, while the responses and the other
+ * commands are all delivered.
+ */
+int test_coalesce_queue(struct ipc_client *client)
+{
+	const struct {
+		unsigned short command;
+		unsigned char type;
+	} frames[] = {
+		{ IPC_DISP_RSSI_INFO, IPC_TYPE_NOTI },
+		{ IPC_NET_REGIST, IPC_TYPE_NOTI },
+		{ IPC_DISP_RSSI_INFO, IPC_TYPE_NOTI },
+		{ IPC_DISP_RSSI_INFO, IPC_TYPE_RESP },
+		{ IPC_DISP_RSSI_INFO, IPC_TYPE_NOTI },
+	};
+	struct ipc_client_coalesce_stats stats;
+	struct ipc_client *fmt_client;
+	unsigned long dropped = 0;
+	unsigned int i;
+	int fd;
+	int rc;
+
+	fmt_client = coalesce_client_create(&fd);
+	if (fmt_client == NULL)
+		return -1;
+
+	for (i = 0; i < sizeof(frames) / sizeof(frames[0]); i++) {
+		if (coalesce_frame_write(fd, frames[i].command, frames[i].type,
+					 i + 1) < 0)
+			goto error;
+	}
+
+	if (coalesce_recv(fmt_client, IPC_NET_REGIST, 2) < 0 ||
+	    coalesce_recv(fmt_client, IPC_DISP_RSSI_INFO, 4) < 0 ||
+	    coalesce_recv(fmt_client, IPC_DISP_RSSI_INFO, 5) < 0) {
+		ipc_client_log(client, "%s: unexpected message\n", __func__);
+		goto error;
+	}
+
+	ipc_client_coalesce_stats_get(fmt_client, &stats);
+	ipc_client_coalesce_dropped_get(fmt_client, IPC_DISP_RSSI_INFO,
+					&dropped);
+
+	if (stats.received != 5 || stats.dropped != 2 || stats.queued != 0 ||
+	    dropped != 2) {
+		ipc_client_log(client, "%s: %lu received, %lu dropped, %u"
+			       " queued\n", __func__, stats.received,
+			       stats.dropped, stats.queued);
+		goto error;
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	close(fd);
+	ipc_client_destroy(fmt_client);
+
+	return rc;
+}
+
+/* The other fds are still polled while messages are queued */
+int test_coalesce_poll(struct ipc_client *client)
+{
+	struct ipc_client *fmt_client;
+	struct ipc_poll_fds fds;
+	struct timeval timeout;
+	int pipe_fds[2] = { -1, -1 };
+	int poll_fd;
+	int fd;
+	int rc;
+
+	fmt_client = coalesce_client_create(&fd);
+	if (fmt_client == NULL)
+		return -1;
+
+	if (pipe(pipe_fds) < 0)
+		goto error;
+
+	if (coalesce_frame_write(fd, IPC_NET_REGIST, IPC_TYPE_NOTI, 1) < 0 ||
+	    coalesce_frame_write(fd, IPC_NET_REGIST, IPC_TYPE_NOTI, 2) < 0 ||
+	    coalesce_recv(fmt_client, IPC_NET_REGIST, 1) < 0)
+		goto error;
+
+	/* A message is queued, but the pipe is empty */
+	memset(&timeout, 0, sizeof(timeout));
+	poll_fd = pipe_fds[0];
+	fds.fds = &poll_fd;
+	fds.count = 1;
+
+	rc = ipc_client_poll(fmt_client, &fds, &timeout);
+	if (rc != 1 || fds.count != 0) {
+		ipc_client_log(client, "%s: %d ready, %u fds\n", __func__, rc,
+			       fds.count);
+		goto error;
+	}
+
+	if (write(pipe_fds[1], "", 1) != 1)
+		goto error;
+
+	poll_fd = pipe_fds[0];
+	fds.count = 1;
+
+	rc = ipc_client_poll(fmt_client, &fds, &timeout);
+	if (rc != 2 || fds.count != 1 || poll_fd != pipe_fds[0]) {
+		ipc_client_log(client, "%s: pipe starved, %d ready, %u fds\n",
+			       __func__, rc, fds.count);
+		goto error;
+	}
+
+	if (coalesce_recv(fmt_client, IPC_NET_REGIST, 2) < 0)
+		goto error;
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	if (pipe_fds[0] >= 0)
+		close(pipe_fds[0]);
+
+	if (pipe_fds[1] >= 0)
+		close(pipe_fds[1]);
+
+	close(fd);
+	ipc_client_destroy(fmt_client);
+
+	return rc;
+}
+
+/* The frames read ahead to be coalesced are counted as they are read */
+int test_coalesce_counters(struct ipc_client *client)
+{
+	struct ipc_client_counters counters;
+	struct ipc_client *fmt_client;
+	unsigned int i;
+	int fd;
+	int rc;
+
+	fmt_client = coalesce_client_create(&fd);
+	if (fmt_client == NULL)
+		return -1;
+
+	for (i = 0; i < 5; i++) {
+		if (coalesce_frame_write(fd, IPC_NET_REGIST, IPC_TYPE_NOTI,
+					 i + 1) < 0)
+			goto error;
+	}
+
+	if (coalesce_recv(fmt_client, IPC_NET_REGIST, 1) < 0)
+		goto error;
+
+	ipc_client_counters_get(fmt_client, &counters);
+
+	if (counters.frames_in != 5 ||
+	    counters.bytes_in != 5 * (sizeof(struct ipc_fmt_header) + 1)) {
+		ipc_client_log(client, "%s: %llu frames and %llu bytes in"
+			       " instead of 5 and %zu\n", __func__,
+			       counters.frames_in, counters.bytes_in,
+			       5 * (sizeof(struct ipc_fmt_header) + 1));
+		goto error;
+	}
+
+	for (i = 1; i < 5; i++) {
+		if (coalesce_recv(fmt_client, IPC_NET_REGIST, i + 1) < 0)
+			goto error;
+	}
+
+	ipc_client_counters_get(fmt_client, &counters);
+
+	if (counters.frames_in != 5) {
+		ipc_client_log(client, "%s: queued frames counted twice\n",
+			       __func__);
+		goto error;
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	close(fd);
+	ipc_client_destroy(fmt_client);
+
+	return rc;
+}
@@ -0,0 +1,468 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <samsung-ipc.h>
+
+#include "fake_modem.h"
+
+#define FAKE_MODEM_BUFFER_SIZE	0x10000
+
+/* The responses wait for the latency in a queue, sorted by due time */
+struct fake_modem_frame {
+	uint64_t due;
+	unsigned char *data;
+	size_t size;
+
+	struct fake_modem_frame *next;
+};
+
+struct fake_modem_storm {
+	unsigned short command;
+	unsigned char *data;
+	size_t size;
+	uint64_t interval;
+	uint64_t next;
+	unsigned int count;
+};
+
+struct fake_modem {
+	int fd;
+	int type;
+
+	const struct fake_modem_rule *rules;
+	unsigned int rules_count;
+	unsigned int latency;
+
+	unsigned char input[FAKE_MODEM_BUFFER_SIZE];
+	size_t input_count;
+
+	unsigned char *output;
+	size_t output_size;
+	size_t output_count;
+
+	struct fake_modem_frame *head;
+	struct fake_modem_frame *tail;
+
+	struct fake_modem_storm storm;
+
+	unsigned char seq;
+	unsigned int received;
+};
+
+static uint64_t fake_modem_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+struct fake_modem *fake_modem_create(int fd, int type,
+				     const struct fake_modem_rule *rules,
+				     unsigned int count, unsigned int latency)
+{
+	struct fake_modem *modem;
+	int flags;
+
+	if (fd < 0 || (type != IPC_CLIENT_TYPE_FMT &&
+		       type != IPC_CLIENT_TYPE_RFS))
+		return NULL;
+
+	flags = fcntl(fd, F_GETFL);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+		return NULL;
+
+	modem = calloc(1, sizeof(struct fake_modem));
+	if (modem == NULL)
+		return NULL;
+
+	modem->fd = fd;
+	modem->type = type;
+	modem->rules = rules;
+	modem->rules_count = count;
+	modem->latency = latency;
+
+	return modem;
+}
+
+void fake_modem_destroy(struct fake_modem *modem)
+{
+	struct fake_modem_frame *frame;
+	struct fake_modem_frame *next;
+
+	if (modem == NULL)
+		return;
+
+	frame = modem->head;
+	while (frame != NULL) {
+		next = frame->next;
+		free(frame->data);
+		free(frame);
+		frame = next;
+	}
+
+	if (modem->storm.data != NULL)
+		free(modem->storm.data);
+
+	if (modem->output != NULL)
+		free(modem->output);
+
+	free(modem);
+}
+
+static int fake_modem_output(struct fake_modem *modem, const void *data,
+			     size_t size)
+{
+	unsigned char *output;
+	size_t needed;
+
+	needed = modem->output_count + size;
+	if (needed > modem->output_size) {
+		output = realloc(modem->output, needed * 2);
+		if (output == NULL)
+			return -1;
+
+		modem->output = output;
+		modem->output_size = needed * 2;
+	}
+
+	memcpy(modem->output + modem->output_count, data, size);
+	modem->output_count += size;
+
+	return 0;
+}
+
+/* Frames the message like the modem would, in a newly allocated buffer */
+static unsigned char *fake_modem_frame(struct fake_modem *modem,
+				       const struct ipc_message *message,
+				       size_t *size)
+{
+	struct ipc_fmt_header fmt_header;
+	struct ipc_rfs_header rfs_header;
+	unsigned char *frame;
+	size_t header_size;
+	const void *header;
+
+	if (modem->type == IPC_CLIENT_TYPE_FMT) {
+		ipc_fmt_header_setup(&fmt_header, message);
+		header = &fmt_header;
+		header_size = sizeof(fmt_header);
+	} else {
+		ipc_rfs_header_setup(&rfs_header, message);
+		header = &rfs_header;
+		header_size = sizeof(rfs_header);
+	}
+
+	frame = malloc(header_size + message->size);
+	if (frame == NULL)
+		return NULL;
+
+	memcpy(frame, header, header_size);
+	if (message->data != NULL && message->size > 0)
+		memcpy(frame + header_size, message->data, message->size);
+
+	*size = header_size + message->size;
+
+	return frame;
+}
+
+static int fake_modem_queue(struct fake_modem *modem,
+			    const struct ipc_message *message, uint64_t due)
+{
+	struct fake_modem_frame *frame;
+
+	frame = calloc(1, sizeof(struct fake_modem_frame));
+	if (frame == NULL)
+		return -1;
+
+	frame->data = fake_modem_frame(modem, message, &frame->size);
+	if (frame->data == NULL) {
+		free(frame);
+		return -1;
+	}
+
+	frame->due = due;
+
+	if (modem->tail != NULL)
+		modem->tail->next = frame;
+	else
+		modem->head = frame;
+
+	modem->tail = frame;
+
+	return 0;
+}
+
+int fake_modem_storm(struct fake_modem *modem, unsigned short command,
+		     const void *data, size_t size, unsigned int rate,
+		     unsigned int count)
+{
+	if (modem == NULL || rate == 0 || modem->storm.count > 0)
+		return -1;
+
+	if (modem->storm.data != NULL) {
+		free(modem->storm.data);
+		modem->storm.data = NULL;
+	}
+
+	if (data != NULL && size > 0) {
+		modem->storm.data = malloc(size);
+		if (modem->storm.data == NULL)
+			return -1;
+
+		memcpy(modem->storm.data, data, size);
+	}
+
+	modem->storm.command = command;
+	modem->storm.size = size;
+	modem->storm.interval = 1000000 / rate;
+	modem->storm.next = fake_modem_now();
+	modem->storm.count = count;
+
+	return 0;
+}
+
+int fake_modem_nv_read_burst(struct fake_modem *modem, unsigned int count,
+			     unsigned int length)
+{
+	struct ipc_rfs_nv_read_item_request_data request;
+	struct ipc_message message;
+	uint64_t due;
+	unsigned int i;
+
+	if (modem == NULL || modem->type != IPC_CLIENT_TYPE_RFS)
+		return -1;
+
+	due = fake_modem_now() + modem->latency;
+
+	for (i = 0; i < count; i++) {
+		request.offset = i * length;
+		request.length = length;
+
+		memset(&message, 0, sizeof(message));
+		message.mseq = modem->seq++;
+		message.command = IPC_RFS_NV_READ_ITEM;
+		message.data = &request;
+		message.size = sizeof(request);
+
+		if (fake_modem_queue(modem, &message, due) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static int fake_modem_request(struct fake_modem *modem,
+			      const struct ipc_message *request)
+{
+	const struct fake_modem_rule *rule;
+	struct ipc_message message;
+	unsigned int i;
+
+	modem->received++;
+
+	for (i = 0; i < modem->rules_count; i++) {
+		rule = &modem->rules[i];
+
+		if (rule->command != request->command ||
+		    (rule->type != 0 && rule->type != request->type))
+			continue;
+
+		memset(&message, 0, sizeof(message));
+		message.mseq = modem->seq++;
+		message.aseq = request->mseq;
+		message.command = request->command;
+		message.type = rule->response_type;
+		message.data = (void *) rule->data;
+		message.size = rule->size;
+
+		return fake_modem_queue(modem, &message,
+					fake_modem_now() + modem->latency);
+	}
+
+	return 0;
+}
+
+/* Handles the complete frames of the input buffer */
+static int fake_modem_input_parse(struct fake_modem *modem)
+{
+	const struct ipc_fmt_header *fmt_header;
+	const struct ipc_rfs_header *rfs_header;
+	struct ipc_message message;
+	size_t header_size;
+	size_t length;
+	size_t offset = 0;
+
+	if (modem->type == IPC_CLIENT_TYPE_FMT)
+		header_size = sizeof(struct ipc_fmt_header);
+	else
+		header_size = sizeof(struct ipc_rfs_header);
+
+	while (modem->input_count - offset >= header_size) {
+		memset(&message, 0, sizeof(message));
+
+		fmt_header = (const struct ipc_fmt_header *)
+			(modem->input + offset);
+		rfs_header = (const struct ipc_rfs_header *)
+			(modem->input + offset);
+
+		if (modem->type == IPC_CLIENT_TYPE_FMT)
+			length = fmt_header->length;
+		else
+			length = rfs_header->length;
+
+		if (length < header_size || length > sizeof(modem->input))
+			return -1;
+
+		if (modem->input_count - offset < length)
+			break;
+
+		if (modem->type == IPC_CLIENT_TYPE_FMT)
+			ipc_fmt_message_setup(fmt_header, &message);
+		else
+			ipc_rfs_message_setup(rfs_header, &message);
+
+		message.data = modem->input + offset + header_size;
+		message.size = length - header_size;
+
+		if (fake_modem_request(modem, &message) < 0)
+			return -1;
+
+		offset += length;
+	}
+
+	memmove(modem->input, modem->input + offset,
+		modem->input_count - offset);
+	modem->input_count -= offset;
+
+	return 0;
+}
+
+static int fake_modem_input(struct fake_modem *modem)
+{
+	ssize_t rc;
+
+	/* A full buffer would make the read return 0, like at the end */
+	if (fake_modem_input_parse(modem) < 0 ||
+	    modem->input_count == sizeof(modem->input)) {
+		return -1;
+	}
+
+	rc = read(modem->fd, modem->input + modem->input_count,
+		  sizeof(modem->input) - modem->input_count);
+	if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		return 0;
+	else if (rc <= 0)
+		return -1;
+
+	modem->input_count += rc;
+
+	return fake_modem_input_parse(modem);
+}
+
+int fake_modem_process(struct fake_modem *modem)
+{
+	struct fake_modem_frame *frame;
+	struct ipc_message message;
+	unsigned char *data;
+	uint64_t now;
+	size_t size;
+	ssize_t rc;
+
+	if (modem == NULL)
+		return -1;
+
+	if (fake_modem_input(modem) < 0)
+		return -1;
+
+	now = fake_modem_now();
+
+	while (modem->head != NULL && modem->head->due <= now) {
+		frame = modem->head;
+
+		if (fake_modem_output(modem, frame->data, frame->size) < 0)
+			return -1;
+
+		modem->head = frame->next;
+		if (modem->head == NULL)
+			modem->tail = NULL;
+
+		free(frame->data);
+		free(frame);
+	}
+
+	while (modem->storm.count > 0 && modem->storm.next <= now) {
+		memset(&message, 0, sizeof(message));
+		message.mseq = modem->seq++;
+		message.command = modem->storm.command;
+		message.type = IPC_TYPE_NOTI;
+		message.data = modem->storm.data;
+		message.size = modem->storm.size;
+
+		data = fake_modem_frame(modem, &message, &size);
+		if (data == NULL)
+			return -1;
+
+		rc = fake_modem_output(modem, data, size);
+		free(data);
+		if (rc < 0)
+			return -1;
+
+		modem->storm.next += modem->storm.interval;
+		modem->storm.count--;
+	}
+
+	if (modem->output_count == 0)
+		return 0;
+
+	rc = write(modem->fd, modem->output, modem->output_count);
+	if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		return 0;
+	else if (rc < 0)
+		return -1;
+
+	memmove(modem->output, modem->output + rc, modem->output_count - rc);
+	modem->output_count -= rc;
+
+	return 0;
+}
+
+unsigned int fake_modem_received(struct fake_modem *modem)
+{
+	if (modem == NULL)
+		return 0;
+
+	return modem->received;
+}
+
+int fake_modem_idle(struct fake_modem *modem)
+{
+	if (modem == NULL)
+		return 1;
+
+	return modem->head == NULL && modem->storm.count == 0 &&
+		modem->output_count == 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TESTS_FAKE_MODEM_H__
+#define __TESTS_FAKE_MODEM_H__
+
+/*
+ * The fake modem plays the modem side of a loopback transport: it answers
+ * the requests that match its rules after the configured latency, and can
+ * send notification storms and RFS NV_READ_ITEM bursts. It never blocks, so
+ * that the tests can run it in the same thread as the client.
+ */
+
+struct fake_modem_rule {
+	unsigned short command;
+	unsigned char type;		/* IPC_TYPE, 0 for any */
+	unsigned char response_type;	/* IPC_TYPE */
+	const void *data;
+	size_t size;
+};
+
+struct fake_modem;
+
+struct fake_modem *fake_modem_create(int fd, int type,
+				     const struct fake_modem_rule *rules,
+				     unsigned int count, unsigned int latency);
+void fake_modem_destroy(struct fake_modem *modem);
+int fake_modem_storm(struct fake_modem *modem, unsigned short command,
+		     const void *data, size_t size, unsigned int rate,
+		     unsigned int count);
+int fake_modem_nv_read_burst(struct fake_modem *modem, unsigned int count,
+			     unsigned int length);
+int fake_modem_process(struct fake_modem *modem);
+unsigned int fake_modem_received(struct fake_modem *modem);
+int fake_modem_idle(struct fake_modem *modem);
+
+#endif /* __TESTS_FAKE_MODEM_H__ */
@@ -0,0 +1,349 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <net/if.h>
+#include <sys/socket.h>
+
+/* linux/netlink.h needs to be included after sys/socket.h */
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <samsung-ipc.h>
+
+/* libsamsung-ipc internal headers */
+#include <ipc.h>
+
+#include "gprs_session.h"
+#include "netlink.h"
+
+/*
+ * The session drives a loopback FMT client, with GPRS handlers that only
+ * count the calls and an interface whose rtnetlink requests are answered by
+ * the test, so that no real interface is changed.
+ */
+
+#define GPRS_SESSION_CID	1
+#define GPRS_SESSION_MSEQ	0x40
+#define GPRS_SESSION_TIMEOUT	10000
+
+struct gprs_session_test {
+	struct ipc_client *client;
+	struct ipc_gprs_session *session;
+	int fd;
+	int netlink_fd;
+
+	unsigned char mseq;
+	unsigned int activated;
+	unsigned int deactivated;
+
+	unsigned int reports;
+	struct ipc_gprs_session_status status;
+};
+
+static int gprs_session_activate_handler(
+	__attribute__((unused)) struct ipc_client *client, void *data,
+	__attribute__((unused)) unsigned int cid)
+{
+	struct gprs_session_test *test = (struct gprs_session_test *) data;
+
+	test->activated++;
+
+	return 0;
+}
+
+static int gprs_session_deactivate_handler(
+	__attribute__((unused)) struct ipc_client *client, void *data,
+	__attribute__((unused)) unsigned int cid)
+{
+	struct gprs_session_test *test = (struct gprs_session_test *) data;
+
+	test->deactivated++;
+
+	return 0;
+}
+
+static char *gprs_session_get_iface(
+	__attribute__((unused)) struct ipc_client *client,
+	__attribute__((unused)) unsigned int cid)
+{
+	return strdup("lo");
+}
+
+static struct ipc_client_gprs_specs gprs_session_specs = {
+	.gprs_get_iface = gprs_session_get_iface,
+};
+
+static unsigned char gprs_session_seq_get(void *data)
+{
+	unsigned char *mseq = (unsigned char *) data;
+
+	return ++(*mseq);
+}
+
+static void gprs_session_callback(void *data,
+				  const struct ipc_gprs_session_status *status)
+{
+	struct gprs_session_test *test = (struct gprs_session_test *) data;
+
+	test->reports++;
+	memcpy(&test->status, status, sizeof(*status));
+}
+
+static void gprs_session_test_destroy(struct gprs_session_test *test)
+{
+	ipc_gprs_session_destroy(test->session);
+
+	if (test->fd >= 0)
+		close(test->fd);
+
+	if (test->netlink_fd >= 0)
+		close(test->netlink_fd);
+
+	if (test->client != NULL)
+		ipc_client_destroy(test->client);
+}
+
+static int gprs_session_test_create(struct gprs_session_test *test)
+{
+	memset(test, 0, sizeof(*test));
+	test->fd = -1;
+	test->netlink_fd = -1;
+	test->mseq = GPRS_SESSION_MSEQ;
+
+	test->client = ipc_client_create(IPC_CLIENT_TYPE_FMT);
+	if (test->client == NULL)
+		return -1;
+
+	test->fd = ipc_client_loopback_open(test->client);
+	if (test->fd < 0)
+		goto error;
+
+	test->netlink_fd = ipc_client_netlink_loopback_open(test->client);
+	if (test->netlink_fd < 0)
+		goto error;
+
+	test->client->gprs_specs = &gprs_session_specs;
+
+	ipc_client_gprs_handlers_register(test->client,
+					  gprs_session_activate_handler,
+					  gprs_session_deactivate_handler,
+					  test);
+
+	/* The mseqs and the reports each have their own data */
+	test->session = ipc_gprs_session_create(test->client, 1,
+						GPRS_SESSION_TIMEOUT, 1000,
+						gprs_session_seq_get,
+						&test->mseq,
+						gprs_session_callback, test);
+	if (test->session == NULL)
+		goto error;
+
+	return 0;
+
+error:
+	gprs_session_test_destroy(test);
+
+	return -1;
+}
+
+static int gprs_session_phone_res(struct gprs_session_test *test,
+				  unsigned char aseq, unsigned short command,
+				  unsigned short code)
+{
+	struct ipc_gen_phone_res_data data;
+	struct ipc_message message;
+
+	memset(&data, 0, sizeof(data));
+	data.group = IPC_GROUP(command);
+	data.index = IPC_INDEX(command);
+	data.type = IPC_TYPE_SET;
+	data.code = code;
+
+	memset(&message, 0, sizeof(message));
+	message.aseq = aseq;
+	message.command = IPC_GEN_PHONE_RES;
+	message.type = IPC_TYPE_RESP;
+	message.data = &data;
+	message.size = sizeof(data);
+
+	return ipc_gprs_session_handle(test->session, &message);
+}
+
+static void gprs_session_noti(struct gprs_session_test *test,
+			      unsigned short command, const void *data,
+			      size_t size)
+{
+	struct ipc_message message;
+
+	memset(&message, 0, sizeof(message));
+	message.command = command;
+	message.type = IPC_TYPE_NOTI;
+	message.data = (void *) data;
+	message.size = size;
+
+	ipc_gprs_session_handle(test->session, &message);
+}
+
+/* Returns the IFF_UP flag of the link request sent to rtnetlink */
+static int gprs_session_link_up(struct gprs_session_test *test)
+{
+	unsigned char buffer[NLMSG_SPACE(sizeof(struct ifinfomsg))];
+	struct nlmsghdr *header = (struct nlmsghdr *) buffer;
+	struct ifinfomsg *message;
+	ssize_t length;
+
+	length = recv(test->netlink_fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+	if (length < (ssize_t) NLMSG_LENGTH(sizeof(*message)) ||
+	    header->nlmsg_type != RTM_NEWLINK) {
+		return -1;
+	}
+
+	message = (struct ifinfomsg *) NLMSG_DATA(header);
+
+	return !!(message->ifi_flags & IFF_UP);
+}
+
+/* Brings the context up, with the IP configuration before the response */
+static int gprs_session_up(struct ipc_client *client,
+			   struct gprs_session_test *test)
+{
+	struct ipc_gprs_ip_configuration_data configuration;
+
+	if (ipc_gprs_session_activate(test->session, GPRS_SESSION_CID,
+				      "internet", NULL, NULL) < 0)
+		return -1;
+
+	/* The define request got the first mseq of the counter */
+	if (test->mseq != GPRS_SESSION_MSEQ + 1) {
+		ipc_client_log(client, "%s: mseq 0x%02x instead of 0x%02x\n",
+			       __func__, test->mseq, GPRS_SESSION_MSEQ + 1);
+		return -1;
+	}
+
+	/* A response to another command with the same aseq */
+	if (gprs_session_phone_res(test, test->mseq, IPC_GPRS_PDP_CONTEXT,
+				   IPC_GEN_PHONE_RES_CODE_SUCCESS) != 0) {
+		ipc_client_log(client, "%s: response to another command"
+			       " matched\n", __func__);
+		return -1;
+	}
+
+	if (gprs_session_phone_res(test, test->mseq,
+				   IPC_GPRS_DEFINE_PDP_CONTEXT,
+				   IPC_GEN_PHONE_RES_CODE_SUCCESS) != 1 ||
+	    test->mseq != GPRS_SESSION_MSEQ + 2) {
+		ipc_client_log(client, "%s: define response not matched\n",
+			       __func__);
+		return -1;
+	}
+
+	memset(&configuration, 0, sizeof(configuration));
+	configuration.cid = GPRS_SESSION_CID;
+	configuration.fail_cause = IPC_GPRS_FAIL_CAUSE_NONE;
+	gprs_session_noti(test, IPC_GPRS_IP_CONFIGURATION, &configuration,
+			  sizeof(configuration));
+
+	if (netlink_acks(test->netlink_fd, 1, 0) < 0)
+		return -1;
+
+	if (gprs_session_phone_res(test, test->mseq, IPC_GPRS_PDP_CONTEXT,
+				   IPC_GEN_PHONE_RES_CODE_SUCCESS) != 1 ||
+	    test->reports != 1 ||
+	    test->status.state != IPC_GPRS_SESSION_STATE_ACTIVE ||
+	    test->activated != 1) {
+		ipc_client_log(client, "%s: context not active\n", __func__);
+		return -1;
+	}
+
+	if (gprs_session_link_up(test) != 1) {
+		ipc_client_log(client, "%s: interface not brought up\n",
+			       __func__);
+		return -1;
+	}
+
+	return 0;
+}
+
+int test_gprs_session_activate(struct ipc_client *client)
+{
+	struct gprs_session_test test;
+	int rc;
+
+	if (gprs_session_test_create(&test) < 0)
+		return -1;
+
+	rc = gprs_session_up(client, &test);
+
+	gprs_session_test_destroy(&test);
+
+	return rc;
+}
+
+/*
+ * When the network tears an active context down, the interface is brought
+ * down as well before the activation is retried.
+ */
+int test_gprs_session_teardown(struct ipc_client *client)
+{
+	struct ipc_gprs_session_status status;
+	struct ipc_gprs_call_status_data call_status;
+	struct gprs_session_test test;
+	int rc = -1;
+
+	if (gprs_session_test_create(&test) < 0)
+		return -1;
+
+	if (gprs_session_up(client, &test) < 0)
+		goto complete;
+
+	if (netlink_acks(test.netlink_fd, 1, 0) < 0)
+		goto complete;
+
+	memset(&call_status, 0, sizeof(call_status));
+	call_status.cid = GPRS_SESSION_CID;
+	call_status.status = IPC_GPRS_STATUS_DISABLED;
+	call_status.fail_cause = IPC_GPRS_FAIL_CAUSE_NETWORK_FAILURE;
+	gprs_session_noti(&test, IPC_GPRS_CALL_STATUS, &call_status,
+			  sizeof(call_status));
+
+	ipc_gprs_session_status_get(test.session, GPRS_SESSION_CID, &status);
+
+	if (status.state != IPC_GPRS_SESSION_STATE_RETRY_WAIT ||
+	    test.deactivated != 1) {
+		ipc_client_log(client, "%s: context in state %u, %u"
+			       " deactivations\n", __func__, status.state,
+			       test.deactivated);
+		goto complete;
+	}
+
+	if (gprs_session_link_up(&test) != 0) {
+		ipc_client_log(client, "%s: interface not brought down\n",
+			       __func__);
+		goto complete;
+	}
+
+	rc = 0;
+
+complete:
+	gprs_session_test_destroy(&test);
+
+	return rc;
+}
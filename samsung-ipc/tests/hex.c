@@ -0,0 +1,334 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <samsung-ipc.h>
+
+#include "hex.h"
+
+/*
+ * The table driven conversions must give exactly the same results as the
+ * original implementations, which are kept here both as a reference and as
+ * a baseline for the benchmarks.
+ */
+
+#define COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+char *hex_reference_data2string(const void *data, size_t size)
+{
+	char *string;
+	char *p;
+	size_t i;
+
+	if (data == NULL || size == 0)
+		return NULL;
+
+	string = (char *) calloc(1, size * 2 + 1);
+	if (string == NULL)
+		return NULL;
+
+	p = string;
+
+	for (i = 0; i < size; i++) {
+		sprintf(p, "%02x", *((unsigned char *) data + i));
+		p += 2 * sizeof(char);
+	}
+
+	return string;
+}
+
+void *hex_reference_string2data(const char *string)
+{
+	void *data;
+	size_t length;
+	int shift;
+	unsigned char *p;
+	unsigned int b;
+	size_t i;
+	int rc;
+
+	if (string == NULL)
+		return NULL;
+
+	length = strlen(string);
+	if (length == 0)
+		return NULL;
+
+	shift = length % 2;
+
+	data = calloc(1, (length + 1) / 2);
+	if (data == NULL)
+		return NULL;
+
+	p = (unsigned char *) data;
+
+	for (i = 0; i < length; i++) {
+		rc = sscanf(&string[i], "%01x", &b);
+		if (rc < 1)
+			b = 0;
+
+		if ((shift % 2) == 0)
+			*p |= ((b & 0x0f) << 4);
+		else
+			*p++ |= b & 0x0f;
+
+		shift++;
+	}
+
+	return data;
+}
+
+int hex_reference_dump_line(const void *data, size_t size, size_t offset,
+			    char *line, size_t length)
+{
+	const unsigned char *p;
+	unsigned int count;
+	unsigned int i;
+	int rc;
+
+	if (data == NULL || line == NULL || offset >= size)
+		return -1;
+
+	count = size - offset;
+	if (count > 16)
+		count = 16;
+
+	p = (const unsigned char *) data + offset;
+
+	rc = snprintf(line, length, "[%04zx]   ", offset);
+
+	for (i = 0; i < 16; i++) {
+		if (i < count)
+			rc += snprintf(line + rc, length - rc, "%02X", p[i]);
+		else
+			rc += snprintf(line + rc, length - rc, "  ");
+
+		if (i == 7)
+			rc += snprintf(line + rc, length - rc, "  ");
+		else if (i != 15)
+			rc += snprintf(line + rc, length - rc, " ");
+	}
+
+	rc += snprintf(line + rc, length - rc, "   ");
+
+	for (i = 0; i < count; i++) {
+		if (isascii(p[i]) && isprint(p[i]))
+			line[rc++] = p[i];
+		else
+			line[rc++] = '.';
+
+		if (i == 7 && count > 8)
+			line[rc++] = ' ';
+	}
+
+	line[rc] = '\0';
+
+	return count;
+}
+
+static const char *hex_invalid_strings[] = {
+	"0g",
+	"g0",
+	"12 4",
+	"-1",
+	"0x12",
+	"abcdefz",
+};
+
+int test_hex_codec(struct ipc_client *client)
+{
+	unsigned char data[256];
+	unsigned char decoded[256];
+	char string[sizeof(data) * 2 + 1];
+	char *reference;
+	char *encoded;
+	void *buffer;
+	size_t size;
+	unsigned int i;
+	int rc;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = (i * 37 + 11) & 0xff;
+
+	for (size = 1; size <= sizeof(data); size++) {
+		reference = hex_reference_data2string(data, size);
+		encoded = data2string(data, size);
+
+		if (reference == NULL || encoded == NULL ||
+		    strcmp(reference, encoded)) {
+			ipc_client_log(client, "%s: encoding %zu bytes"
+				       " failed\n", __func__, size);
+			goto error;
+		}
+
+		rc = data2string_into(data, size, string, sizeof(string));
+		if (rc != (int) size * 2 || strcmp(string, reference)) {
+			ipc_client_log(client, "%s: encoding %zu bytes in place"
+				       " failed\n", __func__, size);
+			goto error;
+		}
+
+		rc = data2string_into(data, size, string, size * 2);
+		if (rc != -1) {
+			ipc_client_log(client, "%s: short buffer accepted\n",
+				       __func__);
+			goto error;
+		}
+
+		/* Both the even and the odd digit counts */
+		for (i = 0; i < 2; i++) {
+			free(reference);
+			reference = hex_reference_string2data(encoded + i);
+			buffer = string2data(encoded + i);
+
+			if (reference == NULL || buffer == NULL ||
+			    memcmp(reference, buffer,
+				   string2data_size(encoded + i))) {
+				free(buffer);
+				ipc_client_log(client, "%s: decoding %zu bytes"
+					       " failed\n", __func__, size);
+				goto error;
+			}
+
+			rc = string2data_into(encoded + i, decoded,
+					      sizeof(decoded));
+			if (rc != (int) string2data_size(encoded + i) ||
+			    memcmp(reference, decoded, rc)) {
+				free(buffer);
+				ipc_client_log(client, "%s: decoding %zu bytes"
+					       " in place failed\n", __func__,
+					       size);
+				goto error;
+			}
+
+			free(buffer);
+		}
+
+		free(reference);
+		free(encoded);
+	}
+
+	rc = string2data_into("ABCDEF", decoded, 3);
+	if (rc != 3 || decoded[0] != 0xab || decoded[1] != 0xcd ||
+	    decoded[2] != 0xef) {
+		ipc_client_log(client, "%s: upper case digits rejected\n",
+			       __func__);
+		return -1;
+	}
+
+	rc = string2data_into("ABCDEF", decoded, 2);
+	if (rc != -1) {
+		ipc_client_log(client, "%s: short buffer accepted\n", __func__);
+		return -1;
+	}
+
+	for (i = 0; i < COUNT(hex_invalid_strings); i++) {
+		rc = string2data_into(hex_invalid_strings[i], decoded,
+				      sizeof(decoded));
+		if (rc != -1) {
+			ipc_client_log(client, "%s: invalid string %s"
+				       " accepted\n", __func__,
+				       hex_invalid_strings[i]);
+			return -1;
+		}
+
+		buffer = string2data(hex_invalid_strings[i]);
+		if (buffer == NULL) {
+			ipc_client_log(client, "%s: invalid string %s not"
+				       " decoded\n", __func__,
+				       hex_invalid_strings[i]);
+			return -1;
+		}
+
+		free(buffer);
+	}
+
+	return 0;
+
+error:
+	free(reference);
+	free(encoded);
+
+	return -1;
+}
+
+int test_hex_dump(struct ipc_client *client)
+{
+	unsigned char data[0x10020];
+	char reference[IPC_DATA_DUMP_LINE_LENGTH];
+	char line[IPC_DATA_DUMP_LINE_LENGTH];
+	size_t offset;
+	size_t size;
+	unsigned int i;
+	int rc;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = (i * 37 + 11) & 0xff;
+
+	/* Every line length, including the longer offsets past 0xffff */
+	for (size = 1; size <= 48; size++) {
+		for (offset = 0; offset < size; offset += 16) {
+			rc = hex_reference_dump_line(data, size, offset,
+						     reference,
+						     sizeof(reference));
+			if (rc < 0)
+				return -1;
+
+			rc = ipc_data_dump_line(data, size, offset, line,
+						sizeof(line));
+			if (rc < 0 || strcmp(line, reference)) {
+				ipc_client_log(client, "%s: %zu bytes at %zu:"
+					       " wrong line\n", __func__, size,
+					       offset);
+				return -1;
+			}
+		}
+	}
+
+	for (offset = 0xfff0; offset < sizeof(data); offset += 16) {
+		rc = hex_reference_dump_line(data, sizeof(data), offset,
+					     reference, sizeof(reference));
+		if (rc < 0)
+			return -1;
+
+		rc = ipc_data_dump_line(data, sizeof(data), offset, line,
+					sizeof(line));
+		if (rc != 16 || strcmp(line, reference)) {
+			ipc_client_log(client, "%s: line at 0x%zx: wrong"
+				       " line\n", __func__, offset);
+			return -1;
+		}
+	}
+
+	rc = ipc_data_dump_line(data, sizeof(data), 0, line, 77);
+	if (rc != -1) {
+		ipc_client_log(client, "%s: short buffer accepted\n", __func__);
+		return -1;
+	}
+
+	rc = ipc_data_dump(client, data, 40);
+	if (rc < 0) {
+		ipc_client_log(client, "%s: dumping data failed\n", __func__);
+		return -1;
+	}
+
+	return 0;
+}
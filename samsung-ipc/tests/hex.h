@@ -0,0 +1,30 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TESTS_HEX_H__
+#define __TESTS_HEX_H__
+
+/* The sprintf, sscanf and snprintf based conversions they replaced */
+char *hex_reference_data2string(const void *data, size_t size);
+void *hex_reference_string2data(const char *string);
+int hex_reference_dump_line(const void *data, size_t size, size_t offset,
+			    char *line, size_t length);
+
+int test_hex_codec(struct ipc_client *client);
+int test_hex_dump(struct ipc_client *client);
+
+#endif /* __TESTS_HEX_H__ */
@@ -0,0 +1,250 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <samsung-ipc.h>
+
+#include "iterators.h"
+
+/*
+ * The frames are copied to buffers of their exact size, so that reading past
+ * the end of the message can be caught by tools like valgrind or
+ * AddressSanitizer.
+ */
+
+typedef int (*iterator_setup)(struct ipc_list_iterator *iterator,
+			      const void *data, size_t size);
+
+static const unsigned char net_plmn_list[] = {
+	0x02,
+	0x02, '2', '0', '8', '0', '1', '#', 0x02, 0x00, 0x00,
+	0x01, '2', '0', '8', '1', '5', '#', 0x02, 0x00, 0x00,
+};
+
+static const unsigned char call_list[] = {
+	0x02,
+	0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00,
+	0x00, 0x01, 0x02, 0x01, 0x02, 0x00, 0x03, 0x00, '1', '1', '2',
+};
+
+static const unsigned char svc_display_screen[] = {
+	0x01,
+	0x00, 0x00,
+	'E', 'C', 'I', 'O', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static void *iterators_next(iterator_setup setup,
+			    struct ipc_list_iterator *iterator)
+{
+	if (setup == ipc_net_plmn_list_iterator_setup)
+		return ipc_net_plmn_list_iterator_next(iterator);
+	else if (setup == ipc_call_list_iterator_setup)
+		return ipc_call_list_iterator_next(iterator);
+	else
+		return ipc_svc_display_screen_iterator_next(iterator);
+}
+
+/*
+ * Returns the number of entries the iterator walked, or -1 when the setup
+ * rejected the frame.
+ */
+static int iterators_walk(iterator_setup setup, const unsigned char *data,
+			  size_t size, unsigned char count)
+{
+	struct ipc_list_iterator iterator;
+	unsigned char *copy;
+	int walked = 0;
+	int rc;
+
+	copy = malloc(size > 0 ? size : 1);
+	if (copy == NULL)
+		return -1;
+
+	memcpy(copy, data, size);
+	copy[0] = count;
+
+	rc = setup(&iterator, copy, size);
+	if (rc < 0) {
+		/* A rejected iterator mustn't yield anything either */
+		if (iterators_next(setup, &iterator) != NULL)
+			walked = -2;
+		else
+			walked = -1;
+
+		goto complete;
+	}
+
+	while (iterators_next(setup, &iterator) != NULL)
+		walked++;
+
+complete:
+	free(copy);
+
+	return walked;
+}
+
+/* Neither a missing nor an empty payload can be walked */
+int test_iterators_empty(struct ipc_client *client)
+{
+	const iterator_setup setups[] = {
+		ipc_net_plmn_list_iterator_setup,
+		ipc_call_list_iterator_setup,
+		ipc_svc_display_screen_iterator_setup,
+	};
+	const unsigned char empty_list[] = { 0x00 };
+	struct ipc_list_iterator iterator;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(setups) / sizeof(setups[0]); i++) {
+		if (setups[i](&iterator, NULL, 0) != -1 ||
+		    setups[i](&iterator, empty_list, 0) != -1 ||
+		    iterators_next(setups[i], &iterator) != NULL) {
+			ipc_client_log(client, "%s: setup %u accepted no"
+				       " payload\n", __func__, i);
+			return -1;
+		}
+
+		/* A list without entries is valid */
+		if (iterators_walk(setups[i], empty_list, sizeof(empty_list),
+				   0) != 0) {
+			ipc_client_log(client, "%s: setup %u failed on an"
+				       " empty list\n", __func__, i);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* A frame cut anywhere in its last entry is rejected */
+int test_iterators_truncated(struct ipc_client *client)
+{
+	const struct {
+		iterator_setup setup;
+		const unsigned char *data;
+		size_t size;
+		size_t last;
+	} frames[] = {
+		{
+			ipc_net_plmn_list_iterator_setup,
+			net_plmn_list, sizeof(net_plmn_list),
+			sizeof(struct ipc_net_plmn_list_entry),
+		},
+		{
+			ipc_call_list_iterator_setup,
+			call_list, sizeof(call_list),
+			sizeof(struct ipc_call_list_entry) + 3,
+		},
+		{
+			ipc_svc_display_screen_iterator_setup,
+			svc_display_screen, sizeof(svc_display_screen),
+			sizeof(struct ipc_svc_display_screen_entry),
+		},
+	};
+	unsigned int i;
+	size_t size;
+	int rc;
+
+	for (i = 0; i < sizeof(frames) / sizeof(frames[0]); i++) {
+		rc = iterators_walk(frames[i].setup, frames[i].data,
+				    frames[i].size, frames[i].data[0]);
+		if (rc != frames[i].data[0]) {
+			ipc_client_log(client, "%s: frame %u walked %d entries"
+				       " instead of %u\n", __func__, i, rc,
+				       frames[i].data[0]);
+			return -1;
+		}
+
+		for (size = frames[i].size - frames[i].last;
+		     size < frames[i].size; size++) {
+			rc = iterators_walk(frames[i].setup, frames[i].data,
+					    size, frames[i].data[0]);
+			if (rc != -1) {
+				ipc_client_log(client, "%s: frame %u cut at %zu"
+					       " bytes not rejected\n",
+					       __func__, i, size);
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * A count larger than the entries of the frame is rejected, while extra
+ * data after the counted entries is left alone.
+ */
+int test_iterators_count_mismatch(struct ipc_client *client)
+{
+	const struct {
+		iterator_setup setup;
+		const unsigned char *data;
+		size_t size;
+	} frames[] = {
+		{
+			ipc_net_plmn_list_iterator_setup,
+			net_plmn_list, sizeof(net_plmn_list),
+		},
+		{
+			ipc_call_list_iterator_setup,
+			call_list, sizeof(call_list),
+		},
+		{
+			ipc_svc_display_screen_iterator_setup,
+			svc_display_screen, sizeof(svc_display_screen),
+		},
+	};
+	unsigned char count;
+	unsigned int i;
+	int rc;
+
+	for (i = 0; i < sizeof(frames) / sizeof(frames[0]); i++) {
+		count = frames[i].data[0];
+
+		rc = iterators_walk(frames[i].setup, frames[i].data,
+				    frames[i].size, count + 1);
+		if (rc != -1) {
+			ipc_client_log(client, "%s: frame %u walked %d entries"
+				       " past its end\n", __func__, i, rc);
+			return -1;
+		}
+
+		rc = iterators_walk(frames[i].setup, frames[i].data,
+				    frames[i].size, 0xff);
+		if (rc != -1) {
+			ipc_client_log(client, "%s: frame %u walked %d entries"
+				       " with a count of 255\n", __func__, i,
+				       rc);
+			return -1;
+		}
+
+		rc = iterators_walk(frames[i].setup, frames[i].data,
+				    frames[i].size, count - 1);
+		if (rc != count - 1) {
+			ipc_client_log(client, "%s: frame %u walked %d entries"
+				       " instead of %u\n", __func__, i, rc,
+				       count - 1);
+			return -1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,1131 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <samsung-ipc.h>
+
+/* libsamsung-ipc internal headers */
+#include <ipc.h>
+
+#include "fake_modem.h"
+#include "loopback.h"
+
+/*
+ * End to end tests of the whole client stack, against the fake modem on the
+ * other side of a loopback transport. They also print the throughput and
+ * latency that they measured, which are only meaningful when compared
+ * between runs on the same machine.
+ */
+
+#define LOOPBACK_REQUESTS	2000
+#define LOOPBACK_WINDOW		16
+#define LOOPBACK_LATENCY	100
+#define LOOPBACK_NOTIFICATIONS	2000
+#define LOOPBACK_NOTI_RATE	50000
+#define LOOPBACK_NV_READS	64
+#define LOOPBACK_NV_READ_LENGTH	0x100
+#define LOOPBACK_TIMEOUT	10000000
+#define LOOPBACK_THREADS	4
+#define LOOPBACK_STRINGS	1000
+#define LOOPBACK_STATE_UPDATES	64
+#define LOOPBACK_SUBMITS	500
+#define LOOPBACK_FRAMES		256
+#define LOOPBACK_FRAME_SIZE	0x800
+
+static const unsigned char loopback_me_sn[] = {
+	/* type, length */
+	0x01, 0x0f,
+	'3', '5', '5', '9', '2', '1', '0', '4', '1', '2', '3', '4', '5', '6',
+	'7', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static const struct fake_modem_rule loopback_rules[] = {
+	{
+		IPC_MISC_ME_SN, IPC_TYPE_GET, IPC_TYPE_RESP,
+		loopback_me_sn, sizeof(loopback_me_sn),
+	},
+};
+
+static uint64_t loopback_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int loopback_compare(const void *a, const void *b)
+{
+	uint64_t x = *((const uint64_t *) a);
+	uint64_t y = *((const uint64_t *) b);
+
+	return x < y ? -1 : x > y;
+}
+
+static struct ipc_client *loopback_client_create(
+	int type, const struct fake_modem_rule *rules, unsigned int count,
+	struct fake_modem **modem)
+{
+	struct ipc_client *client;
+	int fd;
+
+	client = ipc_client_create(type);
+	if (client == NULL)
+		return NULL;
+
+	fd = ipc_client_loopback_open(client);
+	if (fd < 0)
+		goto error;
+
+	*modem = fake_modem_create(fd, type, rules, count, LOOPBACK_LATENCY);
+	if (*modem == NULL) {
+		close(fd);
+		goto error;
+	}
+
+	return client;
+
+error:
+	ipc_client_destroy(client);
+
+	return NULL;
+}
+
+static void loopback_client_destroy(struct ipc_client *client,
+				    struct fake_modem *modem)
+{
+	fake_modem_destroy(modem);
+	ipc_client_destroy(client);
+}
+
+/* Returns 1 when a message was received, 0 when there was none yet */
+static int loopback_step(struct ipc_client *client, struct fake_modem *modem,
+			 struct ipc_message *message)
+{
+	struct timeval timeout;
+	int rc;
+
+	if (fake_modem_process(modem) < 0)
+		return -1;
+
+	memset(&timeout, 0, sizeof(timeout));
+
+	rc = ipc_client_poll(client, NULL, &timeout);
+	if (rc <= 0)
+		return rc;
+
+	memset(message, 0, sizeof(struct ipc_message));
+
+	rc = ipc_client_recv(client, message);
+	if (rc < 0)
+		return -1;
+
+	return 1;
+}
+
+static void loopback_report(const char *name, unsigned int count,
+			    uint64_t elapsed, uint64_t *latencies)
+{
+	double rate;
+
+	rate = elapsed > 0 ? count * 1000000.0 / elapsed : 0;
+
+	if (latencies == NULL) {
+		printf("%s: %u messages, %.0f messages/s\n", name, count,
+		       rate);
+		return;
+	}
+
+	qsort(latencies, count, sizeof(uint64_t), loopback_compare);
+
+	printf("%s: %u messages, %.0f messages/s, p50 %llu us, p99 %llu us\n",
+	       name, count, rate,
+	       (unsigned long long) latencies[count / 2],
+	       (unsigned long long) latencies[count * 99 / 100]);
+}
+
+/* The round trip times that the library measured must match the test's */
+static int loopback_stats_check(struct ipc_client *client,
+				struct ipc_client *fmt_client,
+				unsigned short command, unsigned int count)
+{
+	unsigned int buckets[IPC_CLIENT_STATS_BUCKETS];
+	struct ipc_client_stats stats;
+	unsigned long total = 0;
+	unsigned int i;
+	int rc;
+
+	rc = ipc_client_stats_get(fmt_client, &stats, 1);
+	if (rc != 1 || stats.command != command || stats.count != count ||
+	    stats.unanswered != 0) {
+		ipc_client_log(client, "%s: wrong stats\n", __func__);
+		return -1;
+	}
+
+	if (stats.min < LOOPBACK_LATENCY || stats.p50 < stats.min ||
+	    stats.p99 < stats.p50 || stats.max < stats.p99 ||
+	    stats.total < stats.min * count) {
+		ipc_client_log(client, "%s: wrong round trip times\n",
+			       __func__);
+		return -1;
+	}
+
+	rc = ipc_client_stats_histogram_get(fmt_client, command, buckets);
+	if (rc < 0)
+		return -1;
+
+	for (i = 0; i < IPC_CLIENT_STATS_BUCKETS; i++)
+		total += buckets[i];
+
+	if (total != count) {
+		ipc_client_log(client, "%s: wrong histogram\n", __func__);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int loopback_counters_check(struct ipc_client *client,
+				   struct ipc_client *fmt_client,
+				   unsigned int count, size_t size)
+{
+	struct ipc_client_counters counters;
+
+	if (ipc_client_counters_get(fmt_client, &counters) < 0)
+		return -1;
+
+	if (counters.frames_out != count || counters.frames_in != count ||
+	    counters.bytes_out != count * sizeof(struct ipc_fmt_header) ||
+	    counters.bytes_in != count * (sizeof(struct ipc_fmt_header) +
+					  size) ||
+	    counters.writes < count || counters.reads == 0 ||
+	    counters.allocations < 2 * count || counters.parse_errors != 0 ||
+	    counters.transport_errors != 0) {
+		ipc_client_log(client, "%s: wrong counters\n", __func__);
+		return -1;
+	}
+
+	ipc_client_counters_reset(fmt_client);
+	ipc_client_counters_get(fmt_client, &counters);
+
+	if (counters.frames_in != 0 || counters.allocations != 0) {
+		ipc_client_log(client, "%s: counters not reset\n", __func__);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* The read must have stayed posted, while each write went through the ring */
+static int loopback_uring_check(struct ipc_client *client,
+				struct ipc_client *fmt_client,
+				unsigned int count)
+{
+	struct ipc_client_uring_stats stats;
+
+	if (ipc_client_uring_stats_get(fmt_client, &stats) < 0)
+		return -1;
+
+	if (stats.writes != count || stats.reads == 0 || stats.arms == 0 ||
+	    stats.arms > stats.reads) {
+		ipc_client_log(client, "%s: wrong stats\n", __func__);
+		return -1;
+	}
+
+	printf("%s: %llu enters, %llu reads, %llu arms for %u messages\n",
+	       __func__, stats.enters, stats.reads, stats.arms, count);
+
+	return 0;
+}
+
+/* Only the extra fds that are ready are kept, and counted */
+static int loopback_uring_poll_fds(struct ipc_client *client,
+				   struct ipc_client *fmt_client)
+{
+	struct ipc_poll_fds fds;
+	struct timeval timeout;
+	int ready[2] = { -1, -1 };
+	int idle[2] = { -1, -1 };
+	int poll_fds[2];
+	int rc;
+
+	if (pipe(ready) < 0 || pipe(idle) < 0)
+		goto error;
+
+	memset(&timeout, 0, sizeof(timeout));
+	poll_fds[0] = idle[0];
+	poll_fds[1] = ready[0];
+	fds.fds = poll_fds;
+	fds.count = 2;
+
+	rc = ipc_client_poll(fmt_client, &fds, &timeout);
+	if (rc != 0 || fds.count != 2) {
+		ipc_client_log(client, "%s: %d ready, %u fds while idle\n",
+			       __func__, rc, fds.count);
+		goto error;
+	}
+
+	if (write(ready[1], "", 1) != 1)
+		goto error;
+
+	rc = ipc_client_poll(fmt_client, &fds, &timeout);
+	if (rc != 1 || fds.count != 1 || poll_fds[0] != -1 ||
+	    poll_fds[1] != ready[0]) {
+		ipc_client_log(client, "%s: %d ready, %u fds\n", __func__, rc,
+			       fds.count);
+		goto error;
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	if (ready[0] >= 0) {
+		close(ready[0]);
+		close(ready[1]);
+	}
+
+	if (idle[0] >= 0) {
+		close(idle[0]);
+		close(idle[1]);
+	}
+
+	return rc;
+}
+
+static int loopback_fmt_requests(struct ipc_client *client, const char *name,
+				 int uring)
+{
+	uint64_t sent[256];
+	uint64_t *latencies = NULL;
+	struct ipc_client *fmt_client;
+	struct fake_modem *modem = NULL;
+	struct ipc_message message;
+	unsigned int requested = 0;
+	unsigned int answered = 0;
+	unsigned char mseq;
+	uint64_t start;
+	int rc;
+
+	fmt_client = loopback_client_create(IPC_CLIENT_TYPE_FMT,
+					    loopback_rules, 1, &modem);
+	if (fmt_client == NULL) {
+		ipc_client_log(client, "%s: creating the client failed\n",
+			       __func__);
+		return -1;
+	}
+
+	latencies = calloc(LOOPBACK_REQUESTS, sizeof(uint64_t));
+	if (latencies == NULL)
+		goto error;
+
+	if (ipc_client_stats_enable(fmt_client) < 0)
+		goto error;
+
+	if (uring) {
+		rc = ipc_client_uring_enable(fmt_client);
+		if (rc == IPC_CLIENT_URING_UNAVAILABLE) {
+			printf("%s: io_uring is unavailable, skipped\n", name);
+			rc = 0;
+			goto complete;
+		} else if (rc < 0) {
+			goto error;
+		}
+	}
+
+	start = loopback_now();
+
+	while (answered < LOOPBACK_REQUESTS) {
+		if (loopback_now() - start > LOOPBACK_TIMEOUT) {
+			ipc_client_log(client, "%s: timed out\n", __func__);
+			goto error;
+		}
+
+		while (requested < LOOPBACK_REQUESTS &&
+		       requested - answered < LOOPBACK_WINDOW) {
+			mseq = (requested % 0xff) + 1;
+			sent[mseq] = loopback_now();
+
+			rc = ipc_client_send(fmt_client, mseq, IPC_MISC_ME_SN,
+					     IPC_TYPE_GET, NULL, 0);
+			if (rc < 0)
+				goto error;
+
+			requested++;
+		}
+
+		rc = loopback_step(fmt_client, modem, &message);
+		if (rc < 0)
+			goto error;
+		else if (rc == 0)
+			continue;
+
+		if (message.command != IPC_MISC_ME_SN ||
+		    message.type != IPC_TYPE_RESP ||
+		    message.size != sizeof(loopback_me_sn) ||
+		    memcmp(message.data, loopback_me_sn, message.size)) {
+			ipc_client_log(client, "%s: wrong response\n",
+				       __func__);
+			free(message.data);
+			goto error;
+		}
+
+		latencies[answered++] = loopback_now() - sent[message.aseq];
+		free(message.data);
+	}
+
+	loopback_report(name, answered, loopback_now() - start, latencies);
+
+	if (uring) {
+		rc = loopback_uring_check(client, fmt_client,
+					  LOOPBACK_REQUESTS);
+		if (rc < 0)
+			goto error;
+
+		rc = loopback_uring_poll_fds(client, fmt_client);
+		if (rc < 0)
+			goto error;
+	}
+
+	rc = loopback_stats_check(client, fmt_client, IPC_MISC_ME_SN,
+				  LOOPBACK_REQUESTS);
+	if (rc < 0)
+		goto error;
+
+	rc = loopback_counters_check(client, fmt_client, LOOPBACK_REQUESTS,
+				     sizeof(loopback_me_sn));
+	if (rc < 0)
+		goto error;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	if (latencies != NULL)
+		free(latencies);
+
+	loopback_client_destroy(fmt_client, modem);
+
+	return rc;
+}
+
+int test_loopback_fmt_requests(struct ipc_client *client)
+{
+	return loopback_fmt_requests(client, __func__, 0);
+}
+
+/* The same requests, with the io_uring transport when it's available */
+int test_loopback_uring(struct ipc_client *client)
+{
+	return loopback_fmt_requests(client, __func__, 1);
+}
+
+/* Reads what the client wrote so far, without waiting */
+static int loopback_uring_drain(int fd, unsigned char *buffer, size_t size,
+				size_t *count)
+{
+	ssize_t rc;
+
+	while (*count < size) {
+		rc = recv(fd, buffer + *count, size - *count, MSG_DONTWAIT);
+		if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return 0;
+		else if (rc <= 0)
+			return -1;
+
+		*count += rc;
+	}
+
+	return 0;
+}
+
+/*
+ * Frames that are larger than what the socket can take at once must still
+ * reach the modem side whole and in order, through the output queue.
+ */
+int test_loopback_uring_backpressure(struct ipc_client *client)
+{
+	unsigned char data[LOOPBACK_FRAME_SIZE];
+	const struct ipc_fmt_header *header;
+	struct ipc_client *fmt_client;
+	struct timeval timeout;
+	unsigned char *buffer = NULL;
+	size_t frame = sizeof(struct ipc_fmt_header) + sizeof(data);
+	size_t size = LOOPBACK_FRAMES * frame;
+	size_t count = 0;
+	unsigned int i;
+	uint64_t start;
+	int fd = -1;
+	int rc;
+
+	fmt_client = ipc_client_create(IPC_CLIENT_TYPE_FMT);
+	if (fmt_client == NULL)
+		return -1;
+
+	fd = ipc_client_loopback_open(fmt_client);
+	if (fd < 0)
+		goto error;
+
+	if (ipc_client_output_enable(fmt_client, 0, NULL, NULL) < 0)
+		goto error;
+
+	rc = ipc_client_uring_enable(fmt_client);
+	if (rc == IPC_CLIENT_URING_UNAVAILABLE) {
+		printf("%s: io_uring is unavailable, skipped\n", __func__);
+		rc = 0;
+		goto complete;
+	} else if (rc < 0) {
+		goto error;
+	}
+
+	buffer = malloc(size);
+	if (buffer == NULL)
+		goto error;
+
+	for (i = 0; i < LOOPBACK_FRAMES; i++) {
+		memset(data, i, sizeof(data));
+
+		rc = ipc_client_send(fmt_client, (i % 0xff) + 1,
+				     IPC_MISC_ME_SN, IPC_TYPE_SET, data,
+				     sizeof(data));
+		if (rc < 0) {
+			ipc_client_log(client, "%s: sending failed\n",
+				       __func__);
+			goto error;
+		}
+	}
+
+	if (ipc_client_output_pending(fmt_client) <= 0) {
+		ipc_client_log(client, "%s: nothing was queued\n", __func__);
+		goto error;
+	}
+
+	start = loopback_now();
+
+	while (count < size) {
+		if (loopback_now() - start > LOOPBACK_TIMEOUT) {
+			ipc_client_log(client, "%s: timed out\n", __func__);
+			goto error;
+		}
+
+		if (loopback_uring_drain(fd, buffer, size, &count) < 0)
+			goto error;
+
+		memset(&timeout, 0, sizeof(timeout));
+
+		if (ipc_client_poll(fmt_client, NULL, &timeout) < 0)
+			goto error;
+	}
+
+	for (i = 0; i < LOOPBACK_FRAMES; i++) {
+		header = (const struct ipc_fmt_header *) (buffer + i * frame);
+		memset(data, i, sizeof(data));
+
+		if (header->length != frame || header->mseq != (i % 0xff) + 1 ||
+		    memcmp(buffer + i * frame + sizeof(*header), data,
+			   sizeof(data))) {
+			ipc_client_log(client, "%s: frame %u is wrong\n",
+				       __func__, i);
+			goto error;
+		}
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	if (buffer != NULL)
+		free(buffer);
+
+	if (fd >= 0)
+		close(fd);
+
+	ipc_client_destroy(fmt_client);
+
+	return rc;
+}
+
+int test_loopback_fmt_noti_storm(struct ipc_client *client)
+{
+	struct ipc_disp_rssi_info_data rssi_info;
+	struct ipc_client *fmt_client;
+	struct fake_modem *modem = NULL;
+	struct ipc_message message;
+	unsigned int received = 0;
+	unsigned char mseq = 0;
+	uint64_t start;
+	int rc;
+
+	fmt_client = loopback_client_create(IPC_CLIENT_TYPE_FMT, NULL, 0,
+					    &modem);
+	if (fmt_client == NULL) {
+		ipc_client_log(client, "%s: creating the client failed\n",
+			       __func__);
+		return -1;
+	}
+
+	rssi_info.rssi = 0x42;
+
+	rc = fake_modem_storm(modem, IPC_DISP_RSSI_INFO, &rssi_info,
+			      sizeof(rssi_info), LOOPBACK_NOTI_RATE,
+			      LOOPBACK_NOTIFICATIONS);
+	if (rc < 0)
+		goto error;
+
+	start = loopback_now();
+
+	while (received < LOOPBACK_NOTIFICATIONS) {
+		if (loopback_now() - start > LOOPBACK_TIMEOUT) {
+			ipc_client_log(client, "%s: timed out\n", __func__);
+			goto error;
+		}
+
+		rc = loopback_step(fmt_client, modem, &message);
+		if (rc < 0)
+			goto error;
+		else if (rc == 0)
+			continue;
+
+		/* The notifications must arrive in order, and none lost */
+		if (message.command != IPC_DISP_RSSI_INFO ||
+		    message.type != IPC_TYPE_NOTI || message.mseq != mseq ||
+		    message.size != sizeof(rssi_info)) {
+			ipc_client_log(client, "%s: wrong notification\n",
+				       __func__);
+			free(message.data);
+			goto error;
+		}
+
+		free(message.data);
+
+		mseq++;
+		received++;
+	}
+
+	loopback_report(__func__, received, loopback_now() - start, NULL);
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	loopback_client_destroy(fmt_client, modem);
+
+	return rc;
+}
+
+int test_loopback_rfs_nv_read_burst(struct ipc_client *client)
+{
+	struct ipc_rfs_nv_read_item_response_header *header;
+	const struct ipc_rfs_nv_read_item_request_data *request;
+	unsigned char response[sizeof(*header) + LOOPBACK_NV_READ_LENGTH];
+	struct ipc_client *rfs_client;
+	struct fake_modem *modem = NULL;
+	struct ipc_message message;
+	unsigned int answered = 0;
+	uint64_t start;
+	int rc;
+
+	rfs_client = loopback_client_create(IPC_CLIENT_TYPE_RFS, NULL, 0,
+					    &modem);
+	if (rfs_client == NULL) {
+		ipc_client_log(client, "%s: creating the client failed\n",
+			       __func__);
+		return -1;
+	}
+
+	rc = fake_modem_nv_read_burst(modem, LOOPBACK_NV_READS,
+				      LOOPBACK_NV_READ_LENGTH);
+	if (rc < 0)
+		goto error;
+
+	memset(response, 0, sizeof(response));
+	header = (struct ipc_rfs_nv_read_item_response_header *) response;
+
+	start = loopback_now();
+
+	while (fake_modem_received(modem) < LOOPBACK_NV_READS ||
+	       !fake_modem_idle(modem)) {
+		if (loopback_now() - start > LOOPBACK_TIMEOUT) {
+			ipc_client_log(client, "%s: timed out\n", __func__);
+			goto error;
+		}
+
+		rc = loopback_step(rfs_client, modem, &message);
+		if (rc < 0)
+			goto error;
+		else if (rc == 0)
+			continue;
+
+		if (message.command != IPC_RFS_NV_READ_ITEM ||
+		    message.size != sizeof(*request)) {
+			ipc_client_log(client, "%s: wrong request\n",
+				       __func__);
+			free(message.data);
+			goto error;
+		}
+
+		request = message.data;
+
+		header->confirm = 1;
+		header->offset = request->offset;
+		header->length = request->length;
+
+		free(message.data);
+
+		rc = ipc_client_send(rfs_client, message.mseq,
+				     IPC_RFS_NV_READ_ITEM, 0, response,
+				     sizeof(response));
+		if (rc < 0)
+			goto error;
+
+		answered++;
+	}
+
+	if (answered != LOOPBACK_NV_READS) {
+		ipc_client_log(client, "%s: %u requests instead of %u\n",
+			       __func__, answered, LOOPBACK_NV_READS);
+		goto error;
+	}
+
+	loopback_report(__func__, answered, loopback_now() - start, NULL);
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	loopback_client_destroy(rfs_client, modem);
+
+	return rc;
+}
+
+struct loopback_thread {
+	struct ipc_client *client;
+	pthread_t thread;
+	unsigned int index;
+	unsigned int *finished;
+	int rc;
+};
+
+static int loopback_thread_strings(struct loopback_thread *thread)
+{
+	unsigned short command;
+	char expected[7];
+	const char *string;
+	unsigned int i;
+
+	/* Unknown commands, that are formatted in a buffer of the thread */
+	command = 0xff00 | thread->index;
+	snprintf(expected, sizeof(expected), "0x%04x", command);
+
+	for (i = 0; i < LOOPBACK_STRINGS; i++) {
+		string = ipc_command_string(command);
+		if (strcmp(string, expected)) {
+			ipc_client_log(thread->client, "%s: %s instead of %s\n",
+				       __func__, string, expected);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void *loopback_thread_run(void *data)
+{
+	struct loopback_thread *thread = (struct loopback_thread *) data;
+
+	thread->rc = -1;
+
+	if (loopback_thread_strings(thread) < 0)
+		goto complete;
+
+	if (test_loopback_fmt_requests(thread->client) < 0)
+		goto complete;
+
+	if (test_loopback_rfs_nv_read_burst(thread->client) < 0)
+		goto complete;
+
+	if (loopback_thread_strings(thread) < 0)
+		goto complete;
+
+	thread->rc = 0;
+
+complete:
+	__atomic_add_fetch(thread->finished, 1, __ATOMIC_RELEASE);
+
+	return NULL;
+}
+
+struct loopback_state_reader {
+	struct ipc_client *client;
+	struct ipc_client *state_client;
+	pthread_t thread;
+	unsigned int stop;
+	unsigned long reads;
+	int rc;
+};
+
+static void loopback_state_callback(void *data, unsigned int changed,
+				    const struct ipc_client_state *state)
+{
+	struct loopback_state_reader *reader =
+		(struct loopback_state_reader *) data;
+
+	if (state->rssi != state->hdr_rssi || state->rssi != state->battery)
+		__atomic_store_n(&reader->rc, -1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Every update sets the three icons to the same value, so a copy mixing two
+ * updates is caught by comparing them.
+ */
+static void *loopback_state_reader_run(void *data)
+{
+	struct loopback_state_reader *reader =
+		(struct loopback_state_reader *) data;
+	struct ipc_client_state state;
+	int id = -1;
+
+	while (!__atomic_load_n(&reader->stop, __ATOMIC_ACQUIRE)) {
+		if (ipc_client_state_get(reader->state_client, &state) < 0) {
+			ipc_client_log(reader->client, "%s: getting the state"
+				       " failed\n", __func__);
+			goto error;
+		}
+
+		if (state.rssi != state.hdr_rssi ||
+		    state.rssi != state.battery) {
+			ipc_client_log(reader->client, "%s: torn state %u %u"
+				       " %u\n", __func__, state.rssi,
+				       state.hdr_rssi, state.battery);
+			goto error;
+		}
+
+		/* The subscriptions are changed while the updates go on */
+		if (reader->reads++ % LOOPBACK_STATE_UPDATES == 0) {
+			if (id >= 0)
+				ipc_client_state_unsubscribe(
+					reader->state_client, id);
+
+			id = ipc_client_state_subscribe(
+				reader->state_client,
+				IPC_CLIENT_STATE_MASK(IPC_CLIENT_STATE_RSSI),
+				loopback_state_callback, reader);
+			if (id < 0) {
+				ipc_client_log(reader->client, "%s: subscribing"
+					       " failed\n", __func__);
+				goto error;
+			}
+		}
+	}
+
+	goto complete;
+
+error:
+	__atomic_store_n(&reader->rc, -1, __ATOMIC_RELAXED);
+
+complete:
+	if (id >= 0)
+		ipc_client_state_unsubscribe(reader->state_client, id);
+
+	return NULL;
+}
+
+static void loopback_state_write(struct ipc_client *state_client,
+				 unsigned char value)
+{
+	struct ipc_disp_icon_info_response_data data;
+	struct ipc_message message;
+
+	data.flags = IPC_DISP_ICON_INFO_FLAG_ALL;
+	data.rssi = value;
+	data.hdr_rssi = value;
+	data.battery = value;
+
+	memset(&message, 0, sizeof(message));
+	message.command = IPC_DISP_ICON_INFO;
+	message.type = IPC_TYPE_NOTI;
+	message.data = &data;
+	message.size = sizeof(data);
+
+	ipc_client_state_update(state_client, &message);
+}
+
+/*
+ * Each thread drives its own FMT and RFS clients, while they all log through
+ * the same client, whose log callback is registered again and again. Another
+ * thread reads the state store of a client and subscribes to it while the
+ * main thread updates it, as ipc_client_recv would. It is meant to be run
+ * under ThreadSanitizer as well.
+ */
+int test_loopback_threads(struct ipc_client *client)
+{
+	struct loopback_thread threads[LOOPBACK_THREADS];
+	void (*log_callback)(void *log_data, const char *message);
+	struct loopback_state_reader reader;
+	struct timespec delay;
+	unsigned int finished = 0;
+	unsigned int updates = 0;
+	unsigned int count;
+	void *log_data;
+	unsigned int i;
+	int rc = 0;
+
+	pthread_mutex_lock(&client->lock);
+	log_callback = client->log_callback;
+	log_data = client->log_data;
+	pthread_mutex_unlock(&client->lock);
+
+	memset(&reader, 0, sizeof(reader));
+	reader.client = client;
+
+	reader.state_client = ipc_client_create(IPC_CLIENT_TYPE_DUMMY);
+	if (reader.state_client == NULL)
+		return -1;
+
+	if (ipc_client_state_enable(reader.state_client) < 0)
+		goto error;
+
+	if (pthread_create(&reader.thread, NULL, loopback_state_reader_run,
+			   &reader) != 0) {
+		ipc_client_log(client, "%s: creating the state reader failed\n",
+			       __func__);
+		goto error;
+	}
+
+	for (count = 0; count < LOOPBACK_THREADS; count++) {
+		threads[count].client = client;
+		threads[count].index = count;
+		threads[count].finished = &finished;
+
+		if (pthread_create(&threads[count].thread, NULL,
+				   loopback_thread_run, &threads[count]) != 0) {
+			ipc_client_log(client, "%s: creating thread %u"
+				       " failed\n", __func__, count);
+			rc = -1;
+			break;
+		}
+	}
+
+	delay.tv_sec = 0;
+	delay.tv_nsec = 1000000;
+
+	while (__atomic_load_n(&finished, __ATOMIC_ACQUIRE) < count) {
+		ipc_client_log_callback_register(client, log_callback,
+						 log_data);
+
+		for (i = 0; i < LOOPBACK_STATE_UPDATES; i++)
+			loopback_state_write(reader.state_client, updates++);
+
+		nanosleep(&delay, NULL);
+	}
+
+	for (i = 0; i < count; i++) {
+		pthread_join(threads[i].thread, NULL);
+
+		if (threads[i].rc < 0) {
+			ipc_client_log(client, "%s: thread %u failed\n",
+				       __func__, i);
+			rc = -1;
+		}
+	}
+
+	__atomic_store_n(&reader.stop, 1, __ATOMIC_RELEASE);
+	pthread_join(reader.thread, NULL);
+
+	if (reader.rc < 0 || reader.reads == 0) {
+		ipc_client_log(client, "%s: state reader failed after %lu"
+			       " reads\n", __func__, reader.reads);
+		rc = -1;
+	}
+
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	ipc_client_destroy(reader.state_client);
+
+	return rc;
+}
+
+struct loopback_producer {
+	struct ipc_client *client;
+	pthread_t thread;
+	unsigned long long token;
+	int rc;
+};
+
+static void *loopback_producer_run(void *data)
+{
+	struct loopback_producer *producer = (struct loopback_producer *) data;
+	unsigned int i;
+
+	producer->rc = -1;
+
+	for (i = 0; i < LOOPBACK_SUBMITS; i++) {
+		if (ipc_client_submit(producer->client, (i % 0xfe) + 1,
+				      IPC_MISC_ME_SN, IPC_TYPE_GET, NULL, 0,
+				      &producer->token) < 0)
+			return NULL;
+	}
+
+	producer->rc = 0;
+
+	return NULL;
+}
+
+/*
+ * Several producer threads submit requests on the same client, while this
+ * thread is the writer and also plays the modem side.
+ */
+int test_loopback_submit_threads(struct ipc_client *client)
+{
+	struct loopback_producer producers[LOOPBACK_THREADS];
+	struct ipc_client_submit_stats stats;
+	struct ipc_client *fmt_client;
+	struct fake_modem *modem = NULL;
+	struct ipc_message message;
+	unsigned int total = LOOPBACK_THREADS * LOOPBACK_SUBMITS;
+	unsigned int answered = 0;
+	unsigned int count;
+	unsigned int i;
+	uint64_t start;
+	int step;
+	int rc = 0;
+
+	fmt_client = loopback_client_create(IPC_CLIENT_TYPE_FMT,
+					    loopback_rules, 1, &modem);
+	if (fmt_client == NULL) {
+		ipc_client_log(client, "%s: creating the client failed\n",
+			       __func__);
+		return -1;
+	}
+
+	/* The writer sends the whole queue before the modem reads any of it */
+	if (ipc_client_output_enable(fmt_client, 0, NULL, NULL) < 0 ||
+	    ipc_client_submit_enable(fmt_client) < 0) {
+		loopback_client_destroy(fmt_client, modem);
+		return -1;
+	}
+
+	for (count = 0; count < LOOPBACK_THREADS; count++) {
+		producers[count].client = fmt_client;
+		producers[count].token = 0;
+
+		if (pthread_create(&producers[count].thread, NULL,
+				   loopback_producer_run,
+				   &producers[count]) != 0) {
+			ipc_client_log(client, "%s: creating thread %u"
+				       " failed\n", __func__, count);
+			total = count * LOOPBACK_SUBMITS;
+			rc = -1;
+			break;
+		}
+	}
+
+	start = loopback_now();
+
+	while (answered < total) {
+		if (loopback_now() - start > LOOPBACK_TIMEOUT) {
+			ipc_client_log(client, "%s: timed out\n", __func__);
+			rc = -1;
+			break;
+		}
+
+		if (ipc_client_submit_drain(fmt_client) < 0) {
+			ipc_client_log(client, "%s: draining failed\n",
+				       __func__);
+			rc = -1;
+			break;
+		}
+
+		step = loopback_step(fmt_client, modem, &message);
+		if (step < 0) {
+			rc = -1;
+			break;
+		} else if (step == 0) {
+			continue;
+		}
+
+		if (message.command != IPC_MISC_ME_SN ||
+		    message.type != IPC_TYPE_RESP) {
+			ipc_client_log(client, "%s: wrong response\n",
+				       __func__);
+			rc = -1;
+		}
+
+		free(message.data);
+		answered++;
+	}
+
+	for (i = 0; i < count; i++) {
+		pthread_join(producers[i].thread, NULL);
+
+		if (producers[i].rc < 0 ||
+		    ipc_client_submit_done(fmt_client,
+					   producers[i].token) != 1) {
+			ipc_client_log(client, "%s: producer %u failed\n",
+				       __func__, i);
+			rc = -1;
+		}
+	}
+
+	if (rc == 0) {
+		ipc_client_submit_stats_get(fmt_client, &stats);
+
+		if (stats.submitted != total || stats.sent != total ||
+		    stats.done != total || stats.depth != 0 ||
+		    stats.depth_max == 0) {
+			ipc_client_log(client, "%s: wrong stats\n", __func__);
+			rc = -1;
+		}
+
+		printf("%s: %u messages, %.0f messages/s, enqueue avg %llu ns"
+		       " max %llu ns, depth max %llu\n", __func__, total,
+		       total * 1000000.0 / (loopback_now() - start),
+		       stats.enqueue_total / total, stats.enqueue_max,
+		       stats.depth_max);
+	}
+
+	loopback_client_destroy(fmt_client, modem);
+
+	return rc;
+}
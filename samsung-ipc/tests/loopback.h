@@ -0,0 +1,29 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TESTS_LOOPBACK_H__
+#define __TESTS_LOOPBACK_H__
+
+int test_loopback_fmt_requests(struct ipc_client *client);
+int test_loopback_fmt_noti_storm(struct ipc_client *client);
+int test_loopback_rfs_nv_read_burst(struct ipc_client *client);
+int test_loopback_threads(struct ipc_client *client);
+int test_loopback_submit_threads(struct ipc_client *client);
+int test_loopback_uring(struct ipc_client *client);
+int test_loopback_uring_backpressure(struct ipc_client *client);
+
+#endif /* __TESTS_LOOPBACK_H__ */
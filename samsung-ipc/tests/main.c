@@ -28,7 +28,23 @@
 
 /* libsamsung-ipc internal headers */
 #include <ipc.h>
+#include "arena.h"
+#include "coalesce.h"
+#include "gprs_session.h"
+#include "hex.h"
+#include "iterators.h"
+#include "loopback.h"
+#include "netlink.h"
+#include "output.h"
 #include "partitions/android.h"
+#include "recv.h"
+#include "scheduler.h"
+#include "sec_rsim_cache.h"
+#include "sms_pdu.h"
+#include "sms_pipeline.h"
+#include "state.h"
+#include "stats.h"
+#include "views.h"
 
 struct test {
 	char *name;
@@ -40,6 +56,178 @@ static struct test tests[] = {
 		"open_android_modem_partition",
 		test_open_android_modem_partition
 	},
+	{
+		"iterators_empty",
+		test_iterators_empty
+	},
+	{
+		"iterators_truncated",
+		test_iterators_truncated
+	},
+	{
+		"iterators_count_mismatch",
+		test_iterators_count_mismatch
+	},
+	{
+		"views_valid_frames",
+		test_views_valid_frames
+	},
+	{
+		"views_truncated_frames",
+		test_views_truncated_frames
+	},
+	{
+		"recv_split",
+		test_recv_split
+	},
+	{
+		"recv_deadline",
+		test_recv_deadline
+	},
+	{
+		"sms_pdu_corpus",
+		test_sms_pdu_corpus
+	},
+	{
+		"sms_pdu_codec",
+		test_sms_pdu_codec
+	},
+	{
+		"sms_pdu_concat_store",
+		test_sms_pdu_concat_store
+	},
+	{
+		"sms_pdu_concat_expire",
+		test_sms_pdu_concat_expire
+	},
+	{
+		"sms_pipeline_submit",
+		test_sms_pipeline_submit
+	},
+	{
+		"sms_pipeline_reports",
+		test_sms_pipeline_reports
+	},
+	{
+		"sec_rsim_cache_hits",
+		test_sec_rsim_cache_hits
+	},
+	{
+		"sec_rsim_cache_invalidation",
+		test_sec_rsim_cache_invalidation
+	},
+	{
+		"sec_rsim_cache_pending",
+		test_sec_rsim_cache_pending
+	},
+	{
+		"hex_codec",
+		test_hex_codec
+	},
+	{
+		"hex_dump",
+		test_hex_dump
+	},
+	{
+		"arena_alloc",
+		test_arena_alloc
+	},
+	{
+		"arena_setup_into",
+		test_arena_setup_into
+	},
+	{
+		"state_store",
+		test_state_store
+	},
+	{
+		"state_icon_info",
+		test_state_icon_info
+	},
+	{
+		"state_subscriptions",
+		test_state_subscriptions
+	},
+	{
+		"coalesce_queue",
+		test_coalesce_queue
+	},
+	{
+		"coalesce_poll",
+		test_coalesce_poll
+	},
+	{
+		"coalesce_counters",
+		test_coalesce_counters
+	},
+	{
+		"output_queue",
+		test_output_queue
+	},
+	{
+		"output_poll",
+		test_output_poll
+	},
+	{
+		"scheduler_priorities",
+		test_scheduler_priorities
+	},
+	{
+		"scheduler_deadlines",
+		test_scheduler_deadlines
+	},
+	{
+		"stats_unanswered",
+		test_stats_unanswered
+	},
+	{
+		"netlink_batch",
+		test_netlink_batch
+	},
+	{
+		"netlink_denied",
+		test_netlink_denied
+	},
+	{
+		"netlink_timeout",
+		test_netlink_timeout
+	},
+	{
+		"gprs_session_activate",
+		test_gprs_session_activate
+	},
+	{
+		"gprs_session_teardown",
+		test_gprs_session_teardown
+	},
+	{
+		"loopback_fmt_requests",
+		test_loopback_fmt_requests
+	},
+	{
+		"loopback_fmt_noti_storm",
+		test_loopback_fmt_noti_storm
+	},
+	{
+		"loopback_rfs_nv_read_burst",
+		test_loopback_rfs_nv_read_burst
+	},
+	{
+		"loopback_threads",
+		test_loopback_threads
+	},
+	{
+		"loopback_submit_threads",
+		test_loopback_submit_threads
+	},
+	{
+		"loopback_uring",
+		test_loopback_uring
+	},
+	{
+		"loopback_uring_backpressure",
+		test_loopback_uring_backpressure
+	},
 };
 
 static void usage(const char *progname)
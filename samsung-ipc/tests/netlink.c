@@ -0,0 +1,328 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+/* linux/netlink.h needs to be included after sys/socket.h */
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <samsung-ipc.h>
+
+/* libsamsung-ipc internal headers */
+#include <ipc.h>
+
+#include "netlink.h"
+
+/*
+ * The test plays the kernel side of the rtnetlink socket: the acks are
+ * queued before the requests are sent, since the client waits for them in
+ * the same thread.
+ */
+
+#define NETLINK_IFACE		"lo"
+#define NETLINK_REQUESTS	4
+
+struct netlink_log {
+	unsigned int denied;
+};
+
+static void netlink_log_callback(void *data, const char *message)
+{
+	struct netlink_log *log = (struct netlink_log *) data;
+
+	if (strstr(message, "rtnetlink denied") != NULL)
+		log->denied++;
+}
+
+int netlink_acks(int fd, unsigned int count, int error)
+{
+	unsigned char buffer[NETLINK_REQUESTS *
+			     NLMSG_SPACE(sizeof(struct nlmsgerr))];
+	struct nlmsghdr *header;
+	struct nlmsgerr *data;
+	unsigned int i;
+
+	if (count > NETLINK_REQUESTS)
+		return -1;
+
+	memset(buffer, 0, sizeof(buffer));
+
+	for (i = 0; i < count; i++) {
+		header = (struct nlmsghdr *) (buffer + i *
+			NLMSG_SPACE(sizeof(struct nlmsgerr)));
+		header->nlmsg_len = NLMSG_LENGTH(sizeof(struct nlmsgerr));
+		header->nlmsg_type = NLMSG_ERROR;
+
+		data = (struct nlmsgerr *) NLMSG_DATA(header);
+		data->error = -error;
+	}
+
+	if (send(fd, buffer, count * NLMSG_SPACE(sizeof(struct nlmsgerr)),
+		 0) < 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Returns the number of requests the kernel side received at once */
+static int netlink_requests(int fd, unsigned short *types,
+			    unsigned int count)
+{
+	unsigned char buffer[4096];
+	struct nlmsghdr *header;
+	unsigned int index = 0;
+	ssize_t length;
+
+	length = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+	if (length < 0)
+		return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+
+	for (header = (struct nlmsghdr *) buffer;
+	     NLMSG_OK(header, (size_t) length);
+	     header = NLMSG_NEXT(header, length)) {
+		if (!(header->nlmsg_flags & NLM_F_ACK))
+			return -1;
+
+		if (index < count)
+			types[index] = header->nlmsg_type;
+
+		index++;
+	}
+
+	return index;
+}
+
+static struct ipc_client *netlink_client_create(int *fd,
+						struct netlink_log *log)
+{
+	struct ipc_client *client;
+
+	client = ipc_client_create(IPC_CLIENT_TYPE_DUMMY);
+	if (client == NULL)
+		return NULL;
+
+	ipc_client_log_callback_register(client, netlink_log_callback, log);
+
+	*fd = ipc_client_netlink_loopback_open(client);
+	if (*fd < 0) {
+		ipc_client_destroy(client);
+		return NULL;
+	}
+
+	return client;
+}
+
+/*
+ * The requests of a batch are only sent on commit, in a single datagram,
+ * while the other requests are sent right away.
+ */
+int test_netlink_batch(struct ipc_client *client)
+{
+	unsigned short types[NETLINK_REQUESTS];
+	struct ipc_client *netlink_client;
+	struct netlink_log log;
+	struct in_addr address;
+	int fd = -1;
+	int rc;
+
+	memset(&log, 0, sizeof(log));
+	inet_pton(AF_INET, "127.0.0.1", &address);
+
+	netlink_client = netlink_client_create(&fd, &log);
+	if (netlink_client == NULL)
+		return -1;
+
+	if (ipc_client_netlink_batch_begin(netlink_client) < 0)
+		goto error;
+
+	if (ipc_client_iface_up(netlink_client, NETLINK_IFACE, AF_INET,
+				SOCK_DGRAM) < 0 ||
+	    ipc_client_iface_address_add(netlink_client, NETLINK_IFACE,
+					 AF_INET, &address, 8) < 0) {
+		ipc_client_log(client, "%s: queuing failed\n", __func__);
+		goto error;
+	}
+
+	if (netlink_requests(fd, types, NETLINK_REQUESTS) != 0) {
+		ipc_client_log(client, "%s: batch sent before commit\n",
+			       __func__);
+		goto error;
+	}
+
+	if (netlink_acks(fd, 2, 0) < 0 ||
+	    ipc_client_netlink_batch_commit(netlink_client) < 0) {
+		ipc_client_log(client, "%s: commit failed\n", __func__);
+		goto error;
+	}
+
+	rc = netlink_requests(fd, types, NETLINK_REQUESTS);
+	if (rc != 2 || types[0] != RTM_NEWLINK || types[1] != RTM_NEWADDR) {
+		ipc_client_log(client, "%s: %d requests committed instead of"
+			       " 2\n", __func__, rc);
+		goto error;
+	}
+
+	/* Outside of the batch, the errors are reported at once */
+	if (netlink_acks(fd, 1, EEXIST) < 0 ||
+	    ipc_client_iface_address_add(netlink_client, NETLINK_IFACE,
+					 AF_INET, &address, 8) != -1 ||
+	    errno != EEXIST) {
+		ipc_client_log(client, "%s: error not reported\n", __func__);
+		goto error;
+	}
+
+	if (netlink_requests(fd, types, NETLINK_REQUESTS) != 1 ||
+	    log.denied != 0) {
+		ipc_client_log(client, "%s: request not sent\n", __func__);
+		goto error;
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	if (fd >= 0)
+		close(fd);
+
+	ipc_client_destroy(netlink_client);
+
+	return rc;
+}
+
+/*
+ * A denied batch is replayed through ioctl, which can't set the addresses,
+ * and rtnetlink isn't used anymore afterwards. Whether the ioctl succeeds
+ * depends on the privileges the test runs with.
+ */
+int test_netlink_denied(struct ipc_client *client)
+{
+	unsigned short types[NETLINK_REQUESTS];
+	struct ipc_client *netlink_client;
+	struct netlink_log log;
+	struct in_addr address;
+	int fd = -1;
+	int rc;
+
+	memset(&log, 0, sizeof(log));
+	inet_pton(AF_INET, "127.0.0.1", &address);
+
+	netlink_client = netlink_client_create(&fd, &log);
+	if (netlink_client == NULL)
+		return -1;
+
+	if (ipc_client_netlink_batch_begin(netlink_client) < 0)
+		goto error;
+
+	if (ipc_client_iface_up(netlink_client, NETLINK_IFACE, AF_INET,
+				SOCK_DGRAM) < 0 ||
+	    ipc_client_iface_address_add(netlink_client, NETLINK_IFACE,
+					 AF_INET, &address, 8) < 0) {
+		ipc_client_log(client, "%s: queuing failed\n", __func__);
+		goto error;
+	}
+
+	if (netlink_acks(fd, 2, EACCES) < 0)
+		goto error;
+
+	if (ipc_client_netlink_batch_commit(netlink_client) != -1 ||
+	    errno != EACCES || log.denied != 1) {
+		ipc_client_log(client, "%s: denied batch not replayed\n",
+			       __func__);
+		goto error;
+	}
+
+	if (netlink_requests(fd, types, NETLINK_REQUESTS) != 2)
+		goto error;
+
+	/* The next requests go through ioctl right away */
+	ipc_client_iface_up(netlink_client, NETLINK_IFACE, AF_INET,
+			    SOCK_DGRAM);
+
+	if (netlink_requests(fd, types, NETLINK_REQUESTS) != 0 ||
+	    ipc_client_netlink_batch_begin(netlink_client) != -1) {
+		ipc_client_log(client, "%s: rtnetlink used after denial\n",
+			       __func__);
+		goto error;
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	if (fd >= 0)
+		close(fd);
+
+	ipc_client_destroy(netlink_client);
+
+	return rc;
+}
+
+/* A request that is never acked fails once the ack timeout is reached */
+int test_netlink_timeout(struct ipc_client *client)
+{
+	unsigned short types[NETLINK_REQUESTS];
+	struct ipc_client *netlink_client;
+	struct netlink_log log;
+	int fd = -1;
+	int rc;
+
+	memset(&log, 0, sizeof(log));
+
+	netlink_client = netlink_client_create(&fd, &log);
+	if (netlink_client == NULL)
+		return -1;
+
+	if (ipc_client_iface_up(netlink_client, NETLINK_IFACE, AF_INET,
+				SOCK_DGRAM) != -1 || errno != ETIMEDOUT) {
+		ipc_client_log(client, "%s: unacked request not timed out\n",
+			       __func__);
+		goto error;
+	}
+
+	if (netlink_requests(fd, types, NETLINK_REQUESTS) != 1 ||
+	    types[0] != RTM_NEWLINK || log.denied != 0) {
+		ipc_client_log(client, "%s: request not sent\n", __func__);
+		goto error;
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	if (fd >= 0)
+		close(fd);
+
+	ipc_client_destroy(netlink_client);
+
+	return rc;
+}
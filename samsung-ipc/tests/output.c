@@ -0,0 +1,432 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <samsung-ipc.h>
+
+#include "output.h"
+
+#define OUTPUT_FRAME_SIZE	0x4000
+#define OUTPUT_FRAMES_MAX	0x100
+#define OUTPUT_WATERMARK	0x8000
+#define OUTPUT_TIMEOUT		50
+
+/*
+ * The modem side of a loopback transport doesn't read until the client
+ * queued frames, so that the sends return IPC_CLIENT_SEND_QUEUED.
+ */
+
+struct output_watermark {
+	size_t queued[4];
+	unsigned int count;
+};
+
+struct output_modem {
+	pthread_t thread;
+	int fd;
+	unsigned int delay;
+	size_t size;
+	int respond;
+	unsigned char *buffer;
+	int rc;
+};
+
+static void output_watermark_callback(void *data, size_t queued)
+{
+	struct output_watermark *watermark = (struct output_watermark *) data;
+
+	if (watermark->count < 4)
+		watermark->queued[watermark->count] = queued;
+
+	watermark->count++;
+}
+
+static uint64_t output_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static struct ipc_client *output_client_create(
+	int *fd, struct output_watermark *watermark)
+{
+	struct ipc_client *client;
+
+	client = ipc_client_create(IPC_CLIENT_TYPE_FMT);
+	if (client == NULL)
+		return NULL;
+
+	*fd = ipc_client_loopback_open(client);
+	if (*fd < 0)
+		goto error;
+
+	if (ipc_client_output_enable(client, OUTPUT_WATERMARK,
+				     output_watermark_callback,
+				     watermark) < 0) {
+		close(*fd);
+		goto error;
+	}
+
+	return client;
+
+error:
+	ipc_client_destroy(client);
+
+	return NULL;
+}
+
+/* Sends until the transport is full, then the given count of frames */
+static int output_fill(struct ipc_client *client, unsigned char *data,
+		       unsigned int extra, size_t *size)
+{
+	unsigned int count = 0;
+	unsigned int queued = 0;
+	int rc;
+
+	*size = 0;
+
+	while (count < OUTPUT_FRAMES_MAX && queued <= extra) {
+		memset(data, count, OUTPUT_FRAME_SIZE);
+
+		rc = ipc_client_send(client, count, IPC_MISC_ME_SN,
+				     IPC_TYPE_GET, data, OUTPUT_FRAME_SIZE);
+		if (rc < 0)
+			return -1;
+
+		/* Once something is queued, nothing is written directly */
+		if (queued > 0 && rc != IPC_CLIENT_SEND_QUEUED)
+			return -1;
+
+		if (rc == IPC_CLIENT_SEND_QUEUED)
+			queued++;
+
+		*size += sizeof(struct ipc_fmt_header) + OUTPUT_FRAME_SIZE;
+		count++;
+	}
+
+	if (queued <= extra)
+		return -1;
+
+	return count;
+}
+
+/* The frames must arrive whole and in the order they were sent */
+static int output_frames_check(const unsigned char *buffer, size_t size,
+			       unsigned int count)
+{
+	const struct ipc_fmt_header *header;
+	size_t offset = 0;
+	unsigned int i;
+	size_t j;
+
+	for (i = 0; i < count; i++) {
+		if (offset + sizeof(struct ipc_fmt_header) > size)
+			return -1;
+
+		header = (const struct ipc_fmt_header *) (buffer + offset);
+		if (header->length !=
+		    sizeof(struct ipc_fmt_header) + OUTPUT_FRAME_SIZE ||
+		    header->mseq != (i & 0xff) ||
+		    offset + header->length > size) {
+			return -1;
+		}
+
+		offset += sizeof(struct ipc_fmt_header);
+
+		for (j = 0; j < OUTPUT_FRAME_SIZE; j++) {
+			if (buffer[offset + j] != (i & 0xff))
+				return -1;
+		}
+
+		offset += OUTPUT_FRAME_SIZE;
+	}
+
+	return offset == size ? 0 : -1;
+}
+
+static int output_read(int fd, unsigned char *buffer, size_t size)
+{
+	size_t count = 0;
+	ssize_t rc;
+
+	while (count < size) {
+		rc = read(fd, buffer + count, size - count);
+		if (rc <= 0)
+			return -1;
+
+		count += rc;
+	}
+
+	return 0;
+}
+
+/* Reads everything after a delay, then answers when asked to */
+static void *output_modem_run(void *data)
+{
+	struct output_modem *modem = (struct output_modem *) data;
+	struct ipc_fmt_header header;
+	struct ipc_message message;
+	struct timespec delay;
+
+	modem->rc = -1;
+
+	delay.tv_sec = 0;
+	delay.tv_nsec = modem->delay * 1000000L;
+	nanosleep(&delay, NULL);
+
+	if (output_read(modem->fd, modem->buffer, modem->size) < 0)
+		return NULL;
+
+	if (modem->respond) {
+		memset(&message, 0, sizeof(message));
+		message.command = IPC_MISC_ME_SN;
+		message.type = IPC_TYPE_RESP;
+
+		ipc_fmt_header_setup(&header, &message);
+
+		if (write(modem->fd, &header, sizeof(header)) !=
+		    sizeof(header))
+			return NULL;
+	}
+
+	modem->rc = 0;
+
+	return NULL;
+}
+
+/*
+ * What the transport doesn't accept is queued in order, behind the frames
+ * already queued, and the watermark callback tells when the queue goes
+ * above the high watermark and back below it.
+ */
+int test_output_queue(struct ipc_client *client)
+{
+	struct output_watermark watermark;
+	struct ipc_client *fmt_client;
+	unsigned char *buffer = NULL;
+	unsigned char *data = NULL;
+	size_t received = 0;
+	size_t size;
+	ssize_t length;
+	int count;
+	int fd;
+	int rc;
+
+	memset(&watermark, 0, sizeof(watermark));
+
+	fmt_client = output_client_create(&fd, &watermark);
+	if (fmt_client == NULL)
+		return -1;
+
+	data = malloc(OUTPUT_FRAME_SIZE);
+	if (data == NULL)
+		goto error;
+
+	count = output_fill(fmt_client, data, 3, &size);
+	if (count < 0) {
+		ipc_client_log(client, "%s: sends not queued\n", __func__);
+		goto error;
+	}
+
+	if (ipc_client_output_pending(fmt_client) < 3 * OUTPUT_FRAME_SIZE ||
+	    watermark.count != 1 || watermark.queued[0] < OUTPUT_WATERMARK) {
+		ipc_client_log(client, "%s: %zu bytes queued, %u watermark"
+			       " calls\n", __func__,
+			       ipc_client_output_pending(fmt_client),
+			       watermark.count);
+		goto error;
+	}
+
+	buffer = malloc(size);
+	if (buffer == NULL)
+		goto error;
+
+	/* The modem reads as the queue is flushed */
+	while (received < size) {
+		rc = ipc_client_output_flush(fmt_client);
+		if (rc < 0)
+			goto error;
+
+		length = recv(fd, buffer + received, size - received,
+			      MSG_DONTWAIT);
+		if (length <= 0) {
+			ipc_client_log(client, "%s: queue stalled\n",
+				       __func__);
+			goto error;
+		}
+
+		received += length;
+	}
+
+	if (ipc_client_output_flush(fmt_client) != 0 ||
+	    ipc_client_output_pending(fmt_client) != 0 ||
+	    output_frames_check(buffer, size, count) < 0) {
+		ipc_client_log(client, "%s: queued frames corrupted\n",
+			       __func__);
+		goto error;
+	}
+
+	if (watermark.count != 2 || watermark.queued[1] >= OUTPUT_WATERMARK) {
+		ipc_client_log(client, "%s: %u watermark calls\n", __func__,
+			       watermark.count);
+		goto error;
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	if (buffer != NULL)
+		free(buffer);
+
+	if (data != NULL)
+		free(data);
+
+	close(fd);
+	ipc_client_destroy(fmt_client);
+
+	return rc;
+}
+
+/*
+ * Polling flushes the queue when the transport becomes writable, which
+ * isn't a timeout: the poll only returns when there is input, or when the
+ * timeout expired.
+ */
+int test_output_poll(struct ipc_client *client)
+{
+	struct output_watermark watermark;
+	struct output_modem modem;
+	struct ipc_client *fmt_client;
+	struct ipc_message message;
+	struct timeval timeout;
+	unsigned char *data = NULL;
+	uint64_t elapsed;
+	uint64_t start;
+	unsigned int i;
+	size_t size;
+	int count;
+	int fd;
+	int rc;
+
+	memset(&watermark, 0, sizeof(watermark));
+	memset(&modem, 0, sizeof(modem));
+
+	fmt_client = output_client_create(&fd, &watermark);
+	if (fmt_client == NULL)
+		return -1;
+
+	data = malloc(OUTPUT_FRAME_SIZE);
+	if (data == NULL)
+		goto error;
+
+	for (i = 0; i < 2; i++) {
+		count = output_fill(fmt_client, data, 1, &size);
+		if (count < 0)
+			goto error;
+
+		modem.buffer = malloc(size);
+		if (modem.buffer == NULL)
+			goto error;
+
+		modem.fd = fd;
+		modem.delay = OUTPUT_TIMEOUT / 5;
+		modem.size = size;
+		modem.respond = i;
+
+		if (pthread_create(&modem.thread, NULL, output_modem_run,
+				   &modem) != 0) {
+			free(modem.buffer);
+			goto error;
+		}
+
+		timeout.tv_sec = 0;
+		timeout.tv_usec = OUTPUT_TIMEOUT * 1000;
+
+		start = output_now();
+		rc = ipc_client_poll(fmt_client, NULL, &timeout);
+		elapsed = output_now() - start;
+
+		pthread_join(modem.thread, NULL);
+
+		if (modem.rc == 0 &&
+		    output_frames_check(modem.buffer, size, count) < 0)
+			modem.rc = -1;
+
+		free(modem.buffer);
+
+		if (modem.rc < 0 || ipc_client_output_pending(fmt_client)) {
+			ipc_client_log(client, "%s: queue not flushed\n",
+				       __func__);
+			goto error;
+		}
+
+		/* Without input, only the timeout ends the poll */
+		if (i == 0 && (rc != 0 || elapsed < OUTPUT_TIMEOUT)) {
+			ipc_client_log(client, "%s: poll returned %d after"
+				       " %llu ms without input\n", __func__,
+				       rc, (unsigned long long) elapsed);
+			goto error;
+		}
+
+		if (i == 1 && rc <= 0) {
+			ipc_client_log(client, "%s: input not polled\n",
+				       __func__);
+			goto error;
+		}
+	}
+
+	memset(&message, 0, sizeof(message));
+
+	if (ipc_client_recv(fmt_client, &message) < 0 ||
+	    message.command != IPC_MISC_ME_SN) {
+		ipc_client_log(client, "%s: response not received\n",
+			       __func__);
+		goto error;
+	}
+
+	if (message.data != NULL)
+		free(message.data);
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	if (data != NULL)
+		free(data);
+
+	close(fd);
+	ipc_client_destroy(fmt_client);
+
+	return rc;
+}
@@ -0,0 +1,407 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <samsung-ipc.h>
+
+#include "recv.h"
+
+#define RECV_TIMEOUT		30
+#define RECV_SIGNALS		4
+
+/*
+ * The frames are written on the modem side of a loopback transport in
+ * pieces, so that ipc_client_recv gets them across several reads.
+ */
+
+struct recv_writer {
+	pthread_t thread;
+	pthread_t reader;
+	int fd;
+	const unsigned char *data;
+	size_t size;
+	unsigned int signals;
+	int rc;
+};
+
+static volatile sig_atomic_t recv_interrupted;
+
+static void recv_signal_handler(__attribute__((unused)) int signal)
+{
+	recv_interrupted++;
+}
+
+static uint64_t recv_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void recv_sleep(unsigned int ms)
+{
+	struct timespec delay;
+
+	delay.tv_sec = ms / 1000;
+	delay.tv_nsec = (ms % 1000) * 1000000L;
+
+	nanosleep(&delay, NULL);
+}
+
+/* The data of each frame is its mseq repeated */
+static size_t recv_frame_setup(unsigned char *buffer, unsigned char mseq,
+			       size_t size)
+{
+	struct ipc_fmt_header header;
+	struct ipc_message message;
+
+	memset(&message, 0, sizeof(message));
+	message.mseq = mseq;
+	message.command = IPC_MISC_ME_SN;
+	message.type = IPC_TYPE_RESP;
+	message.size = size;
+
+	ipc_fmt_header_setup(&header, &message);
+
+	memcpy(buffer, &header, sizeof(header));
+	memset(buffer + sizeof(header), mseq, size);
+
+	return sizeof(header) + size;
+}
+
+static int recv_frame_check(struct ipc_client *client, unsigned char mseq,
+			    size_t size, const struct timespec *deadline)
+{
+	struct ipc_message message;
+	unsigned char *data;
+	size_t i;
+	int rc;
+
+	memset(&message, 0, sizeof(message));
+
+	rc = ipc_client_recv_deadline(client, &message, deadline);
+	if (rc != 0)
+		return -1;
+
+	data = (unsigned char *) message.data;
+
+	if (message.mseq != mseq || message.command != IPC_MISC_ME_SN ||
+	    message.size != size)
+		rc = -1;
+
+	for (i = 0; rc == 0 && i < message.size; i++) {
+		if (data[i] != mseq)
+			rc = -1;
+	}
+
+	if (message.data != NULL)
+		free(message.data);
+
+	return rc;
+}
+
+static int recv_timeout_check(struct ipc_client *client, unsigned int timeout)
+{
+	struct ipc_message message;
+	struct timespec deadline;
+	int rc;
+
+	memset(&message, 0, sizeof(message));
+
+	ipc_client_deadline_set(&deadline, timeout);
+
+	rc = ipc_client_recv_deadline(client, &message, &deadline);
+	if (message.data != NULL)
+		free(message.data);
+
+	return rc == IPC_CLIENT_RECV_TIMEOUT ? 0 : -1;
+}
+
+/* Interrupts the reader, then writes the data while it waits */
+static void *recv_writer_run(void *data)
+{
+	struct recv_writer *writer = (struct recv_writer *) data;
+	unsigned int i;
+
+	writer->rc = -1;
+
+	for (i = 0; i < writer->signals; i++) {
+		recv_sleep(RECV_TIMEOUT / (writer->signals + 1));
+
+		if (pthread_kill(writer->reader, SIGUSR1) != 0)
+			return NULL;
+	}
+
+	recv_sleep(RECV_TIMEOUT / (writer->signals + 1));
+
+	if (writer->size > 0 &&
+	    write(writer->fd, writer->data, writer->size) !=
+	    (ssize_t) writer->size) {
+		return NULL;
+	}
+
+	writer->rc = 0;
+
+	return NULL;
+}
+
+static int recv_writer_start(struct recv_writer *writer, int fd,
+			     const unsigned char *data, size_t size,
+			     unsigned int signals)
+{
+	memset(writer, 0, sizeof(struct recv_writer));
+	writer->reader = pthread_self();
+	writer->fd = fd;
+	writer->data = data;
+	writer->size = size;
+	writer->signals = signals;
+
+	return pthread_create(&writer->thread, NULL, recv_writer_run, writer);
+}
+
+static struct ipc_client *recv_client_create(int *fd,
+					     struct sigaction *previous)
+{
+	struct ipc_client *client;
+	struct sigaction action;
+
+	client = ipc_client_create(IPC_CLIENT_TYPE_FMT);
+	if (client == NULL)
+		return NULL;
+
+	*fd = ipc_client_loopback_open(client);
+	if (*fd < 0)
+		goto error;
+
+	/* Without SA_RESTART, so that the signals interrupt the waits */
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = recv_signal_handler;
+	sigemptyset(&action.sa_mask);
+
+	if (sigaction(SIGUSR1, &action, previous) < 0) {
+		close(*fd);
+		goto error;
+	}
+
+	recv_interrupted = 0;
+
+	return client;
+
+error:
+	ipc_client_destroy(client);
+
+	return NULL;
+}
+
+static void recv_client_destroy(struct ipc_client *client, int fd,
+				struct sigaction *previous)
+{
+	sigaction(SIGUSR1, previous, NULL);
+
+	close(fd);
+	ipc_client_destroy(client);
+}
+
+/*
+ * A frame that arrives in pieces is only handed out once complete, the
+ * bytes of the next frames that came with it are kept, and the partial
+ * frame survives the receives that timed out.
+ */
+int test_recv_split(struct ipc_client *client)
+{
+	struct ipc_client_counters counters;
+	struct sigaction previous;
+	struct ipc_client *fmt_client;
+	struct recv_writer writer;
+	struct timespec deadline;
+	unsigned char buffer[0x2000];
+	size_t sizes[3] = { 64, 8, 0x1800 };
+	size_t offsets[4];
+	size_t size = 0;
+	unsigned int i;
+	int fd;
+	int rc;
+
+	for (i = 0; i < 3; i++) {
+		offsets[i] = size;
+		size += recv_frame_setup(buffer + size, i + 1, sizes[i]);
+	}
+
+	offsets[3] = size;
+
+	fmt_client = recv_client_create(&fd, &previous);
+	if (fmt_client == NULL)
+		return -1;
+
+	/* Part of the header, then the rest of it and part of the data */
+	if (write(fd, buffer, 3) != 3 ||
+	    recv_timeout_check(fmt_client, 0) < 0 ||
+	    write(fd, buffer + 3, 20) != 20 ||
+	    recv_timeout_check(fmt_client, 0) < 0) {
+		ipc_client_log(client, "%s: partial frame handed out\n",
+			       __func__);
+		goto error;
+	}
+
+	/* The end of the first frame comes with the second and a bit more */
+	if (write(fd, buffer + 23, offsets[2] + 5 - 23) !=
+	    (ssize_t) (offsets[2] + 5 - 23) ||
+	    recv_frame_check(fmt_client, 1, sizes[0], NULL) < 0 ||
+	    recv_frame_check(fmt_client, 2, sizes[1], NULL) < 0) {
+		ipc_client_log(client, "%s: reassembled frames corrupted\n",
+			       __func__);
+		goto error;
+	}
+
+	if (recv_timeout_check(fmt_client, 0) < 0) {
+		ipc_client_log(client, "%s: partial frame handed out\n",
+			       __func__);
+		goto error;
+	}
+
+	/* The rest of the last frame, larger than a read, comes later */
+	if (recv_writer_start(&writer, fd, buffer + offsets[2] + 5,
+			      offsets[3] - offsets[2] - 5, 0) != 0)
+		goto error;
+
+	ipc_client_deadline_set(&deadline, RECV_TIMEOUT * 100);
+
+	rc = recv_frame_check(fmt_client, 3, sizes[2], &deadline);
+
+	pthread_join(writer.thread, NULL);
+
+	if (rc < 0 || writer.rc < 0) {
+		ipc_client_log(client, "%s: frame completed while waiting"
+			       " corrupted\n", __func__);
+		goto error;
+	}
+
+	ipc_client_counters_get(fmt_client, &counters);
+
+	if (counters.frames_in != 3 || counters.bytes_in != offsets[3] ||
+	    counters.partial_reads < 3) {
+		ipc_client_log(client, "%s: wrong counters: %llu frames, %llu"
+			       " bytes, %llu partial reads\n", __func__,
+			       counters.frames_in, counters.bytes_in,
+			       counters.partial_reads);
+		goto error;
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	recv_client_destroy(fmt_client, fd, &previous);
+
+	return rc;
+}
+
+/*
+ * A receive waits until its deadline and no longer, even when signals
+ * interrupt the wait, and a frame that completes after being interrupted is
+ * still received.
+ */
+int test_recv_deadline(struct ipc_client *client)
+{
+	unsigned char buffer[sizeof(struct ipc_fmt_header) + 16];
+	struct sigaction previous;
+	struct ipc_client *fmt_client;
+	struct recv_writer writer;
+	struct timespec deadline;
+	uint64_t start;
+	uint64_t elapsed;
+	size_t size;
+	int fd;
+	int rc;
+
+	size = recv_frame_setup(buffer, 1, 16);
+
+	fmt_client = recv_client_create(&fd, &previous);
+	if (fmt_client == NULL)
+		return -1;
+
+	/* An expired deadline only takes what is already there */
+	start = recv_now();
+
+	if (recv_timeout_check(fmt_client, 0) < 0 ||
+	    recv_now() - start >= RECV_TIMEOUT) {
+		ipc_client_log(client, "%s: expired deadline waited\n",
+			       __func__);
+		goto error;
+	}
+
+	/* Nothing comes, and the wait is interrupted */
+	if (recv_writer_start(&writer, fd, NULL, 0, RECV_SIGNALS) != 0)
+		goto error;
+
+	start = recv_now();
+
+	rc = recv_timeout_check(fmt_client, RECV_TIMEOUT * 2);
+	elapsed = recv_now() - start;
+
+	pthread_join(writer.thread, NULL);
+
+	if (rc < 0 || writer.rc < 0 || recv_interrupted != RECV_SIGNALS ||
+	    elapsed < RECV_TIMEOUT * 2 || elapsed >= RECV_TIMEOUT * 100) {
+		ipc_client_log(client, "%s: deadline missed: %llu ms, %d"
+			       " signals\n", __func__,
+			       (unsigned long long) elapsed,
+			       (int) recv_interrupted);
+		goto error;
+	}
+
+	/* Half a frame comes, then the rest while the wait is interrupted */
+	if (write(fd, buffer, size / 2) != (ssize_t) (size / 2) ||
+	    recv_writer_start(&writer, fd, buffer + size / 2,
+			      size - size / 2, RECV_SIGNALS) != 0)
+		goto error;
+
+	ipc_client_deadline_set(&deadline, RECV_TIMEOUT * 100);
+
+	rc = recv_frame_check(fmt_client, 1, 16, &deadline);
+
+	pthread_join(writer.thread, NULL);
+
+	if (rc < 0 || writer.rc < 0 || recv_interrupted != RECV_SIGNALS * 2) {
+		ipc_client_log(client, "%s: interrupted frame lost\n",
+			       __func__);
+		goto error;
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	recv_client_destroy(fmt_client, fd, &previous);
+
+	return rc;
+}
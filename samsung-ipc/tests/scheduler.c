@@ -0,0 +1,309 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <samsung-ipc.h>
+
+#include "scheduler.h"
+
+#define SCHEDULER_TIMEOUT	20
+
+static struct ipc_client *scheduler_client_create(int *fd,
+						  const unsigned int *limits,
+						  unsigned int timeout)
+{
+	struct ipc_client *client;
+
+	client = ipc_client_create(IPC_CLIENT_TYPE_FMT);
+	if (client == NULL)
+		return NULL;
+
+	*fd = ipc_client_loopback_open(client);
+	if (*fd < 0)
+		goto error;
+
+	if (ipc_client_scheduler_enable(client, limits, timeout) < 0) {
+		close(*fd);
+		goto error;
+	}
+
+	return client;
+
+error:
+	ipc_client_destroy(client);
+
+	return NULL;
+}
+
+/* Returns the number of frames the modem side received, in order */
+static int scheduler_sent(int fd, unsigned char *mseqs, unsigned int count)
+{
+	const struct ipc_fmt_header *header;
+	unsigned char buffer[0x1000];
+	unsigned int sent = 0;
+	size_t offset = 0;
+	ssize_t length;
+
+	length = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+	if (length <= 0)
+		return 0;
+
+	while (offset + sizeof(struct ipc_fmt_header) <= (size_t) length) {
+		header = (const struct ipc_fmt_header *) (buffer + offset);
+		if (header->length < sizeof(struct ipc_fmt_header))
+			return -1;
+
+		if (sent < count)
+			mseqs[sent] = header->mseq;
+
+		sent++;
+		offset += header->length;
+	}
+
+	return sent;
+}
+
+/* The modem answers the request with the given sequence */
+static int scheduler_response(struct ipc_client *client, int fd,
+			      unsigned short command, unsigned char aseq)
+{
+	struct ipc_fmt_header header;
+	struct ipc_message message;
+	int rc;
+
+	memset(&message, 0, sizeof(message));
+	message.aseq = aseq;
+	message.command = command;
+	message.type = IPC_TYPE_RESP;
+
+	ipc_fmt_header_setup(&header, &message);
+
+	if (write(fd, &header, sizeof(header)) != sizeof(header))
+		return -1;
+
+	memset(&message, 0, sizeof(message));
+
+	rc = ipc_client_recv(client, &message);
+	if (rc < 0)
+		return -1;
+
+	if (message.data != NULL)
+		free(message.data);
+
+	if (message.aseq != aseq)
+		return -1;
+
+	return 0;
+}
+
+/*
+ * The queues are drained highest priority first, and a class that reached
+ * its limit of outstanding requests only holds back its own requests until
+ * one of them gets its response.
+ */
+int test_scheduler_priorities(struct ipc_client *client)
+{
+	const struct {
+		unsigned char mseq;
+		unsigned short command;
+		unsigned char type;
+	} requests[] = {
+		{ 1, IPC_MISC_ME_VERSION, IPC_TYPE_GET },
+		{ 2, IPC_NET_REGIST, IPC_TYPE_GET },
+		{ 3, IPC_CALL_OUTGOING, IPC_TYPE_EXEC },
+		{ 4, IPC_SEC_PIN_STATUS, IPC_TYPE_GET },
+		{ 5, IPC_CALL_LIST, IPC_TYPE_GET },
+		{ 6, IPC_MISC_ME_VERSION, IPC_TYPE_GET },
+	};
+	const unsigned char order[] = { 3, 4, 2, 1, 6 };
+	const unsigned int limits[IPC_CLIENT_PRIORITY_COUNT] = { 1, 0, 0, 0 };
+	struct ipc_client_scheduler_stats stats;
+	struct ipc_client *fmt_client;
+	unsigned char mseqs[8];
+	unsigned int i;
+	int fd;
+	int rc;
+
+	fmt_client = scheduler_client_create(&fd, limits, 0);
+	if (fmt_client == NULL)
+		return -1;
+
+	for (i = 0; i < sizeof(requests) / sizeof(requests[0]); i++) {
+		rc = ipc_client_queue(fmt_client, requests[i].mseq,
+				      requests[i].command, requests[i].type,
+				      NULL, 0);
+		if (rc < 0)
+			goto error;
+	}
+
+	/* Nothing is sent before draining */
+	if (scheduler_sent(fd, mseqs, sizeof(mseqs)) != 0) {
+		ipc_client_log(client, "%s: queued request sent\n", __func__);
+		goto error;
+	}
+
+	rc = ipc_client_scheduler_drain(fmt_client);
+	if (rc != sizeof(order) ||
+	    scheduler_sent(fd, mseqs, sizeof(mseqs)) != sizeof(order) ||
+	    memcmp(mseqs, order, sizeof(order))) {
+		ipc_client_log(client, "%s: wrong drain order\n", __func__);
+		goto error;
+	}
+
+	ipc_client_scheduler_stats_get(fmt_client, IPC_CLIENT_PRIORITY_CALL,
+				       &stats);
+
+	if (stats.queued != 1 || stats.outstanding != 1 || stats.sent != 1) {
+		ipc_client_log(client, "%s: call class not held back\n",
+			       __func__);
+		goto error;
+	}
+
+	/* Nothing changed: the call class is still full */
+	if (ipc_client_scheduler_drain(fmt_client) != 0 ||
+	    scheduler_response(fmt_client, fd, IPC_NET_REGIST, 2) < 0 ||
+	    ipc_client_scheduler_drain(fmt_client) != 0) {
+		ipc_client_log(client, "%s: call class limit exceeded\n",
+			       __func__);
+		goto error;
+	}
+
+	if (scheduler_response(fmt_client, fd, IPC_CALL_OUTGOING, 3) < 0 ||
+	    ipc_client_scheduler_drain(fmt_client) != 1 ||
+	    scheduler_sent(fd, mseqs, sizeof(mseqs)) != 1 || mseqs[0] != 5) {
+		ipc_client_log(client, "%s: response didn't release the call"
+			       " class\n", __func__);
+		goto error;
+	}
+
+	ipc_client_scheduler_stats_get(fmt_client, IPC_CLIENT_PRIORITY_CALL,
+				       &stats);
+
+	if (stats.queued != 0 || stats.outstanding != 1 || stats.sent != 2 ||
+	    stats.expired != 0) {
+		ipc_client_log(client, "%s: wrong call class stats\n",
+			       __func__);
+		goto error;
+	}
+
+	ipc_client_scheduler_stats_get(fmt_client, IPC_CLIENT_PRIORITY_NET,
+				       &stats);
+
+	if (stats.queued != 0 || stats.outstanding != 0 || stats.sent != 1) {
+		ipc_client_log(client, "%s: wrong net class stats\n",
+			       __func__);
+		goto error;
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	close(fd);
+	ipc_client_destroy(fmt_client);
+
+	return rc;
+}
+
+/*
+ * A request without response stops being outstanding once the timeout
+ * expired, which lets the next request of its class go, and the time spent
+ * in the queue is accounted for.
+ */
+int test_scheduler_deadlines(struct ipc_client *client)
+{
+	const unsigned int limits[IPC_CLIENT_PRIORITY_COUNT] = { 1, 0, 0, 0 };
+	struct ipc_client_scheduler_stats stats;
+	struct ipc_client *fmt_client;
+	struct timespec delay;
+	unsigned char mseqs[4];
+	int fd;
+	int rc;
+
+	fmt_client = scheduler_client_create(&fd, limits, SCHEDULER_TIMEOUT);
+	if (fmt_client == NULL)
+		return -1;
+
+	if (ipc_client_queue(fmt_client, 1, IPC_CALL_OUTGOING, IPC_TYPE_EXEC,
+			     NULL, 0) < 0 ||
+	    ipc_client_queue(fmt_client, 2, IPC_CALL_LIST, IPC_TYPE_GET,
+			     NULL, 0) < 0) {
+		goto error;
+	}
+
+	if (ipc_client_scheduler_drain(fmt_client) != 1 ||
+	    ipc_client_scheduler_drain(fmt_client) != 0 ||
+	    scheduler_sent(fd, mseqs, sizeof(mseqs)) != 1 || mseqs[0] != 1) {
+		ipc_client_log(client, "%s: call class limit exceeded\n",
+			       __func__);
+		goto error;
+	}
+
+	delay.tv_sec = 0;
+	delay.tv_nsec = SCHEDULER_TIMEOUT * 2 * 1000000L;
+	nanosleep(&delay, NULL);
+
+	if (ipc_client_scheduler_drain(fmt_client) != 1 ||
+	    scheduler_sent(fd, mseqs, sizeof(mseqs)) != 1 || mseqs[0] != 2) {
+		ipc_client_log(client, "%s: request didn't time out\n",
+			       __func__);
+		goto error;
+	}
+
+	ipc_client_scheduler_stats_get(fmt_client, IPC_CLIENT_PRIORITY_CALL,
+				       &stats);
+
+	if (stats.expired != 1 || stats.outstanding != 1 || stats.sent != 2 ||
+	    stats.delay_max < SCHEDULER_TIMEOUT * 1000) {
+		ipc_client_log(client, "%s: wrong stats: %lu expired, %u"
+			       " outstanding, %llu us max delay\n", __func__,
+			       stats.expired, stats.outstanding,
+			       stats.delay_max);
+		goto error;
+	}
+
+	/* A late response to the expired request doesn't release anything */
+	if (scheduler_response(fmt_client, fd, IPC_CALL_OUTGOING, 1) < 0 ||
+	    ipc_client_scheduler_stats_get(fmt_client,
+					   IPC_CLIENT_PRIORITY_CALL,
+					   &stats) < 0 ||
+	    stats.outstanding != 1) {
+		ipc_client_log(client, "%s: late response released a"
+			       " request\n", __func__);
+		goto error;
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	close(fd);
+	ipc_client_destroy(fmt_client);
+
+	return rc;
+}
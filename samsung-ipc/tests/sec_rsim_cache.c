@@ -0,0 +1,577 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <samsung-ipc.h>
+
+#include "sec_rsim_cache.h"
+
+#define RSIM_CACHE_RESPONSES	8
+#define RSIM_CACHE_TIMEOUT	10000
+
+#define RSIM_EF_ICCID		0x2FE2
+#define RSIM_EF_AD		0x6FAD
+#define RSIM_EF_SPN		0x6F46
+#define RSIM_EF_MSISDN		0x6F40
+
+struct rsim_cache_responses {
+	unsigned char mseqs[RSIM_CACHE_RESPONSES];
+	unsigned char sw1[RSIM_CACHE_RESPONSES];
+	unsigned int count;
+};
+
+static void rsim_cache_callback(void *data, unsigned char mseq,
+				const void *response, size_t response_size)
+{
+	struct rsim_cache_responses *responses =
+		(struct rsim_cache_responses *) data;
+	const struct ipc_sec_rsim_access_response_header *header;
+
+	if (responses->count >= RSIM_CACHE_RESPONSES)
+		return;
+
+	header = (const struct ipc_sec_rsim_access_response_header *)
+		response;
+
+	responses->mseqs[responses->count] = mseq;
+	responses->sw1[responses->count] = header != NULL ? header->sw1 : 0;
+	responses->count++;
+}
+
+static struct ipc_client *rsim_cache_client_create(int *fd)
+{
+	struct ipc_client *client;
+
+	client = ipc_client_create(IPC_CLIENT_TYPE_FMT);
+	if (client == NULL)
+		return NULL;
+
+	*fd = ipc_client_loopback_open(client);
+	if (*fd < 0) {
+		ipc_client_destroy(client);
+		return NULL;
+	}
+
+	return client;
+}
+
+/* Returns the number of IPC_SEC_RSIM_ACCESS frames the modem received */
+static int rsim_cache_sent(int fd)
+{
+	const struct ipc_fmt_header *header;
+	unsigned char buffer[0x1000];
+	unsigned int sent = 0;
+	size_t offset = 0;
+	ssize_t length;
+
+	length = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+	if (length <= 0)
+		return 0;
+
+	while (offset + sizeof(struct ipc_fmt_header) <= (size_t) length) {
+		header = (const struct ipc_fmt_header *) (buffer + offset);
+		if (header->length < sizeof(struct ipc_fmt_header))
+			return -1;
+
+		if (IPC_COMMAND(header->group, header->index) ==
+		    IPC_SEC_RSIM_ACCESS) {
+			sent++;
+		}
+
+		offset += header->length;
+	}
+
+	return sent;
+}
+
+static int rsim_cache_read(struct ipc_sec_rsim_cache *cache,
+			   unsigned char mseq, unsigned short file_id)
+{
+	struct ipc_sec_rsim_access_request_header header;
+
+	memset(&header, 0, sizeof(header));
+	header.command = IPC_SEC_RSIM_COMMAND_READ_BINARY;
+	header.file_id = file_id;
+	header.p3 = 4;
+
+	return ipc_sec_rsim_cache_request(cache, mseq, &header, NULL, 0);
+}
+
+static int rsim_cache_update(struct ipc_sec_rsim_cache *cache,
+			     unsigned char mseq, unsigned short file_id)
+{
+	struct ipc_sec_rsim_access_request_header header;
+	unsigned char data[] = { 0x00, 0x00, 0x01, 0x02 };
+
+	memset(&header, 0, sizeof(header));
+	header.command = IPC_SEC_RSIM_COMMAND_UPDATE_BINARY;
+	header.file_id = file_id;
+	header.p3 = sizeof(data);
+
+	return ipc_sec_rsim_cache_request(cache, mseq, &header, data,
+					  sizeof(data));
+}
+
+static int rsim_cache_response(struct ipc_sec_rsim_cache *cache,
+			       unsigned char aseq, unsigned char sw1,
+			       unsigned char content)
+{
+	struct ipc_sec_rsim_access_response_header *header;
+	unsigned char buffer[sizeof(*header) + 4];
+	struct ipc_message message;
+
+	header = (struct ipc_sec_rsim_access_response_header *) buffer;
+	header->sw1 = sw1;
+	header->sw2 = 0x00;
+	header->length = sizeof(buffer) - sizeof(*header);
+	memset(buffer + sizeof(*header), content, header->length);
+
+	memset(&message, 0, sizeof(message));
+	message.aseq = aseq;
+	message.command = IPC_SEC_RSIM_ACCESS;
+	message.type = IPC_TYPE_RESP;
+	message.data = buffer;
+	message.size = sizeof(buffer);
+
+	return ipc_sec_rsim_cache_handle(cache, &message);
+}
+
+/*
+ * A miss is sent once for every identical request, the response is then
+ * served from the cache, and the least recently used file is evicted when
+ * the cache is full. EF ICCID is never served from the cache.
+ */
+int test_sec_rsim_cache_hits(struct ipc_client *client)
+{
+	struct ipc_sec_rsim_cache_stats stats;
+	struct ipc_sec_rsim_cache *cache = NULL;
+	struct rsim_cache_responses responses;
+	struct ipc_client *fmt_client;
+	int fd = -1;
+	int rc;
+
+	memset(&responses, 0, sizeof(responses));
+
+	fmt_client = rsim_cache_client_create(&fd);
+	if (fmt_client == NULL)
+		return -1;
+
+	cache = ipc_sec_rsim_cache_create(fmt_client, 2,
+					  RSIM_CACHE_TIMEOUT,
+					  rsim_cache_callback, &responses);
+	if (cache == NULL)
+		goto error;
+
+	if (rsim_cache_read(cache, 1, RSIM_EF_AD) !=
+	    IPC_SEC_RSIM_CACHE_SENT ||
+	    rsim_cache_read(cache, 2, RSIM_EF_AD) !=
+	    IPC_SEC_RSIM_CACHE_JOINED) {
+		ipc_client_log(client, "%s: miss not joined\n", __func__);
+		goto error;
+	}
+
+	rc = rsim_cache_sent(fd);
+	if (rc != 1) {
+		ipc_client_log(client, "%s: %d requests sent instead of 1\n",
+			       __func__, rc);
+		goto error;
+	}
+
+	if (rsim_cache_response(cache, 1, 0x90, 0xAD) != 1 ||
+	    responses.count != 2 || responses.mseqs[0] != 1 ||
+	    responses.mseqs[1] != 2) {
+		ipc_client_log(client, "%s: response not given to every"
+			       " requester\n", __func__);
+		goto error;
+	}
+
+	/* A response that belongs to no request isn't consumed */
+	if (rsim_cache_response(cache, 1, 0x90, 0xAD) != 0) {
+		ipc_client_log(client, "%s: unknown response consumed\n",
+			       __func__);
+		goto error;
+	}
+
+	if (rsim_cache_read(cache, 3, RSIM_EF_AD) != IPC_SEC_RSIM_CACHE_HIT ||
+	    responses.count != 3 || responses.mseqs[2] != 3 ||
+	    responses.sw1[2] != 0x90 || rsim_cache_sent(fd) != 0) {
+		ipc_client_log(client, "%s: cached file not served\n",
+			       __func__);
+		goto error;
+	}
+
+	/* Failed reads aren't cached */
+	if (rsim_cache_read(cache, 4, RSIM_EF_MSISDN) !=
+	    IPC_SEC_RSIM_CACHE_SENT ||
+	    rsim_cache_response(cache, 4, 0x6A, 0x00) != 1 ||
+	    rsim_cache_read(cache, 5, RSIM_EF_MSISDN) !=
+	    IPC_SEC_RSIM_CACHE_SENT ||
+	    rsim_cache_response(cache, 5, 0x6A, 0x00) != 1) {
+		ipc_client_log(client, "%s: failed read cached\n", __func__);
+		goto error;
+	}
+
+	/* EF AD was used last: EF SPN is evicted for EF MSISDN */
+	if (rsim_cache_read(cache, 6, RSIM_EF_SPN) !=
+	    IPC_SEC_RSIM_CACHE_SENT ||
+	    rsim_cache_response(cache, 6, 0x90, 0x46) != 1 ||
+	    rsim_cache_read(cache, 7, RSIM_EF_AD) != IPC_SEC_RSIM_CACHE_HIT ||
+	    rsim_cache_read(cache, 8, RSIM_EF_MSISDN) !=
+	    IPC_SEC_RSIM_CACHE_SENT ||
+	    rsim_cache_response(cache, 8, 0x90, 0x40) != 1) {
+		ipc_client_log(client, "%s: filling the cache failed\n",
+			       __func__);
+		goto error;
+	}
+
+	if (rsim_cache_read(cache, 9, RSIM_EF_AD) != IPC_SEC_RSIM_CACHE_HIT ||
+	    rsim_cache_read(cache, 10, RSIM_EF_MSISDN) !=
+	    IPC_SEC_RSIM_CACHE_HIT ||
+	    rsim_cache_read(cache, 11, RSIM_EF_SPN) !=
+	    IPC_SEC_RSIM_CACHE_SENT) {
+		ipc_client_log(client, "%s: wrong file evicted\n", __func__);
+		goto error;
+	}
+
+	if (rsim_cache_response(cache, 11, 0x90, 0x46) != 1)
+		goto error;
+
+	/* EF ICCID always goes to the card */
+	if (rsim_cache_read(cache, 12, RSIM_EF_ICCID) !=
+	    IPC_SEC_RSIM_CACHE_SENT ||
+	    rsim_cache_response(cache, 12, 0x90, 0x89) != 1 ||
+	    rsim_cache_read(cache, 13, RSIM_EF_ICCID) !=
+	    IPC_SEC_RSIM_CACHE_SENT ||
+	    rsim_cache_response(cache, 13, 0x90, 0x89) != 1) {
+		ipc_client_log(client, "%s: EF ICCID served from the cache\n",
+			       __func__);
+		goto error;
+	}
+
+	ipc_sec_rsim_cache_stats_get(cache, &stats);
+
+	if (stats.hits != 4 || stats.misses != 8 || stats.joined != 1 ||
+	    stats.entries != 2 || stats.pending != 0) {
+		ipc_client_log(client, "%s: wrong stats: %lu hits, %lu misses,"
+			       " %lu joined, %u entries, %u pending\n",
+			       __func__, stats.hits, stats.misses,
+			       stats.joined, stats.entries, stats.pending);
+		goto error;
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	if (cache != NULL)
+		ipc_sec_rsim_cache_destroy(cache);
+
+	close(fd);
+	ipc_client_destroy(fmt_client);
+
+	return rc;
+}
+
+static int rsim_cache_sat_refresh(struct ipc_sec_rsim_cache *cache,
+				  unsigned char qualifier,
+				  unsigned short file_id)
+{
+	struct ipc_message message;
+	unsigned char data[] = {
+		0xD0, 0x12,
+		0x81, 0x03, 0x01, 0x01, qualifier,
+		0x82, 0x02, 0x81, 0x82,
+		0x92, 0x07, 0x01, 0x3F, 0x00, 0x7F, 0xFF,
+		file_id >> 8, file_id & 0xFF,
+	};
+
+	memset(&message, 0, sizeof(message));
+	message.command = IPC_SAT_PROACTIVE_CMD;
+	message.type = IPC_TYPE_INDI;
+	message.data = data;
+	message.size = sizeof(data);
+
+	return ipc_sec_rsim_cache_handle(cache, &message);
+}
+
+/*
+ * Cached files expire when they are written, when SAT REFRESH lists them
+ * and when the card changes, and a read in flight while its file expired
+ * isn't cached.
+ */
+int test_sec_rsim_cache_invalidation(struct ipc_client *client)
+{
+	struct ipc_sec_rsim_cache_stats stats;
+	struct ipc_sec_rsim_cache *cache = NULL;
+	struct rsim_cache_responses responses;
+	struct ipc_client *fmt_client;
+	int fd = -1;
+	int rc;
+
+	memset(&responses, 0, sizeof(responses));
+
+	fmt_client = rsim_cache_client_create(&fd);
+	if (fmt_client == NULL)
+		return -1;
+
+	cache = ipc_sec_rsim_cache_create(fmt_client, 4,
+					  RSIM_CACHE_TIMEOUT,
+					  rsim_cache_callback, &responses);
+	if (cache == NULL)
+		goto error;
+
+	if (rsim_cache_read(cache, 1, RSIM_EF_AD) !=
+	    IPC_SEC_RSIM_CACHE_SENT ||
+	    rsim_cache_response(cache, 1, 0x90, 0xAD) != 1 ||
+	    rsim_cache_read(cache, 2, RSIM_EF_SPN) !=
+	    IPC_SEC_RSIM_CACHE_SENT ||
+	    rsim_cache_response(cache, 2, 0x90, 0x46) != 1) {
+		ipc_client_log(client, "%s: filling the cache failed\n",
+			       __func__);
+		goto error;
+	}
+
+	/* Writing a file only expires that file */
+	if (rsim_cache_update(cache, 3, RSIM_EF_AD) !=
+	    IPC_SEC_RSIM_CACHE_SENT ||
+	    rsim_cache_read(cache, 4, RSIM_EF_SPN) != IPC_SEC_RSIM_CACHE_HIT ||
+	    rsim_cache_read(cache, 5, RSIM_EF_AD) != IPC_SEC_RSIM_CACHE_SENT) {
+		ipc_client_log(client, "%s: written file not expired\n",
+			       __func__);
+		goto error;
+	}
+
+	/* The file expires again before the response comes */
+	if (ipc_sec_rsim_cache_invalidate(cache, RSIM_EF_AD) != 0 ||
+	    rsim_cache_response(cache, 5, 0x90, 0xAD) != 1 ||
+	    rsim_cache_read(cache, 6, RSIM_EF_AD) != IPC_SEC_RSIM_CACHE_SENT ||
+	    rsim_cache_response(cache, 6, 0x90, 0xAD) != 1) {
+		ipc_client_log(client, "%s: read in flight cached\n",
+			       __func__);
+		goto error;
+	}
+
+	/* SAT REFRESH with a file list only expires the listed files */
+	if (rsim_cache_sat_refresh(cache, 0x01, RSIM_EF_SPN) != 0 ||
+	    rsim_cache_read(cache, 7, RSIM_EF_AD) != IPC_SEC_RSIM_CACHE_HIT ||
+	    rsim_cache_read(cache, 8, RSIM_EF_SPN) !=
+	    IPC_SEC_RSIM_CACHE_SENT ||
+	    rsim_cache_response(cache, 8, 0x90, 0x46) != 1) {
+		ipc_client_log(client, "%s: SAT REFRESH file list not"
+			       " honored\n", __func__);
+		goto error;
+	}
+
+	/* Any other refresh mode expires everything */
+	if (rsim_cache_sat_refresh(cache, 0x04, RSIM_EF_SPN) != 0 ||
+	    rsim_cache_read(cache, 9, RSIM_EF_AD) != IPC_SEC_RSIM_CACHE_SENT ||
+	    rsim_cache_response(cache, 9, 0x90, 0xAD) != 1) {
+		ipc_client_log(client, "%s: SAT REFRESH reset not honored\n",
+			       __func__);
+		goto error;
+	}
+
+	/* A different ICCID means a different card */
+	if (rsim_cache_read(cache, 10, RSIM_EF_ICCID) !=
+	    IPC_SEC_RSIM_CACHE_SENT ||
+	    rsim_cache_response(cache, 10, 0x90, 0x89) != 1 ||
+	    rsim_cache_read(cache, 11, RSIM_EF_AD) != IPC_SEC_RSIM_CACHE_HIT ||
+	    rsim_cache_read(cache, 12, RSIM_EF_ICCID) !=
+	    IPC_SEC_RSIM_CACHE_SENT ||
+	    rsim_cache_response(cache, 12, 0x90, 0x98) != 1 ||
+	    rsim_cache_read(cache, 13, RSIM_EF_AD) !=
+	    IPC_SEC_RSIM_CACHE_SENT) {
+		ipc_client_log(client, "%s: SIM card change not detected\n",
+			       __func__);
+		goto error;
+	}
+
+	ipc_sec_rsim_cache_stats_get(cache, &stats);
+
+	if (stats.hits != 3 || stats.invalidations != 6 ||
+	    stats.entries != 0 || stats.pending != 1) {
+		ipc_client_log(client, "%s: wrong stats: %lu hits, %lu"
+			       " invalidations, %u entries, %u pending\n",
+			       __func__, stats.hits, stats.invalidations,
+			       stats.entries, stats.pending);
+		goto error;
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	if (cache != NULL)
+		ipc_sec_rsim_cache_destroy(cache);
+
+	close(fd);
+	ipc_client_destroy(fmt_client);
+
+	return rc;
+}
+
+static void rsim_cache_card_status(struct ipc_sec_rsim_cache *cache,
+				   unsigned char status)
+{
+	struct ipc_sec_pin_status_response_data data;
+	struct ipc_message message;
+
+	memset(&data, 0, sizeof(data));
+	data.status = status;
+
+	memset(&message, 0, sizeof(message));
+	message.command = IPC_SEC_PIN_STATUS;
+	message.type = IPC_TYPE_NOTI;
+	message.data = &data;
+	message.size = sizeof(data);
+
+	ipc_sec_rsim_cache_handle(cache, &message);
+}
+
+/*
+ * Reads in flight fail with every requester that joined them when the
+ * cache is flushed or the card goes away, and a read that got no response
+ * within the timeout isn't joined.
+ */
+int test_sec_rsim_cache_pending(struct ipc_client *client)
+{
+	struct timespec delay = { 0, 20 * 1000 * 1000 };
+	struct ipc_sec_rsim_cache_stats stats;
+	struct ipc_sec_rsim_cache *cache = NULL;
+	struct rsim_cache_responses responses;
+	struct ipc_client *fmt_client;
+	int fd = -1;
+	int rc;
+
+	memset(&responses, 0, sizeof(responses));
+
+	fmt_client = rsim_cache_client_create(&fd);
+	if (fmt_client == NULL)
+		return -1;
+
+	cache = ipc_sec_rsim_cache_create(fmt_client, 4, 10,
+					  rsim_cache_callback, &responses);
+	if (cache == NULL)
+		goto error;
+
+	if (rsim_cache_read(cache, 1, RSIM_EF_AD) !=
+	    IPC_SEC_RSIM_CACHE_SENT ||
+	    rsim_cache_read(cache, 2, RSIM_EF_AD) !=
+	    IPC_SEC_RSIM_CACHE_JOINED ||
+	    rsim_cache_read(cache, 3, RSIM_EF_SPN) !=
+	    IPC_SEC_RSIM_CACHE_SENT) {
+		ipc_client_log(client, "%s: reads not sent\n", __func__);
+		goto error;
+	}
+
+	ipc_sec_rsim_cache_flush(cache);
+
+	if (responses.count != 3 || responses.sw1[0] != 0 ||
+	    responses.sw1[1] != 0 || responses.sw1[2] != 0) {
+		ipc_client_log(client, "%s: %u reads failed by the flush"
+			       " instead of 3\n", __func__, responses.count);
+		goto error;
+	}
+
+	/* Late responses belong to no request anymore */
+	if (rsim_cache_response(cache, 1, 0x90, 0xAD) != 0 ||
+	    rsim_cache_response(cache, 3, 0x90, 0x46) != 0) {
+		ipc_client_log(client, "%s: failed read completed\n",
+			       __func__);
+		goto error;
+	}
+
+	responses.count = 0;
+
+	if (rsim_cache_read(cache, 4, RSIM_EF_AD) !=
+	    IPC_SEC_RSIM_CACHE_SENT ||
+	    rsim_cache_read(cache, 5, RSIM_EF_AD) !=
+	    IPC_SEC_RSIM_CACHE_JOINED) {
+		ipc_client_log(client, "%s: read not sent\n", __func__);
+		goto error;
+	}
+
+	rsim_cache_card_status(cache, IPC_SEC_PIN_STATUS_CARD_NOT_PRESENT);
+
+	if (responses.count != 2 || responses.mseqs[0] != 4 ||
+	    responses.mseqs[1] != 5) {
+		ipc_client_log(client, "%s: read not failed when the card went"
+			       " away\n", __func__);
+		goto error;
+	}
+
+	responses.count = 0;
+
+	/* The first read times out: the second one is sent again */
+	if (rsim_cache_read(cache, 6, RSIM_EF_SPN) !=
+	    IPC_SEC_RSIM_CACHE_SENT) {
+		goto error;
+	}
+
+	nanosleep(&delay, NULL);
+
+	if (rsim_cache_read(cache, 7, RSIM_EF_SPN) !=
+	    IPC_SEC_RSIM_CACHE_SENT ||
+	    responses.count != 1 || responses.mseqs[0] != 6 ||
+	    responses.sw1[0] != 0) {
+		ipc_client_log(client, "%s: timed out read joined\n",
+			       __func__);
+		goto error;
+	}
+
+	if (rsim_cache_response(cache, 7, 0x90, 0x46) != 1 ||
+	    responses.count != 2 || responses.mseqs[1] != 7 ||
+	    responses.sw1[1] != 0x90) {
+		ipc_client_log(client, "%s: read sent again not completed\n",
+			       __func__);
+		goto error;
+	}
+
+	ipc_sec_rsim_cache_stats_get(cache, &stats);
+
+	if (stats.joined != 2 || stats.entries != 1 || stats.pending != 0) {
+		ipc_client_log(client, "%s: wrong stats: %lu joined, %u"
+			       " entries, %u pending\n", __func__,
+			       stats.joined, stats.entries, stats.pending);
+		goto error;
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	if (cache != NULL)
+		ipc_sec_rsim_cache_destroy(cache);
+
+	close(fd);
+	ipc_client_destroy(fmt_client);
+
+	return rc;
+}
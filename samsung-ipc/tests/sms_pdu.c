@@ -0,0 +1,514 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <samsung-ipc.h>
+
+#include "sms_pdu.h"
+
+#define COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+/*
+ * SMS-DELIVER PDUs, including the SMSC address, as received in
+ * IPC_SMS_INCOMING_MSG. The corpus covers GSM 7-bit with the extension
+ * table, alphanumeric originators, UCS2 with characters beyond the BMP and
+ * both 8-bit and 16-bit concatenation references.
+ */
+const struct sms_pdu_sample sms_pdu_corpus[] = {
+	{
+		"+31641600986",
+		"\x07\x91\x13\x26\x04\x00\x00\xf0\x04\x0b\x91\x13\x46\x61\x00\x89"
+		"\xf6\x00\x00\x20\x80\x62\x91\x73\x14\x08\x0c\xc8\xf7\x1d\x14\x96"
+		"\x97\x41\xf9\x77\xfd\x07",
+		38,
+		"How are you?",
+		0, 0,
+	},
+	{
+		"+33612345678",
+		"\x07\x91\x13\x26\x04\x00\x00\xf0\x04\x0b\x91\x33\x16\x32\x54\x76"
+		"\xf8\x00\x00\x02\x80\x26\x19\x37\x41\x80\x51\xcd\x72\x99\x9e\x76"
+		"\x9f\x41\xed\xb7\xbd\x4c\x06\xd1\xdf\xa0\x19\xbc\xcd\x02\xc9\xdf"
+		"\xef\x36\x48\x28\x73\x81\x84\xf2\xb4\xfb\x0c\xa2\xa3\xcb\xa0\xe8"
+		"\x0c\x64\x4e\x9f\xeb\xf2\xf2\x1c\xb4\x41\x91\xe5\x61\x33\x7d\x93"
+		"\x02\x85\xdd\x64\xd0\xa6\x2c\x83\x81\xcc\x6f\x39\x88\x5d\x77\x8f"
+		"\xd1\x21",
+		98,
+		"Meeting moved to 3pm, room B2. Bring the Q3 figures "
+		"{draft} and \xe2\x82\xac" "20 for lunch!",
+		0, 0,
+	},
+	{
+		"Bank",
+		"\x07\x91\x13\x26\x04\x00\x00\xf0\x04\x08\xd0\xc2\xb0\x7b\x0d\x00"
+		"\x00\x02\x80\x26\x19\x37\x41\x80\x44\xd6\x37\x5d\x5e\x06\x8d\xdf"
+		"\xe4\x32\x88\x5c\x06\xd9\x0b\xf2\xb4\x39\x3d\x0e\xd3\xd3\x6f\x37"
+		"\xa8\x3c\xa7\x83\x68\x38\x59\x2e\x36\x73\x81\x9c\x65\x10\xbb\x0c"
+		"\x82\x87\xe5\xf4\xf0\xb9\xac\x07\x85\xed\xe5\x31\x08\x5e\x96\xcf"
+		"\xdf\x6e\x77\xd9\x05",
+		85,
+		"Votre code de v\xc3\xa9rification est 482913. Ne le "
+		"partagez avec personne.",
+		0, 0,
+	},
+	{
+		"+79161234567",
+		"\x07\x91\x13\x26\x04\x00\x00\xf0\x04\x0b\x91\x97\x61\x21\x43\x65"
+		"\xf7\x00\x08\x02\x80\x26\x19\x37\x41\x80\x44\x04\x1f\x04\x40\x04"
+		"\x38\x04\x32\x04\x35\x04\x42\x00\x21\x00\x20\x04\x12\x04\x41\x04"
+		"\x42\x04\x40\x04\x35\x04\x47\x04\x30\x00\x20\x04\x32\x00\x20\x00"
+		"\x31\x00\x38\x00\x3a\x00\x30\x00\x30\x00\x20\x04\x43\x00\x20\x04"
+		"\x32\x04\x45\x04\x3e\x04\x34\x04\x30\x00\x20\xd8\x3d\xde\x00",
+		95,
+		"\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82! "
+		"\xd0\x92\xd1\x81\xd1\x82\xd1\x80\xd0\xb5\xd1\x87\xd0\xb0 "
+		"\xd0\xb2 18:00 \xd1\x83 "
+		"\xd0\xb2\xd1\x85\xd0\xbe\xd0\xb4\xd0\xb0 "
+		"\xf0\x9f\x98\x80",
+		0, 0,
+	},
+	{
+		"+4915112345678",
+		"\x07\x91\x13\x26\x04\x00\x00\xf0\x44\x0d\x91\x94\x51\x11\x32\x54"
+		"\x76\xf8\x00\x00\x02\x80\x26\x19\x37\x41\x80\xa0\x05\x00\x03\x2a"
+		"\x02\x01\xa8\xe8\xf4\x1c\x94\x9e\x83\xc2\x20\xf6\xdb\x7d\x06\x8d"
+		"\xdf\xee\x71\x98\x5e\x76\x87\xe9\x65\x32\xa8\x5d\x9e\xcf\xc3\xe7"
+		"\x32\x88\x8e\x0e\xd3\x41\x73\x78\xd8\x3d\x07\xb5\xdf\xf2\x32\x88"
+		"\x8e\x0e\xbb\x41\x6f\x77\x19\x04\x0f\xcb\xe9\x2e\x10\x15\x9d\x9e"
+		"\x83\xd2\x73\x50\x18\xc4\x7e\xbb\xcf\xa0\xf1\xdb\x3d\x0e\xd3\xcb"
+		"\xee\x30\xbd\x4c\x06\xb5\xcb\xf3\x79\xf8\x5c\x06\xd1\xd1\x61\x3a"
+		"\x68\x0e\x0f\xbb\xe7\xa0\xf6\x5b\x5e\x06\xd1\xd1\x61\x37\xe8\xed"
+		"\x2e\x83\xe0\x61\x39\xdd\x05\xa2\xa2\xd3\x73\x50\x7a\x0e\x0a\x83"
+		"\xd8\x6f\xf7\x19\x34\x7e\xbb\xc7",
+		168,
+		"This is a long concatenated message that spans more than "
+		"one part. This is a long concatenated message that spans "
+		"more than one part. This is a long conc",
+		2, 1,
+	},
+	{
+		"+4915112345678",
+		"\x07\x91\x13\x26\x04\x00\x00\xf0\x44\x0d\x91\x94\x51\x11\x32\x54"
+		"\x76\xf8\x00\x00\x02\x80\x26\x19\x37\x41\x80\x7a\x05\x00\x03\x2a"
+		"\x02\x02\xc2\xf4\xb2\x3b\x4c\x2f\x93\x41\xed\xf2\x7c\x1e\x3e\x97"
+		"\x41\x74\x74\x98\x0e\x9a\xc3\xc3\xee\x39\xa8\xfd\x96\x97\x41\x74"
+		"\x74\xd8\x0d\x7a\xbb\xcb\x20\x78\x58\x4e\x77\x81\xa8\xe8\xf4\x1c"
+		"\x94\x9e\x83\xc2\x20\xf6\xdb\x7d\x06\x8d\xdf\xee\x71\x98\x5e\x76"
+		"\x87\xe9\x65\x32\xa8\x5d\x9e\xcf\xc3\xe7\x32\x88\x8e\x0e\xd3\x41"
+		"\x73\x78\xd8\x3d\x07\xb5\xdf\xf2\x32\x88\x8e\x0e\xbb\x41\x6f\x77"
+		"\x19\x04\x0f\xcb\xe9\x2e\x10",
+		135,
+		"atenated message that spans more than one part. This is "
+		"a long concatenated message that spans more than one "
+		"part. ",
+		2, 2,
+	},
+	{
+		"+79031112233",
+		"\x07\x91\x13\x26\x04\x00\x00\xf0\x44\x0b\x91\x97\x30\x11\x21\x32"
+		"\xf3\x00\x08\x02\x80\x26\x19\x37\x41\x80\x8d\x06\x08\x04\x12\x34"
+		"\x02\x01\x04\x12\x04\x30\x04\x48\x00\x20\x04\x37\x04\x30\x04\x3a"
+		"\x04\x30\x04\x37\x00\x20\x21\x16\x00\x31\x00\x32\x00\x33\x00\x34"
+		"\x00\x35\x00\x20\x04\x34\x04\x3e\x04\x41\x04\x42\x04\x30\x04\x32"
+		"\x04\x3b\x04\x35\x04\x3d\x00\x2e\x00\x20\x04\x21\x04\x3f\x04\x30"
+		"\x04\x41\x04\x38\x04\x31\x04\x3e\x00\x2c\x00\x20\x04\x47\x04\x42"
+		"\x04\x3e\x00\x20\x04\x32\x04\x4b\x04\x31\x04\x40\x04\x30\x04\x3b"
+		"\x04\x38\x00\x20\x04\x3d\x04\x30\x04\x41\x00\x21\x00\x20\x04\x12"
+		"\x04\x30\x04\x48\x00\x20\x04\x37\x04\x30\x04\x3a\x04\x30\x04\x37"
+		"\x00\x20\x21\x16\x00\x31\x00\x32",
+		168,
+		"\xd0\x92\xd0\xb0\xd1\x88 "
+		"\xd0\xb7\xd0\xb0\xd0\xba\xd0\xb0\xd0\xb7 "
+		"\xe2\x84\x96" "12345 "
+		"\xd0\xb4\xd0\xbe\xd1\x81\xd1\x82\xd0\xb0\xd0\xb2\xd0\xbb\xd0\xb5\xd0\xbd. "
+		"\xd0\xa1\xd0\xbf\xd0\xb0\xd1\x81\xd0\xb8\xd0\xb1\xd0\xbe, "
+		"\xd1\x87\xd1\x82\xd0\xbe "
+		"\xd0\xb2\xd1\x8b\xd0\xb1\xd1\x80\xd0\xb0\xd0\xbb\xd0\xb8 "
+		"\xd0\xbd\xd0\xb0\xd1\x81! \xd0\x92\xd0\xb0\xd1\x88 "
+		"\xd0\xb7\xd0\xb0\xd0\xba\xd0\xb0\xd0\xb7 "
+		"\xe2\x84\x96" "12",
+		2, 1,
+	},
+	{
+		"+79031112233",
+		"\x07\x91\x13\x26\x04\x00\x00\xf0\x44\x0b\x91\x97\x30\x11\x21\x32"
+		"\xf3\x00\x08\x02\x80\x26\x19\x37\x41\x80\x59\x06\x08\x04\x12\x34"
+		"\x02\x02\x00\x33\x00\x34\x00\x35\x00\x20\x04\x34\x04\x3e\x04\x41"
+		"\x04\x42\x04\x30\x04\x32\x04\x3b\x04\x35\x04\x3d\x00\x2e\x00\x20"
+		"\x04\x21\x04\x3f\x04\x30\x04\x41\x04\x38\x04\x31\x04\x3e\x00\x2c"
+		"\x00\x20\x04\x47\x04\x42\x04\x3e\x00\x20\x04\x32\x04\x4b\x04\x31"
+		"\x04\x40\x04\x30\x04\x3b\x04\x38\x00\x20\x04\x3d\x04\x30\x04\x41"
+		"\x00\x21\x00\x20",
+		116,
+		"345 "
+		"\xd0\xb4\xd0\xbe\xd1\x81\xd1\x82\xd0\xb0\xd0\xb2\xd0\xbb\xd0\xb5\xd0\xbd. "
+		"\xd0\xa1\xd0\xbf\xd0\xb0\xd1\x81\xd0\xb8\xd0\xb1\xd0\xbe, "
+		"\xd1\x87\xd1\x82\xd0\xbe "
+		"\xd0\xb2\xd1\x8b\xd0\xb1\xd1\x80\xd0\xb0\xd0\xbb\xd0\xb8 "
+		"\xd0\xbd\xd0\xb0\xd1\x81! ",
+		2, 2,
+	},
+};
+
+const unsigned int sms_pdu_corpus_count = COUNT(sms_pdu_corpus);
+
+static const char * const sms_pdu_messages[] = {
+	"How are you?",
+	"Meeting moved to 3pm, room B2. Bring the Q3 figures "
+	"{draft} and \xe2\x82\xac" "20 for lunch!",
+	"Votre code de v\xc3\xa9rification est 482913. Ne le "
+	"partagez avec personne.",
+	NULL,
+	NULL,
+	NULL,
+};
+
+int test_sms_pdu_corpus(struct ipc_client *client)
+{
+	struct ipc_sms_pdu_deliver deliver;
+	char text[IPC_SMS_PDU_TEXT_SIZE];
+	unsigned int i;
+	int rc;
+
+	for (i = 0; i < sms_pdu_corpus_count; i++) {
+		rc = ipc_sms_pdu_deliver_parse(sms_pdu_corpus[i].pdu,
+					       sms_pdu_corpus[i].pdu_size,
+					       &deliver);
+		if (rc < 0 ||
+		    strcmp(deliver.originator, sms_pdu_corpus[i].originator)) {
+			ipc_client_log(client, "%s: sample %u: parsing failed\n",
+				       __func__, i);
+			return -1;
+		}
+
+		if (deliver.concatenated != !!sms_pdu_corpus[i].count ||
+		    (deliver.concatenated &&
+		     (deliver.concat.count != sms_pdu_corpus[i].count ||
+		      deliver.concat.sequence != sms_pdu_corpus[i].sequence))) {
+			ipc_client_log(client, "%s: sample %u: wrong UDH\n",
+				       __func__, i);
+			return -1;
+		}
+
+		rc = ipc_sms_pdu_deliver_text(&deliver, text, sizeof(text));
+		if (rc < 0 || (size_t) rc != strlen(sms_pdu_corpus[i].text) ||
+		    strcmp(text, sms_pdu_corpus[i].text)) {
+			ipc_client_log(client, "%s: sample %u: wrong text\n",
+				       __func__, i);
+			return -1;
+		}
+
+		/* Truncated PDUs must be rejected */
+		rc = ipc_sms_pdu_deliver_parse(sms_pdu_corpus[i].pdu,
+					       sms_pdu_corpus[i].pdu_size - 1,
+					       &deliver);
+		if (rc != -1) {
+			ipc_client_log(client, "%s: sample %u: truncated PDU"
+				       " accepted\n", __func__, i);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int test_sms_pdu_codec(struct ipc_client *client)
+{
+	unsigned char septets[160];
+	unsigned char unpacked[160];
+	unsigned char packed[160];
+	char text[IPC_SMS_PDU_TEXT_SIZE];
+	const char *message;
+	size_t count;
+	size_t fill;
+	size_t size;
+	unsigned int i;
+	int rc;
+
+	for (i = 0; i < COUNT(septets); i++)
+		septets[i] = (i * 37 + 11) & 0x7F;
+
+	/* Both the aligned and the bit by bit paths */
+	for (fill = 0; fill < 7; fill++) {
+		for (count = 0; count <= COUNT(septets); count++) {
+			size = ipc_sms_pdu_gsm7_pack(septets, count, fill,
+						     packed, sizeof(packed));
+			if (size != (fill + count * 7 + 7) / 8) {
+				ipc_client_log(client, "%s: packing %zu septets"
+					       " failed\n", __func__, count);
+				return -1;
+			}
+
+			memset(unpacked, 0xFF, sizeof(unpacked));
+			if (ipc_sms_pdu_gsm7_unpack(packed, size, fill, unpacked,
+						    count) != count ||
+			    memcmp(unpacked, septets, count)) {
+				ipc_client_log(client, "%s: unpacking %zu"
+					       " septets failed\n", __func__,
+					       count);
+				return -1;
+			}
+		}
+	}
+
+	for (i = 0; i < COUNT(sms_pdu_messages); i++) {
+		message = sms_pdu_messages[i];
+		if (message == NULL)
+			break;
+
+		rc = ipc_sms_pdu_utf8_gsm7(message, septets, sizeof(septets));
+		if (rc < 0)
+			return -1;
+
+		rc = ipc_sms_pdu_gsm7_utf8(septets, rc, text, sizeof(text));
+		if (rc < 0 || strcmp(text, message)) {
+			ipc_client_log(client, "%s: GSM 7-bit round-trip"
+				       " failed\n", __func__);
+			return -1;
+		}
+	}
+
+	/* Cyrillic and U+1F600, which needs a surrogate pair */
+	message = "\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82 "
+		"\xf0\x9f\x98\x80";
+
+	if (ipc_sms_pdu_utf8_gsm7(message, septets, sizeof(septets)) != -1) {
+		ipc_client_log(client, "%s: unsupported characters encoded\n",
+			       __func__);
+		return -1;
+	}
+
+	rc = ipc_sms_pdu_utf8_ucs2(message, packed, sizeof(packed));
+	if (rc != 18)
+		return -1;
+
+	rc = ipc_sms_pdu_ucs2_utf8(packed, rc, text, sizeof(text));
+	if (rc < 0 || strcmp(text, message)) {
+		ipc_client_log(client, "%s: UCS2 round-trip failed\n",
+			       __func__);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Indexes in the corpus, with the expected ipc_sms_pdu_concat_store_add */
+static const struct {
+	unsigned int sample;
+	int rc;
+} sms_pdu_eviction[] = {
+	{ 4, 0 },
+	{ 6, 0 },
+	{ 5, 0 },
+	{ 4, 1 },
+};
+
+int test_sms_pdu_concat_store(struct ipc_client *client)
+{
+	struct ipc_sms_pdu_concat_store *store;
+	const struct sms_pdu_sample *sample;
+	struct ipc_sms_pdu_deliver deliver;
+	unsigned int completed = 0;
+	unsigned int i;
+	size_t size;
+	char *text;
+	int rc = -1;
+
+	store = ipc_sms_pdu_concat_store_create(2, 60000);
+	if (store == NULL)
+		return -1;
+
+	/* Interleave the parts of both concatenated messages, backwards */
+	for (i = sms_pdu_corpus_count; i > 0; i--) {
+		rc = ipc_sms_pdu_deliver_parse(sms_pdu_corpus[i - 1].pdu,
+					       sms_pdu_corpus[i - 1].pdu_size,
+					       &deliver);
+		if (rc < 0)
+			goto complete;
+
+		rc = ipc_sms_pdu_concat_store_add(store, &deliver, &text,
+						  &size);
+		if (rc < 0)
+			goto complete;
+
+		if (rc == 0)
+			continue;
+
+		/* The text of the first part comes first */
+		if (sms_pdu_corpus[i - 1].sequence > 1 ||
+		    strncmp(text, sms_pdu_corpus[i - 1].text,
+			    strlen(sms_pdu_corpus[i - 1].text))) {
+			ipc_client_log(client, "%s: sample %u: wrong text\n",
+				       __func__, i - 1);
+			free(text);
+			rc = -1;
+			goto complete;
+		}
+
+		free(text);
+		completed++;
+	}
+
+	if (completed != 6) {
+		ipc_client_log(client, "%s: %u messages completed\n", __func__,
+			       completed);
+		rc = -1;
+		goto complete;
+	}
+
+	/*
+	 * With room for a single message, the first part of the second
+	 * concatenated message evicts the first one, which then has to start
+	 * over.
+	 */
+	ipc_sms_pdu_concat_store_destroy(store);
+	store = ipc_sms_pdu_concat_store_create(1, 60000);
+	if (store == NULL)
+		return -1;
+
+	for (i = 0; i < COUNT(sms_pdu_eviction); i++) {
+		sample = &sms_pdu_corpus[sms_pdu_eviction[i].sample];
+
+		rc = ipc_sms_pdu_deliver_parse(sample->pdu, sample->pdu_size,
+					       &deliver);
+		if (rc < 0)
+			goto complete;
+
+		rc = ipc_sms_pdu_concat_store_add(store, &deliver, &text,
+						  &size);
+		if (rc == 1)
+			free(text);
+
+		if (rc != sms_pdu_eviction[i].rc) {
+			ipc_client_log(client, "%s: step %u: got %d instead of"
+				       " %d\n", __func__, i, rc,
+				       sms_pdu_eviction[i].rc);
+			rc = -1;
+			goto complete;
+		}
+	}
+
+	/* Nothing is left in the store */
+	rc = ipc_sms_pdu_concat_store_expire(store);
+	if (rc != 0) {
+		rc = -1;
+		goto complete;
+	}
+
+complete:
+	ipc_sms_pdu_concat_store_destroy(store);
+
+	return rc;
+}
+
+#define SMS_PDU_EXPIRE_TIMEOUT	10
+
+/*
+ * An 8-bit concatenated message whose first part is empty, from an
+ * originator whose length counts the filler as a digit
+ */
+static const char * const sms_pdu_empty_parts[] = {
+	"\x07\x91\x13\x26\x04\x00\x00\xf0\x44\x0c\x91\x13\x46\x61\x00\x89"
+	"\xf6\x00\x04\x20\x80\x62\x91\x73\x14\x08\x06\x05\x00\x03\x2a"
+	"\x02\x01",
+	"\x07\x91\x13\x26\x04\x00\x00\xf0\x44\x0c\x91\x13\x46\x61\x00\x89"
+	"\xf6\x00\x04\x20\x80\x62\x91\x73\x14\x08\x08\x05\x00\x03\x2a"
+	"\x02\x02\x68\x69",
+};
+
+static const size_t sms_pdu_empty_parts_size[] = { 34, 36 };
+
+/*
+ * Empty parts count as received, and incomplete messages expire after the
+ * timeout, in milliseconds.
+ */
+int test_sms_pdu_concat_expire(struct ipc_client *client)
+{
+	struct ipc_sms_pdu_concat_store *store;
+	struct ipc_sms_pdu_deliver deliver;
+	struct timespec delay;
+	unsigned int i;
+	size_t size;
+	char *text;
+	int rc;
+
+	store = ipc_sms_pdu_concat_store_create(1, SMS_PDU_EXPIRE_TIMEOUT);
+	if (store == NULL)
+		return -1;
+
+	/* The empty part, twice as the network retries, then the other */
+	for (i = 0; i < 3; i++) {
+		rc = ipc_sms_pdu_deliver_parse(sms_pdu_empty_parts[i / 2],
+					       sms_pdu_empty_parts_size[i / 2],
+					       &deliver);
+		if (rc < 0 || strcmp(deliver.originator, "+31641600986")) {
+			ipc_client_log(client, "%s: wrong originator\n",
+				       __func__);
+			goto error;
+		}
+
+		rc = ipc_sms_pdu_concat_store_add(store, &deliver, &text,
+						  &size);
+		if (rc != (i == 2)) {
+			ipc_client_log(client, "%s: step %u: got %d\n",
+				       __func__, i, rc);
+			if (rc == 1)
+				free(text);
+			goto error;
+		}
+	}
+
+	rc = strcmp(text, "hi");
+	free(text);
+
+	if (rc != 0 || size != 2) {
+		ipc_client_log(client, "%s: wrong text\n", __func__);
+		goto error;
+	}
+
+	rc = ipc_sms_pdu_deliver_parse(sms_pdu_empty_parts[1],
+				       sms_pdu_empty_parts_size[1], &deliver);
+	if (rc < 0 ||
+	    ipc_sms_pdu_concat_store_add(store, &deliver, &text, &size) != 0 ||
+	    ipc_sms_pdu_concat_store_expire(store) != 0) {
+		ipc_client_log(client, "%s: part expired early\n", __func__);
+		goto error;
+	}
+
+	delay.tv_sec = 0;
+	delay.tv_nsec = SMS_PDU_EXPIRE_TIMEOUT * 2 * 1000000L;
+	nanosleep(&delay, NULL);
+
+	if (ipc_sms_pdu_concat_store_expire(store) != 1) {
+		ipc_client_log(client, "%s: part didn't expire\n", __func__);
+		goto error;
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	ipc_sms_pdu_concat_store_destroy(store);
+
+	return rc;
+}
@@ -0,0 +1,38 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TESTS_SMS_PDU_H__
+#define __TESTS_SMS_PDU_H__
+
+struct sms_pdu_sample {
+	const char *originator;
+	const char *pdu;
+	size_t pdu_size;
+	const char *text;
+	unsigned char count;
+	unsigned char sequence;
+};
+
+extern const struct sms_pdu_sample sms_pdu_corpus[];
+extern const unsigned int sms_pdu_corpus_count;
+
+int test_sms_pdu_corpus(struct ipc_client *client);
+int test_sms_pdu_codec(struct ipc_client *client);
+int test_sms_pdu_concat_store(struct ipc_client *client);
+int test_sms_pdu_concat_expire(struct ipc_client *client);
+
+#endif /* __TESTS_SMS_PDU_H__ */
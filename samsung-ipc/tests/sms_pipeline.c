@@ -0,0 +1,380 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <samsung-ipc.h>
+
+#include "sms_pipeline.h"
+
+#define PIPELINE_WINDOW		2
+#define PIPELINE_TIMEOUT	10000
+#define PIPELINE_RESULTS	8
+
+/* The SMSC and an SMS-SUBMIT without and with TP-SRR */
+static const unsigned char pipeline_smsc[] = {
+	0x07, 0x91, 0x13, 0x26, 0x04, 0x00, 0x00, 0xf0,
+};
+
+static const unsigned char pipeline_pdu[] = {
+	0x01, 0x00, 0x0b, 0x91, 0x13, 0x46, 0x61, 0x00, 0x89, 0xf6, 0x00, 0x00,
+	0x02, 0xc8, 0x34,
+};
+
+static const unsigned char pipeline_pdu_report[] = {
+	0x21, 0x00, 0x0b, 0x91, 0x13, 0x46, 0x61, 0x00, 0x89, 0xf6, 0x00, 0x00,
+	0x02, 0xc8, 0x34,
+};
+
+struct pipeline_results {
+	struct ipc_sms_pipeline_result results[PIPELINE_RESULTS];
+	unsigned int count;
+};
+
+static void pipeline_callback(void *data,
+			      const struct ipc_sms_pipeline_result *result)
+{
+	struct pipeline_results *results = (struct pipeline_results *) data;
+
+	if (results->count < PIPELINE_RESULTS)
+		results->results[results->count] = *result;
+
+	results->count++;
+}
+
+/* Returns the number of IPC_SMS_SEND_MSG frames the modem side received */
+static int pipeline_sent(int fd, unsigned char *mseqs, unsigned int count)
+{
+	const struct ipc_fmt_header *header;
+	unsigned char buffer[0x1000];
+	unsigned int sent = 0;
+	size_t offset = 0;
+	ssize_t length;
+
+	length = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+	if (length <= 0)
+		return 0;
+
+	while (offset + sizeof(struct ipc_fmt_header) <= (size_t) length) {
+		header = (const struct ipc_fmt_header *) (buffer + offset);
+		if (header->length < sizeof(struct ipc_fmt_header))
+			return -1;
+
+		if (IPC_COMMAND(header->group, header->index) ==
+		    IPC_SMS_SEND_MSG && sent < count) {
+			mseqs[sent++] = header->mseq;
+		}
+
+		offset += header->length;
+	}
+
+	return sent;
+}
+
+static int pipeline_response(struct ipc_sms_pipeline *pipeline,
+			     unsigned char aseq, unsigned short ack,
+			     unsigned char id)
+{
+	struct ipc_sms_send_msg_response_data data;
+	struct ipc_message message;
+
+	memset(&data, 0, sizeof(data));
+	data.type = IPC_SMS_TYPE_OUTGOING;
+	data.ack = ack;
+	data.id = id;
+
+	memset(&message, 0, sizeof(message));
+	message.aseq = aseq;
+	message.command = IPC_SMS_SEND_MSG;
+	message.type = IPC_TYPE_RESP;
+	message.data = &data;
+	message.size = sizeof(data);
+
+	return ipc_sms_pipeline_handle(pipeline, &message);
+}
+
+static int pipeline_status_report(struct ipc_sms_pipeline *pipeline,
+				  unsigned char reference,
+				  unsigned char status)
+{
+	struct ipc_sms_incoming_msg_header *header;
+	unsigned char buffer[sizeof(struct ipc_sms_incoming_msg_header) + 22];
+	struct ipc_message message;
+	unsigned char *pdu;
+
+	memset(buffer, 0, sizeof(buffer));
+	header = (struct ipc_sms_incoming_msg_header *) buffer;
+	header->msg_type = IPC_SMS_MSG_TYPE_SINGLE;
+	header->type = IPC_SMS_TYPE_STATUS_REPORT;
+	header->length = sizeof(buffer) - sizeof(*header);
+
+	/*
+	 * No SMSC, SMS-STATUS-REPORT, TP-MR, TP-RA of 4 digits, TP-SCTS and
+	 * TP-DT, then TP-ST
+	 */
+	pdu = buffer + sizeof(*header);
+	pdu[1] = 0x06;
+	pdu[2] = reference;
+	pdu[3] = 4;
+	pdu[4] = 0x81;
+	pdu[21] = status;
+
+	memset(&message, 0, sizeof(message));
+	message.command = IPC_SMS_INCOMING_MSG;
+	message.type = IPC_TYPE_NOTI;
+	message.data = buffer;
+	message.size = sizeof(buffer);
+
+	return ipc_sms_pipeline_handle(pipeline, &message);
+}
+
+static struct ipc_client *pipeline_client_create(int *fd)
+{
+	struct ipc_client *client;
+
+	client = ipc_client_create(IPC_CLIENT_TYPE_FMT);
+	if (client == NULL)
+		return NULL;
+
+	*fd = ipc_client_loopback_open(client);
+	if (*fd < 0) {
+		ipc_client_destroy(client);
+		return NULL;
+	}
+
+	return client;
+}
+
+/*
+ * The window holds the messages in the queue, a pending mseq can't be used
+ * again, and a message that couldn't be sent isn't kept, so that submitting
+ * it again doesn't send it twice.
+ */
+int test_sms_pipeline_submit(struct ipc_client *client)
+{
+	struct ipc_sms_pipeline_stats stats;
+	struct ipc_sms_pipeline *pipeline = NULL;
+	struct pipeline_results results;
+	struct ipc_client *fmt_client;
+	unsigned char mseqs[4];
+	int fd = -1;
+	int rc;
+
+	memset(&results, 0, sizeof(results));
+
+	fmt_client = pipeline_client_create(&fd);
+	if (fmt_client == NULL)
+		return -1;
+
+	pipeline = ipc_sms_pipeline_create(fmt_client, PIPELINE_WINDOW,
+					   PIPELINE_TIMEOUT, 0,
+					   pipeline_callback, &results);
+	if (pipeline == NULL)
+		goto error;
+
+	if (ipc_sms_pipeline_submit(pipeline, 1, pipeline_smsc,
+				    sizeof(pipeline_smsc), pipeline_pdu,
+				    sizeof(pipeline_pdu)) != 1 ||
+	    ipc_sms_pipeline_submit(pipeline, 2, pipeline_smsc,
+				    sizeof(pipeline_smsc), pipeline_pdu,
+				    sizeof(pipeline_pdu)) != 1 ||
+	    ipc_sms_pipeline_submit(pipeline, 3, pipeline_smsc,
+				    sizeof(pipeline_smsc), pipeline_pdu,
+				    sizeof(pipeline_pdu)) != 0) {
+		ipc_client_log(client, "%s: submitting failed\n", __func__);
+		goto error;
+	}
+
+	/* Queued and outstanding mseqs are rejected */
+	if (ipc_sms_pipeline_submit(pipeline, 3, pipeline_smsc,
+				    sizeof(pipeline_smsc), pipeline_pdu,
+				    sizeof(pipeline_pdu)) != -1 ||
+	    ipc_sms_pipeline_submit(pipeline, 1, pipeline_smsc,
+				    sizeof(pipeline_smsc), pipeline_pdu,
+				    sizeof(pipeline_pdu)) != -1) {
+		ipc_client_log(client, "%s: duplicate mseq accepted\n",
+			       __func__);
+		goto error;
+	}
+
+	rc = pipeline_sent(fd, mseqs, sizeof(mseqs));
+	if (rc != 2 || mseqs[0] != 1 || mseqs[1] != 2) {
+		ipc_client_log(client, "%s: %d messages sent instead of 2\n",
+			       __func__, rc);
+		goto error;
+	}
+
+	/* The response frees a slot for the queued message */
+	if (pipeline_response(pipeline, 1, IPC_SMS_ACK_NO_ERROR, 0x10) != 1 ||
+	    results.count != 1 ||
+	    results.results[0].status != IPC_SMS_PIPELINE_STATUS_SENT ||
+	    results.results[0].reference != 0x10) {
+		ipc_client_log(client, "%s: response not reported\n",
+			       __func__);
+		goto error;
+	}
+
+	rc = pipeline_sent(fd, mseqs, sizeof(mseqs));
+	if (rc != 1 || mseqs[0] != 3) {
+		ipc_client_log(client, "%s: queued message not sent\n",
+			       __func__);
+		goto error;
+	}
+
+	if (pipeline_response(pipeline, 2, IPC_SMS_ACK_NO_ERROR, 0x11) != 1)
+		goto error;
+
+	/* The modem is gone: the message isn't kept */
+	close(fd);
+	fd = -1;
+
+	if (ipc_sms_pipeline_submit(pipeline, 4, pipeline_smsc,
+				    sizeof(pipeline_smsc), pipeline_pdu,
+				    sizeof(pipeline_pdu)) != -1 ||
+	    ipc_sms_pipeline_submit(pipeline, 4, pipeline_smsc,
+				    sizeof(pipeline_smsc), pipeline_pdu,
+				    sizeof(pipeline_pdu)) != -1) {
+		ipc_client_log(client, "%s: sending to a closed modem"
+			       " succeeded\n", __func__);
+		goto error;
+	}
+
+	ipc_sms_pipeline_stats_get(pipeline, &stats);
+
+	if (stats.submitted != 3 || stats.sent != 2 || stats.queued != 0 ||
+	    stats.outstanding != 1) {
+		ipc_client_log(client, "%s: %lu submitted, %lu sent, %u queued,"
+			       " %u outstanding\n", __func__, stats.submitted,
+			       stats.sent, stats.queued, stats.outstanding);
+		goto error;
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	if (fd >= 0)
+		close(fd);
+
+	ipc_sms_pipeline_destroy(pipeline);
+	ipc_client_destroy(fmt_client);
+
+	return rc;
+}
+
+/*
+ * The status reports are matched by TP-MR, the pending ones don't complete
+ * the message, and the failed requests are matched by mseq.
+ */
+int test_sms_pipeline_reports(struct ipc_client *client)
+{
+	struct ipc_sms_pipeline *pipeline = NULL;
+	struct ipc_gen_phone_res_data phone_res;
+	struct pipeline_results results;
+	struct ipc_client *fmt_client;
+	struct ipc_message message;
+	unsigned char mseqs[4];
+	int fd = -1;
+	int rc;
+
+	memset(&results, 0, sizeof(results));
+
+	fmt_client = pipeline_client_create(&fd);
+	if (fmt_client == NULL)
+		return -1;
+
+	pipeline = ipc_sms_pipeline_create(fmt_client, PIPELINE_WINDOW,
+					   PIPELINE_TIMEOUT, 0,
+					   pipeline_callback, &results);
+	if (pipeline == NULL)
+		goto error;
+
+	if (ipc_sms_pipeline_submit(pipeline, 1, pipeline_smsc,
+				    sizeof(pipeline_smsc), pipeline_pdu_report,
+				    sizeof(pipeline_pdu_report)) != 1 ||
+	    ipc_sms_pipeline_submit(pipeline, 2, pipeline_smsc,
+				    sizeof(pipeline_smsc), pipeline_pdu,
+				    sizeof(pipeline_pdu)) != 1) {
+		ipc_client_log(client, "%s: submitting failed\n", __func__);
+		goto error;
+	}
+
+	if (pipeline_sent(fd, mseqs, sizeof(mseqs)) != 2)
+		goto error;
+
+	if (pipeline_response(pipeline, 1, IPC_SMS_ACK_NO_ERROR, 0x42) != 1)
+		goto error;
+
+	/* Another reference, then the SC is still trying */
+	if (pipeline_status_report(pipeline, 0x41, 0x00) != 0 ||
+	    pipeline_status_report(pipeline, 0x42, 0x20) != 1 ||
+	    results.count != 1) {
+		ipc_client_log(client, "%s: status report matched too early\n",
+			       __func__);
+		goto error;
+	}
+
+	if (pipeline_status_report(pipeline, 0x42, 0x00) != 1 ||
+	    results.count != 2 ||
+	    results.results[1].mseq != 1 ||
+	    results.results[1].status != IPC_SMS_PIPELINE_STATUS_DELIVERED) {
+		ipc_client_log(client, "%s: status report not matched\n",
+			       __func__);
+		goto error;
+	}
+
+	memset(&phone_res, 0, sizeof(phone_res));
+	phone_res.group = IPC_GROUP(IPC_SMS_SEND_MSG);
+	phone_res.index = IPC_INDEX(IPC_SMS_SEND_MSG);
+	phone_res.type = IPC_TYPE_EXEC;
+	phone_res.code = 0x0003;
+
+	memset(&message, 0, sizeof(message));
+	message.aseq = 2;
+	message.command = IPC_GEN_PHONE_RES;
+	message.type = IPC_TYPE_RESP;
+	message.data = &phone_res;
+	message.size = sizeof(phone_res);
+
+	if (ipc_sms_pipeline_handle(pipeline, &message) != 1 ||
+	    results.count != 3 || results.results[2].mseq != 2 ||
+	    results.results[2].status != IPC_SMS_PIPELINE_STATUS_FAILED) {
+		ipc_client_log(client, "%s: failed request not reported\n",
+			       __func__);
+		goto error;
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	if (fd >= 0)
+		close(fd);
+
+	ipc_sms_pipeline_destroy(pipeline);
+	ipc_client_destroy(fmt_client);
+
+	return rc;
+}
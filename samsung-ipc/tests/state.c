@@ -0,0 +1,297 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <samsung-ipc.h>
+
+/* libsamsung-ipc internal headers */
+#include <ipc.h>
+
+#include "state.h"
+
+/*
+ * The state store is fed with the messages directly, as ipc_client_recv
+ * would after receiving them.
+ */
+
+#define STATE_MASK(field)	IPC_CLIENT_STATE_MASK(IPC_CLIENT_STATE_##field)
+
+struct state_calls {
+	unsigned int count;
+	unsigned int changed;
+	unsigned char rssi;
+};
+
+static void state_update(struct ipc_client *client, unsigned short command,
+			 unsigned char type, const void *data, size_t size)
+{
+	struct ipc_message message;
+
+	memset(&message, 0, sizeof(message));
+	message.command = command;
+	message.type = type;
+	message.data = (void *) data;
+	message.size = size;
+
+	ipc_client_state_update(client, &message);
+}
+
+static void state_icon_info(struct ipc_client *client, unsigned char flags,
+			    unsigned char rssi, unsigned char hdr_rssi,
+			    unsigned char battery)
+{
+	struct ipc_disp_icon_info_response_data data;
+
+	data.flags = flags;
+	data.rssi = rssi;
+	data.hdr_rssi = hdr_rssi;
+	data.battery = battery;
+
+	state_update(client, IPC_DISP_ICON_INFO, IPC_TYPE_NOTI, &data,
+		     sizeof(data));
+}
+
+static void state_callback(void *data, unsigned int changed,
+			   const struct ipc_client_state *state)
+{
+	struct state_calls *calls = (struct state_calls *) data;
+
+	calls->count++;
+	calls->changed = changed;
+	calls->rssi = state->rssi;
+}
+
+static struct ipc_client *state_client_create(void)
+{
+	struct ipc_client *client;
+
+	client = ipc_client_create(IPC_CLIENT_TYPE_DUMMY);
+	if (client == NULL)
+		return NULL;
+
+	if (ipc_client_state_enable(client) < 0) {
+		ipc_client_destroy(client);
+		return NULL;
+	}
+
+	return client;
+}
+
+int test_state_store(struct ipc_client *client)
+{
+	struct ipc_net_serving_network_data serving_network;
+	struct ipc_net_regist_response_data regist;
+	struct ipc_gprs_hsdpa_status_data hsdpa_status;
+	struct ipc_disp_rssi_info_data rssi_info;
+	struct ipc_client *state_client;
+	struct ipc_client_state state;
+	int rc = -1;
+
+	state_client = state_client_create();
+	if (state_client == NULL)
+		return -1;
+
+	if (ipc_client_state_get(state_client, &state) < 0 ||
+	    state.valid != 0) {
+		ipc_client_log(client, "%s: state valid before any update\n",
+			       __func__);
+		goto complete;
+	}
+
+	memset(&regist, 0, sizeof(regist));
+	regist.act = IPC_NET_ACCESS_TECHNOLOGY_UMTS;
+	regist.domain = IPC_NET_SERVICE_DOMAIN_GPRS;
+	regist.status = IPC_NET_REGISTRATION_STATUS_HOME;
+	regist.lac = 0x1234;
+	regist.cid = 0x56789;
+	state_update(state_client, IPC_NET_REGIST, IPC_TYPE_NOTI, &regist,
+		     sizeof(regist));
+
+	/* The requests don't report anything */
+	regist.domain = IPC_NET_SERVICE_DOMAIN_GSM;
+	state_update(state_client, IPC_NET_REGIST, IPC_TYPE_GET, &regist,
+		     sizeof(regist));
+
+	memset(&serving_network, 0, sizeof(serving_network));
+	memcpy(serving_network.plmn, "20801f", 6);
+	serving_network.lac = 0x4321;
+	state_update(state_client, IPC_NET_SERVING_NETWORK, IPC_TYPE_RESP,
+		     &serving_network, sizeof(serving_network));
+
+	rssi_info.rssi = 0x42;
+	state_update(state_client, IPC_DISP_RSSI_INFO, IPC_TYPE_NOTI,
+		     &rssi_info, sizeof(rssi_info));
+
+	/* Truncated messages are ignored */
+	hsdpa_status.status = 1;
+	state_update(state_client, IPC_GPRS_HSDPA_STATUS, IPC_TYPE_NOTI,
+		     &hsdpa_status, 0);
+
+	ipc_client_state_get(state_client, &state);
+
+	if (state.valid != (STATE_MASK(REGIST_GPRS) |
+			    STATE_MASK(SERVING_NETWORK) | STATE_MASK(RSSI)) ||
+	    state.regist_gprs.act != IPC_NET_ACCESS_TECHNOLOGY_UMTS ||
+	    state.regist_gprs.status != IPC_NET_REGISTRATION_STATUS_HOME ||
+	    state.regist_gprs.lac != 0x1234 ||
+	    state.regist_gprs.cid != 0x56789 ||
+	    strcmp(state.plmn, "20801f") || state.lac != 0x4321 ||
+	    state.rssi != 0x42 ||
+	    state.timestamps[IPC_CLIENT_STATE_RSSI] == 0 ||
+	    state.timestamps[IPC_CLIENT_STATE_REGIST_GSM] != 0) {
+		ipc_client_log(client, "%s: wrong state\n", __func__);
+		goto complete;
+	}
+
+	rc = 0;
+
+complete:
+	ipc_client_destroy(state_client);
+
+	return rc;
+}
+
+int test_state_icon_info(struct ipc_client *client)
+{
+	struct ipc_client *state_client;
+	struct ipc_client_state state;
+	int rc = -1;
+
+	state_client = state_client_create();
+	if (state_client == NULL)
+		return -1;
+
+	/* HDR RSSI is its own value, not RSSI and battery together */
+	state_icon_info(state_client, IPC_DISP_ICON_INFO_FLAG_HDR_RSSI, 1, 2,
+			3);
+	ipc_client_state_get(state_client, &state);
+
+	if (state.valid != STATE_MASK(HDR_RSSI) || state.hdr_rssi != 2) {
+		ipc_client_log(client, "%s: wrong HDR RSSI decoding\n",
+			       __func__);
+		goto complete;
+	}
+
+	state_icon_info(state_client, IPC_DISP_ICON_INFO_FLAG_RSSI, 4, 5, 6);
+	state_icon_info(state_client, IPC_DISP_ICON_INFO_FLAG_BATTERY, 7, 8,
+			9);
+	ipc_client_state_get(state_client, &state);
+
+	if (state.rssi != 4 || state.hdr_rssi != 2 || state.battery != 9) {
+		ipc_client_log(client, "%s: wrong single icon decoding\n",
+			       __func__);
+		goto complete;
+	}
+
+	state_icon_info(state_client, IPC_DISP_ICON_INFO_FLAG_ALL, 10, 11,
+			12);
+	ipc_client_state_get(state_client, &state);
+
+	if (state.valid != (STATE_MASK(RSSI) | STATE_MASK(HDR_RSSI) |
+			    STATE_MASK(BATTERY)) ||
+	    state.rssi != 10 || state.hdr_rssi != 11 || state.battery != 12) {
+		ipc_client_log(client, "%s: wrong decoding of all icons\n",
+			       __func__);
+		goto complete;
+	}
+
+	rc = 0;
+
+complete:
+	ipc_client_destroy(state_client);
+
+	return rc;
+}
+
+int test_state_subscriptions(struct ipc_client *client)
+{
+	struct state_calls calls;
+	struct ipc_client *state_client;
+	int ids[IPC_CLIENT_STATE_COUNT + 8];
+	unsigned int count = 0;
+	unsigned int i;
+	int rc = -1;
+	int id;
+
+	state_client = state_client_create();
+	if (state_client == NULL)
+		return -1;
+
+	memset(&calls, 0, sizeof(calls));
+
+	id = ipc_client_state_subscribe(state_client, STATE_MASK(RSSI),
+					state_callback, &calls);
+	if (id < 0)
+		goto complete;
+
+	state_icon_info(state_client, IPC_DISP_ICON_INFO_FLAG_RSSI, 20, 0, 0);
+	if (calls.count != 1 || calls.changed != STATE_MASK(RSSI) ||
+	    calls.rssi != 20) {
+		ipc_client_log(client, "%s: no call on change\n", __func__);
+		goto complete;
+	}
+
+	/* Neither the same value again nor another field call it */
+	state_icon_info(state_client, IPC_DISP_ICON_INFO_FLAG_RSSI, 20, 0, 0);
+	state_icon_info(state_client, IPC_DISP_ICON_INFO_FLAG_BATTERY, 0, 0,
+			50);
+	if (calls.count != 1) {
+		ipc_client_log(client, "%s: call without change\n", __func__);
+		goto complete;
+	}
+
+	if (ipc_client_state_unsubscribe(state_client, id) < 0)
+		goto complete;
+
+	state_icon_info(state_client, IPC_DISP_ICON_INFO_FLAG_RSSI, 21, 0, 0);
+	if (calls.count != 1) {
+		ipc_client_log(client, "%s: call after unsubscribing\n",
+			       __func__);
+		goto complete;
+	}
+
+	/* The table is limited, and then rejects the subscriptions */
+	for (i = 0; i < sizeof(ids) / sizeof(ids[0]); i++) {
+		ids[i] = ipc_client_state_subscribe(state_client,
+						    STATE_MASK(BATTERY),
+						    state_callback, &calls);
+		if (ids[i] >= 0)
+			count++;
+	}
+
+	if (count == 0 || count == sizeof(ids) / sizeof(ids[0])) {
+		ipc_client_log(client, "%s: wrong subscription limit\n",
+			       __func__);
+		goto complete;
+	}
+
+	state_icon_info(state_client, IPC_DISP_ICON_INFO_FLAG_BATTERY, 0, 0,
+			60);
+	if (calls.count != 1 + count) {
+		ipc_client_log(client, "%s: not every subscriber called\n",
+			       __func__);
+		goto complete;
+	}
+
+	rc = 0;
+
+complete:
+	ipc_client_destroy(state_client);
+
+	return rc;
+}
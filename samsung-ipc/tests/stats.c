@@ -0,0 +1,191 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <samsung-ipc.h>
+
+#include "stats.h"
+
+#define STATS_COMMANDS		4
+
+#define COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+static struct ipc_client *stats_client_create(int *fd)
+{
+	struct ipc_client *client;
+
+	client = ipc_client_create(IPC_CLIENT_TYPE_FMT);
+	if (client == NULL)
+		return NULL;
+
+	*fd = ipc_client_loopback_open(client);
+	if (*fd < 0)
+		goto error;
+
+	if (ipc_client_stats_enable(client) < 0) {
+		close(*fd);
+		goto error;
+	}
+
+	return client;
+
+error:
+	ipc_client_destroy(client);
+
+	return NULL;
+}
+
+/* The modem answers the request with the given sequence */
+static int stats_response(struct ipc_client *client, int fd,
+			  unsigned short command, unsigned char aseq,
+			  const void *data, size_t size)
+{
+	unsigned char frame[sizeof(struct ipc_fmt_header) + 16];
+	struct ipc_fmt_header header;
+	struct ipc_message message;
+	int rc;
+
+	memset(&message, 0, sizeof(message));
+	message.aseq = aseq;
+	message.command = command;
+	message.type = IPC_TYPE_RESP;
+	message.size = size;
+
+	ipc_fmt_header_setup(&header, &message);
+
+	memcpy(frame, &header, sizeof(header));
+	if (size > 0)
+		memcpy(frame + sizeof(header), data, size);
+
+	if (write(fd, frame, sizeof(header) + size) !=
+	    (ssize_t) (sizeof(header) + size))
+		return -1;
+
+	memset(&message, 0, sizeof(message));
+
+	rc = ipc_client_recv(client, &message);
+	if (message.data != NULL)
+		free(message.data);
+
+	return rc;
+}
+
+static const struct ipc_client_stats *stats_find(
+	const struct ipc_client_stats *stats, int count,
+	unsigned short command)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (stats[i].command == command)
+			return &stats[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * The requests whose sequence is used again before they got a response are
+ * unanswered, including for commands that never got any response.
+ */
+int test_stats_unanswered(struct ipc_client *client)
+{
+	const struct {
+		unsigned short command;
+		unsigned long count;
+		unsigned long unanswered;
+	} expected[] = {
+		{ IPC_MISC_ME_SN, 0, 2 },
+		{ IPC_MISC_ME_VERSION, 1, 0 },
+		{ IPC_CALL_OUTGOING, 1, 0 },
+	};
+	struct ipc_client_stats stats[STATS_COMMANDS];
+	struct ipc_gen_phone_res_data data;
+	const struct ipc_client_stats *found;
+	struct ipc_client *fmt_client;
+	unsigned int i;
+	int count;
+	int fd;
+	int rc;
+
+	fmt_client = stats_client_create(&fd);
+	if (fmt_client == NULL)
+		return -1;
+
+	memset(&data, 0, sizeof(data));
+	data.group = IPC_GROUP(IPC_CALL_OUTGOING);
+	data.index = IPC_INDEX(IPC_CALL_OUTGOING);
+	data.type = IPC_TYPE_EXEC;
+	data.code = IPC_GEN_PHONE_RES_CODE_SUCCESS;
+
+	/* The same sequence is used again before the response */
+	if (ipc_client_send(fmt_client, 1, IPC_MISC_ME_SN, IPC_TYPE_GET,
+			    NULL, 0) < 0 ||
+	    ipc_client_send(fmt_client, 1, IPC_MISC_ME_VERSION, IPC_TYPE_GET,
+			    NULL, 0) < 0 ||
+	    stats_response(fmt_client, fd, IPC_MISC_ME_VERSION, 1, NULL,
+			   0) < 0) {
+		goto error;
+	}
+
+	if (ipc_client_send(fmt_client, 2, IPC_CALL_OUTGOING, IPC_TYPE_EXEC,
+			    NULL, 0) < 0 ||
+	    stats_response(fmt_client, fd, IPC_GEN_PHONE_RES, 2, &data,
+			   sizeof(data)) < 0) {
+		goto error;
+	}
+
+	if (ipc_client_send(fmt_client, 3, IPC_MISC_ME_SN, IPC_TYPE_GET,
+			    NULL, 0) < 0 ||
+	    ipc_client_send(fmt_client, 3, IPC_MISC_ME_SN, IPC_TYPE_GET,
+			    NULL, 0) < 0) {
+		goto error;
+	}
+
+	count = ipc_client_stats_get(fmt_client, stats, STATS_COMMANDS);
+	if (count != (int) COUNT(expected)) {
+		ipc_client_log(client, "%s: %d commands instead of %zu\n",
+			       __func__, count, COUNT(expected));
+		goto error;
+	}
+
+	for (i = 0; i < COUNT(expected); i++) {
+		found = stats_find(stats, count, expected[i].command);
+		if (found == NULL || found->count != expected[i].count ||
+		    found->unanswered != expected[i].unanswered) {
+			ipc_client_log(client, "%s: wrong stats for command"
+				       " 0x%04x\n", __func__,
+				       expected[i].command);
+			goto error;
+		}
+	}
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+complete:
+	close(fd);
+	ipc_client_destroy(fmt_client);
+
+	return rc;
+}
@@ -0,0 +1,275 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <samsung-ipc.h>
+
+#include "views.h"
+
+/*
+ * Every frame of the corpus is exactly as long as it needs to be: any
+ * truncated copy of it must be rejected, and the copies are allocated with
+ * their exact size so that out of bounds reads can be caught by tools like
+ * valgrind or AddressSanitizer.
+ */
+
+struct view_frame {
+	const char *name;
+	const unsigned char *data;
+	size_t size;
+	int (*view)(const void *data, size_t size, struct ipc_data_view *view);
+	size_t view_size;
+};
+
+struct list_frame {
+	const char *name;
+	const unsigned char *data;
+	size_t size;
+	int (*setup)(struct ipc_list_iterator *iterator, const void *data,
+		     size_t size);
+	unsigned int count;
+};
+
+static const unsigned char sms_incoming_msg[] = {
+	/* msg_type, type, sim_index, id, length */
+	0x02, 0x01, 0x00, 0x00, 0x00, 0x04,
+	/* PDU */
+	0x00, 0x01, 0x02, 0x03,
+};
+
+static const unsigned char sms_svc_center_addr[] = {
+	0x07, 0x91, 0x33, 0x86, 0x09, 0x40, 0x00, 0xf0,
+};
+
+static const unsigned char sec_rsim_access[] = {
+	/* sw1, sw2, length */
+	0x90, 0x00, 0x03,
+	0x98, 0x10, 0x20,
+};
+
+static const unsigned char misc_me_imsi[] = {
+	0x0f,
+	'2', '0', '8', '1', '5', '0', '1', '2', '3', '4', '5', '6', '7', '8',
+	'9',
+};
+
+static const unsigned char misc_me_sn[] = {
+	/* type, length */
+	0x01, 0x0f,
+	'3', '5', '5', '9', '2', '1', '0', '4', '1', '2', '3', '4', '5', '6',
+	'7', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static const unsigned char net_serving_network[] = {
+	0x00, 0x00, 0x00,
+	'2', '0', '8', '1', '5', '#',
+	0x34, 0x12,
+};
+
+static const unsigned char net_plmn_list[] = {
+	0x02,
+	0x02, '2', '0', '8', '0', '1', '#', 0x02, 0x00, 0x00,
+	0x01, '2', '0', '8', '1', '5', '#', 0x02, 0x00, 0x00,
+};
+
+static const unsigned char call_list[] = {
+	0x02,
+	0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x03, 0x00, '1', '1', '2',
+	0x00, 0x01, 0x02, 0x01, 0x02, 0x00, 0x00, 0x00,
+};
+
+static const unsigned char svc_display_screen[] = {
+	0x01,
+	0x00, 0x00,
+	'E', 'C', 'I', 'O', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static const struct view_frame view_frames[] = {
+	{
+		"sms_incoming_msg_pdu",
+		sms_incoming_msg, sizeof(sms_incoming_msg),
+		ipc_sms_incoming_msg_pdu_view, 4,
+	},
+	{
+		"sms_svc_center_addr_smsc",
+		sms_svc_center_addr, sizeof(sms_svc_center_addr),
+		ipc_sms_svc_center_addr_smsc_view, 7,
+	},
+	{
+		"sec_rsim_access",
+		sec_rsim_access, sizeof(sec_rsim_access),
+		ipc_sec_rsim_access_view, 3,
+	},
+	{
+		"misc_me_imsi_imsi",
+		misc_me_imsi, sizeof(misc_me_imsi),
+		ipc_misc_me_imsi_imsi_view, 15,
+	},
+	{
+		"misc_me_sn",
+		misc_me_sn, sizeof(misc_me_sn),
+		ipc_misc_me_sn_view, 15,
+	},
+	{
+		"net_serving_network_plmn",
+		net_serving_network, sizeof(net_serving_network),
+		ipc_net_serving_network_plmn_view, 5,
+	},
+};
+
+static const struct list_frame list_frames[] = {
+	{
+		"net_plmn_list",
+		net_plmn_list, sizeof(net_plmn_list),
+		ipc_net_plmn_list_iterator_setup, 2,
+	},
+	{
+		"call_list",
+		call_list, sizeof(call_list),
+		ipc_call_list_iterator_setup, 2,
+	},
+	{
+		"svc_display_screen",
+		svc_display_screen, sizeof(svc_display_screen),
+		ipc_svc_display_screen_iterator_setup, 1,
+	},
+};
+
+#define COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+static unsigned int list_frame_walk(const struct list_frame *frame,
+				    struct ipc_list_iterator *iterator)
+{
+	unsigned int count = 0;
+
+	if (frame->setup == ipc_net_plmn_list_iterator_setup) {
+		while (ipc_net_plmn_list_iterator_next(iterator) != NULL)
+			count++;
+	} else if (frame->setup == ipc_call_list_iterator_setup) {
+		while (ipc_call_list_iterator_next(iterator) != NULL)
+			count++;
+	} else {
+		while (ipc_svc_display_screen_iterator_next(iterator) != NULL)
+			count++;
+	}
+
+	return count;
+}
+
+int test_views_valid_frames(struct ipc_client *client)
+{
+	struct ipc_list_iterator iterator;
+	struct ipc_data_view view;
+	unsigned int count;
+	unsigned int i;
+	int rc;
+
+	for (i = 0; i < COUNT(view_frames); i++) {
+		rc = view_frames[i].view(view_frames[i].data,
+					 view_frames[i].size, &view);
+		if (rc < 0 || view.size != view_frames[i].view_size ||
+		    (const unsigned char *) view.data < view_frames[i].data ||
+		    (const unsigned char *) view.data + view.size >
+		    view_frames[i].data + view_frames[i].size) {
+			ipc_client_log(client, "%s: %s: wrong view\n",
+				       __func__, view_frames[i].name);
+			return -1;
+		}
+
+		rc = view_frames[i].view(NULL, view_frames[i].size, &view);
+		if (rc != -1) {
+			ipc_client_log(client, "%s: %s: NULL data accepted\n",
+				       __func__, view_frames[i].name);
+			return -1;
+		}
+	}
+
+	for (i = 0; i < COUNT(list_frames); i++) {
+		rc = list_frames[i].setup(&iterator, list_frames[i].data,
+					  list_frames[i].size);
+		if (rc < 0) {
+			ipc_client_log(client, "%s: %s: setup failed\n",
+				       __func__, list_frames[i].name);
+			return -1;
+		}
+
+		count = list_frame_walk(&list_frames[i], &iterator);
+		if (count != list_frames[i].count) {
+			ipc_client_log(client, "%s: %s: %u entries instead of"
+				       " %u\n", __func__, list_frames[i].name,
+				       count, list_frames[i].count);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int test_views_truncated_frames(struct ipc_client *client)
+{
+	struct ipc_list_iterator iterator;
+	struct ipc_data_view view;
+	unsigned char *data;
+	size_t size;
+	unsigned int i;
+	int rc;
+
+	for (i = 0; i < COUNT(view_frames); i++) {
+		for (size = 0; size < view_frames[i].size; size++) {
+			data = malloc(size ? size : 1);
+			if (data == NULL)
+				return -1;
+
+			memcpy(data, view_frames[i].data, size);
+			rc = view_frames[i].view(data, size, &view);
+			free(data);
+
+			if (rc != -1) {
+				ipc_client_log(client, "%s: %s: frame"
+					       " truncated to %zu bytes"
+					       " accepted\n", __func__,
+					       view_frames[i].name, size);
+				return -1;
+			}
+		}
+	}
+
+	for (i = 0; i < COUNT(list_frames); i++) {
+		for (size = 0; size < list_frames[i].size; size++) {
+			data = malloc(size ? size : 1);
+			if (data == NULL)
+				return -1;
+
+			memcpy(data, list_frames[i].data, size);
+			rc = list_frames[i].setup(&iterator, data, size);
+			free(data);
+
+			if (rc != -1) {
+				ipc_client_log(client, "%s: %s: list"
+					       " truncated to %zu bytes"
+					       " accepted\n", __func__,
+					       list_frames[i].name, size);
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
@@ -489,6 +489,96 @@ complete:
 	return rc;
 }
 
+/*
+ * Hexadecimal conversion is table driven: encoding stores the two digits of
+ * each byte at once from a table of all the digit pairs and decoding looks
+ * each digit up in a table where anything else than a hexadecimal digit is
+ * marked as invalid with 0xff.
+ */
+static const char hex_pairs[513] =
+	"000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+	"202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+	"404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+	"606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+	"808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+	"a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+	"c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+	"e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+static const unsigned char hex_values[256] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	0x08, 0x09, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
+static int hex_decode(const char *string, size_t length, unsigned char *p,
+		      int strict)
+{
+	unsigned char high;
+	unsigned char low;
+	size_t i = 0;
+
+	/* An odd digit count gives a first byte holding a single digit */
+	if (length % 2 != 0) {
+		low = hex_values[(unsigned char) string[0]];
+		if (low == 0xff) {
+			if (strict)
+				return -1;
+			low = 0;
+		}
+
+		*p++ = low;
+		i++;
+	}
+
+	for (; i < length; i += 2) {
+		high = hex_values[(unsigned char) string[i]];
+		low = hex_values[(unsigned char) string[i + 1]];
+
+		if ((high | low) & 0xf0) {
+			if (strict)
+				return -1;
+			if (high == 0xff)
+				high = 0;
+			if (low == 0xff)
+				low = 0;
+		}
+
+		*p++ = (high << 4) | low;
+	}
+
+	return 0;
+}
+
 size_t data2string_length(const void *data, size_t size)
 {
 	size_t length;
@@ -501,12 +591,33 @@ size_t data2string_length(const void *data, size_t size)
 	return length;
 }
 
+int data2string_into(const void *data, size_t size, char *string,
+		     size_t length)
+{
+	const unsigned char *p;
+	size_t i;
+
+	if (data == NULL || size == 0 || string == NULL)
+		return -1;
+
+	if (length < data2string_length(data, size))
+		return -1;
+
+	p = (const unsigned char *) data;
+
+	for (i = 0; i < size; i++)
+		memcpy(&string[i * 2], &hex_pairs[p[i] * 2], 2);
+
+	string[size * 2] = '\0';
+
+	return size * 2;
+}
+
 char *data2string(const void *data, size_t size)
 {
 	char *string;
 	size_t length;
-	char *p;
-	size_t i;
+	int rc;
 
 	if (data == NULL || size == 0)
 		return NULL;
@@ -515,13 +626,14 @@ char *data2string(const void *data, size_t size)
 	if (length == 0)
 		return NULL;
 
-	string = (char *) calloc(1, length);
-
-	p = string;
+	string = (char *) malloc(length);
+	if (string == NULL)
+		return NULL;
 
-	for (i = 0; i < size; i++) {
-		sprintf(p, "%02x", *((unsigned char *) data + i));
-		p += 2 * sizeof(char);
+	rc = data2string_into(data, size, string, length);
+	if (rc < 0) {
+		free(string);
+		return NULL;
 	}
 
 	return string;
@@ -547,16 +659,35 @@ size_t string2data_size(const char *string)
 	return size;
 }
 
+int string2data_into(const char *string, void *data, size_t size)
+{
+	size_t length;
+	size_t count;
+	int rc;
+
+	if (string == NULL || data == NULL)
+		return -1;
+
+	length = strlen(string);
+	if (length == 0)
+		return -1;
+
+	count = (length + 1) / 2;
+	if (size < count)
+		return -1;
+
+	rc = hex_decode(string, length, (unsigned char *) data, 1);
+	if (rc < 0)
+		return -1;
+
+	return count;
+}
+
 void *string2data(const char *string)
 {
 	void *data;
 	size_t size;
 	size_t length;
-	int shift;
-	unsigned char *p;
-	unsigned int b;
-	size_t i;
-	int rc;
 
 	if (string == NULL)
 		return NULL;
@@ -565,31 +696,16 @@ void *string2data(const char *string)
 	if (length == 0)
 		return NULL;
 
-	if (length % 2 == 0)
-		shift = 0;
-	else
-		shift = 1;
-
 	size = string2data_size(string);
 	if (size == 0)
 		return NULL;
 
-	data = calloc(1, size);
-
-	p = (unsigned char *) data;
-
-	for (i = 0; i < length; i++) {
-		rc = sscanf(&string[i], "%01x", &b);
-		if (rc < 1)
-			b = 0;
-
-		if ((shift % 2) == 0)
-			*p |= ((b & 0x0f) << 4);
-		else
-			*p++ |= b & 0x0f;
+	data = malloc(size);
+	if (data == NULL)
+		return NULL;
 
-		shift++;
-	}
+	/* Invalid digits are decoded as 0 */
+	hex_decode(string, length, (unsigned char *) data, 0);
 
 	return data;
 }
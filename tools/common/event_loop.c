@@ -0,0 +1,343 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <samsung-ipc.h>
+
+#include "event_loop.h"
+
+/* Interval of the frames per second reports, in milliseconds */
+#define EVENT_LOOP_REPORT_INTERVAL	1000
+
+/*
+ * The loop blocks in ipc_client_poll_deadline until a frame arrives or the
+ * first timer expires, and then handles all the frames that are already
+ * available before polling again.
+ */
+
+struct event_loop_timer {
+	int id;
+	struct timespec deadline;
+	int (*callback)(struct event_loop *loop, void *data);
+	void *data;
+	struct event_loop_timer *next;
+};
+
+struct event_loop {
+	struct ipc_client *client;
+	int (*handler)(struct ipc_client *client, struct ipc_message *message,
+		       void *data);
+	void *data;
+
+	/* Sorted by deadline */
+	struct event_loop_timer *timers;
+	int timer_id;
+
+	void (*log_callback)(void *log_data, const char *message);
+	void *log_data;
+	int report_id;
+	unsigned long frames;
+	unsigned long frames_total;
+	struct timespec start;
+};
+
+static void event_loop_log(struct event_loop *loop, const char *message, ...)
+{
+	char buffer[256];
+	va_list args;
+
+	if (loop->log_callback == NULL)
+		return;
+
+	va_start(args, message);
+	vsnprintf(buffer, sizeof(buffer), message, args);
+	loop->log_callback(loop->log_data, buffer);
+	va_end(args);
+}
+
+static int timespec_compare(const struct timespec *a,
+			    const struct timespec *b)
+{
+	if (a->tv_sec != b->tv_sec)
+		return a->tv_sec < b->tv_sec ? -1 : 1;
+
+	if (a->tv_nsec != b->tv_nsec)
+		return a->tv_nsec < b->tv_nsec ? -1 : 1;
+
+	return 0;
+}
+
+struct event_loop *event_loop_create(
+	struct ipc_client *client,
+	int (*handler)(struct ipc_client *client, struct ipc_message *message,
+		       void *data),
+	void *data)
+{
+	struct event_loop *loop;
+
+	if (client == NULL || handler == NULL)
+		return NULL;
+
+	loop = calloc(1, sizeof(struct event_loop));
+	if (loop == NULL)
+		return NULL;
+
+	loop->client = client;
+	loop->handler = handler;
+	loop->data = data;
+	loop->report_id = -1;
+
+	return loop;
+}
+
+void event_loop_destroy(struct event_loop *loop)
+{
+	struct event_loop_timer *timer;
+
+	if (loop == NULL)
+		return;
+
+	while (loop->timers != NULL) {
+		timer = loop->timers;
+		loop->timers = timer->next;
+		free(timer);
+	}
+
+	free(loop);
+}
+
+int event_loop_timer_add(struct event_loop *loop, unsigned int timeout,
+			 int (*callback)(struct event_loop *loop, void *data),
+			 void *data)
+{
+	struct event_loop_timer **p;
+	struct event_loop_timer *timer;
+
+	if (loop == NULL || callback == NULL)
+		return -1;
+
+	timer = calloc(1, sizeof(struct event_loop_timer));
+	if (timer == NULL)
+		return -1;
+
+	if (ipc_client_deadline_set(&timer->deadline, timeout) < 0) {
+		free(timer);
+		return -1;
+	}
+
+	timer->id = loop->timer_id++;
+	if (loop->timer_id < 0)
+		loop->timer_id = 0;
+
+	timer->callback = callback;
+	timer->data = data;
+
+	/* Timers with the same deadline fire in the order they were added */
+	p = &loop->timers;
+	while (*p != NULL &&
+	       timespec_compare(&(*p)->deadline, &timer->deadline) <= 0)
+		p = &(*p)->next;
+
+	timer->next = *p;
+	*p = timer;
+
+	return timer->id;
+}
+
+int event_loop_timer_remove(struct event_loop *loop, int id)
+{
+	struct event_loop_timer **p;
+	struct event_loop_timer *timer;
+
+	if (loop == NULL)
+		return -1;
+
+	for (p = &loop->timers; *p != NULL; p = &(*p)->next) {
+		if ((*p)->id == id) {
+			timer = *p;
+			*p = timer->next;
+			free(timer);
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+static int event_loop_report(struct event_loop *loop,
+			     __attribute__((unused)) void *data)
+{
+	if (loop->frames > 0) {
+		event_loop_log(loop, "Received %lu frames/s",
+			       loop->frames * 1000 /
+			       EVENT_LOOP_REPORT_INTERVAL);
+	}
+
+	loop->frames_total += loop->frames;
+	loop->frames = 0;
+
+	loop->report_id = event_loop_timer_add(loop,
+					       EVENT_LOOP_REPORT_INTERVAL,
+					       event_loop_report, NULL);
+
+	return -EAGAIN;
+}
+
+void event_loop_log_callback_register(
+	struct event_loop *loop,
+	void (*log_callback)(void *log_data, const char *message),
+	void *log_data)
+{
+	if (loop == NULL)
+		return;
+
+	loop->log_callback = log_callback;
+	loop->log_data = log_data;
+}
+
+static int event_loop_timers_run(struct event_loop *loop)
+{
+	struct event_loop_timer *timer;
+	struct timespec now;
+	int rc;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	while (loop->timers != NULL &&
+	       timespec_compare(&loop->timers->deadline, &now) <= 0) {
+		timer = loop->timers;
+		loop->timers = timer->next;
+
+		rc = timer->callback(loop, timer->data);
+		free(timer);
+
+		if (rc != -EAGAIN)
+			return rc;
+	}
+
+	return -EAGAIN;
+}
+
+static int event_loop_frames_handle(struct event_loop *loop)
+{
+	struct ipc_message message;
+	struct timeval timeout;
+	struct timespec now;
+	int rc;
+
+	do {
+		memset(&message, 0, sizeof(message));
+
+		/* Only what is already there is read */
+		ipc_client_deadline_set(&now, 0);
+
+		rc = ipc_client_recv_deadline(loop->client, &message, &now);
+		if (rc == IPC_CLIENT_RECV_TIMEOUT)
+			return -EAGAIN;
+		else if (rc < 0)
+			return rc;
+
+		loop->frames++;
+
+		rc = loop->handler(loop->client, &message, loop->data);
+
+		if (message.data != NULL)
+			free(message.data);
+
+		if (rc != -EAGAIN)
+			return rc;
+
+		timeout.tv_sec = 0;
+		timeout.tv_usec = 0;
+	} while (ipc_client_poll(loop->client, NULL, &timeout) > 0);
+
+	return -EAGAIN;
+}
+
+static void event_loop_summary(struct event_loop *loop)
+{
+	struct timespec now;
+	double seconds;
+
+	if (loop->log_callback == NULL)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	seconds = (now.tv_sec - loop->start.tv_sec) +
+		(now.tv_nsec - loop->start.tv_nsec) / 1000000000.0;
+	if (seconds <= 0)
+		return;
+
+	loop->frames_total += loop->frames;
+	loop->frames = 0;
+
+	event_loop_log(loop, "Received %lu frames in %.3f s: %.0f frames/s",
+		       loop->frames_total, seconds,
+		       loop->frames_total / seconds);
+}
+
+int event_loop_run(struct event_loop *loop)
+{
+	int rc;
+
+	if (loop == NULL)
+		return -1;
+
+	clock_gettime(CLOCK_MONOTONIC, &loop->start);
+	loop->frames = 0;
+	loop->frames_total = 0;
+
+	if (loop->log_callback != NULL && loop->report_id < 0) {
+		loop->report_id = event_loop_timer_add(
+			loop, EVENT_LOOP_REPORT_INTERVAL, event_loop_report,
+			NULL);
+	}
+
+	while (1) {
+		rc = ipc_client_poll_deadline(
+			loop->client, NULL,
+			loop->timers != NULL ? &loop->timers->deadline : NULL);
+		if (rc < 0)
+			break;
+
+		if (rc > 0) {
+			rc = event_loop_frames_handle(loop);
+			if (rc != -EAGAIN)
+				break;
+		}
+
+		rc = event_loop_timers_run(loop);
+		if (rc != -EAGAIN)
+			break;
+	}
+
+	if (loop->report_id >= 0) {
+		event_loop_timer_remove(loop, loop->report_id);
+		loop->report_id = -1;
+	}
+
+	event_loop_summary(loop);
+
+	return rc;
+}
@@ -0,0 +1,51 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOOLS_EVENT_LOOP_H
+#define TOOLS_EVENT_LOOP_H
+
+#include <samsung-ipc.h>
+
+struct event_loop;
+
+/*
+ * The message handler and the timer callbacks return -EAGAIN to keep the
+ * loop running, 0 to make event_loop_run return 0, and any other negative
+ * value to make it return that error. The timers only fire once, and can be
+ * added again from their callback.
+ */
+struct event_loop *event_loop_create(
+	struct ipc_client *client,
+	int (*handler)(struct ipc_client *client, struct ipc_message *message,
+		       void *data),
+	void *data);
+void event_loop_destroy(struct event_loop *loop);
+
+int event_loop_timer_add(struct event_loop *loop, unsigned int timeout,
+			 int (*callback)(struct event_loop *loop, void *data),
+			 void *data);
+int event_loop_timer_remove(struct event_loop *loop, int id);
+
+/* With a log callback, the received frames per second are reported */
+void event_loop_log_callback_register(
+	struct event_loop *loop,
+	void (*log_callback)(void *log_data, const char *message),
+	void *log_data);
+
+int event_loop_run(struct event_loop *loop);
+
+#endif /* TOOLS_EVENT_LOOP_H */
@@ -28,9 +28,10 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include "event_loop.h"
 #include "modem.h"
 
-int seq;
+unsigned int seq;
 
 static enum modem_state current_state = MODEM_STATE_LPM;
 
@@ -60,17 +61,12 @@ void common_modem_log(struct ipc_client *client, const char *message, ...)
 /* Taken from tools/ipc-modem.c */
 int seq_get(void)
 {
-        if (seq == 0xff)
-                seq = 0x00;
-
-        seq++;
-
-        return seq;
+        return __atomic_fetch_add(&seq, 1, __ATOMIC_RELAXED) % 0xff + 1;
 }
 
 const char *modem_callback_state_string(unsigned char type)
 {
-        static char type_string[5] = { 0 };
+        static __thread char type_string[5] = { 0 };
 
         switch (type) {
         case MODEM_CALLBACK_STATE_UTILS:
@@ -327,28 +323,11 @@ static int modem_response_handle(struct ipc_client *client,
 	if (current_state == new_state)
 		callback_state = MODEM_CALLBACK_STATE_APP;
 
-	ipc_client_log(client,
-		       "%s: current_state %d: %s\n",
-		       __func__, current_state,
-		       modem_state_string(current_state));
-
-	ipc_client_log(client,
-		       "%s: new_state %d: %s\n",
-		       __func__, new_state,
+	ipc_client_log(client, "%s: %s, current_state %s, new_state %s\n",
+		       __func__, modem_callback_state_string(callback_state),
+		       modem_state_string(current_state),
 		       modem_state_string(new_state));
 
-	ipc_client_log(client,
-		       "%s: %s\n",
-		       __func__,
-		       (current_state == new_state) ?
-		       "current_state == new_state" :
-		       "current_state !== new_state");
-
-	ipc_client_log(client,
-		       "%s: callback state %d: %s\n",
-		       __func__, callback_state,
-		       modem_callback_state_string(callback_state));
-
 	if (callback_state == MODEM_CALLBACK_STATE_UTILS)
 		rc = modem_start_response_handle(client, resp, new_state);
 	else
@@ -357,13 +336,40 @@ static int modem_response_handle(struct ipc_client *client,
 	return rc;
 }
 
-/* TODO: share modem_read_loop and fix it elsewhere too */
+struct modem_read_data {
+	enum modem_state new_state;
+	struct app_modem_response_handler *handler;
+};
+
+static int modem_read_handle(struct ipc_client *client,
+			     struct ipc_message *resp, void *data)
+{
+	struct modem_read_data *read_data = data;
+	int rc;
+
+	rc = modem_response_handle(client, resp, read_data->new_state,
+				   read_data->handler);
+	if (rc == 0) {
+		/* The callback exited normally because it reached
+		 * new_state.
+		 * It's now to the app callback to take over
+		 */
+		if (callback_state == MODEM_CALLBACK_STATE_UTILS)
+			callback_state = MODEM_CALLBACK_STATE_APP;
+	} else if (rc != -EAGAIN) {
+		common_modem_log(client, "modem_response_handle: rc=%d", rc);
+	}
+
+	return rc;
+}
+
 /* TODO: new_state is not needed for the application */
 int modem_read_loop(struct ipc_client *client,
 		    enum modem_state new_state,
 		    struct app_modem_response_handler *handler)
 {
-	struct ipc_message resp;
+	struct modem_read_data read_data;
+	struct event_loop *loop;
 	int rc;
 
 	common_modem_log(client, "ENTER %s", __func__);
@@ -376,53 +382,20 @@ int modem_read_loop(struct ipc_client *client,
 	/* TODO: this is comming from the app */
 	ipc_imei_request_imei(client);
 
-	memset(&resp, 0, sizeof(resp));
+	read_data.new_state = new_state;
+	read_data.handler = handler;
 
-	while (1) {
-		usleep(3000);
+	loop = event_loop_create(client, modem_read_handle, &read_data);
+	if (loop == NULL)
+		return -ENOMEM;
 
-		common_modem_log(client, "%s: Starting ipc_client_poll", __func__);
-		rc = ipc_client_poll(client, NULL, NULL);
+	event_loop_log_callback_register(loop, modem_log_handler, "mdm");
 
-		common_modem_log(client, "%s: ipc_client_poll: %d", __func__, rc);
-		if (rc < 0)
-			continue;
+	rc = event_loop_run(loop);
 
-		common_modem_log(client, "%s: ipc_client_poll done", __func__);
+	event_loop_destroy(loop);
 
-		rc = ipc_client_recv(client, &resp);
-		if (rc < 0) {
-			if (resp.data != NULL)
-				free(resp.data);
-			return rc;
-		}
-
-		common_modem_log(client, "%s: Received response", __func__);
-
-		rc = modem_response_handle(client, &resp, new_state, handler);
-
-		if (rc == -EAGAIN)
-			common_modem_log(client, "modem_response_handle: rc=-EAGAIN");
-		else
-			common_modem_log(client, "modem_response_handle: rc=%d", rc);
-
-		if (resp.data != NULL)
-			free(resp.data);
-
-		if (rc == -EAGAIN) {
-			continue;
-		} else if (rc < 0) {
-			return rc;
-		} else if (rc == 0) {
-			/* The callback exited normally because it reached
-			 * new_state.
-			 * It's now to the app callback to take over
-			 */
-			if (callback_state == MODEM_CALLBACK_STATE_UTILS)
-				callback_state = MODEM_CALLBACK_STATE_APP;
-			return 0;
-		}
-	}
+	return rc;
 }
 
 static int _modem_start(struct ipc_client *client)
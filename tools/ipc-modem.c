@@ -19,6 +19,7 @@
  */
 
 #include <assert.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
 #include <pthread.h>
@@ -36,12 +37,14 @@
 
 #include <samsung-ipc.h>
 
+#include "common/event_loop.h"
+
 #define MODEM_STATE_LPM     0
 #define MODEM_STATE_NORMAL  2
 #define MODEM_STATE_SIM_OK  4
 
 int state = MODEM_STATE_LPM;
-int seq;
+unsigned int seq;
 int in_call;
 int out_call;
 int call_done;
@@ -49,14 +52,10 @@ int call_done;
 char call_number[14];
 char sim_pin[8];
 
+/* The sequence numbers go from 0x01 to 0xff, whatever thread sends */
 int seq_get(void)
 {
-	if (seq == 0xff)
-		seq = 0x00;
-
-	seq++;
-
-	return seq;
+	return __atomic_fetch_add(&seq, 1, __ATOMIC_RELAXED) % 0xff + 1;
 }
 
 void modem_snd_no_mic_mute(struct ipc_client *client)
@@ -376,37 +375,6 @@ void modem_response_handle(struct ipc_client *client, struct ipc_message *resp)
 }
 
 
-int modem_read_loop(struct ipc_client *client)
-{
-	struct ipc_message resp;
-	int rc;
-
-	memset(&resp, 0, sizeof(resp));
-
-	while (1) {
-		usleep(3000);
-
-		rc = ipc_client_poll(client, NULL, NULL);
-		if (rc < 0)
-			continue;
-
-		rc = ipc_client_recv(client, &resp);
-		if (rc < 0) {
-			printf("[E] "
-			       "Can't RECV from modem: please run this again"
-			       "\n");
-			break;
-		}
-
-		modem_response_handle(client, &resp);
-
-		if (resp.data != NULL)
-			free(resp.data);
-	}
-
-	return 0;
-}
-
 void modem_log_handler(__attribute__((unused)) void *user_data,
 		       const char *msg)
 {
@@ -435,6 +403,40 @@ void modem_log_handler_quiet(__attribute__((unused)) void *user_data,
 {
 }
 
+static int modem_read_handle(struct ipc_client *client,
+			     struct ipc_message *resp,
+			     __attribute__((unused)) void *data)
+{
+	modem_response_handle(client, resp);
+
+	return -EAGAIN;
+}
+
+int modem_read_loop(struct ipc_client *client, int debug)
+{
+	struct event_loop *loop;
+	int rc;
+
+	loop = event_loop_create(client, modem_read_handle, NULL);
+	if (loop == NULL)
+		return -1;
+
+	if (debug)
+		event_loop_log_callback_register(loop, modem_log_handler,
+						 NULL);
+
+	rc = event_loop_run(loop);
+	if (rc < 0) {
+		printf("[E] "
+		       "Can't RECV from modem: please run this again"
+		       "\n");
+	}
+
+	event_loop_destroy(loop);
+
+	return 0;
+}
+
 int modem_start(struct ipc_client *client)
 {
 	int rc = -1;
@@ -587,7 +589,7 @@ int main(int argc, char *argv[])
 			}
 
 			printf("[1] Starting modem_read_loop on FMT client\n");
-			modem_read_loop(client_fmt);
+			modem_read_loop(client_fmt, debug);
 
 			modem_stop(client_fmt);
 		} else {
@@ -0,0 +1,674 @@
+/*
+ * This file is part of libsamsung-ipc.
+ *
+ * libsamsung-ipc is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * libsamsung-ipc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <samsung-ipc.h>
+
+/* Larger records can only come from a corrupted capture */
+#define RECORD_DATA_SIZE_MAX	0x1000000
+
+struct replay_client {
+	struct ipc_client *client;
+	int fd;
+};
+
+struct replay_command {
+	unsigned short command;
+	unsigned char direction;
+	unsigned long count;
+	unsigned long long time_total;
+	unsigned long long time_max;
+};
+
+struct replay {
+	struct replay_client clients[2];
+	struct replay_command *commands;
+	size_t commands_count;
+	size_t commands_size;
+	unsigned long messages;
+	unsigned long long bytes;
+	bool fast;
+	bool verbose;
+	bool stats;
+	bool histograms;
+};
+
+void usage_print(void)
+{
+	printf("Usage: ipc-replay [-f|--fast] [-s|--stats] [-H|--histograms]"
+	       " [-v|--verbose] CAPTURE\n");
+	printf("\n");
+	printf("Plays a capture made with ipc_client_capture_open back into\n");
+	printf("clients that use a loopback transport, at the recorded pacing\n");
+	printf("or with --fast as fast as possible, and prints the throughput\n");
+	printf("and the time taken to handle each command. With --verbose\n");
+	printf("the library messages are printed too, which slows it down.\n");
+	printf("\n");
+	printf("With --stats, the round trip times of the requests that the\n");
+	printf("library measured are printed for each command, and with\n");
+	printf("--histograms their histograms too. They only match the ones\n");
+	printf("of the capture when it is played at the recorded pacing.\n");
+}
+
+void log_callback(__attribute__((unused)) void *data, const char *message)
+{
+	if (message == NULL)
+		return;
+
+	fprintf(stderr, "[ipc] %s\n", message);
+}
+
+static unsigned long long time_us(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (unsigned long long) (now.tv_sec - start->tv_sec) * 1000000 +
+		(now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+static void time_wait(const struct timespec *start,
+		      unsigned long long timestamp)
+{
+	struct timespec target;
+
+	target.tv_sec = start->tv_sec + timestamp / 1000000;
+	target.tv_nsec = start->tv_nsec + (timestamp % 1000000) * 1000;
+	if (target.tv_nsec >= 1000000000) {
+		target.tv_sec++;
+		target.tv_nsec -= 1000000000;
+	}
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target,
+			       NULL) == EINTR)
+		continue;
+}
+
+static int replay_command_add(struct replay *replay, unsigned char direction,
+			      unsigned short command,
+			      unsigned long long time)
+{
+	struct replay_command *entry = NULL;
+	struct replay_command *p;
+	size_t i;
+
+	for (i = 0; i < replay->commands_count; i++) {
+		if (replay->commands[i].command == command &&
+		    replay->commands[i].direction == direction) {
+			entry = &replay->commands[i];
+			break;
+		}
+	}
+
+	if (entry == NULL) {
+		if (replay->commands_count == replay->commands_size) {
+			replay->commands_size = replay->commands_size ?
+				replay->commands_size * 2 : 32;
+			p = realloc(replay->commands, replay->commands_size *
+				    sizeof(struct replay_command));
+			if (p == NULL)
+				return -1;
+
+			replay->commands = p;
+		}
+
+		entry = &replay->commands[replay->commands_count++];
+		memset(entry, 0, sizeof(struct replay_command));
+		entry->command = command;
+		entry->direction = direction;
+	}
+
+	entry->count++;
+	entry->time_total += time;
+	if (time > entry->time_max)
+		entry->time_max = time;
+
+	return 0;
+}
+
+static struct replay_client *replay_client_get(struct replay *replay,
+					       unsigned char type)
+{
+	struct replay_client *client = &replay->clients[type];
+	int flags;
+
+	if (client->client != NULL)
+		return client;
+
+	client->client = ipc_client_create(type);
+	if (client->client == NULL) {
+		printf("Creating client failed\n");
+		return NULL;
+	}
+
+	if (replay->verbose)
+		ipc_client_log_callback_register(client->client, log_callback,
+						 NULL);
+
+	client->fd = ipc_client_loopback_open(client->client);
+	if (client->fd < 0) {
+		printf("Opening loopback failed\n");
+		goto error;
+	}
+
+	/* Both sides are non-blocking, so that neither can stall the other */
+	flags = fcntl(client->fd, F_GETFL);
+	if (flags < 0 || fcntl(client->fd, F_SETFL, flags | O_NONBLOCK) < 0)
+		goto error;
+
+	if (ipc_client_output_enable(client->client, 0, NULL, NULL) < 0)
+		goto error;
+
+	if (replay->stats && ipc_client_stats_enable(client->client) < 0)
+		goto error;
+
+	return client;
+
+error:
+	if (client->fd >= 0)
+		close(client->fd);
+
+	ipc_client_destroy(client->client);
+	client->client = NULL;
+
+	return NULL;
+}
+
+static void replay_clients_destroy(struct replay *replay)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(replay->clients) / sizeof(replay->clients[0]);
+	     i++) {
+		if (replay->clients[i].client == NULL)
+			continue;
+
+		close(replay->clients[i].fd);
+		ipc_client_destroy(replay->clients[i].client);
+		replay->clients[i].client = NULL;
+	}
+}
+
+/* Plays the modem: the frame is written while the client reads it */
+static int replay_recv(struct replay_client *client, const void *frame,
+		       size_t size, struct ipc_message *message)
+{
+	const unsigned char *p = frame;
+	struct timespec deadline;
+	bool received = false;
+	size_t count = 0;
+	ssize_t rc;
+
+	while (count < size) {
+		rc = write(client->fd, p + count, size - count);
+		if (rc > 0) {
+			count += rc;
+			continue;
+		} else if (rc < 0 && errno != EAGAIN && errno != EINTR) {
+			return -1;
+		}
+
+		if (received)
+			return -1;
+
+		ipc_client_deadline_set(&deadline, 0);
+		rc = ipc_client_recv_deadline(client->client, message,
+					      &deadline);
+		if (rc < 0)
+			return -1;
+		else if (rc == 0)
+			received = true;
+	}
+
+	if (received)
+		return 0;
+
+	rc = ipc_client_recv_deadline(client->client, message, NULL);
+	if (rc != 0)
+		return -1;
+
+	return 0;
+}
+
+/* Plays the modem: the frame is read while the client writes it */
+static int replay_send(struct replay_client *client,
+		       const struct ipc_message *message, size_t size)
+{
+	unsigned char buffer[4096];
+	struct pollfd pollfd;
+	size_t count = 0;
+	ssize_t rc;
+
+	rc = ipc_client_send(client->client, message->mseq, message->command,
+			     message->type, message->data, message->size);
+	if (rc < 0)
+		return -1;
+
+	while (count < size) {
+		if (ipc_client_output_flush(client->client) < 0)
+			return -1;
+
+		pollfd.fd = client->fd;
+		pollfd.events = POLLIN;
+
+		rc = poll(&pollfd, 1, -1);
+		if (rc < 0 && errno != EINTR)
+			return -1;
+
+		rc = read(client->fd, buffer, sizeof(buffer));
+		if (rc == 0)
+			return -1;
+		else if (rc < 0 && errno != EAGAIN && errno != EINTR)
+			return -1;
+		else if (rc > 0)
+			count += rc;
+	}
+
+	return count == size ? 0 : -1;
+}
+
+static int replay_record(struct replay *replay,
+			 const struct ipc_capture_record *record,
+			 void *frame)
+{
+	struct replay_client *client;
+	struct ipc_message message;
+	struct timespec start;
+	unsigned char *data;
+	size_t size;
+	int rc;
+
+	client = replay_client_get(replay, record->client_type);
+	if (client == NULL)
+		return -1;
+
+	memset(&message, 0, sizeof(message));
+
+	if (record->client_type == IPC_CLIENT_TYPE_FMT)
+		ipc_fmt_message_setup(frame, &message);
+	else
+		ipc_rfs_message_setup(frame, &message);
+
+	data = (unsigned char *) frame + record->header_size;
+	size = record->header_size + record->data_size;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	if (record->direction == IPC_CAPTURE_DIRECTION_SEND) {
+		message.data = record->data_size > 0 ? data : NULL;
+		message.size = record->data_size;
+
+		rc = replay_send(client, &message, size);
+	} else {
+		message.data = NULL;
+		message.size = 0;
+
+		rc = replay_recv(client, frame, size, &message);
+		if (message.data != NULL)
+			free(message.data);
+	}
+
+	if (rc < 0) {
+		printf("Replaying %s %s failed\n",
+		       record->direction == IPC_CAPTURE_DIRECTION_SEND ?
+		       "sent" : "received", ipc_command_string(message.command));
+		return -1;
+	}
+
+	replay->messages++;
+	replay->bytes += size;
+
+	return replay_command_add(replay, record->direction, message.command,
+				  time_us(&start));
+}
+
+static int replay_record_check(const struct ipc_capture_record *record)
+{
+	if (record->direction != IPC_CAPTURE_DIRECTION_SEND &&
+	    record->direction != IPC_CAPTURE_DIRECTION_RECV)
+		return -1;
+
+	if (record->data_size > RECORD_DATA_SIZE_MAX)
+		return -1;
+
+	switch (record->client_type) {
+	case IPC_CLIENT_TYPE_FMT:
+		if (record->header_size != sizeof(struct ipc_fmt_header))
+			return -1;
+		break;
+	case IPC_CLIENT_TYPE_RFS:
+		if (record->header_size != sizeof(struct ipc_rfs_header))
+			return -1;
+		break;
+	default:
+		return -1;
+	}
+
+	return 0;
+}
+
+/* The frame is delivered as it is, so its header must match the record */
+static int replay_frame_check(const struct ipc_capture_record *record,
+			      const void *frame)
+{
+	size_t size = record->header_size + record->data_size;
+
+	switch (record->client_type) {
+	case IPC_CLIENT_TYPE_FMT:
+		if (((const struct ipc_fmt_header *) frame)->length != size)
+			return -1;
+		break;
+	case IPC_CLIENT_TYPE_RFS:
+		if (((const struct ipc_rfs_header *) frame)->length != size)
+			return -1;
+		break;
+	default:
+		return -1;
+	}
+
+	return 0;
+}
+
+static int replay_command_compare(const void *a, const void *b)
+{
+	const struct replay_command *command_a = a;
+	const struct replay_command *command_b = b;
+
+	if (command_a->time_total > command_b->time_total)
+		return -1;
+	else if (command_a->time_total < command_b->time_total)
+		return 1;
+
+	return 0;
+}
+
+static void replay_report(struct replay *replay, unsigned long long elapsed)
+{
+	struct replay_command *command;
+	double seconds;
+	size_t i;
+
+	seconds = elapsed > 0 ? elapsed / 1000000.0 : 1e-6;
+
+	printf("Replayed %lu messages (%llu bytes) in %.3f s: "
+	       "%.0f messages/s, %.0f bytes/s\n", replay->messages,
+	       replay->bytes, seconds, replay->messages / seconds,
+	       replay->bytes / seconds);
+
+	if (replay->commands_count == 0)
+		return;
+
+	qsort(replay->commands, replay->commands_count,
+	      sizeof(struct replay_command), replay_command_compare);
+
+	printf("\n");
+	printf("direction\tcommand\tcount\tavg_us\tmax_us\n");
+
+	for (i = 0; i < replay->commands_count; i++) {
+		command = &replay->commands[i];
+
+		printf("%s\t%s\t%lu\t%.1f\t%llu\n",
+		       command->direction == IPC_CAPTURE_DIRECTION_SEND ?
+		       "send" : "recv", ipc_command_string(command->command),
+		       command->count,
+		       (double) command->time_total / command->count,
+		       command->time_max);
+	}
+}
+
+static void replay_histogram_print(struct ipc_client *client,
+				   unsigned short command)
+{
+	unsigned int buckets[IPC_CLIENT_STATS_BUCKETS];
+	unsigned int i;
+
+	if (ipc_client_stats_histogram_get(client, command, buckets) < 0)
+		return;
+
+	for (i = 0; i < IPC_CLIENT_STATS_BUCKETS; i++) {
+		if (buckets[i] == 0)
+			continue;
+
+		printf("\t<= %llu us\t%u\n", ipc_client_stats_bucket_value(i),
+		       buckets[i]);
+	}
+}
+
+static void replay_stats_report(struct replay *replay)
+{
+	struct ipc_client_stats stats[IPC_CLIENT_STATS_COMMANDS];
+	struct ipc_client *client;
+	unsigned int i;
+	int count;
+	int j;
+
+	printf("\n");
+	printf("client\tcommand\tcount\tunanswered\tmin_us\tp50_us\t"
+	       "p90_us\tp99_us\tmax_us\n");
+
+	for (i = 0; i < sizeof(replay->clients) / sizeof(replay->clients[0]);
+	     i++) {
+		client = replay->clients[i].client;
+		if (client == NULL)
+			continue;
+
+		count = ipc_client_stats_get(client, stats,
+					     IPC_CLIENT_STATS_COMMANDS);
+		if (count < 0)
+			continue;
+
+		for (j = 0; j < count; j++) {
+			printf("%s\t%s\t%lu\t%lu\t%llu\t%llu\t%llu\t%llu\t"
+			       "%llu\n", ipc_client_type_string(i),
+			       ipc_command_string(stats[j].command),
+			       stats[j].count, stats[j].unanswered,
+			       stats[j].min, stats[j].p50, stats[j].p90,
+			       stats[j].p99, stats[j].max);
+
+			if (replay->histograms)
+				replay_histogram_print(client,
+						       stats[j].command);
+		}
+
+		if (ipc_client_stats_dropped_get(client) > 0) {
+			printf("%s\t%lu responses of other commands\n",
+			       ipc_client_type_string(i),
+			       ipc_client_stats_dropped_get(client));
+		}
+	}
+}
+
+static int replay_file(struct replay *replay, FILE *file)
+{
+	struct ipc_capture_header header;
+	struct ipc_capture_record record;
+	unsigned long long first = 0;
+	struct timespec start;
+	void *buffer = NULL;
+	size_t buffer_size = 0;
+	size_t count;
+	size_t size;
+	void *p;
+	int rc;
+
+	if (fread(&header, sizeof(header), 1, file) != 1 ||
+	    memcmp(header.magic, IPC_CAPTURE_MAGIC, sizeof(header.magic)) ||
+	    header.version != IPC_CAPTURE_VERSION) {
+		printf("Not a version %d capture file\n", IPC_CAPTURE_VERSION);
+		return EX_DATAERR;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (1) {
+		count = fread(&record, 1, sizeof(record), file);
+		if (count == 0 && !ferror(file))
+			break;
+
+		if (count != sizeof(record)) {
+			printf("Truncated record after %lu messages\n",
+			       replay->messages);
+			rc = EX_DATAERR;
+			goto complete;
+		}
+
+		if (replay_record_check(&record) < 0) {
+			printf("Invalid record after %lu messages\n",
+			       replay->messages);
+			rc = EX_DATAERR;
+			goto complete;
+		}
+
+		size = record.header_size + record.data_size;
+		if (size > buffer_size) {
+			p = realloc(buffer, size);
+			if (p == NULL) {
+				rc = EX_OSERR;
+				goto complete;
+			}
+
+			buffer = p;
+			buffer_size = size;
+		}
+
+		if (fread(buffer, size, 1, file) != 1) {
+			printf("Truncated record after %lu messages\n",
+			       replay->messages);
+			rc = EX_DATAERR;
+			goto complete;
+		}
+
+		if (replay_frame_check(&record, buffer) < 0) {
+			printf("Invalid frame length after %lu messages\n",
+			       replay->messages);
+			rc = EX_DATAERR;
+			goto complete;
+		}
+
+		/* Creating the client mustn't delay the record */
+		if (replay_client_get(replay, record.client_type) == NULL) {
+			rc = EX_SOFTWARE;
+			goto complete;
+		}
+
+		/* The pacing starts with the first record */
+		if (replay->messages == 0)
+			first = record.timestamp;
+
+		if (!replay->fast && record.timestamp > first)
+			time_wait(&start, record.timestamp - first);
+
+		rc = replay_record(replay, &record, buffer);
+		if (rc < 0) {
+			rc = EX_SOFTWARE;
+			goto complete;
+		}
+	}
+
+	replay_report(replay, time_us(&start));
+
+	rc = 0;
+
+complete:
+	if (buffer != NULL)
+		free(buffer);
+
+	return rc;
+}
+
+int main(int argc, char *argv[])
+{
+	struct replay replay;
+	FILE *file;
+	int c, rc;
+
+	memset(&replay, 0, sizeof(replay));
+
+	while (1) {
+		static struct option long_options[] = {
+			{"help", no_argument, 0, 'h' },
+			{"fast", no_argument, 0, 'f' },
+			{"stats", no_argument, 0, 's' },
+			{"histograms", no_argument, 0, 'H' },
+			{"verbose", no_argument, 0, 'v' },
+			{0, 0, 0, 0 }
+		};
+
+		c = getopt_long(argc, argv, "hfsHv", long_options, NULL);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			usage_print();
+			return 0;
+		case 'f':
+			replay.fast = true;
+			break;
+		case 's':
+			replay.stats = true;
+			break;
+		case 'H':
+			replay.stats = true;
+			replay.histograms = true;
+			break;
+		case 'v':
+			replay.verbose = true;
+			break;
+		default:
+			usage_print();
+			return EX_USAGE;
+		}
+	}
+
+	if (optind != argc - 1) {
+		usage_print();
+		return EX_USAGE;
+	}
+
+	file = fopen(argv[optind], "rb");
+	if (file == NULL) {
+		printf("Opening %s failed: %s\n", argv[optind],
+		       strerror(errno));
+		return EX_NOINPUT;
+	}
+
+	rc = replay_file(&replay, file);
+	if (rc == 0 && replay.stats)
+		replay_stats_report(&replay);
+
+	replay_clients_destroy(&replay);
+
+	if (replay.commands != NULL)
+		free(replay.commands);
+
+	fclose(file);
+
+	return rc;
+}
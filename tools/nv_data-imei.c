@@ -32,6 +32,10 @@
 #include <sysexits.h>
 #include <unistd.h>
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
 #include <samsung-ipc.h>
 
 #include "../samsung-ipc/modems/xmm616/xmm616.h"
@@ -242,6 +246,20 @@ static struct command_option commands_options[] = {
 		"--imei=355921041234567",
 		get_imei,
 	},
+	{
+		OPTION_JOBS,
+		"-j JOBS|--jobs=JOBS",
+		"Scan the files with JOBS threads",
+		"--jobs=4",
+		NULL,
+	},
+	{
+		OPTION_FILES,
+		"",
+		"",
+		"./nv_data.bin ./efs_backup_copy/nv_data.bin",
+		NULL,
+	},
 	{ /* Sentinel */ },
 };
 
@@ -274,6 +292,13 @@ static struct command commands[] = {
 		OPTION_FILE|OPTION_IMEI,
 		bruteforce_imei_offset,
 	},
+	{
+		"scan-imei",
+		"Find the offsets of one or more IMEIs in several nv_data files",
+		OPTION_IMEI|OPTION_JOBS|OPTION_FILES,
+		OPTION_IMEI|OPTION_FILES,
+		scan_imei,
+	},
 	{ /* Sentinel */ },
 };
 
@@ -396,6 +421,7 @@ static int nv_data_imei_help(void)
 
 	printf("Usage:\n");
 	printf("\tnv_data-imei FILE COMMAND [OPTIONS]\n");
+	printf("\tnv_data-imei scan-imei [OPTIONS] FILE...\n");
 	printf("\tnv_data-imei COMMAND -h|--help "
 		"# Display the command specific help message\n");
 
@@ -480,6 +506,9 @@ static int command_help(const char *command_name)
 		}
 	}
 
+	if (command->options & OPTION_FILES)
+		printf(" FILE...");
+
 	printf("\n");
 
 	if (command->options) {
@@ -668,8 +697,13 @@ int bruteforce_imei_offset(char *nv_data_path, struct imei *given_imei)
 	do {
 		ptr = memchr(ptr, given_imei_buffer[0], search_size);
 		if (ptr) {
-			if (!strncmp((void*)given_imei_buffer, ptr,
-				     sizeof(given_imei_buffer))) {
+			/* The encoded IMEI can contain NUL bytes, so strncmp
+			 * would stop comparing too early.
+			 */
+			if (ptr - buffer + sizeof(given_imei_buffer) <=
+			    file_size &&
+			    !memcmp(given_imei_buffer, ptr,
+				    sizeof(given_imei_buffer))) {
 				ipc_client_log(client,
 					       "=> Found IMEI at 0x%x (%d)",
 					       (ptr - buffer),
@@ -681,8 +715,8 @@ int bruteforce_imei_offset(char *nv_data_path, struct imei *given_imei)
 			 * it just in case we find the IMEI at a second
 			 * location too.
 			 */
+			ptr++;
 			search_size = file_size - (ptr - buffer);
-			ptr ++;
 		}
 	} while (ptr);
 
@@ -700,6 +734,339 @@ error:
 	return rc;
 }
 
+/* Non-zero if any of the bytes of word is zero. Bytes above a real zero byte
+ * can be reported as well, which is fine as the candidates are all checked
+ * again afterward.
+ */
+static inline uint64_t word_has_zero_byte(uint64_t word)
+{
+	return (word - 0x0101010101010101ULL) & ~word & 0x8080808080808080ULL;
+}
+
+static int scan_imei_add(struct scan_imei *scan, const char *imei_string)
+{
+	struct command *command;
+	struct imei *imei;
+	unsigned char buffer[(IMEI_LENGTH + 1) / 2] = { 0 };
+	int rc;
+
+	if (scan->count == SCAN_IMEI_MAX) {
+		printf("Too many IMEIs: at most %d can be searched at once\n",
+		       SCAN_IMEI_MAX);
+		return -EINVAL;
+	}
+
+	command = get_command("scan-imei");
+	imei = &scan->imeis[scan->count];
+	imei->optarg = (char *)imei_string;
+	imei->option_set = true;
+
+	rc = get_imei(command, imei);
+	if (rc)
+		return rc;
+
+	rc = encode_imei(buffer, imei);
+	if (rc < 0)
+		return rc;
+
+	memcpy(&scan->patterns[scan->count], buffer, sizeof(buffer));
+
+	if (!scan->first_bytes[buffer[0]]) {
+		scan->first_bytes[buffer[0]] = true;
+		scan->first_words[scan->first_words_count++] =
+			0x0101010101010101ULL * buffer[0];
+	}
+
+	scan->count++;
+
+	return 0;
+}
+
+static void scan_imei_print(const char *path, const char *status,
+			    const char *imei, size_t offset)
+{
+	if (imei)
+		printf("%s\t%s\t%s\t0x%zx\n", path, status, imei, offset);
+	else
+		printf("%s\t%s\t-\t-\n", path, status);
+}
+
+/* The file is mapped and read one 64-bit word at a time: words that don't
+ * contain the first byte of any of the encoded IMEIs are skipped without
+ * looking at their individual bytes. This keeps the search portable across
+ * the architectures the tool runs on while avoiding the per-byte cost for
+ * most of the file.
+ */
+static int scan_imei_file(struct scan_imei *scan, const char *path)
+{
+	const unsigned char *data = NULL;
+	size_t *offsets = NULL;
+	size_t *imei_indexes = NULL;
+	size_t *resized;
+	size_t matches_count = 0;
+	size_t matches_size = 0;
+	struct stat st;
+	size_t size = 0;
+	uint64_t word;
+	size_t i, j, k;
+	bool candidate;
+	int fd = -1;
+	int rc;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		rc = errno;
+		goto error;
+	}
+
+	rc = fstat(fd, &st);
+	if (rc < 0) {
+		rc = errno;
+		goto error;
+	}
+
+	size = st.st_size;
+	if (size < sizeof(word))
+		goto complete;
+
+	data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED) {
+		data = NULL;
+		rc = errno;
+		goto error;
+	}
+
+	madvise((void *)data, size, MADV_SEQUENTIAL);
+
+	for (i = 0; i + sizeof(word) <= size; i += sizeof(word)) {
+		memcpy(&word, data + i, sizeof(word));
+
+		candidate = false;
+		for (k = 0; k < scan->first_words_count; k++) {
+			if (word_has_zero_byte(word ^ scan->first_words[k])) {
+				candidate = true;
+				break;
+			}
+		}
+
+		if (!candidate)
+			continue;
+
+		for (j = i; j < i + sizeof(word); j++) {
+			/* The IMEI would end after the end of the file */
+			if (j + sizeof(word) > size)
+				break;
+
+			if (!scan->first_bytes[data[j]])
+				continue;
+
+			memcpy(&word, data + j, sizeof(word));
+
+			for (k = 0; k < scan->count; k++) {
+				if (word != scan->patterns[k])
+					continue;
+
+				if (matches_count == matches_size) {
+					matches_size = matches_size ?
+						matches_size * 2 : 4;
+
+					/* Keep the old arrays to free them */
+					resized = realloc(offsets,
+							  matches_size *
+							  sizeof(size_t));
+					if (!resized) {
+						rc = ENOMEM;
+						goto error;
+					}
+					offsets = resized;
+
+					resized = realloc(imei_indexes,
+							  matches_size *
+							  sizeof(size_t));
+					if (!resized) {
+						rc = ENOMEM;
+						goto error;
+					}
+					imei_indexes = resized;
+				}
+
+				offsets[matches_count] = j;
+				imei_indexes[matches_count] = k;
+				matches_count++;
+			}
+		}
+	}
+
+complete:
+	/* Keep all the lines of a given file together */
+	flockfile(stdout);
+
+	for (i = 0; i < matches_count; i++)
+		scan_imei_print(path, "found",
+				scan->imeis[imei_indexes[i]].imei, offsets[i]);
+
+	if (!matches_count)
+		scan_imei_print(path, "not-found", NULL, 0);
+
+	funlockfile(stdout);
+
+	rc = 0;
+	goto cleanup;
+
+error:
+	flockfile(stdout);
+	printf("%s\terror\t-\t%s\n", path, strerror(rc));
+	funlockfile(stdout);
+
+cleanup:
+	if (offsets)
+		free(offsets);
+
+	if (imei_indexes)
+		free(imei_indexes);
+
+	if (data)
+		munmap((void *)data, size);
+
+	if (fd >= 0)
+		close(fd);
+
+	return rc;
+}
+
+static void *scan_imei_worker(void *arg)
+{
+	struct scan_job *job = arg;
+	const char *path;
+	int rc;
+
+	while (true) {
+		pthread_mutex_lock(&job->mutex);
+
+		if (job->next == job->count) {
+			pthread_mutex_unlock(&job->mutex);
+			break;
+		}
+
+		path = job->paths[job->next++];
+
+		pthread_mutex_unlock(&job->mutex);
+
+		rc = scan_imei_file(job->scan, path);
+		if (rc) {
+			pthread_mutex_lock(&job->mutex);
+			job->rc = rc;
+			pthread_mutex_unlock(&job->mutex);
+		}
+	}
+
+	return NULL;
+}
+
+int scan_imei(int argc, char * const argv[])
+{
+	pthread_t threads[SCAN_JOBS_MAX];
+	size_t threads_count = 0;
+	struct scan_imei scan;
+	struct scan_job job;
+	unsigned long jobs = 0;
+	char *end;
+	size_t i;
+	long cpus;
+	int c, rc;
+
+	memset(&scan, 0, sizeof(scan));
+	memset(&job, 0, sizeof(job));
+
+	optind = 1;
+
+	while (1) {
+		static struct option long_options[] = {
+			{"help", no_argument, 0, 'h' },
+			{"imei", required_argument, 0, 'i' },
+			{"jobs", required_argument, 0, 'j' },
+			{0, 0, 0, 0 }
+		};
+
+		c = getopt_long(argc, argv, "hi:j:", long_options, NULL);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			return command_help(argv[0]);
+		case 'i':
+			rc = scan_imei_add(&scan, optarg);
+			if (rc)
+				return EX_USAGE;
+			break;
+		case 'j':
+			errno = 0;
+			jobs = strtoul(optarg, &end, 0);
+			if (errno || *end != '\0' || jobs == 0 ||
+			    jobs > SCAN_JOBS_MAX) {
+				printf("Error: The '%s' number of jobs is"
+				       " invalid, it must be between 1 and %d."
+				       "\n", optarg, SCAN_JOBS_MAX);
+				return EX_USAGE;
+			}
+			break;
+		default:
+			printf("Unknown option '%s'.\n", argv[optind - 1]);
+			printf("Try nv_data-imei %s -h to print the help.\n",
+			       argv[0]);
+			return EX_USAGE;
+		}
+	}
+
+	if (!scan.count) {
+		printf("IMEI option required\n");
+		printf("See nv_data-imei %s -h for more details.\n", argv[0]);
+		return EX_USAGE;
+	}
+
+	if (optind == argc) {
+		printf("Error: the '%s' command needs at least one FILE"
+		       " argument.\n", argv[0]);
+		printf("See 'nv_data-imei %s -h' for more details.\n", argv[0]);
+		return EX_USAGE;
+	}
+
+	job.scan = &scan;
+	job.paths = &argv[optind];
+	job.count = argc - optind;
+	pthread_mutex_init(&job.mutex, NULL);
+
+	if (!jobs) {
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		jobs = cpus > 0 ? (unsigned long)cpus : 1;
+		if (jobs > SCAN_JOBS_MAX)
+			jobs = SCAN_JOBS_MAX;
+	}
+
+	if (jobs > job.count)
+		jobs = job.count;
+
+	/* The main thread is also one of the workers */
+	for (i = 1; i < jobs; i++) {
+		rc = pthread_create(&threads[threads_count], NULL,
+				    scan_imei_worker, &job);
+		if (rc)
+			break;
+
+		threads_count++;
+	}
+
+	scan_imei_worker(&job);
+
+	for (i = 0; i < threads_count; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_mutex_destroy(&job.mutex);
+
+	return job.rc ? EX_NOINPUT : EX_OK;
+}
+
 int read_imei(char *nv_data_path, struct offset *offset)
 {
 	struct ipc_client *client = NULL;
@@ -857,6 +1224,10 @@ int main(int argc, char * const argv[])
 		return EX_USAGE;
 	}
 
+	/* nv_data-imei scan-imei [OPTIONS] FILE... */
+	if (!strcmp(argv[1], "scan-imei"))
+		return scan_imei(argc - 1, argv + 1);
+
 	while (1) {
 		static struct option long_options[] = {
 			{"help", no_argument, 0, 'h' },
@@ -920,6 +1291,17 @@ int main(int argc, char * const argv[])
 					       " to print the help.\n");
 					return EX_USAGE;
 				}
+				/* nv_data-imei FILE scan-imei [...] */
+				if (command->options & OPTION_FILES) {
+					printf("The '%s' command takes its FILE"
+					       " arguments after the command\n",
+					       argv[optind - 1]);
+					printf("Try nv_data-imei %s --help to"
+					       " print the %s command help.\n",
+					       argv[optind - 1],
+					       argv[optind - 1]);
+					return EX_USAGE;
+				}
 				/* Some commands don't take arguments nor files.
 				 * The help command is already handled but some
 				 * other command like list-supported need to be
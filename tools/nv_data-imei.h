@@ -20,6 +20,7 @@
 #ifndef NV_DATA_IMEI_H
 #define NV_DATA_IMEI_H
 
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
@@ -74,8 +75,37 @@ struct command_option {
 #define OPTION_HELP	BIT(1)
 #define OPTION_IMEI	BIT(2)
 #define OPTION_OFFSET	BIT(3)
+#define OPTION_JOBS	BIT(4)
+#define OPTION_FILES	BIT(5)
+
+/* Limits of the scan-imei batch command */
+#define SCAN_IMEI_MAX	16
+#define SCAN_JOBS_MAX	64
+
+/* The encoded IMEIs are (IMEI_LENGTH + 1) / 2 = 8 bytes long, so each of them
+ * fits in an uint64_t and can be compared in a single operation.
+ */
+struct scan_imei {
+	struct imei imeis[SCAN_IMEI_MAX];
+	uint64_t patterns[SCAN_IMEI_MAX];
+	size_t count;
+	/* First encoded byte of the patterns, repeated in every byte */
+	uint64_t first_words[SCAN_IMEI_MAX];
+	size_t first_words_count;
+	bool first_bytes[256];
+};
+
+struct scan_job {
+	struct scan_imei *scan;
+	char * const *paths;
+	size_t count;
+	size_t next;
+	int rc;
+	pthread_mutex_t mutex;
+};
 
 int bruteforce_imei_offset(char *nv_data_path, struct imei *given_imei);
+int scan_imei(int argc, char * const argv[]);
 int read_imei(char *nv_data_path, struct offset *offset);
 int write_imei(char *nv_data_path, struct offset *offset, struct imei *imei);
 
@@ -38,6 +38,7 @@ commands = [
     "read-imei",
     "write-imei",
     "bruteforce-imei",
+    "scan-imei",
 ]
 
 def get_output(data):
@@ -97,6 +98,22 @@ class NvDataImei(object):
         if not re.search(expect, output):
             raise Exception()
 
+        other_imei = "355921041234567"
+        empty_nv_data_bin = get_output(sh.mktemp())
+        sh.ddrescue("/dev/zero", empty_nv_data_bin, "-s",
+                    str(XMM616_NV_DATA_SIZE))
+        output = str(self.nv_data_imei("scan-imei", "-i", other_imei,
+                                       "-i", valid_imei, "-j", "2",
+                                       nv_data_bin, empty_nv_data_bin))
+        print(output)
+        expect = "{}\tfound\t{}\t{}".format(nv_data_bin, valid_imei,
+                                             str(hex(offset)))
+        if expect not in output.split(os.linesep):
+            raise Exception()
+        expect = "{}\tnot-found\t-\t-".format(empty_nv_data_bin)
+        if expect not in output.split(os.linesep):
+            raise Exception()
+
         inaccessible_nv_data_bin = str(sh.mktemp("-u")).replace(os.linesep,"")
         sh.ddrescue("/dev/zero", inaccessible_nv_data_bin, "-s",
                     str(XMM616_NV_DATA_SIZE))
@@ -113,6 +130,14 @@ class NvDataImei(object):
         else:
             raise Exception()
 
+        try:
+            self.nv_data_imei("scan-imei", "-i", valid_imei, nv_data_bin,
+                              inaccessible_nv_data_bin)
+        except SysExit.EX_NOINPUT:
+            pass
+        else:
+            raise Exception()
+
 def main():
     nv_data_imei = NvDataImei()
     nv_data_imei.test_help()
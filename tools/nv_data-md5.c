@@ -17,18 +17,72 @@
  * along with libsamsung-ipc.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
 
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 
 #include <samsung-ipc.h>
 
+#define MD5_STRING_LENGTH	32
+#define JOBS_MAX		64
+
+enum verify_status {
+	VERIFY_OK,
+	VERIFY_BAD,
+	VERIFY_MISSING,
+	VERIFY_REPAIRED,
+	VERIFY_ERROR,
+	VERIFY_STATUS_COUNT,
+};
+
+static const char * const verify_status_strings[] = {
+	"ok",
+	"bad",
+	"missing",
+	"repaired",
+	"error",
+};
+
+struct verify_job {
+	char **paths;
+	size_t count;
+	size_t next;
+	bool repair;
+	size_t statuses[VERIFY_STATUS_COUNT];
+	unsigned long long bytes;
+	pthread_mutex_t mutex;
+};
+
+/* Filled by nftw, which has no user data argument */
+static char **paths;
+static size_t paths_count;
+static size_t paths_size;
+
 void usage_print(void)
 {
 	printf("Usage: nv_data-md5 [nv_data.bin]\n");
+	printf("       nv_data-md5 verify [-r|--repair] [-j JOBS|--jobs=JOBS]"
+	       " PATH...\n");
+	printf("\n");
+	printf("The verify command checks the nv_data.bin.md5 file of each\n");
+	printf("given nv_data.bin file. Directories are searched recursively\n");
+	printf("for files of %d bytes. With --repair the .md5 files that are\n",
+	       NV_DATA_SIZE);
+	printf("wrong or missing are rewritten.\n");
 }
 
 void log_callback(__attribute__((unused)) void *data,
@@ -56,6 +110,402 @@ void log_callback(__attribute__((unused)) void *data,
 	free(buffer);
 }
 
+static int paths_add(const char *path)
+{
+	char **p;
+
+	if (paths_count == paths_size) {
+		paths_size = paths_size ? paths_size * 2 : 16;
+		p = realloc(paths, paths_size * sizeof(char *));
+		if (p == NULL)
+			return -1;
+
+		paths = p;
+	}
+
+	paths[paths_count] = strdup(path);
+	if (paths[paths_count] == NULL)
+		return -1;
+
+	paths_count++;
+
+	return 0;
+}
+
+static int paths_walk(const char *path, const struct stat *st, int type,
+		      __attribute__((unused)) struct FTW *ftw)
+{
+	if (type != FTW_F || !S_ISREG(st->st_mode))
+		return 0;
+
+	/* An empty file is reported like a truncated nv_data.bin would be */
+	if (st->st_size != 0 && st->st_size != NV_DATA_SIZE)
+		return 0;
+
+	return paths_add(path);
+}
+
+static int md5_file_read(const char *md5_path, char *md5_string)
+{
+	ssize_t count;
+	char buffer[MD5_STRING_LENGTH + 1];
+	int fd;
+
+	fd = open(md5_path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	count = read(fd, buffer, sizeof(buffer));
+	close(fd);
+
+	/* A longer file is wrong as well */
+	if (count != MD5_STRING_LENGTH) {
+		memset(md5_string, 0, MD5_STRING_LENGTH + 1);
+		return 0;
+	}
+
+	memcpy(md5_string, buffer, MD5_STRING_LENGTH);
+	md5_string[MD5_STRING_LENGTH] = '\0';
+
+	return 0;
+}
+
+static int md5_file_write(const char *md5_path, const char *md5_string)
+{
+	char *tmp_path = NULL;
+	ssize_t count;
+	int fd = -1;
+	int rc = -1;
+
+	rc = asprintf(&tmp_path, "%s.tmp", md5_path);
+	if (rc == -1) {
+		tmp_path = NULL;
+		goto error;
+	}
+
+	fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		goto error;
+
+	count = write(fd, md5_string, MD5_STRING_LENGTH);
+	if (count != MD5_STRING_LENGTH)
+		goto error;
+
+	rc = fsync(fd);
+	if (rc < 0)
+		goto error;
+
+	close(fd);
+	fd = -1;
+
+	/* Never leave a truncated .md5 file behind */
+	rc = rename(tmp_path, md5_path);
+	if (rc < 0)
+		goto error;
+
+	rc = 0;
+	goto complete;
+
+error:
+	rc = -1;
+
+	if (fd >= 0)
+		close(fd);
+
+	if (tmp_path != NULL)
+		unlink(tmp_path);
+
+complete:
+	if (tmp_path != NULL)
+		free(tmp_path);
+
+	return rc;
+}
+
+static enum verify_status verify_file(struct ipc_client *client,
+				      const char *path, bool repair,
+				      char **md5_string)
+{
+	char expected_md5[MD5_STRING_LENGTH + 1];
+	enum verify_status status;
+	char *md5_path = NULL;
+	void *data = MAP_FAILED;
+	struct stat st;
+	int fd = -1;
+	int rc;
+
+	*md5_string = NULL;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		goto error;
+
+	rc = fstat(fd, &st);
+	if (rc < 0)
+		goto error;
+
+	/* An empty file can't be mapped */
+	if (st.st_size == 0) {
+		ipc_client_log(client, "%s: %s is empty", __func__, path);
+		goto error;
+	}
+
+	if (st.st_size != NV_DATA_SIZE) {
+		ipc_client_log(client, "%s: %s is %lld bytes instead of %d",
+			       __func__, path, (long long)st.st_size,
+			       NV_DATA_SIZE);
+		goto error;
+	}
+
+	data = mmap(NULL, NV_DATA_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED)
+		goto error;
+
+	*md5_string = ipc_nv_data_md5_data_calculate(client, data,
+						     NV_DATA_SIZE,
+						     NV_DATA_SECRET);
+	if (*md5_string == NULL)
+		goto error;
+
+	rc = asprintf(&md5_path, "%s.md5", path);
+	if (rc == -1) {
+		md5_path = NULL;
+		goto error;
+	}
+
+	rc = md5_file_read(md5_path, expected_md5);
+	if (rc < 0 && errno != ENOENT)
+		goto error;
+
+	if (rc < 0)
+		status = VERIFY_MISSING;
+	else if (strcmp(expected_md5, *md5_string))
+		status = VERIFY_BAD;
+	else
+		status = VERIFY_OK;
+
+	if (status != VERIFY_OK && repair) {
+		rc = md5_file_write(md5_path, *md5_string);
+		if (rc < 0) {
+			ipc_client_log(client, "%s: Writing %s failed: %s",
+				       __func__, md5_path, strerror(errno));
+			goto error;
+		}
+
+		status = VERIFY_REPAIRED;
+	}
+
+	goto complete;
+
+error:
+	status = VERIFY_ERROR;
+
+complete:
+	if (md5_path != NULL)
+		free(md5_path);
+
+	if (data != MAP_FAILED)
+		munmap(data, NV_DATA_SIZE);
+
+	if (fd >= 0)
+		close(fd);
+
+	return status;
+}
+
+static void *verify_worker(void *arg)
+{
+	struct verify_job *job = arg;
+	struct ipc_client *client;
+	enum verify_status status;
+	char *md5_string;
+	const char *path;
+
+	client = ipc_client_create(IPC_CLIENT_TYPE_DUMMY);
+	if (client == NULL) {
+		flockfile(stdout);
+		printf("Creating client failed\n");
+		funlockfile(stdout);
+		return NULL;
+	}
+
+	ipc_client_log_callback_register(client, log_callback, NULL);
+
+	while (true) {
+		pthread_mutex_lock(&job->mutex);
+
+		if (job->next == job->count) {
+			pthread_mutex_unlock(&job->mutex);
+			break;
+		}
+
+		path = job->paths[job->next++];
+
+		pthread_mutex_unlock(&job->mutex);
+
+		status = verify_file(client, path, job->repair, &md5_string);
+
+		flockfile(stdout);
+		printf("%s\t%s\t%s\n", path, verify_status_strings[status],
+		       md5_string != NULL ? md5_string : "-");
+		funlockfile(stdout);
+
+		pthread_mutex_lock(&job->mutex);
+		job->statuses[status]++;
+		if (status != VERIFY_ERROR)
+			job->bytes += NV_DATA_SIZE;
+		pthread_mutex_unlock(&job->mutex);
+
+		if (md5_string != NULL)
+			free(md5_string);
+	}
+
+	ipc_client_destroy(client);
+
+	return NULL;
+}
+
+static int verify(int argc, char *argv[])
+{
+	pthread_t threads[JOBS_MAX];
+	size_t threads_count = 0;
+	struct timespec start, end;
+	struct verify_job job;
+	unsigned long jobs = 0;
+	double seconds;
+	struct stat st;
+	char *endptr;
+	size_t i;
+	long cpus;
+	int c, rc;
+
+	memset(&job, 0, sizeof(job));
+
+	optind = 1;
+
+	while (1) {
+		static struct option long_options[] = {
+			{"help", no_argument, 0, 'h' },
+			{"repair", no_argument, 0, 'r' },
+			{"jobs", required_argument, 0, 'j' },
+			{0, 0, 0, 0 }
+		};
+
+		c = getopt_long(argc, argv, "hrj:", long_options, NULL);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			usage_print();
+			return 0;
+		case 'r':
+			job.repair = true;
+			break;
+		case 'j':
+			errno = 0;
+			jobs = strtoul(optarg, &endptr, 0);
+			if (errno || *endptr != '\0' || jobs == 0 ||
+			    jobs > JOBS_MAX) {
+				printf("Invalid number of jobs '%s': it must be"
+				       " between 1 and %d\n", optarg, JOBS_MAX);
+				return EX_USAGE;
+			}
+			break;
+		default:
+			usage_print();
+			return EX_USAGE;
+		}
+	}
+
+	if (optind == argc) {
+		usage_print();
+		return EX_USAGE;
+	}
+
+	for (i = optind; i < (size_t)argc; i++) {
+		rc = stat(argv[i], &st);
+		if (rc == 0 && S_ISDIR(st.st_mode))
+			rc = nftw(argv[i], paths_walk, 16, FTW_PHYS);
+		else
+			rc = paths_add(argv[i]);
+
+		if (rc) {
+			printf("Listing %s failed\n", argv[i]);
+			return EX_NOINPUT;
+		}
+	}
+
+	if (paths_count == 0) {
+		printf("No nv_data file found\n");
+		return EX_NOINPUT;
+	}
+
+	job.paths = paths;
+	job.count = paths_count;
+	pthread_mutex_init(&job.mutex, NULL);
+
+	if (!jobs) {
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		jobs = cpus > 0 ? (unsigned long)cpus : 1;
+		if (jobs > JOBS_MAX)
+			jobs = JOBS_MAX;
+	}
+
+	if (jobs > job.count)
+		jobs = job.count;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	/* The main thread is also one of the workers */
+	for (i = 1; i < jobs; i++) {
+		rc = pthread_create(&threads[threads_count], NULL,
+				    verify_worker, &job);
+		if (rc)
+			break;
+
+		threads_count++;
+	}
+
+	verify_worker(&job);
+
+	for (i = 0; i < threads_count; i++)
+		pthread_join(threads[i], NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	pthread_mutex_destroy(&job.mutex);
+
+	seconds = (end.tv_sec - start.tv_sec) +
+		(end.tv_nsec - start.tv_nsec) / 1e9;
+
+	printf("%zu files: %zu ok, %zu bad, %zu missing, %zu repaired,"
+	       " %zu errors\n", job.count, job.statuses[VERIFY_OK],
+	       job.statuses[VERIFY_BAD], job.statuses[VERIFY_MISSING],
+	       job.statuses[VERIFY_REPAIRED], job.statuses[VERIFY_ERROR]);
+	printf("%llu bytes in %.3f s (%.1f MiB/s)\n", job.bytes, seconds,
+	       seconds > 0 ? job.bytes / seconds / (1024 * 1024) : 0);
+
+	/* The files are left over when every worker failed to start */
+	if (job.next < job.count)
+		printf("%zu files not verified\n", job.count - job.next);
+
+	for (i = 0; i < paths_count; i++)
+		free(paths[i]);
+	free(paths);
+
+	if (job.next < job.count)
+		return EX_OSERR;
+
+	if (job.statuses[VERIFY_ERROR])
+		return EX_NOINPUT;
+
+	if (job.statuses[VERIFY_BAD] || job.statuses[VERIFY_MISSING])
+		return EX_DATAERR;
+
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
 	struct ipc_client *client = NULL;
@@ -71,6 +521,9 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
+	if (!strcmp(argv[1], "verify"))
+		return verify(argc - 1, argv + 1);
+
 	path = argv[1];
 
 	client = ipc_client_create(IPC_CLIENT_TYPE_DUMMY);
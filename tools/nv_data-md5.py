@@ -60,6 +60,56 @@ class NvDataMD5(object):
         if output != expected_md5:
             raise Exception()
 
+        # Verify and repair the .md5 files of a directory
+        nv_data_dir = get_output(sh.mktemp("-d"))
+        for name in ["good", "bad"]:
+            sh.cp(nv_data_bin, nv_data_dir + os.sep + name + ".bin")
+        with open(nv_data_dir + os.sep + "good.bin.md5", "w") as f:
+            f.write(expected_md5)
+        with open(nv_data_dir + os.sep + "bad.bin.md5", "w") as f:
+            f.write("0" * len(expected_md5))
+
+        try:
+            self.nv_data_md5("verify", nv_data_dir)
+        except sh.ErrorReturnCode_65:
+            pass
+        else:
+            raise Exception()
+
+        output = str(self.nv_data_md5("verify", "--repair", "-j", "2",
+                                      nv_data_dir))
+        print(output)
+        for name, status in [("good", "ok"), ("bad", "repaired")]:
+            expect = "{}\t{}\t{}".format(nv_data_dir + os.sep + name + ".bin",
+                                         status, expected_md5)
+            if expect not in output.split(os.linesep):
+                raise Exception()
+
+        self.nv_data_md5("verify", nv_data_dir)
+
+        # An empty file is an error, not a crash
+        empty_bin = get_output(sh.mktemp())
+        try:
+            self.nv_data_md5("verify", empty_bin)
+        except sh.ErrorReturnCode_66 as e:
+            expect = "{}\terror\t-".format(empty_bin)
+            if expect not in e.stdout.decode().split(os.linesep):
+                raise Exception()
+        else:
+            raise Exception()
+
+        # Including when it is found in a directory
+        empty_bin = nv_data_dir + os.sep + "empty.bin"
+        open(empty_bin, "w").close()
+        try:
+            self.nv_data_md5("verify", nv_data_dir)
+        except sh.ErrorReturnCode_66 as e:
+            expect = "{}\terror\t-".format(empty_bin)
+            if expect not in e.stdout.decode().split(os.linesep):
+                raise Exception()
+        else:
+            raise Exception()
+
 def main():
     nv_data_md5 = NvDataMD5()
     nv_data_md5.test_help()